@@ -16,6 +16,7 @@
 
 #import "GoogleDataTransport/GDTCCTLibrary/Private/GDTCCTCompressionHelper.h"
 
+#import <time.h>
 #import <zlib.h>
 
 @implementation GDTCCTCompressionHelper
@@ -28,8 +29,6 @@
   }
 #endif
 
-  enum { kChunkSize = 1024 };
-
   const void *bytes = [data bytes];
   NSUInteger length = [data length];
 
@@ -44,42 +43,26 @@
   int memLevel = 8;          // Default.
   int windowBits = 15 + 16;  // Enable gzip header instead of zlib header.
 
-  int retCode;
   if (deflateInit2(&strm, level, Z_DEFLATED, windowBits, memLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
     return nil;
   }
 
-  // Hint the size at 1/4 the input size.
-  NSMutableData *result = [NSMutableData dataWithCapacity:(length / 4)];
-  unsigned char output[kChunkSize];
+  // Size the output for the worst case, so that the data is compressed in a single call.
+  uLong bound = deflateBound(&strm, (uLong)length);
+  NSMutableData *result = [NSMutableData dataWithLength:bound];
 
-  // Setup the input.
+  // Setup the input and the output.
   strm.avail_in = (unsigned int)length;
   strm.next_in = (unsigned char *)bytes;
+  strm.avail_out = (unsigned int)bound;
+  strm.next_out = result.mutableBytes;
 
-  // Collect the data.
-  do {
-    // update what we're passing in
-    strm.avail_out = kChunkSize;
-    strm.next_out = output;
-    retCode = deflate(&strm, Z_FINISH);
-    if ((retCode != Z_OK) && (retCode != Z_STREAM_END)) {
-      deflateEnd(&strm);
-      return nil;
-    }
-    // Collect what we got.
-    unsigned gotBack = kChunkSize - strm.avail_out;
-    if (gotBack > 0) {
-      [result appendBytes:output length:gotBack];
-    }
-
-  } while (retCode == Z_OK);
-
-  // If the loop exits, it used all input and the stream ended.
-  NSAssert(strm.avail_in == 0,
-           @"Should have finished deflating without using all input, %u bytes left", strm.avail_in);
-  NSAssert(retCode == Z_STREAM_END,
-           @"thought we finished deflate w/o getting a result of stream end, code %d", retCode);
+  int retCode = deflate(&strm, Z_FINISH);
+  if (retCode != Z_STREAM_END) {
+    deflateEnd(&strm);
+    return nil;
+  }
+  result.length = strm.total_out;
 
   // Clean up.
   deflateEnd(&strm);
@@ -93,3 +76,246 @@
 }
 
 @end
+
+/** The size of the buffer small appends are gathered in before they're compressed. It is also the
+ * size of the sample compressibility is estimated from. */
+enum { kGDTCCTGzipStreamInputBufferSize = 16 * 1024 };
+
+/** Payloads up to this length aren't compressed by adaptive streams, as the gzip header and trailer
+ * take up most of what could be saved. */
+static const NSUInteger kGDTCCTGzipStreamMinCompressedLength = 256;
+
+/** Payloads whose sample compresses to more than this ratio of its length aren't compressed by
+ * adaptive streams. */
+static const double kGDTCCTGzipStreamMaxSampleRatio = 0.9;
+
+/** The payload length after which adaptive streams switch to their faster compression level. */
+static const uint64_t kGDTCCTGzipStreamLargePayloadLength = 256 * 1024;
+
+/** zlib's default compression level, which Z_DEFAULT_COMPRESSION stands for. */
+static const int kGDTCCTGzipStreamDefaultLevel = 6;
+
+/** Returns the CPU time consumed by the current thread. */
+static NSTimeInterval GDTCCTThreadCPUTime(void) {
+  struct timespec time;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) {
+    return 0;
+  }
+  return time.tv_sec + time.tv_nsec / (double)NSEC_PER_SEC;
+}
+
+@implementation GDTCCTGzipStream {
+  z_stream _stream;
+
+  /** YES between a successful deflateInit2 and deflateEnd. */
+  BOOL _isStreamOpen;
+
+  /** YES if the stream adapts compression to the payload. */
+  BOOL _isAdaptive;
+
+  /** YES once an adaptive stream decided whether to compress the payload. */
+  BOOL _isCompressionDecided;
+
+  /** The level an adaptive stream switches to once the payload is large. */
+  int _largePayloadLevel;
+
+  /** The compressed bytes, or the appended bytes if they aren't compressed. */
+  NSMutableData *_output;
+
+  /** The appended bytes not compressed yet. */
+  unsigned char _inputBuffer[kGDTCCTGzipStreamInputBufferSize];
+  NSUInteger _inputBufferLength;
+}
+
+- (nullable instancetype)init {
+  return [self initWithLevel:kGDTCCTGzipStreamDefaultLevel
+           largePayloadLevel:kGDTCCTGzipStreamDefaultLevel];
+}
+
+- (nullable instancetype)initWithUploadConditions:(GDTCORUploadConditions)conditions {
+  // Bytes are costlier than CPU time on mobile data, so compress harder there.
+  BOOL isMobileData = (conditions & GDTCORUploadConditionMobileData) &&
+                      !(conditions & GDTCORUploadConditionWifiData);
+  self = isMobileData ? [self initWithLevel:Z_BEST_COMPRESSION
+                             largePayloadLevel:kGDTCCTGzipStreamDefaultLevel]
+                      : [self initWithLevel:kGDTCCTGzipStreamDefaultLevel
+                             largePayloadLevel:Z_BEST_SPEED];
+  if (self) {
+    _isAdaptive = YES;
+  }
+  return self;
+}
+
+- (nullable instancetype)initWithLevel:(int)level largePayloadLevel:(int)largePayloadLevel {
+  self = [super init];
+  if (self) {
+    int memLevel = 8;          // Default.
+    int windowBits = 15 + 16;  // Enable gzip header instead of zlib header.
+    if (deflateInit2(&_stream, level, Z_DEFLATED, windowBits, memLevel, Z_DEFAULT_STRATEGY) !=
+        Z_OK) {
+      return nil;
+    }
+    _isStreamOpen = YES;
+    _compressed = YES;
+    _compressionLevel = level;
+    _largePayloadLevel = largePayloadLevel;
+    _output = [[NSMutableData alloc] init];
+  }
+  return self;
+}
+
+- (void)dealloc {
+  if (_isStreamOpen) {
+    deflateEnd(&_stream);
+  }
+}
+
+- (double)compressionRatio {
+  return _uncompressedLength > 0 ? (double)_output.length / _uncompressedLength : 1;
+}
+
+- (BOOL)appendBytes:(const void *)bytes length:(NSUInteger)length {
+  if (!_isStreamOpen) {
+    return NO;
+  }
+  _uncompressedLength += length;
+  if (!_compressed) {
+    [_output appendBytes:bytes length:length];
+    return YES;
+  }
+  const unsigned char *remainingBytes = bytes;
+  while (length > 0) {
+    NSUInteger copiedLength = MIN(length, kGDTCCTGzipStreamInputBufferSize - _inputBufferLength);
+    memcpy(_inputBuffer + _inputBufferLength, remainingBytes, copiedLength);
+    _inputBufferLength += copiedLength;
+    remainingBytes += copiedLength;
+    length -= copiedLength;
+    if (_inputBufferLength == kGDTCCTGzipStreamInputBufferSize &&
+        ![self deflateInputBufferWithFlush:Z_NO_FLUSH]) {
+      return NO;
+    }
+  }
+  return YES;
+}
+
+- (nullable NSData *)finish {
+  if (!_isStreamOpen || ![self deflateInputBufferWithFlush:Z_FINISH]) {
+    return nil;
+  }
+  deflateEnd(&_stream);
+  _isStreamOpen = NO;
+  return _output;
+}
+
+#pragma mark - Private helper methods
+
+/** Compresses the bytes in the input buffer into the output, and empties the buffer. Ends the
+ * stream if compression fails. An adaptive stream may decide to stop compressing instead, in which
+ * case the bytes are moved to the output as is.
+ */
+- (BOOL)deflateInputBufferWithFlush:(int)flush {
+  if (_isAdaptive && !_isCompressionDecided) {
+    _isCompressionDecided = YES;
+    _compressed = [self shouldCompressInputBufferWithFlush:flush];
+  }
+  if (!_compressed) {
+    [_output appendBytes:_inputBuffer length:_inputBufferLength];
+    _inputBufferLength = 0;
+    _compressionLevel = 0;
+    return YES;
+  }
+
+  NSTimeInterval startCPUTime = GDTCCTThreadCPUTime();
+  [self lowerCompressionLevelIfNeeded];
+  _stream.next_in = _inputBuffer;
+  _stream.avail_in = (uInt)_inputBufferLength;
+  int retCode;
+  do {
+    NSUInteger outputLength = [self reserveOutputLength:deflateBound(&_stream, _stream.avail_in)];
+    retCode = deflate(&_stream, flush);
+    [self commitOutputFromLength:outputLength];
+    if (retCode != Z_OK && retCode != Z_BUF_ERROR && retCode != Z_STREAM_END) {
+      deflateEnd(&_stream);
+      _isStreamOpen = NO;
+      return NO;
+    }
+    // Without flushing, the input is consumed once deflate leaves output space unused. When
+    // finishing, deflate signals the end of the stream.
+  } while (flush == Z_FINISH ? retCode != Z_STREAM_END : _stream.avail_out == 0);
+  _inputBufferLength = 0;
+  _compressionCPUTime += GDTCCTThreadCPUTime() - startCPUTime;
+  return YES;
+}
+
+/** Returns NO if the payload is too small to be worth compressing, or if the bytes in the input
+ * buffer, which are the start of the payload, don't compress well at the fastest level.
+ */
+- (BOOL)shouldCompressInputBufferWithFlush:(int)flush {
+  if (flush == Z_FINISH && _uncompressedLength <= kGDTCCTGzipStreamMinCompressedLength) {
+    return NO;
+  }
+
+  NSTimeInterval startCPUTime = GDTCCTThreadCPUTime();
+  z_stream sampleStream;
+  bzero(&sampleStream, sizeof(z_stream));
+  // Compress the sample as a raw deflate stream, without a header.
+  if (deflateInit2(&sampleStream, Z_BEST_SPEED, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return YES;
+  }
+  uLong sampleBound = deflateBound(&sampleStream, _inputBufferLength);
+  unsigned char *sampleOutput = malloc(sampleBound);
+  BOOL shouldCompress = YES;
+  if (sampleOutput) {
+    sampleStream.next_in = _inputBuffer;
+    sampleStream.avail_in = (uInt)_inputBufferLength;
+    sampleStream.next_out = sampleOutput;
+    sampleStream.avail_out = (uInt)sampleBound;
+    if (deflate(&sampleStream, Z_FINISH) == Z_STREAM_END) {
+      double sampleRatio = (double)sampleStream.total_out / _inputBufferLength;
+      shouldCompress = sampleRatio <= kGDTCCTGzipStreamMaxSampleRatio;
+    }
+    free(sampleOutput);
+  }
+  deflateEnd(&sampleStream);
+  _compressionCPUTime += GDTCCTThreadCPUTime() - startCPUTime;
+  return shouldCompress;
+}
+
+/** Switches to the level for large payloads once the payload grows large. The level is kept if
+ * zlib can't switch without more output space, and switching is attempted again later. */
+- (void)lowerCompressionLevelIfNeeded {
+  if (_compressionLevel == _largePayloadLevel ||
+      _uncompressedLength - _inputBufferLength < kGDTCCTGzipStreamLargePayloadLength) {
+    return;
+  }
+  // Compressing the pending input with the previous level may need output space.
+  _stream.avail_in = 0;
+  NSUInteger outputLength = [self reserveOutputLength:kGDTCCTGzipStreamInputBufferSize];
+  int retCode = deflateParams(&_stream, _largePayloadLevel, Z_DEFAULT_STRATEGY);
+  [self commitOutputFromLength:outputLength];
+  if (retCode == Z_OK) {
+    _compressionLevel = _largePayloadLevel;
+  }
+}
+
+/** Grows the output by at least the given length for deflate to write into.
+ *
+ * @return The length of the output before it was grown.
+ */
+- (NSUInteger)reserveOutputLength:(NSUInteger)length {
+  NSUInteger outputLength = _output.length;
+  NSUInteger reservedLength = MAX(length, 64);
+  [_output setLength:outputLength + reservedLength];
+  _stream.next_out = (unsigned char *)_output.mutableBytes + outputLength;
+  _stream.avail_out = (uInt)reservedLength;
+  return outputLength;
+}
+
+/** Trims the output grown from the given length to the bytes deflate wrote. */
+- (void)commitOutputFromLength:(NSUInteger)outputLength {
+  NSUInteger writtenLength =
+      (NSUInteger)(_stream.next_out - ((unsigned char *)_output.mutableBytes + outputLength));
+  [_output setLength:outputLength + writtenLength];
+}
+
+@end
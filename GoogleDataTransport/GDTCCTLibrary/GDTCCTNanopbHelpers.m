@@ -31,6 +31,7 @@
 #import <nanopb/pb_decode.h>
 #import <nanopb/pb_encode.h>
 
+#import "GoogleDataTransport/GDTCCTLibrary/Private/GDTCCTCompressionHelper.h"
 #import "GoogleDataTransport/GDTCCTLibrary/Public/GDTCOREvent+GDTCCTSupport.h"
 
 #pragma mark - General purpose encoders
@@ -49,6 +50,37 @@ pb_bytes_array_t *_Nullable GDTCCTEncodeData(NSData *data) {
   return pbBytesArray;
 }
 
+bool GDTCCTEncodeDataCallback(pb_ostream_t *stream, const pb_field_t *field, void *const *arg) {
+  NSData *data = (__bridge NSData *)*arg;
+  if (!pb_encode_tag_for_field(stream, field) || !pb_encode_varint(stream, data.length)) {
+    return false;
+  }
+  __block bool isWritten = true;
+  [data enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop) {
+    isWritten = pb_write(stream, bytes, byteRange.length);
+    *stop = !isWritten;
+  }];
+  return isWritten;
+}
+
+void GDTCCTReleaseLogEvent(gdt_cct_LogEvent *logEvent) {
+  if (logEvent->source_extension.arg != NULL) {
+    CFRelease(logEvent->source_extension.arg);
+    logEvent->source_extension.arg = NULL;
+  }
+  pb_release(gdt_cct_LogEvent_fields, logEvent);
+}
+
+void GDTCCTReleaseBatchedLogRequest(gdt_cct_BatchedLogRequest *batchedLogRequest) {
+  for (pb_size_t i = 0; i < batchedLogRequest->log_request_count; i++) {
+    gdt_cct_LogRequest *logRequest = &batchedLogRequest->log_request[i];
+    for (pb_size_t j = 0; j < logRequest->log_event_count; j++) {
+      GDTCCTReleaseLogEvent(&logRequest->log_event[j]);
+    }
+  }
+  pb_release(gdt_cct_BatchedLogRequest_fields, batchedLogRequest);
+}
+
 #pragma mark - CCT object constructors
 
 NSData *_Nullable GDTCCTEncodeBatchedLogRequest(gdt_cct_BatchedLogRequest *batchedLogRequest) {
@@ -72,6 +104,29 @@ NSData *_Nullable GDTCCTEncodeBatchedLogRequest(gdt_cct_BatchedLogRequest *batch
   return CFBridgingRelease(dataRef);
 }
 
+/** A nanopb output stream callback passing the encoded bytes to the GDTCCTGzipStream in the state
+ * of the stream. */
+static bool GDTCCTGzipStreamWriteCallback(pb_ostream_t *stream,
+                                          const pb_byte_t *buf,
+                                          size_t count) {
+  GDTCCTGzipStream *gzipStream = (__bridge GDTCCTGzipStream *)stream->state;
+  return [gzipStream appendBytes:buf length:count];
+}
+
+NSData *_Nullable GDTCCTEncodeGzippedBatchedLogRequest(gdt_cct_BatchedLogRequest *batchedLogRequest,
+                                                       GDTCCTGzipStream *gzipStream) {
+  pb_ostream_t ostream = {.callback = GDTCCTGzipStreamWriteCallback,
+                          .state = (__bridge void *)gzipStream,
+                          .max_size = SIZE_MAX,
+                          .bytes_written = 0};
+  if (!pb_encode(&ostream, gdt_cct_BatchedLogRequest_fields, batchedLogRequest)) {
+    GDTCORLogError(GDTCORMCEGeneralError, @"Error in nanopb encoding for gzipped bytes: %s",
+                   PB_GET_ERROR(&ostream));
+    return nil;
+  }
+  return [gzipStream finish];
+}
+
 gdt_cct_BatchedLogRequest GDTCCTConstructBatchedLogRequest(
     NSDictionary<NSString *, NSSet<GDTCOREvent *> *> *logMappingIDToLogSet) {
   gdt_cct_BatchedLogRequest batchedLogRequest = gdt_cct_BatchedLogRequest_init_default;
@@ -96,6 +151,39 @@ gdt_cct_BatchedLogRequest GDTCCTConstructBatchedLogRequest(
   return batchedLogRequest;
 }
 
+gdt_cct_BatchedLogRequest GDTCCTConstructBatchedLogRequestWithLogEvents(
+    NSDictionary<NSString *, NSMutableData *> *logMappingIDToLogEvents) {
+  gdt_cct_BatchedLogRequest batchedLogRequest = gdt_cct_BatchedLogRequest_init_default;
+  gdt_cct_LogRequest *logRequests =
+      calloc(logMappingIDToLogEvents.count, sizeof(gdt_cct_LogRequest));
+
+  __block pb_size_t i = 0;
+  [logMappingIDToLogEvents
+      enumerateKeysAndObjectsUsingBlock:^(NSString *_Nonnull logMappingID,
+                                          NSMutableData *_Nonnull logEventsData,
+                                          BOOL *_Nonnull stop) {
+        pb_size_t logEventCount = (pb_size_t)(logEventsData.length / sizeof(gdt_cct_LogEvent));
+        gdt_cct_LogEvent *logEvents = logRequests ? malloc(logEventsData.length) : NULL;
+        if (logEvents == NULL) {
+          // Release the log events, as there is no log request to take ownership of them.
+          gdt_cct_LogEvent *unownedLogEvents = logEventsData.mutableBytes;
+          for (pb_size_t j = 0; j < logEventCount; j++) {
+            GDTCCTReleaseLogEvent(&unownedLogEvents[j]);
+          }
+          return;
+        }
+        memcpy(logEvents, logEventsData.bytes, logEventsData.length);
+        int32_t logSource = [logMappingID intValue];
+        logRequests[i] =
+            GDTCCTConstructLogRequestWithLogEvents(logSource, logEvents, logEventCount);
+        i++;
+      }];
+
+  batchedLogRequest.log_request = logRequests;
+  batchedLogRequest.log_request_count = logRequests ? i : 0;
+  return batchedLogRequest;
+}
+
 gdt_cct_LogRequest GDTCCTConstructLogRequest(int32_t logSource,
                                              NSSet<GDTCOREvent *> *_Nonnull logSet) {
   if (logSet.count == 0) {
@@ -104,22 +192,30 @@ gdt_cct_LogRequest GDTCCTConstructLogRequest(int32_t logSource,
     gdt_cct_LogRequest logRequest = gdt_cct_LogRequest_init_default;
     return logRequest;
   }
+  gdt_cct_LogEvent *logEvents = calloc(logSet.count, sizeof(gdt_cct_LogEvent));
+  pb_size_t logEventCount = 0;
+  if (logEvents != NULL) {
+    for (GDTCOREvent *log in logSet) {
+      logEvents[logEventCount] = GDTCCTConstructLogEvent(log);
+      logEventCount++;
+    }
+  }
+  return GDTCCTConstructLogRequestWithLogEvents(logSource, logEvents, logEventCount);
+}
+
+gdt_cct_LogRequest GDTCCTConstructLogRequestWithLogEvents(int32_t logSource,
+                                                          gdt_cct_LogEvent *_Nullable logEvents,
+                                                          pb_size_t logEventCount) {
   gdt_cct_LogRequest logRequest = gdt_cct_LogRequest_init_default;
   logRequest.log_source = logSource;
   logRequest.has_log_source = 1;
   logRequest.client_info = GDTCCTConstructClientInfo();
   logRequest.has_client_info = 1;
-  logRequest.log_event = calloc(logSet.count, sizeof(gdt_cct_LogEvent));
-  if (logRequest.log_event == NULL) {
+  if (logEvents == NULL) {
     return logRequest;
   }
-  int i = 0;
-  for (GDTCOREvent *log in logSet) {
-    gdt_cct_LogEvent logEvent = GDTCCTConstructLogEvent(log);
-    logRequest.log_event[i] = logEvent;
-    i++;
-  }
-  logRequest.log_event_count = (pb_size_t)logSet.count;
+  logRequest.log_event = logEvents;
+  logRequest.log_event_count = logEventCount;
 
   GDTCORClock *currentTime = [GDTCORClock snapshot];
   logRequest.request_time_ms = currentTime.timeMillis;
@@ -151,15 +247,13 @@ gdt_cct_LogEvent GDTCCTConstructLogEvent(GDTCOREvent *event) {
       logEvent.event_code = [eventCode intValue];
     }
   }
-  NSError *error;
-  NSData *extensionBytes;
-  extensionBytes = event.serializedDataObjectBytes;
-  if (error) {
-    GDTCORLogWarning(GDTCORMCWFileReadError,
-                     @"There was an error reading extension bytes from disk: %@", error);
-    return logEvent;
+  NSData *extensionBytes = event.serializedDataObjectBytes;
+  if (extensionBytes != nil) {
+    // The bytes, which may be a slice of a memory-mapped event file, are written straight to the
+    // encoded request instead of being copied to the proto first.
+    logEvent.source_extension.funcs.encode = GDTCCTEncodeDataCallback;
+    logEvent.source_extension.arg = (__bridge_retained void *)extensionBytes;
   }
-  logEvent.source_extension = GDTCCTEncodeData(extensionBytes);  // read bytes from the file.
   if (event.productData) {
     logEvent.compliance_data = GDTCCTConstructComplianceData(event.productData);
     logEvent.has_compliance_data = 1;
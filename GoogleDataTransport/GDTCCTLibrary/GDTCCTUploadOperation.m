@@ -51,6 +51,23 @@ static NSString *const kGDTCCTSupportSDKVersion = @STR(GDTCOR_VERSION);
 static NSString *const kGDTCCTSupportSDKVersion = @"UNKNOWN";
 #endif  // GDTCOR_VERSION
 
+const NSUInteger kGDTCCTUploadBatchMaxEventCount = 1000;
+
+const uint64_t kGDTCCTUploadBatchMaxSizeBytes = 1024 * 1024;  // 1 MB.
+
+const uint64_t kGDTCCTUploadDefaultByteBudget = 4 * 1024 * 1024;  // 4 MB.
+
+const NSTimeInterval kGDTCCTUploadDefaultTimeBudget = 20;
+
+/** The time after which a batch is dissolved if its upload never completes. */
+static const NSTimeInterval kGDTCCTUploadBatchExpiration = 600;  // 10 minutes.
+
+/** The time after which a batch is dissolved if its upload never completes, when the storage keeps
+ * the batches across upload attempts. It outlasts the longest wait the backend usually asks for
+ * after a transient error, so that the batch is resumed rather than formed again.
+ */
+static const NSTimeInterval kGDTCCTResumableUploadBatchExpiration = 24 * 60 * 60;  // 1 day.
+
 typedef void (^GDTCCTUploaderURLTaskCompletion)(NSNumber *batchID,
                                                 NSSet<GDTCOREvent *> *_Nullable events,
                                                 NSData *_Nullable data,
@@ -64,8 +81,6 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
 
 /// The properties to store parameters passed in the initializer. See the initialized docs for
 /// details.
-@property(nonatomic, readonly) GDTCORTarget target;
-@property(nonatomic, readonly) GDTCORUploadConditions conditions;
 @property(nonatomic, readonly) NSURL *uploadURL;
 @property(nonatomic, readonly) id<GDTCORStoragePromiseProtocol> storage;
 @property(nonatomic, readonly) id<GDTCCTUploadMetadataProvider> metadataProvider;
@@ -74,11 +89,31 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
 /** The URL session that will attempt upload. */
 @property(nonatomic, nullable) NSURLSession *uploaderSession;
 
-/// The metrics being uploaded by the operation. These metrics are fetched and included as an event
-/// in the upload batch as part of the upload process.
+/// The metrics included in the batches of the operation by batch ID. These metrics are fetched and
+/// included as an event in each upload batch as part of the upload process.
 ///
 /// Metrics being uploaded are retained so they can be re-stored if upload is not successful.
-@property(nonatomic, nullable) GDTCORMetrics *currentMetrics;
+@property(nonatomic, readonly) NSMutableDictionary<NSNumber *, GDTCORMetrics *> *metricsByBatchID;
+
+/// The batches the metrics were added to, as formed by the storage, by batch ID. A batch kept for
+/// the next attempt is stored with the request body of this batch, so that the stored body never
+/// carries metrics.
+@property(nonatomic, readonly)
+    NSMutableDictionary<NSNumber *, GDTCORUploadBatch *> *batchesWithoutMetricsByBatchID;
+
+/// The request bodies built for the batches of the operation by batch ID. A request body is stored
+/// with its batch if the upload fails with a transient error, so that the next attempt only has to
+/// send it again.
+@property(nonatomic, readonly) NSMutableDictionary<NSNumber *, NSData *> *requestBodiesByBatchID;
+
+/// The batches prepared ahead while a batch is in flight, in the order they are to be sent.
+@property(nonatomic, readonly) NSMutableArray<FBLPromise<GDTCORUploadBatch *> *> *preparedBatches;
+
+/// The number of request body bytes sent by the operation so far.
+@property(nonatomic) uint64_t sentBytes;
+
+/// The system uptime when the operation started uploading, used to check the time budget.
+@property(nonatomic) NSTimeInterval uploadStartTime;
 
 /// NSOperation state properties implementation.
 @property(nonatomic, readwrite, getter=isExecuting) BOOL executing;
@@ -106,6 +141,13 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
     _storage = storage;
     _metadataProvider = metadataProvider;
     _metricsController = metricsController;
+    _byteBudget = kGDTCCTUploadDefaultByteBudget;
+    _timeBudget = kGDTCCTUploadDefaultTimeBudget;
+    _pipelineDepth = 1;
+    _metricsByBatchID = [[NSMutableDictionary alloc] init];
+    _batchesWithoutMetricsByBatchID = [[NSMutableDictionary alloc] init];
+    _requestBodiesByBatchID = [[NSMutableDictionary alloc] init];
+    _preparedBatches = [[NSMutableArray alloc] init];
   }
   return self;
 }
@@ -149,6 +191,7 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
                 }];
 
   id<GDTCORStoragePromiseProtocol> storage = self.storage;
+  self.uploadStartTime = [NSProcessInfo processInfo].systemUptime;
 
   // 1. Check if the conditions for the target are suitable.
   [self isReadyToUploadTarget:target conditions:conditions]
@@ -158,45 +201,13 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
                     return !self.isCancelled;
                   })
       .thenOn(self.uploaderQueue,
-              ^FBLPromise *(NSNull *result) {
-                // 3. Remove previously attempted batches.
-                return [storage removeAllBatchesForTarget:target deleteEvents:NO];
-              })
-      .thenOn(self.uploaderQueue,
-              ^FBLPromise<NSNumber *> *(NSNull *__unused _) {
-                // There may be a big amount of events stored, so creating a batch may be an
-                // expensive operation.
-
-                // 4. Do a lightweight check if there are any events for the target first to
-                // finish early if there are none.
-                return [storage hasEventsForTarget:target];
-              })
-      .validateOn(self.uploaderQueue,
-                  ^BOOL(NSNumber *hasEvents) {
-                    // 5. Stop operation if there are no events to upload.
-                    return hasEvents.boolValue;
-                  })
-      .thenOn(self.uploaderQueue,
-              ^FBLPromise<GDTCORUploadBatch *> *(NSNumber *__unused _) {
-                // 6. Fetch events to upload.
-                GDTCORStorageEventSelector *eventSelector = [self eventSelectorTarget:target
-                                                                       withConditions:conditions];
-                return [storage batchWithEventSelector:eventSelector
-                                       batchExpiration:[NSDate dateWithTimeIntervalSinceNow:600]];
-              })
-      .thenOn(self.uploaderQueue,
-              ^FBLPromise<GDTCORUploadBatch *> *(GDTCORUploadBatch *batch) {
-                // 7. Add metrics to the batch if the target has a
-                // corresponding metrics controller.
-                if (!self.metricsController) {
-                  return [FBLPromise resolvedWith:batch];
-                }
-
-                return [self batchByAddingMetricsEventToBatch:batch forTarget:target];
+              ^FBLPromise<GDTCORUploadBatch *> *(NSNull *__unused _) {
+                // 3. Resume the batch of a previous attempt, or create a new batch.
+                return [self batchToUploadForTarget:target conditions:conditions storage:storage];
               })
       .validateOn(self.uploaderQueue,
                   ^BOOL(GDTCORUploadBatch *__unused _) {
-                    // 8. Stop the operation if it has been cancelled.
+                    // 4. Stop the operation if it has been cancelled.
                     return !self.isCancelled;
                   })
       .thenOn(self.uploaderQueue,
@@ -204,26 +215,280 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
                 // A non-empty batch has been created, consider it as an upload attempt.
                 self.uploadAttempted = YES;
 
-                // 9. Perform upload.
-                return [self uploadBatch:batch toTarget:target storage:storage];
+                // 5. Perform upload, then keep uploading the rest of the stored events.
+                return [self drainTarget:target
+                          startingWithBatch:batch
+                                 conditions:conditions
+                                    storage:storage];
               })
       .catchOn(self.uploaderQueue,
                ^(NSError *error){
                    // TODO: Consider reporting the error to the client.
                })
       .alwaysOn(self.uploaderQueue, ^{
-        // 10. Finish operation.
+        // 6. Invalidate session to release the delegate (which is `self`) to break the retain
+        // cycle, and finish operation.
+        [self.uploaderSession finishTasksAndInvalidate];
         [self finishOperation];
         backgroundTaskCompletion();
       });
 }
 
-#pragma mark - Upload implementation details
+#pragma mark - Draining
 
-/** Uploads a given batch from storage to a target. */
-- (FBLPromise<NSNull *> *)uploadBatch:(GDTCORUploadBatch *)batch
-                             toTarget:(GDTCORTarget)target
+/** Uploads the batch, then forms and uploads the next batch of the target as long as the upload
+ * succeeds, the backend doesn't ask to wait and the budget of the operation isn't spent. The
+ * promise is rejected once there are no more events to upload.
+ */
+- (FBLPromise<NSNull *> *)drainTarget:(GDTCORTarget)target
+                    startingWithBatch:(GDTCORUploadBatch *)batch
+                           conditions:(GDTCORUploadConditions)conditions
                               storage:(id<GDTCORStoragePromiseProtocol>)storage {
+  FBLPromise<NSNumber *> *upload = [self uploadBatch:batch toTarget:target storage:storage];
+  [self fillPipelineForTarget:target conditions:conditions storage:storage];
+  return upload
+      .thenOn(self.uploaderQueue,
+              ^id(NSNumber *isDelivered) {
+                [self.metricsByBatchID removeObjectForKey:batch.batchID];
+                [self.batchesWithoutMetricsByBatchID removeObjectForKey:batch.batchID];
+                [self.requestBodiesByBatchID removeObjectForKey:batch.batchID];
+                if (isDelivered.boolValue && [self shouldUploadNextBatchToTarget:target]) {
+                  return [self nextBatchForTarget:target conditions:conditions storage:storage];
+                }
+                return [self rollBackPreparedBatchesWithStorage:storage].thenOn(
+                    self.uploaderQueue, ^NSError *(NSNull *__unused _) {
+                      return [self genericRejectedPromiseErrorWithReason:@"Upload stopped."];
+                    });
+              })
+      .thenOn(self.uploaderQueue, ^FBLPromise<NSNull *> *(GDTCORUploadBatch *nextBatch) {
+        return [self drainTarget:target
+               startingWithBatch:nextBatch
+                      conditions:conditions
+                         storage:storage];
+      });
+}
+
+/** Returns the next batch to upload, taking the earliest batch prepared ahead if there is one. */
+- (FBLPromise<GDTCORUploadBatch *> *)nextBatchForTarget:(GDTCORTarget)target
+                                             conditions:(GDTCORUploadConditions)conditions
+                                                storage:(id<GDTCORStoragePromiseProtocol>)storage {
+  FBLPromise<GDTCORUploadBatch *> *preparedBatch = self.preparedBatches.firstObject;
+  if (preparedBatch) {
+    [self.preparedBatches removeObjectAtIndex:0];
+    return preparedBatch;
+  }
+  return [self createBatchForTarget:target
+                         conditions:conditions
+                            storage:storage
+                    batchExpiration:[self batchExpirationForStorage:storage]];
+}
+
+/** Forms and encodes batches ahead until the pipeline depth is reached, so that they're ready to be
+ * sent as soon as the batch in flight is delivered. Each batch is prepared after the previous one,
+ * and isn't prepared once the previous one couldn't be.
+ */
+- (void)fillPipelineForTarget:(GDTCORTarget)target
+                   conditions:(GDTCORUploadConditions)conditions
+                      storage:(id<GDTCORStoragePromiseProtocol>)storage {
+  while (self.preparedBatches.count + 1 < self.pipelineDepth) {
+    FBLPromise *previousBatch = self.preparedBatches.lastObject;
+    if (previousBatch == nil) {
+      previousBatch = [FBLPromise resolvedWith:[NSNull null]];
+    }
+    FBLPromise<GDTCORUploadBatch *> *preparedBatch = previousBatch.thenOn(
+        self.uploaderQueue, ^id(id __unused _) {
+          if (![self shouldUploadNextBatchToTarget:target]) {
+            return [self genericRejectedPromiseErrorWithReason:@"No more batches to upload."];
+          }
+          return [self createBatchForTarget:target
+                                 conditions:conditions
+                                    storage:storage
+                            batchExpiration:[self batchExpirationForStorage:storage]]
+              .thenOn(self.uploaderQueue, ^GDTCORUploadBatch *(GDTCORUploadBatch *batch) {
+                [self requestBodyForBatch:batch];
+                return batch;
+              });
+        });
+    [self.preparedBatches addObject:preparedBatch];
+  }
+}
+
+/** Dissolves the batches prepared ahead, placing their events and metrics back in storage. */
+- (FBLPromise<NSNull *> *)rollBackPreparedBatchesWithStorage:
+    (id<GDTCORStoragePromiseProtocol>)storage {
+  NSMutableArray<FBLPromise *> *rollbacks = [[NSMutableArray alloc] init];
+  for (FBLPromise<GDTCORUploadBatch *> *preparedBatch in self.preparedBatches) {
+    FBLPromise *rollback =
+        preparedBatch
+            .thenOn(self.uploaderQueue,
+                    ^FBLPromise<NSNull *> *(GDTCORUploadBatch *batch) {
+                      GDTCORLogDebug(@"CCT: batch %@ was prepared but not sent. Batch will be "
+                                     @"dissolved.",
+                                     batch.batchID);
+                      GDTCORMetrics *metrics = self.metricsByBatchID[batch.batchID];
+                      if (metrics) {
+                        [self.metricsController offerMetrics:metrics];
+                      }
+                      [self.metricsByBatchID removeObjectForKey:batch.batchID];
+                      [self.batchesWithoutMetricsByBatchID removeObjectForKey:batch.batchID];
+                      [self.requestBodiesByBatchID removeObjectForKey:batch.batchID];
+                      return [storage removeBatchWithID:batch.batchID deleteEvents:NO];
+                    })
+            .recoverOn(self.uploaderQueue, ^id(NSError *__unused _) {
+              // The batch wasn't formed.
+              return [NSNull null];
+            });
+    [rollbacks addObject:rollback];
+  }
+  [self.preparedBatches removeAllObjects];
+  return [FBLPromise onQueue:self.uploaderQueue all:rollbacks].thenOn(
+      self.uploaderQueue, ^NSNull *(NSArray *__unused _) {
+        return [NSNull null];
+      });
+}
+
+/** Returns YES if the operation should upload another batch after a successful upload. */
+- (BOOL)shouldUploadNextBatchToTarget:(GDTCORTarget)target {
+  if (self.isCancelled) {
+    return NO;
+  }
+  if (self.sentBytes >= self.byteBudget) {
+    GDTCORLogDebug(@"CCT: %llu bytes sent to target %ld, the byte budget is spent.",
+                   self.sentBytes, (long)target);
+    return NO;
+  }
+  NSTimeInterval uploadDuration = [NSProcessInfo processInfo].systemUptime - self.uploadStartTime;
+  if (uploadDuration >= self.timeBudget) {
+    GDTCORLogDebug(@"CCT: uploading to target %ld for %f seconds, the time budget is spent.",
+                   (long)target, uploadDuration);
+    return NO;
+  }
+  // Stop if the backend asked to wait before the next request, even for high priority uploads.
+  return [self isAfterNextUploadTimeForTarget:target];
+}
+
+#pragma mark - Batch preparation
+
+/** Returns the batch left open by a previous upload attempt if the storage keeps batches across
+ * attempts, so that it's sent again as is. Otherwise the previously attempted batches are dissolved
+ * and a new batch is created.
+ */
+- (FBLPromise<GDTCORUploadBatch *> *)batchToUploadForTarget:(GDTCORTarget)target
+                                                 conditions:(GDTCORUploadConditions)conditions
+                                                    storage:
+                                                        (id<GDTCORStoragePromiseProtocol>)storage {
+  if (![self storageResumesBatches:storage]) {
+    // Remove previously attempted batches.
+    return [storage removeAllBatchesForTarget:target deleteEvents:NO].thenOn(
+        self.uploaderQueue, ^FBLPromise<GDTCORUploadBatch *> *(NSNull *__unused _) {
+          return [self createBatchForTarget:target
+                                 conditions:conditions
+                                    storage:storage
+                            batchExpiration:kGDTCCTUploadBatchExpiration];
+        });
+  }
+  // A kept batch is only resumed if the current conditions allow uploading all of its events.
+  GDTCORStorageEventSelector *eventSelector = [self eventSelectorTarget:target
+                                                         withConditions:conditions];
+  return [storage pendingBatchWithEventSelector:eventSelector].recoverOn(
+      self.uploaderQueue, ^FBLPromise<GDTCORUploadBatch *> *(NSError *__unused _) {
+        // There is no batch to resume.
+        return [self createBatchForTarget:target
+                               conditions:conditions
+                                  storage:storage
+                          batchExpiration:kGDTCCTResumableUploadBatchExpiration];
+      });
+}
+
+/** Creates a batch of the events to upload for the target, with metrics added if the target has a
+ * corresponding metrics controller. The promise is rejected if there are no events to upload.
+ */
+- (FBLPromise<GDTCORUploadBatch *> *)createBatchForTarget:(GDTCORTarget)target
+                                               conditions:(GDTCORUploadConditions)conditions
+                                                  storage:(id<GDTCORStoragePromiseProtocol>)storage
+                                          batchExpiration:(NSTimeInterval)batchExpiration {
+  // There may be a big amount of events stored, so creating a batch may be an
+  // expensive operation.
+
+  // 1. Do a lightweight check if there are any events for the target first to
+  // finish early if there are none.
+  return [storage hasEventsForTarget:target]
+      .validateOn(self.uploaderQueue,
+                  ^BOOL(NSNumber *hasEvents) {
+                    // 2. Stop operation if there are no events to upload.
+                    return hasEvents.boolValue;
+                  })
+      .thenOn(self.uploaderQueue,
+              ^FBLPromise<GDTCORUploadBatch *> *(NSNumber *__unused _) {
+                // 3. Fetch events to upload.
+                GDTCORStorageEventSelector *eventSelector = [self eventSelectorTarget:target
+                                                                       withConditions:conditions];
+                NSDate *expiration = [NSDate dateWithTimeIntervalSinceNow:batchExpiration];
+                return [storage batchWithEventSelector:eventSelector batchExpiration:expiration];
+              })
+      .thenOn(self.uploaderQueue, ^FBLPromise<GDTCORUploadBatch *> *(GDTCORUploadBatch *batch) {
+        // 4. Add metrics to the batch if the target has a
+        // corresponding metrics controller.
+        if (!self.metricsController) {
+          return [FBLPromise resolvedWith:batch];
+        }
+
+        return [self batchByAddingMetricsEventToBatch:batch forTarget:target];
+      });
+}
+
+/** Returns the time after which a batch formed for the storage is dissolved. */
+- (NSTimeInterval)batchExpirationForStorage:(id<GDTCORStoragePromiseProtocol>)storage {
+  return [self storageResumesBatches:storage] ? kGDTCCTResumableUploadBatchExpiration
+                                              : kGDTCCTUploadBatchExpiration;
+}
+
+/** Returns YES if the storage keeps the batches and their request bodies across upload attempts. */
+- (BOOL)storageResumesBatches:(id<GDTCORStoragePromiseProtocol>)storage {
+  return [storage respondsToSelector:@selector(pendingBatchWithEventSelector:)] &&
+         [storage respondsToSelector:@selector(storeRequestBody:forBatchID:retryDate:)];
+}
+
+/** Keeps the batch open after a transient upload failure so that the next attempt resumes it, and
+ * stores its request body along with it, to be replayed from the next upload time. The metrics
+ * included in the batch are placed back in storage, and the stored body is built without them, so
+ * that a body the storage later drops doesn't take any metrics with it.
+ */
+- (FBLPromise<NSNull *> *)keepBatchForNextAttempt:(GDTCORUploadBatch *)batch
+                                          storage:(id<GDTCORStoragePromiseProtocol>)storage {
+  if (batch.requestBody) {
+    // The batch was resumed with its stored request body, which carries no metrics.
+    return [FBLPromise resolvedWith:[NSNull null]];
+  }
+  NSData *requestBody = self.requestBodiesByBatchID[batch.batchID];
+  GDTCORMetrics *uploadedMetrics = self.metricsByBatchID[batch.batchID];
+  if (uploadedMetrics) {
+    [self.metricsController offerMetrics:uploadedMetrics];
+    GDTCORUploadBatch *batchWithoutMetrics = self.batchesWithoutMetricsByBatchID[batch.batchID];
+    requestBody =
+        batchWithoutMetrics ? [self constructRequestBodyWithBatch:batchWithoutMetrics] : nil;
+  }
+  FBLPromise<NSNull *> *storeRequestBody =
+      requestBody ? [storage storeRequestBody:requestBody
+                                   forBatchID:batch.batchID
+                                    retryDate:[self nextUploadDateForTarget:self.target]]
+                  : [FBLPromise resolvedWith:[self genericRejectedPromiseErrorWithReason:
+                                                       @"No request body was built."]];
+  return storeRequestBody.recoverOn(self.uploaderQueue, ^id(NSError *error) {
+    // The next attempt builds the body again from the events of the batch.
+    GDTCORLogDebug(@"CCT: request body of batch %@ wasn't stored: %@", batch.batchID, error);
+    return [NSNull null];
+  });
+}
+
+#pragma mark - Upload implementation details
+
+/** Uploads a given batch from storage to a target. The promise is resolved with YES if the batch
+ * was delivered, and with NO if it is left to be uploaded later or dropped.
+ */
+- (FBLPromise<NSNumber *> *)uploadBatch:(GDTCORUploadBatch *)batch
+                               toTarget:(GDTCORTarget)target
+                                storage:(id<GDTCORStoragePromiseProtocol>)storage {
   // 1. Send URL request.
   return [self sendURLRequestWithBatch:batch target:target]
       .thenOn(self.uploaderQueue,
@@ -234,21 +499,34 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
                 return [self processResponse:response forBatch:batch storage:storage];
               })
       .recoverOn(self.uploaderQueue, ^id(NSError *error) {
-        // If a network error occurred, move the events back to the main
-        // storage so they can attempt to be uploaded in the next attempt.
-        // Additionally, if metrics were added to the batch, place them back
-        // in storage.
-        if (self.currentMetrics) {
-          [self.metricsController offerMetrics:self.currentMetrics];
+        // If a network error occurred, keep the batch for the next attempt if the storage
+        // supports it.
+        FBLPromise<NSNull *> *cleanup;
+        if ([self storageResumesBatches:storage]) {
+          cleanup = [self keepBatchForNextAttempt:batch storage:storage];
+        } else {
+          // Otherwise, move the events back to the main
+          // storage so they can attempt to be uploaded in the next attempt.
+          // Additionally, if metrics were added to the batch, place them back
+          // in storage.
+          GDTCORMetrics *uploadedMetrics = self.metricsByBatchID[batch.batchID];
+          if (uploadedMetrics) {
+            [self.metricsController offerMetrics:uploadedMetrics];
+          }
+          cleanup = [storage removeBatchWithID:batch.batchID deleteEvents:NO];
         }
-        return [storage removeBatchWithID:batch.batchID deleteEvents:NO];
+        return cleanup.thenOn(self.uploaderQueue, ^NSNumber *(NSNull *__unused _) {
+          return @NO;
+        });
       });
 }
 
-/** Processes a URL session response for a given batch from storage. */
-- (FBLPromise<NSNull *> *)processResponse:(GDTCCTURLSessionDataResponse *)response
-                                 forBatch:(GDTCORUploadBatch *)batch
-                                  storage:(id<GDTCORStoragePromiseProtocol>)storage {
+/** Processes a URL session response for a given batch from storage. The promise is resolved with
+ * YES if the response confirms the batch was delivered.
+ */
+- (FBLPromise<NSNumber *> *)processResponse:(GDTCCTURLSessionDataResponse *)response
+                                   forBatch:(GDTCORUploadBatch *)batch
+                                    storage:(id<GDTCORStoragePromiseProtocol>)storage {
   // Cleanup batch based on the response's status code.
   NSInteger statusCode = response.HTTPResponse.statusCode;
   BOOL isSuccess = statusCode >= 200 && statusCode < 300;
@@ -258,9 +536,18 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
 
   BOOL shouldDeleteEvents = isSuccess || !isTransientError;
 
+  if (isTransientError && [self storageResumesBatches:storage]) {
+    GDTCORLogDebug(@"CCT: batch %@ upload failed. Batch will be resumed by the next attempt.",
+                   batch.batchID);
+    return [self keepBatchForNextAttempt:batch storage:storage].thenOn(
+        self.uploaderQueue, ^NSNumber *(NSNull *__unused _) {
+          return @NO;
+        });
+  }
+
   // If the batch included metrics and the upload failed, place metrics back
   // in storage.
-  GDTCORMetrics *uploadedMetrics = [self currentMetrics];
+  GDTCORMetrics *uploadedMetrics = self.metricsByBatchID[batch.batchID];
   if (uploadedMetrics && !isSuccess) {
     [self.metricsController offerMetrics:uploadedMetrics];
   }
@@ -282,7 +569,23 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
     }
   }
 
-  return [storage removeBatchWithID:batch.batchID deleteEvents:shouldDeleteEvents];
+  return [storage removeBatchWithID:batch.batchID deleteEvents:shouldDeleteEvents].thenOn(
+      self.uploaderQueue, ^NSNumber *(NSNull *__unused _) {
+        return @(isSuccess);
+      });
+}
+
+/** Returns the request body of the batch. A resumed batch is sent with the body built for it by the
+ * previous attempt, and a batch prepared ahead with the body built while preparing it. Otherwise
+ * the body is built and kept for the batch.
+ */
+- (NSData *)requestBodyForBatch:(GDTCORUploadBatch *)batch {
+  NSData *requestBody = batch.requestBody ?: self.requestBodiesByBatchID[batch.batchID];
+  if (requestBody == nil) {
+    requestBody = [self constructRequestBodyWithBatch:batch];
+  }
+  self.requestBodiesByBatchID[batch.batchID] = requestBody;
+  return requestBody;
 }
 
 /** Composes and sends URL request. */
@@ -292,17 +595,14 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
              onQueue:self.uploaderQueue
                   do:^NSURLRequest * {
                     // 1. Prepare URL request.
-                    NSData *requestProtoData = [self constructRequestProtoWithEvents:batch.events];
-                    NSData *gzippedData = [GDTCCTCompressionHelper gzippedData:requestProtoData];
-                    BOOL usingGzipData =
-                        gzippedData != nil && gzippedData.length < requestProtoData.length;
-                    NSData *dataToSend = usingGzipData ? gzippedData : requestProtoData;
+                    NSData *dataToSend = [self requestBodyForBatch:batch];
+                    self.sentBytes += dataToSend.length;
                     NSURLRequest *request = [self constructRequestWithURL:self.uploadURL
                                                                 forTarget:target
                                                                      data:dataToSend];
                     GDTCORLogDebug(@"CTT: request containing %lu events for batch: %@ for target: "
                                    @"%ld created: %@",
-                                   (unsigned long)batch.events.count, batch.batchID, (long)target,
+                                   (unsigned long)batch.eventCount, batch.batchID, (long)target,
                                    request);
                     return request;
                   }]
@@ -326,20 +626,7 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
                                 }
                               }] resume];
                 }];
-              })
-      .thenOn(self.uploaderQueue,
-              ^GDTCCTURLSessionDataResponse *(GDTCCTURLSessionDataResponse *response) {
-                // Invalidate session to release the delegate (which is `self`) to break the retain
-                // cycle.
-                [self.uploaderSession finishTasksAndInvalidate];
-                return response;
-              })
-      .recoverOn(self.uploaderQueue, ^id(NSError *error) {
-        // Invalidate session to release the delegate (which is `self`) to break the retain cycle.
-        [self.uploaderSession finishTasksAndInvalidate];
-        // Re-throw the error.
-        return error;
-      });
+              });
 }
 
 /** Parses server response and update next upload time for the specified target based on it. */
@@ -426,7 +713,20 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
     return YES;
   }
 
-  // Check next upload time for the target.
+  return [self isAfterNextUploadTimeForTarget:target];
+}
+
+/** Returns YES if the time the backend asked to wait before the next request has passed. */
+/** Returns the date the next upload of the target is due, or now if it is already due. */
+- (NSDate *)nextUploadDateForTarget:(GDTCORTarget)target {
+  GDTCORClock *nextUploadTime = [self.metadataProvider nextUploadTimeForTarget:target];
+  if (nextUploadTime == nil || [[GDTCORClock snapshot] isAfter:nextUploadTime]) {
+    return [NSDate date];
+  }
+  return [NSDate dateWithTimeIntervalSince1970:nextUploadTime.timeMillis / 1000.0];
+}
+
+- (BOOL)isAfterNextUploadTimeForTarget:(GDTCORTarget)target {
   BOOL isAfterNextUploadTime = YES;
   GDTCORClock *nextUploadTime = [self.metadataProvider nextUploadTimeForTarget:target];
   if (nextUploadTime) {
@@ -444,27 +744,47 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
   return isAfterNextUploadTime;
 }
 
-/** Constructs data given an upload package.
+/** Constructs the request body given an upload batch. The events are read from the batch one at a
+ * time and converted to log events right away, so the decoded events of the batch aren't held in
+ * memory. The request is gzipped as it's encoded unless the upload conditions and the payload make
+ * compression not worth it, and only encoded again uncompressed if compression doesn't make it
+ * smaller.
  *
- * @param events The events used to construct the request proto bytes.
- * @return Proto bytes representing a gdt_cct_LogRequest object.
+ * @param batch The batch used to construct the request proto bytes.
+ * @return Proto bytes representing a gdt_cct_LogRequest object, gzipped or not.
  */
-- (nonnull NSData *)constructRequestProtoWithEvents:(NSSet<GDTCOREvent *> *)events {
+- (nonnull NSData *)constructRequestBodyWithBatch:(GDTCORUploadBatch *)batch {
   // Segment the log events by log type.
-  NSMutableDictionary<NSString *, NSMutableSet<GDTCOREvent *> *> *logMappingIDToLogSet =
+  NSMutableDictionary<NSString *, NSMutableData *> *logMappingIDToLogEvents =
       [[NSMutableDictionary alloc] init];
-  [events enumerateObjectsUsingBlock:^(GDTCOREvent *_Nonnull event, BOOL *_Nonnull stop) {
-    NSMutableSet *logSet = logMappingIDToLogSet[event.mappingID];
-    logSet = logSet ? logSet : [[NSMutableSet alloc] init];
-    [logSet addObject:event];
-    logMappingIDToLogSet[event.mappingID] = logSet;
+  [batch enumerateEventsUsingBlock:^(GDTCOREvent *_Nonnull event, BOOL *_Nonnull stop) {
+    NSMutableData *logEvents = logMappingIDToLogEvents[event.mappingID];
+    if (logEvents == nil) {
+      logEvents = [[NSMutableData alloc] init];
+      logMappingIDToLogEvents[event.mappingID] = logEvents;
+    }
+    gdt_cct_LogEvent logEvent = GDTCCTConstructLogEvent(event);
+    [logEvents appendBytes:&logEvent length:sizeof(gdt_cct_LogEvent)];
   }];
 
   gdt_cct_BatchedLogRequest batchedLogRequest =
-      GDTCCTConstructBatchedLogRequest(logMappingIDToLogSet);
-
-  NSData *data = GDTCCTEncodeBatchedLogRequest(&batchedLogRequest);
-  pb_release(gdt_cct_BatchedLogRequest_fields, &batchedLogRequest);
+      GDTCCTConstructBatchedLogRequestWithLogEvents(logMappingIDToLogEvents);
+
+  GDTCCTGzipStream *gzipStream =
+      [[GDTCCTGzipStream alloc] initWithUploadConditions:self.conditions];
+  NSData *data =
+      gzipStream ? GDTCCTEncodeGzippedBatchedLogRequest(&batchedLogRequest, gzipStream) : nil;
+  if (data == nil || (gzipStream.isCompressed && data.length >= gzipStream.uncompressedLength)) {
+    data = GDTCCTEncodeBatchedLogRequest(&batchedLogRequest);
+  } else {
+    GDTCORLogDebug(@"CCT: request of batch %@ %@ at level %d from %llu to %lu bytes, ratio %.2f, "
+                   @"in %.2f ms of CPU time.",
+                   batch.batchID, gzipStream.isCompressed ? @"compressed" : @"not compressed",
+                   gzipStream.compressionLevel, gzipStream.uncompressedLength,
+                   (unsigned long)data.length, gzipStream.compressionRatio,
+                   gzipStream.compressionCPUTime * 1000);
+  }
+  GDTCCTReleaseBatchedLogRequest(&batchedLogRequest);
   return data ? data : [[NSData alloc] init];
 }
 
@@ -525,8 +845,17 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
 /** Creates and returns a storage event selector for the specified target and conditions. */
 - (GDTCORStorageEventSelector *)eventSelectorTarget:(GDTCORTarget)target
                                      withConditions:(GDTCORUploadConditions)conditions {
+  // Bound the batch so that the request size doesn't grow with the backlog. Whatever doesn't fit
+  // is uploaded by the next batch of the operation.
   if ((conditions & GDTCORUploadConditionHighPriority) == GDTCORUploadConditionHighPriority) {
-    return [GDTCORStorageEventSelector eventSelectorForTarget:target];
+    return [[GDTCORStorageEventSelector alloc]
+           initWithTarget:target
+                 eventIDs:nil
+               mappingIDs:nil
+                 qosTiers:nil
+            maxEventCount:kGDTCCTUploadBatchMaxEventCount
+        maxBatchSizeBytes:kGDTCCTUploadBatchMaxSizeBytes
+                    order:GDTCORStorageEventSelectorOrderPriorityFirst];
   }
   NSMutableSet<NSNumber *> *qosTiers = [[NSMutableSet alloc] init];
   if (conditions & GDTCORUploadConditionWifiData) {
@@ -539,10 +868,14 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
     [qosTiers addObjectsFromArray:@[ @(GDTCOREventQoSFast), @(GDTCOREventQosDefault) ]];
   }
 
-  return [[GDTCORStorageEventSelector alloc] initWithTarget:target
-                                                   eventIDs:nil
-                                                 mappingIDs:nil
-                                                   qosTiers:qosTiers];
+  return [[GDTCORStorageEventSelector alloc]
+         initWithTarget:target
+               eventIDs:nil
+             mappingIDs:nil
+               qosTiers:qosTiers
+          maxEventCount:kGDTCCTUploadBatchMaxEventCount
+      maxBatchSizeBytes:kGDTCCTUploadBatchMaxSizeBytes
+                  order:GDTCORStorageEventSelectorOrderPriorityFirst];
 }
 
 - (FBLPromise<GDTCORUploadBatch *> *)batchByAddingMetricsEventToBatch:(GDTCORUploadBatch *)batch
@@ -551,14 +884,11 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
       .thenOn(self.uploaderQueue,
               ^GDTCORUploadBatch *(GDTCORMetrics *metrics) {
                 // Save the metrics so they can be re-stored if upload fails.
-                [self setCurrentMetrics:metrics];
+                self.metricsByBatchID[batch.batchID] = metrics;
+                self.batchesWithoutMetricsByBatchID[batch.batchID] = batch;
 
                 GDTCOREvent *metricsEvent = [GDTCOREvent eventWithMetrics:metrics forTarget:target];
-                GDTCORUploadBatch *batchWithMetricEvent = [[GDTCORUploadBatch alloc]
-                    initWithBatchID:batch.batchID
-                             events:[batch.events setByAddingObject:metricsEvent]];
-
-                return batchWithMetricEvent;
+                return [batch batchByAddingEvent:metricsEvent];
               })
       .recoverOn(self.uploaderQueue, ^GDTCORUploadBatch *(NSError *error) {
         // Return given batch if an error occurs (i.e. no metrics were fetched).
@@ -26,13 +26,21 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/** The maximum number of upload operations in flight for a single target. Operations of the same
+ * target share the target's storage batches, so they are not run in parallel with each other.
+ */
+static const NSInteger kGDTCCTUploaderMaxConcurrentOperationCountPerTarget = 1;
+
 @interface GDTCCTUploader () <NSURLSessionDelegate, GDTCCTUploadMetadataProvider>
 
-#if !GDT_TEST
-@property(nonatomic, readonly) NSOperationQueue *uploadOperationQueue;
-#endif
 @property(nonatomic, readonly) dispatch_queue_t uploadQueue;
 
+/** The operation queues upload operations run on, one per target, so that the targets are uploaded
+ * concurrently. Guarded by synchronizing on the dictionary.
+ */
+@property(nonatomic, readonly)
+    NSMutableDictionary<NSNumber * /*GDTCORTarget*/, NSOperationQueue *> *uploadOperationQueues;
+
 @property(nonatomic, readonly)
     NSMutableDictionary<NSNumber * /*GDTCORTarget*/, GDTCORClock *> *nextUploadTimeByTarget;
 
@@ -66,8 +74,10 @@ static NSURL *_testServerURL = nil;
   self = [super init];
   if (self) {
     _uploadQueue = dispatch_queue_create("com.google.GDTCCTUploader", DISPATCH_QUEUE_SERIAL);
-    _uploadOperationQueue = [[NSOperationQueue alloc] init];
-    _uploadOperationQueue.maxConcurrentOperationCount = 1;
+    _uploadOperationQueues = [[NSMutableDictionary alloc] init];
+    _uploadByteBudget = kGDTCCTUploadDefaultByteBudget;
+    _uploadTimeBudget = kGDTCCTUploadDefaultTimeBudget;
+    _uploadPipelineDepth = 1;
     _nextUploadTimeByTarget = [[NSMutableDictionary alloc] init];
   }
   return self;
@@ -76,9 +86,9 @@ static NSURL *_testServerURL = nil;
 - (void)uploadTarget:(GDTCORTarget)target withConditions:(GDTCORUploadConditions)conditions {
   // Current GDTCCTUploader expected behaviour:
   // 1. Accept multiple upload request
-  // 2. Verify if there are events eligible for upload and start upload for the first suitable
-  // target
-  // 3. Ignore other requests while an upload is in-progress.
+  // 2. Verify if there are events eligible for upload and start upload for each target
+  // independently of the other targets
+  // 3. Ignore other requests for the target while an upload for it is in-progress.
 
   // TODO: Revisit expected behaviour.
   // Potentially better option:
@@ -94,6 +104,13 @@ static NSURL *_testServerURL = nil;
     return;
   }
 
+  NSOperationQueue *operationQueue = [self uploadOperationQueueForTarget:target];
+  if ([self hasPendingOperationInQueue:operationQueue withConditions:conditions]) {
+    // Coalesce with the request that hasn't started yet, it uploads the same events.
+    GDTCORLogDebug(@"Upload request coalesced with a pending one, target: %@", @(target));
+    return;
+  }
+
   id<GDTCORMetricsControllerProtocol> metricsController =
       GDTCORMetricsControllerInstanceForTarget(target);
 
@@ -105,15 +122,18 @@ static NSURL *_testServerURL = nil;
                                             storage:storage
                                    metadataProvider:self
                                   metricsController:metricsController];
+  uploadOperation.byteBudget = self.uploadByteBudget;
+  uploadOperation.timeBudget = self.uploadTimeBudget;
+  uploadOperation.pipelineDepth = self.uploadPipelineDepth;
 
   GDTCORLogDebug(@"Upload operation created: %@, target: %@", uploadOperation, @(target));
 
-  __weak __auto_type weakSelf = self;
+  __weak NSOperationQueue *weakOperationQueue = operationQueue;
   __weak GDTCCTUploadOperation *weakOperation = uploadOperation;
   uploadOperation.completionBlock = ^{
-    __auto_type strongSelf = weakSelf;
+    NSOperationQueue *strongOperationQueue = weakOperationQueue;
     GDTCCTUploadOperation *strongOperation = weakOperation;
-    if (strongSelf == nil || strongOperation == nil) {
+    if (strongOperationQueue == nil || strongOperation == nil) {
       GDTCORLogDebug(@"Internal inconsistency: GDTCCTUploader was deallocated during upload.", nil);
       return;
     }
@@ -122,14 +142,53 @@ static NSURL *_testServerURL = nil;
                    @(strongOperation.uploadAttempted));
 
     if (strongOperation.uploadAttempted) {
-      // Ignore all upload requests received when the upload was in progress.
-      [strongSelf.uploadOperationQueue cancelAllOperations];
+      // Ignore the upload requests for the target received when the upload was in progress.
+      [strongOperationQueue cancelAllOperations];
     }
   };
 
-  [self.uploadOperationQueue addOperation:uploadOperation];
+  [operationQueue addOperation:uploadOperation];
   GDTCORLogDebug(@"Upload operation scheduled: %@, operation count: %@", uploadOperation,
-                 @(self.uploadOperationQueue.operationCount));
+                 @(operationQueue.operationCount));
+}
+
+#pragma mark - Operation queues
+
+- (NSOperationQueue *)uploadOperationQueueForTarget:(GDTCORTarget)target {
+  @synchronized(self.uploadOperationQueues) {
+    NSOperationQueue *operationQueue = self.uploadOperationQueues[@(target)];
+    if (operationQueue == nil) {
+      operationQueue = [[NSOperationQueue alloc] init];
+      operationQueue.name =
+          [NSString stringWithFormat:@"com.google.GDTCCTUploader.%ld", (long)target];
+      operationQueue.maxConcurrentOperationCount =
+          kGDTCCTUploaderMaxConcurrentOperationCountPerTarget;
+      self.uploadOperationQueues[@(target)] = operationQueue;
+    }
+    return operationQueue;
+  }
+}
+
+/** Returns YES if the queue has an operation with the given conditions that hasn't started yet. */
+- (BOOL)hasPendingOperationInQueue:(NSOperationQueue *)operationQueue
+                    withConditions:(GDTCORUploadConditions)conditions {
+  for (NSOperation *operation in operationQueue.operations) {
+    if (![operation isKindOfClass:[GDTCCTUploadOperation class]]) {
+      continue;
+    }
+    GDTCCTUploadOperation *uploadOperation = (GDTCCTUploadOperation *)operation;
+    if (!uploadOperation.isExecuting && !uploadOperation.isFinished &&
+        !uploadOperation.isCancelled && uploadOperation.conditions == conditions) {
+      return YES;
+    }
+  }
+  return NO;
+}
+
+- (NSArray<NSOperationQueue *> *)allUploadOperationQueues {
+  @synchronized(self.uploadOperationQueues) {
+    return self.uploadOperationQueues.allValues;
+  }
 }
 
 #pragma mark - URLs
@@ -199,17 +258,31 @@ static NSURL *_testServerURL = nil;
 - (BOOL)waitForUploadFinishedWithTimeout:(NSTimeInterval)timeout {
   NSDate *expirationDate = [NSDate dateWithTimeIntervalSinceNow:timeout];
   while ([expirationDate compare:[NSDate date]] == NSOrderedDescending) {
-    if (self.uploadOperationQueue.operationCount == 0) {
+    if ([self uploadOperationCount] == 0) {
       return YES;
     } else {
       [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
     }
   }
 
-  GDTCORLogDebug(@"Uploader wait for finish timeout exceeded. Operations still in queue: %@",
-                 self.uploadOperationQueue.operations);
+  GDTCORLogDebug(@"Uploader wait for finish timeout exceeded. Operations still in queues: %@",
+                 [[self allUploadOperationQueues] valueForKey:@"operations"]);
   return NO;
 }
+
+- (NSUInteger)uploadOperationCount {
+  NSUInteger count = 0;
+  for (NSOperationQueue *operationQueue in [self allUploadOperationQueues]) {
+    count += operationQueue.operationCount;
+  }
+  return count;
+}
+
+- (void)cancelAllUploadOperations {
+  for (NSOperationQueue *operationQueue in [self allUploadOperationQueues]) {
+    [operationQueue cancelAllOperations];
+  }
+}
 #endif  // GDT_TEST
 
 @end
@@ -16,6 +16,8 @@
 
 #import <Foundation/Foundation.h>
 
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORUploader.h"
+
 NS_ASSUME_NONNULL_BEGIN
 
 /** A class with methods to help with gzipped data. */
@@ -37,4 +39,56 @@ NS_ASSUME_NONNULL_BEGIN
 
 @end
 
+/** Compresses bytes appended in pieces into gzip data, so that the uncompressed bytes don't have
+ * to be held in memory at once. Not thread safe.
+ *
+ * A stream created for upload conditions picks the compression level from the network type and
+ * lowers it once the payload grows large. It leaves tiny payloads, and payloads whose first bytes
+ * don't compress well, uncompressed, in which case the appended bytes are returned as is.
+ */
+@interface GDTCCTGzipStream : NSObject
+
+/** The number of uncompressed bytes appended to the stream. */
+@property(nonatomic, readonly) uint64_t uncompressedLength;
+
+/** YES if the stream compresses the appended bytes, NO if it returns them as is. Only final once
+ * the stream is finished. */
+@property(nonatomic, readonly, getter=isCompressed) BOOL compressed;
+
+/** The compression level used for the last compressed bytes, or 0 if they aren't compressed. */
+@property(nonatomic, readonly) int compressionLevel;
+
+/** The length of the finished stream output divided by `uncompressedLength`, or 1 if nothing was
+ * appended. */
+@property(nonatomic, readonly) double compressionRatio;
+
+/** The CPU time spent compressing, including sampling the payload. */
+@property(nonatomic, readonly) NSTimeInterval compressionCPUTime;
+
+/** Creates a stream that always compresses with the default compression level, or returns nil if
+ * the compressor couldn't be initialized. */
+- (nullable instancetype)init;
+
+/** Creates a stream that adapts compression to the payload and the given upload conditions, or
+ * returns nil if the compressor couldn't be initialized.
+ *
+ * @param conditions The conditions the compressed data is likely to be uploaded under.
+ */
+- (nullable instancetype)initWithUploadConditions:(GDTCORUploadConditions)conditions;
+
+/** Compresses the given bytes after the ones appended before.
+ *
+ * @return NO if compression failed, in which case the stream can't be used any further.
+ */
+- (BOOL)appendBytes:(const void *)bytes length:(NSUInteger)length;
+
+/** Compresses the remaining bytes and ends the stream.
+ *
+ * @return The compressed data, the appended bytes if the stream doesn't compress them, or nil if
+ * compression failed.
+ */
+- (nullable NSData *)finish;
+
+@end
+
 NS_ASSUME_NONNULL_END
@@ -23,6 +23,8 @@
 #import "GoogleDataTransport/GDTCCTLibrary/Protogen/nanopb/cct.nanopb.h"
 #import "GoogleDataTransport/GDTCCTLibrary/Protogen/nanopb/compliance.nanopb.h"
 
+@class GDTCCTGzipStream;
+
 NS_ASSUME_NONNULL_BEGIN
 
 #pragma mark - General purpose encoders
@@ -45,11 +47,36 @@ pb_bytes_array_t *_Nullable GDTCCTEncodeString(NSString *string);
  */
 pb_bytes_array_t *_Nullable GDTCCTEncodeData(NSData *data);
 
+/** A nanopb encode callback writing the bytes of the NSData* retained by the callback argument as
+ * a bytes field, without copying them to a pb_bytes_array_t* first.
+ *
+ * @param stream The stream to write to.
+ * @param field The field being encoded.
+ * @param arg A pointer to the retained NSData*.
+ * @return YES if the field was written.
+ */
+bool GDTCCTEncodeDataCallback(pb_ostream_t *stream, const pb_field_t *field, void *const *arg);
+
+/** Releases a log event, including the data retained by its callback fields.
+ *
+ * @param logEvent The log event to release.
+ */
+FOUNDATION_EXPORT
+void GDTCCTReleaseLogEvent(gdt_cct_LogEvent *logEvent);
+
+/** Releases a batched log request, including the data retained by the callback fields of its log
+ * events. Use this instead of pb_release on the requests constructed by this file.
+ *
+ * @param batchedLogRequest The batched log request to release.
+ */
+FOUNDATION_EXPORT
+void GDTCCTReleaseBatchedLogRequest(gdt_cct_BatchedLogRequest *batchedLogRequest);
+
 #pragma mark - CCT object constructors
 
 /** Encodes a batched log request.
  *
- * @note Ensure that pb_release is called on the batchedLogRequest param.
+ * @note Ensure that GDTCCTReleaseBatchedLogRequest is called on the batchedLogRequest param.
  *
  * @param batchedLogRequest A pointer to the log batch to encode to bytes.
  * @return An NSData object representing the bytes of the log request batch.
@@ -57,9 +84,24 @@ pb_bytes_array_t *_Nullable GDTCCTEncodeData(NSData *data);
 FOUNDATION_EXPORT
 NSData *GDTCCTEncodeBatchedLogRequest(gdt_cct_BatchedLogRequest *batchedLogRequest);
 
+/** Encodes a batched log request into a gzip stream, which compresses the bytes as they are
+ * encoded, in a single pass, so that the uncompressed bytes are never held in memory.
+ *
+ * @note Ensure that GDTCCTReleaseBatchedLogRequest is called on the batchedLogRequest param.
+ *
+ * @param batchedLogRequest A pointer to the log batch to encode to bytes.
+ * @param gzipStream A new stream to encode the log batch into. It is finished on return, and its
+ * properties describe the compression of the log batch.
+ * @return The output of the stream, or nil if encoding or compression failed.
+ */
+FOUNDATION_EXPORT
+NSData *_Nullable GDTCCTEncodeGzippedBatchedLogRequest(gdt_cct_BatchedLogRequest *batchedLogRequest,
+                                                       GDTCCTGzipStream *gzipStream);
+
 /** Constructs a gdt_cct_BatchedLogRequest given sets of events segemented by mapping ID.
  *
- * @note calloc is called in this method. Ensure that pb_release is called on this or the parent.
+ * @note calloc is called in this method. Ensure that GDTCCTReleaseBatchedLogRequest is called on
+ * this.
  *
  * @param logMappingIDToLogSet A map of mapping IDs to sets of events to convert into a batch.
  * @return A newly created gdt_cct_BatchedLogRequest.
@@ -68,16 +110,49 @@ FOUNDATION_EXPORT
 gdt_cct_BatchedLogRequest GDTCCTConstructBatchedLogRequest(
     NSDictionary<NSString *, NSSet<GDTCOREvent *> *> *logMappingIDToLogSet);
 
+/** Constructs a gdt_cct_BatchedLogRequest given log events segmented by mapping ID. This allows
+ * constructing a request without holding all of the events in memory, as each event can be
+ * converted with GDTCCTConstructLogEvent as soon as it's read.
+ *
+ * @note calloc is called in this method. Ensure that GDTCCTReleaseBatchedLogRequest is called on
+ * this.
+ *
+ * @param logMappingIDToLogEvents A map of mapping IDs to contiguous gdt_cct_LogEvent structs. The
+ * batched log request takes ownership of the allocations made by the log events.
+ * @return A newly created gdt_cct_BatchedLogRequest.
+ */
+FOUNDATION_EXPORT
+gdt_cct_BatchedLogRequest GDTCCTConstructBatchedLogRequestWithLogEvents(
+    NSDictionary<NSString *, NSMutableData *> *logMappingIDToLogEvents);
+
 /** Constructs a log request given a log source and a set of events.
  *
- * @note calloc is called in this method. Ensure that pb_release is called on this or the parent.
+ * @note calloc is called in this method. Ensure that GDTCCTReleaseBatchedLogRequest is called on
+ * the parent.
  * @param logSource The CCT log source to put into the log request.
  * @param logSet The set of events to send in this log request.
  */
 FOUNDATION_EXPORT
 gdt_cct_LogRequest GDTCCTConstructLogRequest(int32_t logSource, NSSet<GDTCOREvent *> *logSet);
 
-/** Constructs a gdt_cct_LogEvent given a GDTCOREvent*.
+/** Constructs a log request given a log source and already constructed log events.
+ *
+ * @note The log request takes ownership of the logEvents array, which must be allocated with
+ * malloc. Ensure that GDTCCTReleaseBatchedLogRequest is called on the parent.
+ * @param logSource The CCT log source to put into the log request.
+ * @param logEvents The log events to send in this log request.
+ * @param logEventCount The number of log events.
+ */
+FOUNDATION_EXPORT
+gdt_cct_LogRequest GDTCCTConstructLogRequestWithLogEvents(int32_t logSource,
+                                                          gdt_cct_LogEvent *_Nullable logEvents,
+                                                          pb_size_t logEventCount);
+
+/** Constructs a gdt_cct_LogEvent given a GDTCOREvent*. The serialized data object bytes of the
+ * event are retained and written by an encode callback when the log event is encoded.
+ *
+ * @note Ensure that GDTCCTReleaseLogEvent is called on this or GDTCCTReleaseBatchedLogRequest on
+ * the parent.
  *
  * @param event The GDTCOREvent to convert.
  * @return The new gdt_cct_LogEvent object.
@@ -23,6 +23,19 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/** The maximum number of events uploaded by a single upload operation. */
+FOUNDATION_EXPORT const NSUInteger kGDTCCTUploadBatchMaxEventCount;
+
+/** The maximum number of stored bytes of the events uploaded by a single upload operation. */
+FOUNDATION_EXPORT const uint64_t kGDTCCTUploadBatchMaxSizeBytes;
+
+/** The default number of request body bytes an upload operation sends before it stops uploading
+ * further batches. */
+FOUNDATION_EXPORT const uint64_t kGDTCCTUploadDefaultByteBudget;
+
+/** The default time an upload operation keeps uploading further batches for. */
+FOUNDATION_EXPORT const NSTimeInterval kGDTCCTUploadDefaultTimeBudget;
+
 /// The protocol defines methods to retrieve/update data shared between different upload operations.
 @protocol GDTCCTUploadMetadataProvider <NSObject>
 
@@ -63,6 +76,27 @@ NS_ASSUME_NONNULL_BEGIN
              metricsController:(nullable id<GDTCORMetricsControllerProtocol>)metricsController
     NS_DESIGNATED_INITIALIZER;
 
+/** The events target the operation uploads. */
+@property(nonatomic, readonly) GDTCORTarget target;
+
+/** The upload conditions the operation was created with. */
+@property(nonatomic, readonly) GDTCORUploadConditions conditions;
+
+/** The number of request body bytes after which the operation stops uploading further batches.
+ * The batch in flight when the budget is spent is completed. Defaults to
+ * `kGDTCCTUploadDefaultByteBudget`. Must be set before the operation starts. */
+@property(nonatomic) uint64_t byteBudget;
+
+/** The time since the operation started after which it stops uploading further batches. Defaults
+ * to `kGDTCCTUploadDefaultTimeBudget`. Must be set before the operation starts. */
+@property(nonatomic) NSTimeInterval timeBudget;
+
+/** The number of batches in the upload pipeline: the batch in flight plus the batches formed and
+ * encoded ahead while it is in flight. The batches prepared ahead are dissolved if the batch in
+ * flight isn't delivered. Defaults to 1, in which case each batch is prepared after the previous
+ * one is delivered. Must be set before the operation starts. */
+@property(nonatomic) NSUInteger pipelineDepth;
+
 /** YES if a batch upload attempt was performed. NO otherwise. If NO for the finished operation,
  * then  there were no events suitable for upload. */
 @property(nonatomic, readonly) BOOL uploadAttempted;
@@ -29,12 +29,30 @@ NS_ASSUME_NONNULL_BEGIN
  */
 + (instancetype)sharedInstance;
 
+/** The number of request body bytes an upload of a target sends before it stops uploading further
+ * batches until the next upload request. Defaults to `kGDTCCTUploadDefaultByteBudget`. */
+@property(nonatomic) uint64_t uploadByteBudget;
+
+/** The time an upload of a target keeps uploading further batches for. Defaults to
+ * `kGDTCCTUploadDefaultTimeBudget`. */
+@property(nonatomic) NSTimeInterval uploadTimeBudget;
+
+/** The number of batches of a target being uploaded or encoded ahead at a time, see
+ * `GDTCCTUploadOperation.pipelineDepth`. Defaults to 1, which disables the pipeline. */
+@property(nonatomic) NSUInteger uploadPipelineDepth;
+
 #if GDT_TEST
 /** An upload URL used across all targets. For testing only. */
 @property(class, nullable, nonatomic) NSURL *testServerURL;
 
-/** The queue on which upload operations run. For testing only. */
-@property(nonatomic, readonly) NSOperationQueue *uploadOperationQueue;
+/** Returns the queue on which upload operations for the target run. For testing only. */
+- (NSOperationQueue *)uploadOperationQueueForTarget:(GDTCORTarget)target;
+
+/** The number of upload operations queued or running across all targets. For testing only. */
+- (NSUInteger)uploadOperationCount;
+
+/** Cancels the upload operations of all targets. For testing only. */
+- (void)cancelAllUploadOperations;
 
 /** Spins runloop until upload finishes or timeout.
  *  @return YES if upload finishes, NO in the case of timeout.
@@ -164,7 +164,7 @@ typedef struct _gdt_cct_QosTiersOverride {
 typedef struct _gdt_cct_LogEvent {
     bool has_event_time_ms;
     int64_t event_time_ms;
-    pb_bytes_array_t *source_extension;
+    pb_callback_t source_extension;
     bool has_event_code;
     int32_t event_code;
     bool has_timezone_offset_seconds;
@@ -209,7 +209,7 @@ extern const gdt_cct_QosTierConfiguration_QosTier gdt_cct_LogRequest_qos_tier_de
 extern const int32_t gdt_cct_QosTierConfiguration_log_source_default;
 
 /* Initializer values for message structs */
-#define gdt_cct_LogEvent_init_default            {false, 0, NULL, false, 0, false, 0, false, 0, false, gdt_cct_NetworkConnectionInfo_init_default, false, gdt_cct_ComplianceData_init_default}
+#define gdt_cct_LogEvent_init_default            {false, 0, {{NULL}, NULL}, false, 0, false, 0, false, 0, false, gdt_cct_NetworkConnectionInfo_init_default, false, gdt_cct_ComplianceData_init_default}
 #define gdt_cct_NetworkConnectionInfo_init_default {false, gdt_cct_NetworkConnectionInfo_NetworkType_NONE, false, gdt_cct_NetworkConnectionInfo_MobileSubtype_UNKNOWN_MOBILE_SUBTYPE}
 #define gdt_cct_MacClientInfo_init_default       {NULL, NULL, NULL, NULL}
 #define gdt_cct_IosClientInfo_init_default       {NULL, NULL, NULL, NULL, NULL, NULL, NULL}
@@ -219,7 +219,7 @@ extern const int32_t gdt_cct_QosTierConfiguration_log_source_default;
 #define gdt_cct_QosTierConfiguration_init_default {false, _gdt_cct_QosTierConfiguration_QosTier_MIN, false, 0}
 #define gdt_cct_QosTiersOverride_init_default    {0, NULL, false, 0}
 #define gdt_cct_LogResponse_init_default         {false, 0, false, gdt_cct_QosTiersOverride_init_default}
-#define gdt_cct_LogEvent_init_zero               {false, 0, NULL, false, 0, false, 0, false, 0, false, gdt_cct_NetworkConnectionInfo_init_zero, false, gdt_cct_ComplianceData_init_zero}
+#define gdt_cct_LogEvent_init_zero               {false, 0, {{NULL}, NULL}, false, 0, false, 0, false, 0, false, gdt_cct_NetworkConnectionInfo_init_zero, false, gdt_cct_ComplianceData_init_zero}
 #define gdt_cct_NetworkConnectionInfo_init_zero  {false, _gdt_cct_NetworkConnectionInfo_NetworkType_MIN, false, _gdt_cct_NetworkConnectionInfo_MobileSubtype_MIN}
 #define gdt_cct_MacClientInfo_init_zero          {NULL, NULL, NULL, NULL}
 #define gdt_cct_IosClientInfo_init_zero          {NULL, NULL, NULL, NULL, NULL, NULL, NULL}
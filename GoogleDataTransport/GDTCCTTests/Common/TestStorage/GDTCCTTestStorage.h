@@ -37,6 +37,17 @@ typedef void (^GDTCCTTestStorageHasEventsHandler)(GDTCORTarget target,
 @property(nonatomic, nullable) XCTestExpectation *removeBatchAndDeleteEventsExpectation;
 @property(nonatomic, nullable) XCTestExpectation *removeBatchWithoutDeletingEventsExpectation;
 @property(nonatomic, nullable) XCTestExpectation *batchIDsForTargetExpectation;
+@property(nonatomic, nullable) XCTestExpectation *storeRequestBodyExpectation;
+
+#pragma mark - Optional behavior.
+
+/// If YES, the storage implements `pendingBatchWithEventSelector:` and
+/// `storeRequestBody:forBatchID:retryDate:`, so the uploader resumes the batches instead of
+/// removing them. NO by default.
+@property(nonatomic) BOOL resumesBatches;
+
+/// The retry date the last request body was stored with.
+@property(nonatomic, readonly, nullable) NSDate *lastRequestBodyRetryDate;
 
 #pragma mark - Blocks to provide custom implementations for the methods.
 
@@ -31,6 +31,9 @@
 
   /** Store the batches in memory. */
   NSMutableDictionary<NSNumber *, NSSet<GDTCOREvent *> *> *_batches;
+
+  /** Store the request bodies of the batches in memory. */
+  NSMutableDictionary<NSNumber *, NSData *> *_requestBodies;
 }
 
 @synthesize delegate = _delegate;
@@ -40,10 +43,19 @@
   if (self) {
     _storedEvents = [[NSMutableDictionary alloc] init];
     _batches = [[NSMutableDictionary alloc] init];
+    _requestBodies = [[NSMutableDictionary alloc] init];
   }
   return self;
 }
 
+- (BOOL)respondsToSelector:(SEL)aSelector {
+  if (aSelector == @selector(pendingBatchWithEventSelector:) ||
+      aSelector == @selector(storeRequestBody:forBatchID:retryDate:)) {
+    return self.resumesBatches;
+  }
+  return [super respondsToSelector:aSelector];
+}
+
 - (void)storeEvent:(GDTCOREvent *)event
         onComplete:(void (^_Nullable)(BOOL wasWritten, NSError *_Nullable))completion {
   _storedEvents[event.eventID] = event;
@@ -73,12 +85,14 @@
                onComplete:(void (^_Nullable)(void))onComplete {
   if (deleteEvents) {
     [_batches removeObjectForKey:batchID];
+    [_requestBodies removeObjectForKey:batchID];
     [self.removeBatchAndDeleteEventsExpectation fulfill];
   } else {
     for (GDTCOREvent *batchedEvent in _batches[batchID]) {
       _storedEvents[batchedEvent.eventID] = batchedEvent;
     }
     [_batches removeObjectForKey:batchID];
+    [_requestBodies removeObjectForKey:batchID];
     [self.removeBatchWithoutDeletingEventsExpectation fulfill];
   }
 
@@ -209,6 +223,39 @@
       }];
 }
 
+- (FBLPromise<GDTCORUploadBatch *> *)pendingBatchWithEventSelector:
+    (GDTCORStorageEventSelector *)eventSelector {
+  NSSet<NSNumber *> *qosTiers = eventSelector.selectedQosTiers;
+  NSNumber *batchID;
+  for (NSNumber *openBatchID in [[_batches allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+    NSSet<NSNumber *> *batchQosTiers = [_batches[openBatchID] valueForKey:@"qosTier"];
+    if (qosTiers == nil || [batchQosTiers isSubsetOfSet:qosTiers]) {
+      batchID = openBatchID;
+      break;
+    }
+    [self removeBatchWithID:openBatchID deleteEvents:NO onComplete:nil];
+  }
+  if (batchID == nil) {
+    return [FBLPromise
+        resolvedWith:[self genericRejectedPromiseErrorWithReason:@"There is no open batch."]];
+  }
+  GDTCORUploadBatch *batch = [[GDTCORUploadBatch alloc] initWithBatchID:batchID
+                                                                 events:_batches[batchID]];
+  if (_requestBodies[batchID]) {
+    batch = [batch batchWithRequestBody:_requestBodies[batchID]];
+  }
+  return [FBLPromise resolvedWith:batch];
+}
+
+- (FBLPromise<NSNull *> *)storeRequestBody:(NSData *)requestBody
+                                forBatchID:(NSNumber *)batchID
+                                 retryDate:(NSDate *)retryDate {
+  _requestBodies[batchID] = requestBody;
+  _lastRequestBodyRetryDate = retryDate;
+  [self.storeRequestBodyExpectation fulfill];
+  return [FBLPromise resolvedWith:[NSNull null]];
+}
+
 - (FBLPromise<NSNull *> *)fetchAndUpdateMetricsWithHandler:
     (GDTCORMetricsMetadata * (^)(GDTCORMetricsMetadata *_Nullable fetchedMetadata,
                                  NSError *_Nullable fetchError))handler {
@@ -23,6 +23,7 @@
 
 #import <SystemConfiguration/SCNetworkReachability.h>
 
+#import "GoogleDataTransport/GDTCCTLibrary/Private/GDTCCTNanopbHelpers.h"
 #import "GoogleDataTransport/GDTCCTLibrary/Private/GDTCCTUploader.h"
 #import "GoogleDataTransport/GDTCCTLibrary/Protogen/nanopb/cct.nanopb.h"
 
@@ -65,7 +66,7 @@ static NSString *const kMetricEventMappingID = @"1710";
 
 - (void)setUp {
   // Cancel pending operations from previous tests and wait for them to finish.
-  [[GDTCCTUploader sharedInstance].uploadOperationQueue cancelAllOperations];
+  [[GDTCCTUploader sharedInstance] cancelAllUploadOperations];
   [[GDTCCTUploader sharedInstance] waitForUploadFinishedWithTimeout:5];
 
   // Make sure clean storage state before start.
@@ -232,6 +233,7 @@ static NSString *const kMetricEventMappingID = @"1710";
             [GDTCCTTestRequestParser requestWithData:dataRequest.data error:&decodeError];
         XCTAssertNil(decodeError);
         __auto_type events = [GDTCCTTestRequestParser eventsWithBatchRequest:decodedRequest];
+        GDTCCTReleaseBatchedLogRequest(&decodedRequest);
         [weakSelf.serverReceivedEvents addObjectsFromArray:events];
 
         // Send response.
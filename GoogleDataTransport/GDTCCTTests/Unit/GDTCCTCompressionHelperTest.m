@@ -0,0 +1,150 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "GoogleDataTransport/GDTCCTLibrary/Private/GDTCCTCompressionHelper.h"
+
+#import "GoogleDataTransport/GDTCCTTests/Unit/Helpers/NSData+GDTCCTGunzip.h"
+
+@interface GDTCCTCompressionHelperTest : XCTestCase
+
+@end
+
+@implementation GDTCCTCompressionHelperTest
+
+/** Tests that gzipped data decompresses to the original data. */
+- (void)testGzippedDataDecompressesToData {
+  NSData *data = [self compressibleDataWithLength:100 * 1024];
+  NSData *gzippedData = [GDTCCTCompressionHelper gzippedData:data];
+  XCTAssertTrue([GDTCCTCompressionHelper isGzipped:gzippedData]);
+  XCTAssertLessThan(gzippedData.length, data.length);
+  XCTAssertEqualObjects([gzippedData gunzippedData], data);
+}
+
+/** Tests that data appended to a gzip stream in pieces of varying size decompresses to the data. */
+- (void)testGzipStreamDecompressesToAppendedData {
+  NSData *data = [self compressibleDataWithLength:200 * 1024];
+
+  GDTCCTGzipStream *stream = [[GDTCCTGzipStream alloc] init];
+  XCTAssertNotNil(stream);
+  [self appendData:data toStream:stream];
+  XCTAssertEqual(stream.uncompressedLength, data.length);
+
+  NSData *gzippedData = [stream finish];
+  XCTAssertTrue([GDTCCTCompressionHelper isGzipped:gzippedData]);
+  XCTAssertLessThan(gzippedData.length, data.length);
+  XCTAssertEqualObjects([gzippedData gunzippedData], data);
+}
+
+/** Tests that an empty gzip stream produces valid gzip data. */
+- (void)testGzipStreamWithoutAppendedData {
+  GDTCCTGzipStream *stream = [[GDTCCTGzipStream alloc] init];
+  NSData *gzippedData = [stream finish];
+  XCTAssertTrue([GDTCCTCompressionHelper isGzipped:gzippedData]);
+  XCTAssertEqualObjects([gzippedData gunzippedData], [NSData data]);
+}
+
+/** Tests that an adaptive stream doesn't compress tiny payloads. */
+- (void)testAdaptiveGzipStreamWithTinyPayload {
+  NSData *data = [self compressibleDataWithLength:200];
+  GDTCCTGzipStream *stream =
+      [[GDTCCTGzipStream alloc] initWithUploadConditions:GDTCORUploadConditionWifiData];
+  [self appendData:data toStream:stream];
+
+  XCTAssertEqualObjects([stream finish], data);
+  XCTAssertFalse(stream.isCompressed);
+  XCTAssertEqual(stream.compressionLevel, 0);
+  XCTAssertEqual(stream.compressionRatio, 1);
+}
+
+/** Tests that an adaptive stream doesn't compress payloads that start with incompressible bytes. */
+- (void)testAdaptiveGzipStreamWithIncompressiblePayload {
+  NSMutableData *data = [NSMutableData dataWithLength:100 * 1024];
+  arc4random_buf(data.mutableBytes, data.length);
+  GDTCCTGzipStream *stream =
+      [[GDTCCTGzipStream alloc] initWithUploadConditions:GDTCORUploadConditionWifiData];
+  [self appendData:data toStream:stream];
+
+  XCTAssertEqualObjects([stream finish], data);
+  XCTAssertFalse(stream.isCompressed);
+  XCTAssertEqual(stream.compressionLevel, 0);
+}
+
+/** Tests that an adaptive stream compresses harder on mobile data. */
+- (void)testAdaptiveGzipStreamOnMobileData {
+  NSData *data = [self compressibleDataWithLength:100 * 1024];
+  GDTCCTGzipStream *stream =
+      [[GDTCCTGzipStream alloc] initWithUploadConditions:GDTCORUploadConditionMobileData];
+  [self appendData:data toStream:stream];
+  NSData *gzippedData = [stream finish];
+
+  XCTAssertTrue(stream.isCompressed);
+  XCTAssertEqual(stream.compressionLevel, 9);
+  XCTAssertEqualWithAccuracy(stream.compressionRatio, (double)gzippedData.length / data.length,
+                             0.0001);
+  XCTAssertLessThan(stream.compressionRatio, 1);
+  XCTAssertGreaterThan(stream.compressionCPUTime, 0);
+  XCTAssertEqualObjects([gzippedData gunzippedData], data);
+}
+
+/** Tests that an adaptive stream switches to a faster level once the payload is large. */
+- (void)testAdaptiveGzipStreamWithLargePayloadOnWifi {
+  NSData *data = [self compressibleDataWithLength:1024 * 1024];
+  GDTCCTGzipStream *stream =
+      [[GDTCCTGzipStream alloc] initWithUploadConditions:GDTCORUploadConditionWifiData];
+  [self appendData:data toStream:stream];
+  NSData *gzippedData = [stream finish];
+
+  XCTAssertTrue(stream.isCompressed);
+  XCTAssertEqual(stream.compressionLevel, 1);
+  XCTAssertEqualObjects([gzippedData gunzippedData], data);
+}
+
+/** Tests that a finished gzip stream can't be appended to. */
+- (void)testGzipStreamAfterFinish {
+  GDTCCTGzipStream *stream = [[GDTCCTGzipStream alloc] init];
+  XCTAssertNotNil([stream finish]);
+  XCTAssertFalse([stream appendBytes:"a" length:1]);
+  XCTAssertNil([stream finish]);
+}
+
+#pragma mark - Helpers
+
+/** Returns text-like data of the given length. */
+- (NSData *)compressibleDataWithLength:(NSUInteger)length {
+  NSMutableData *data = [NSMutableData dataWithCapacity:length];
+  for (NSUInteger i = 0; data.length < length; i++) {
+    [data appendData:[[NSString stringWithFormat:@"event %lu;", (unsigned long)i]
+                         dataUsingEncoding:NSUTF8StringEncoding]];
+  }
+  data.length = length;
+  return data;
+}
+
+/** Appends the data to the stream in pieces of varying length. */
+- (void)appendData:(NSData *)data toStream:(GDTCCTGzipStream *)stream {
+  NSUInteger offset = 0;
+  NSUInteger pieceLength = 1;
+  while (offset < data.length) {
+    NSUInteger length = MIN(pieceLength, data.length - offset);
+    XCTAssertTrue([stream appendBytes:(const char *)data.bytes + offset length:length]);
+    offset += length;
+    pieceLength = pieceLength * 3 % 40000 + 1;
+  }
+}
+
+@end
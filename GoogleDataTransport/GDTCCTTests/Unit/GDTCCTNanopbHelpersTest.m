@@ -19,7 +19,10 @@
 #import <nanopb/pb_decode.h>
 
 #import "GoogleDataTransport/GDTCCTTests/Unit/Helpers/GDTCCTEventGenerator.h"
+#import "GoogleDataTransport/GDTCCTTests/Unit/Helpers/GDTCCTTestRequestParser.h"
+#import "GoogleDataTransport/GDTCCTTests/Unit/Helpers/NSData+GDTCCTGunzip.h"
 
+#import "GoogleDataTransport/GDTCCTLibrary/Private/GDTCCTCompressionHelper.h"
 #import "GoogleDataTransport/GDTCCTLibrary/Private/GDTCCTNanopbHelpers.h"
 
 @interface GDTCCTNanopbHelpersTest : XCTestCase
@@ -70,7 +73,7 @@
   }
   gdt_cct_BatchedLogRequest batch = gdt_cct_BatchedLogRequest_init_default;
   XCTAssertNoThrow((batch = GDTCCTConstructBatchedLogRequest(@{@"1018" : storedEvents})));
-  pb_release(gdt_cct_BatchedLogRequest_fields, &batch);
+  GDTCCTReleaseBatchedLogRequest(&batch);
 }
 
 /** Tests batched log requests include platform-specific client info. */
@@ -90,7 +93,7 @@
   XCTAssertTrue(batch.log_request->client_info.has_mac_client_info);
   XCTAssertFalse(batch.log_request->client_info.has_ios_client_info);
 #endif
-  pb_release(gdt_cct_BatchedLogRequest_fields, &batch);
+  GDTCCTReleaseBatchedLogRequest(&batch);
 }
 
 /** Tests encoding a batched log request generates bytes equivalent to canonical protobuf. */
@@ -116,7 +119,22 @@
   NSData *encodedBatchLogRequest;
   XCTAssertNoThrow((encodedBatchLogRequest = GDTCCTEncodeBatchedLogRequest(&batch)));
   XCTAssertNotNil(encodedBatchLogRequest);
-  pb_release(gdt_cct_BatchedLogRequest_fields, &batch);
+  GDTCCTReleaseBatchedLogRequest(&batch);
+}
+
+/** Tests that the gzipped encoding decompresses to the uncompressed encoding. */
+- (void)testGzippedEncodingMatchesEncoding {
+  NSSet<GDTCOREvent *> *storedEvents =
+      [NSSet setWithArray:[self.generator generateTheFiveConsistentEvents]];
+  gdt_cct_BatchedLogRequest batch = GDTCCTConstructBatchedLogRequest(@{@"1018" : storedEvents});
+  NSData *encodedBatchLogRequest = GDTCCTEncodeBatchedLogRequest(&batch);
+  GDTCCTGzipStream *gzipStream = [[GDTCCTGzipStream alloc] init];
+  NSData *gzippedBatchLogRequest = GDTCCTEncodeGzippedBatchedLogRequest(&batch, gzipStream);
+  GDTCCTReleaseBatchedLogRequest(&batch);
+
+  XCTAssertTrue([GDTCCTCompressionHelper isGzipped:gzippedBatchLogRequest]);
+  XCTAssertEqual(gzipStream.uncompressedLength, encodedBatchLogRequest.length);
+  XCTAssertEqualObjects([gzippedBatchLogRequest gunzippedData], encodedBatchLogRequest);
 }
 
 /** Tests that the bytes generated are decodable. */
@@ -135,7 +153,7 @@
                  batch.log_request[0].log_event[0].event_time_ms);
   XCTAssertEqual(decodedBatch.log_request[0].log_event[0].event_uptime_ms,
                  batch.log_request[0].log_event[0].event_uptime_ms);
-  pb_release(gdt_cct_BatchedLogRequest_fields, &batch);
+  GDTCCTReleaseBatchedLogRequest(&batch);
   pb_release(gdt_cct_BatchedLogRequest_fields, &decodedBatch);
 }
 
@@ -151,6 +169,31 @@
   }
   XCTAssertEqual(eventsThatContainProductData, 2,
                  @"Only two of the five events should have compliance data.");
+  GDTCCTReleaseBatchedLogRequest(&batch);
+}
+
+/** Tests that the data objects of the events are encoded from the event payloads. */
+- (void)testEncodedBatchContainsEventPayloads {
+  NSArray<GDTCOREvent *> *storedEvents = [self.generator generateTheFiveConsistentEvents];
+  gdt_cct_BatchedLogRequest batch =
+      GDTCCTConstructBatchedLogRequest(@{@"1018" : [NSSet setWithArray:storedEvents]});
+  NSData *encodedBatchLogRequest = GDTCCTEncodeBatchedLogRequest(&batch);
+  XCTAssertNotNil(encodedBatchLogRequest);
+
+  NSError *error;
+  gdt_cct_BatchedLogRequest decodedBatch =
+      [GDTCCTTestRequestParser requestWithData:encodedBatchLogRequest error:&error];
+  XCTAssertNil(error);
+  NSArray<GDTCOREvent *> *decodedEvents =
+      [GDTCCTTestRequestParser eventsWithBatchRequest:decodedBatch];
+  NSCountedSet *expectedPayloads =
+      [[NSCountedSet alloc] initWithArray:[storedEvents valueForKey:@"serializedDataObjectBytes"]];
+  NSCountedSet *decodedPayloads =
+      [[NSCountedSet alloc] initWithArray:[decodedEvents valueForKey:@"serializedDataObjectBytes"]];
+  XCTAssertEqualObjects(decodedPayloads, expectedPayloads);
+
+  GDTCCTReleaseBatchedLogRequest(&batch);
+  GDTCCTReleaseBatchedLogRequest(&decodedBatch);
 }
 
 - (void)testDecodedEventTimestampMatchToBatchContent {
@@ -171,7 +214,7 @@
   XCTAssertEqual(decodedLogEvent.timezone_offset_seconds,
                  storedEvent.clockSnapshot.timezoneOffsetSeconds);
 
-  pb_release(gdt_cct_BatchedLogRequest_fields, &batch);
+  GDTCCTReleaseBatchedLogRequest(&batch);
   pb_release(gdt_cct_BatchedLogRequest_fields, &decodedBatch);
 }
 
@@ -210,7 +253,7 @@
     }
   }
   XCTAssertFalse(allZeroes);
-  pb_release(gdt_cct_BatchedLogRequest_fields, &batch);
+  GDTCCTReleaseBatchedLogRequest(&batch);
 }
 
 - (void)testSimpleByteEncodingConsistency {
@@ -22,6 +22,7 @@
 #import "GoogleDataTransport/GDTCORTests/Common/Categories/GDTCORRegistrar+Testing.h"
 
 #import "GoogleDataTransport/GDTCCTLibrary/Private/GDTCCTNanopbHelpers.h"
+#import "GoogleDataTransport/GDTCCTLibrary/Private/GDTCCTUploadOperation.h"
 #import "GoogleDataTransport/GDTCCTLibrary/Private/GDTCCTUploader.h"
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORMetrics.h"
 
@@ -164,8 +165,9 @@ typedef NS_ENUM(NSInteger, GDTNextRequestWaitTimeSource) {
  * Once 1st finished, another one can be started. */
 - (void)testUploadTargetWhenThereIsOngoingUploadThenNoOp {
   // 0. Set up expectations to track 1st upload progress.
-  // 0.1. Configure no next request wait time.
+  // 0.1. Configure no next request wait time and upload a single batch per operation.
   self.testServer.responseNextRequestWaitTime = 0;
+  self.uploader.uploadByteBudget = 1;
 
   // 0.2. Generate and store and an event.
   [self.generator generateEvent:GDTCOREventQoSFast];
@@ -261,6 +263,212 @@ typedef NS_ENUM(NSInteger, GDTNextRequestWaitTimeSource) {
   [self waitForUploadOperationsToFinish:self.uploader];
 }
 
+- (void)testUploadTarget_WhenAnotherTargetIsUploading_ThenTargetsAreUploadedConcurrently {
+  // 0. Store an event for a second target.
+  GDTCCTTestStorage *CSHStorage = [[GDTCCTTestStorage alloc] init];
+  [[GDTCORRegistrar sharedInstance] registerStorage:CSHStorage target:kGDTCORTargetCSH];
+  CSHStorage.hasEventsForTargetHandler =
+      ^(GDTCORTarget target, GDTCCTTestStorageHasEventsCompletion _Nonnull completion) {
+        completion(YES);
+      };
+  [[[GDTCCTEventGenerator alloc] initWithTarget:kGDTCORTargetCSH]
+      generateEvent:GDTCOREventQoSFast];
+
+  // 1. Store an event for the test target.
+  [self.generator generateEvent:GDTCOREventQoSFast];
+  XCTestExpectation *hasEventsExpectation = [self expectStorageHasEventsForTarget:kGDTCORTargetTest
+                                                                           result:YES];
+
+  // 2. Hold the server responses until both targets have sent a request.
+  NSMutableArray<dispatch_block_t> *responseBlocks = [NSMutableArray array];
+  XCTestExpectation *serverRequestsExpectation =
+      [self expectationWithDescription:@"serverRequestsExpectation"];
+  serverRequestsExpectation.expectedFulfillmentCount = 2;
+  self.testServer.requestHandler =
+      ^(GCDWebServerRequest *_Nonnull request, GCDWebServerResponse *_Nullable suggestedResponse,
+        GCDWebServerCompletionBlock _Nonnull completionBlock) {
+        @synchronized(responseBlocks) {
+          [responseBlocks addObject:^{
+            completionBlock(suggestedResponse);
+          }];
+        }
+        [serverRequestsExpectation fulfill];
+      };
+
+  // 3. Start the uploads.
+  [self.uploader uploadTarget:kGDTCORTargetTest withConditions:GDTCORUploadConditionWifiData];
+  [self.uploader uploadTarget:kGDTCORTargetCSH withConditions:GDTCORUploadConditionWifiData];
+
+  [self waitForExpectations:@[ hasEventsExpectation, serverRequestsExpectation ] timeout:1];
+
+  // 4. Finish the uploads.
+  @synchronized(responseBlocks) {
+    for (dispatch_block_t responseBlock in responseBlocks) {
+      responseBlock();
+    }
+  }
+  [self waitForUploadOperationsToFinish:self.uploader];
+}
+
+- (void)testUploadTarget_WhenThereIsOngoingUpload_ThenPendingRequestsAreCoalesced {
+  // 0. Start an upload and hold the server response.
+  [self.generator generateEvent:GDTCOREventQoSFast];
+  XCTestExpectation *hasEventsExpectation = [self expectStorageHasEventsForTarget:kGDTCORTargetTest
+                                                                           result:YES];
+
+  __block dispatch_block_t requestCompletionBlock;
+  __auto_type __weak weakSelf = self;
+  XCTestExpectation *serverRequestExpectation =
+      [self expectationWithDescription:@"serverRequestExpectation"];
+  self.testServer.requestHandler =
+      ^(GCDWebServerRequest *_Nonnull request, GCDWebServerResponse *_Nullable suggestedResponse,
+        GCDWebServerCompletionBlock _Nonnull completionBlock) {
+        weakSelf.testServer.requestHandler = nil;
+        requestCompletionBlock = ^{
+          completionBlock(suggestedResponse);
+        };
+        [serverRequestExpectation fulfill];
+      };
+
+  [self.uploader uploadTarget:kGDTCORTargetTest withConditions:GDTCORUploadConditionWifiData];
+  [self waitForExpectations:@[ hasEventsExpectation, serverRequestExpectation ] timeout:1];
+
+  // 1. Request more uploads for the target while the first one is in progress.
+  for (NSInteger i = 0; i < 3; i++) {
+    [self.uploader uploadTarget:kGDTCORTargetTest withConditions:GDTCORUploadConditionWifiData];
+  }
+
+  // 2. Expect the in progress operation and a single pending one.
+  XCTAssertEqual([self.uploader uploadOperationQueueForTarget:kGDTCORTargetTest].operationCount,
+                 2);
+
+  // 3. Finish the upload.
+  requestCompletionBlock();
+  [self waitForUploadOperationsToFinish:self.uploader];
+}
+
+- (void)testUploadTarget_WhenEventsDontFitInOneBatch_ThenBatchesAreUploadedUntilStorageIsEmpty {
+  // 0. Batch a single event at a time, three times.
+  [self configureStorageToBatchSingleEvents:3];
+  self.testServer.responseNextRequestWaitTime = 0;
+
+  // 1. Expect a request for each batch.
+  XCTestExpectation *responseSentExpectation = [self expectationTestServerSuccessRequestResponse];
+  responseSentExpectation.expectedFulfillmentCount = 3;
+
+  // 2. Start upload once.
+  [self.uploader uploadTarget:kGDTCORTargetTest withConditions:GDTCORUploadConditionWifiData];
+
+  [self waitForExpectations:@[ responseSentExpectation ] timeout:3];
+  [self waitForUploadOperationsToFinish:self.uploader];
+}
+
+- (void)testUploadTarget_WhenBackendAsksToWait_ThenNextBatchIsNotUploaded {
+  // 0. Batch a single event at a time, and ask to wait after the first request.
+  [self configureStorageToBatchSingleEvents:3];
+  self.testServer.responseNextRequestWaitTime = 42;
+
+  // 1. Expect a single request.
+  XCTestExpectation *responseSentExpectation = [self expectationTestServerSuccessRequestResponse];
+  responseSentExpectation.assertForOverFulfill = YES;
+
+  // 2. Start upload.
+  [self.uploader uploadTarget:kGDTCORTargetTest withConditions:GDTCORUploadConditionHighPriority];
+
+  [self waitForExpectations:@[ responseSentExpectation ] timeout:1];
+  [self waitForUploadOperationsToFinish:self.uploader];
+}
+
+- (void)testUploadTarget_WhenByteBudgetIsSpent_ThenNextBatchIsNotUploaded {
+  // 0. Batch a single event at a time, and allow a single request worth of bytes.
+  [self configureStorageToBatchSingleEvents:3];
+  self.testServer.responseNextRequestWaitTime = 0;
+  self.uploader.uploadByteBudget = 1;
+
+  // 1. Expect a single request.
+  XCTestExpectation *responseSentExpectation = [self expectationTestServerSuccessRequestResponse];
+  responseSentExpectation.assertForOverFulfill = YES;
+
+  // 2. Start upload.
+  [self.uploader uploadTarget:kGDTCORTargetTest withConditions:GDTCORUploadConditionWifiData];
+
+  [self waitForExpectations:@[ responseSentExpectation ] timeout:1];
+  [self waitForUploadOperationsToFinish:self.uploader];
+}
+
+- (void)testUploadTarget_WhenPipelined_ThenNextBatchIsPreparedWhileBatchIsInFlight {
+  // 0. Batch a single event at a time, twice, and prepare a batch ahead.
+  [self configureStorageToBatchSingleEvents:2];
+  self.testServer.responseNextRequestWaitTime = 0;
+  self.uploader.uploadPipelineDepth = 2;
+
+  // 1. Hold the response to the first request.
+  __block dispatch_block_t requestCompletionBlock;
+  __auto_type __weak weakSelf = self;
+  XCTestExpectation *serverRequestExpectation =
+      [self expectationWithDescription:@"serverRequestExpectation"];
+  self.testServer.requestHandler =
+      ^(GCDWebServerRequest *_Nonnull request, GCDWebServerResponse *_Nullable suggestedResponse,
+        GCDWebServerCompletionBlock _Nonnull completionBlock) {
+        weakSelf.testServer.requestHandler = nil;
+        requestCompletionBlock = ^{
+          completionBlock(suggestedResponse);
+        };
+        [serverRequestExpectation fulfill];
+      };
+
+  self.testStorage.batchWithEventSelectorExpectation =
+      [self expectationWithDescription:@"batchWithEventSelectorExpectation"];
+  self.testStorage.batchWithEventSelectorExpectation.expectedFulfillmentCount = 2;
+
+  // 2. Start upload and expect both batches to be formed while the first one is in flight.
+  [self.uploader uploadTarget:kGDTCORTargetTest withConditions:GDTCORUploadConditionWifiData];
+  [self waitForExpectations:@[
+    serverRequestExpectation, self.testStorage.batchWithEventSelectorExpectation
+  ]
+                    timeout:1];
+
+  // 3. Release the first response and expect the prepared batch to be sent.
+  XCTestExpectation *responseSentExpectation = [self expectationTestServerSuccessRequestResponse];
+  responseSentExpectation.expectedFulfillmentCount = 2;
+  requestCompletionBlock();
+
+  [self waitForExpectations:@[ responseSentExpectation ] timeout:1];
+  [self waitForUploadOperationsToFinish:self.uploader];
+}
+
+- (void)testUploadTarget_WhenPipelinedBatchIsNotDelivered_ThenPreparedBatchIsDissolved {
+  // 0. Batch a single event at a time, twice, and prepare a batch ahead.
+  [self configureStorageToBatchSingleEvents:2];
+  self.uploader.uploadPipelineDepth = 2;
+
+  // 1. Expect both batches to be formed, and then removed without deleting the events.
+  self.testStorage.batchWithEventSelectorExpectation =
+      [self expectationWithDescription:@"batchWithEventSelectorExpectation"];
+  self.testStorage.batchWithEventSelectorExpectation.expectedFulfillmentCount = 2;
+  self.testStorage.removeBatchWithoutDeletingEventsExpectation =
+      [self expectationWithDescription:@"removeBatchWithoutDeletingEventsExpectation"];
+  self.testStorage.removeBatchWithoutDeletingEventsExpectation.expectedFulfillmentCount = 2;
+  self.testStorage.removeBatchAndDeleteEventsExpectation =
+      [self expectationWithDescription:@"removeBatchAndDeleteEventsExpectation"];
+  self.testStorage.removeBatchAndDeleteEventsExpectation.inverted = YES;
+
+  // 2. Expect the first batch to fail with a transient error.
+  XCTestExpectation *responseSentExpectation = [self expectationTestServerResponseWithCode:500
+                                                                                   headers:@{}];
+
+  // 3. Start upload.
+  [self.uploader uploadTarget:kGDTCORTargetTest withConditions:GDTCORUploadConditionWifiData];
+
+  [self waitForExpectations:@[
+    self.testStorage.batchWithEventSelectorExpectation, responseSentExpectation,
+    self.testStorage.removeBatchWithoutDeletingEventsExpectation,
+    self.testStorage.removeBatchAndDeleteEventsExpectation
+  ]
+                    timeout:1];
+  [self waitForUploadOperationsToFinish:self.uploader];
+}
+
 - (void)testUploadTargetFailure503 {
   [self sendEventFailureWithStatusCode:503 headers:nil expectEventsToBeRemoved:NO];
 }
@@ -288,6 +496,147 @@ typedef NS_ENUM(NSInteger, GDTNextRequestWaitTimeSource) {
   [self sendEventSuccessfully];
 }
 
+/** Tests that when the storage supports resuming batches, a batch failing with a transient error is
+ * kept with its request body, and sent again as is by the next attempt. */
+- (void)testUploadTarget_WhenStorageResumesBatches_ThenFailedBatchIsSentAgainAsIs {
+  self.testStorage.resumesBatches = YES;
+  [self.generator generateEvent:GDTCOREventQoSFast];
+
+  // 1. Fail the first attempt with a transient error.
+  // 1.1. Expect a new batch to be created and kept with its request body.
+  [self setUpStorageExpectations];
+  self.testStorage.storeRequestBodyExpectation =
+      [self expectationWithDescription:@"storeRequestBodyExpectation"];
+  self.testStorage.batchIDsForTargetExpectation.inverted = YES;
+  self.testStorage.removeBatchWithoutDeletingEventsExpectation.inverted = YES;
+  self.testStorage.removeBatchAndDeleteEventsExpectation.inverted = YES;
+  XCTestExpectation *hasEventsExpectation =
+      [self expectStorageHasEventsForTarget:self.generator.target result:YES];
+  XCTestExpectation *responseSentExpectation =
+      [self expectationTestServerResponseWithCode:503 headers:@{@"Retry-After" : @"0"}];
+
+  // 1.2. Start upload.
+  [self.uploader uploadTarget:self.generator.target withConditions:GDTCORUploadConditionWifiData];
+
+  // 1.3. Wait for operations to complete in the specified order.
+  [self waitForExpectations:@[
+    hasEventsExpectation, self.testStorage.batchWithEventSelectorExpectation,
+    responseSentExpectation, self.testStorage.storeRequestBodyExpectation,
+    self.testStorage.batchIDsForTargetExpectation,
+    self.testStorage.removeBatchWithoutDeletingEventsExpectation,
+    self.testStorage.removeBatchAndDeleteEventsExpectation
+  ]
+                    timeout:1
+               enforceOrder:YES];
+  [self waitForUploadOperationsToFinish:self.uploader];
+
+  // 2. Expect the next attempt to send the kept batch without creating a new one.
+  // 2.1. Set up expectations.
+  [self setUpStorageExpectations];
+  self.testStorage.storeRequestBodyExpectation = nil;
+  self.testStorage.batchIDsForTargetExpectation.inverted = YES;
+  self.testStorage.batchWithEventSelectorExpectation.inverted = YES;
+  self.testStorage.removeBatchWithoutDeletingEventsExpectation.inverted = YES;
+  XCTestExpectation *hasEventsExpectation2 =
+      [self expectStorageHasEventsForTarget:self.generator.target result:YES];
+  hasEventsExpectation2.inverted = YES;
+  responseSentExpectation = [self expectationTestServerSuccessRequestResponse];
+
+  // 2.2. Start upload.
+  [self.uploader uploadTarget:self.generator.target withConditions:GDTCORUploadConditionWifiData];
+
+  // 2.3. Wait for operations to complete in the specified order.
+  [self waitForExpectations:@[
+    responseSentExpectation, self.testStorage.removeBatchAndDeleteEventsExpectation,
+    hasEventsExpectation2, self.testStorage.batchIDsForTargetExpectation,
+    self.testStorage.batchWithEventSelectorExpectation,
+    self.testStorage.removeBatchWithoutDeletingEventsExpectation
+  ]
+                    timeout:1
+               enforceOrder:YES];
+  [self waitForUploadOperationsToFinish:self.uploader];
+}
+
+/** Tests that when a batch with metrics is kept for the next attempt, the metrics are placed back
+ * in storage right away instead of being stored in the kept request body. */
+- (void)testUploadTarget_WhenStorageResumesBatchWithMetrics_ThenMetricsAreReStored {
+  self.testStorage.resumesBatches = YES;
+  [self.generator generateEvent:GDTCOREventQoSFast];
+
+  [self setUpStorageExpectations];
+  self.testStorage.storeRequestBodyExpectation =
+      [self expectationWithDescription:@"storeRequestBodyExpectation"];
+  self.testStorage.batchIDsForTargetExpectation.inverted = YES;
+  self.testStorage.removeBatchWithoutDeletingEventsExpectation.inverted = YES;
+  self.testStorage.removeBatchAndDeleteEventsExpectation.inverted = YES;
+  XCTestExpectation *hasEventsExpectation = [self expectStorageHasEventsForTarget:kGDTCORTargetTest
+                                                                           result:YES];
+
+  GDTCORMetricsControllerFake *metricsControllerFake = [[GDTCORMetricsControllerFake alloc] init];
+  [[GDTCORRegistrar sharedInstance] registerMetricsController:metricsControllerFake
+                                                       target:kGDTCORTargetTest];
+  GDTCORMetrics *dummyMetrics = [[GDTCORMetrics alloc] init];
+  XCTestExpectation *getAndResetExpectation =
+      [self expectationWithDescription:@"getAndResetExpectation"];
+  metricsControllerFake.onGetAndResetMetricsHandler = ^FBLPromise<GDTCORMetrics *> * {
+    [getAndResetExpectation fulfill];
+    return [FBLPromise resolvedWith:dummyMetrics];
+  };
+  XCTestExpectation *offerMetricsExpectation =
+      [self expectationWithDescription:@"offerMetricsExpectation"];
+  metricsControllerFake.onOfferMetricsHandler = ^(GDTCORMetrics *metrics) {
+    [offerMetricsExpectation fulfill];
+    XCTAssertEqualObjects(metrics, dummyMetrics);
+  };
+
+  XCTestExpectation *responseFailedExpectation =
+      [self expectationTestServerResponseWithCode:503 headers:@{@"Retry-After" : @"0"}];
+
+  [self.uploader uploadTarget:kGDTCORTargetTest withConditions:GDTCORUploadConditionWifiData];
+
+  [self waitForExpectations:@[
+    hasEventsExpectation, self.testStorage.batchWithEventSelectorExpectation,
+    getAndResetExpectation, responseFailedExpectation, offerMetricsExpectation,
+    self.testStorage.storeRequestBodyExpectation, self.testStorage.batchIDsForTargetExpectation,
+    self.testStorage.removeBatchWithoutDeletingEventsExpectation,
+    self.testStorage.removeBatchAndDeleteEventsExpectation
+  ]
+                    timeout:1
+               enforceOrder:YES];
+  [self waitForUploadOperationsToFinish:self.uploader];
+}
+
+/** Tests that the request body of a kept batch is stored with the date of the next attempt, so that
+ * it is still replayed after the default 15 minute backoff. */
+- (void)testUploadTarget_WhenBatchIsKeptWithDefaultBackoff_ThenRequestBodyRetryDateIsAfterBackoff {
+  self.testStorage.resumesBatches = YES;
+  [self.generator generateEvent:GDTCOREventQoSFast];
+
+  [self setUpStorageExpectations];
+  self.testStorage.storeRequestBodyExpectation =
+      [self expectationWithDescription:@"storeRequestBodyExpectation"];
+  XCTestExpectation *hasEventsExpectation = [self expectStorageHasEventsForTarget:kGDTCORTargetTest
+                                                                           result:YES];
+  // Without a wait time in the response, the next attempt is due in 15 minutes.
+  XCTestExpectation *responseFailedExpectation = [self expectationTestServerResponseWithCode:503
+                                                                                     headers:nil];
+
+  NSDate *uploadDate = [NSDate date];
+  [self.uploader uploadTarget:kGDTCORTargetTest withConditions:GDTCORUploadConditionWifiData];
+
+  [self waitForExpectations:@[
+    hasEventsExpectation, self.testStorage.batchWithEventSelectorExpectation,
+    responseFailedExpectation, self.testStorage.storeRequestBodyExpectation
+  ]
+                    timeout:1
+               enforceOrder:YES];
+  [self waitForUploadOperationsToFinish:self.uploader];
+
+  NSTimeInterval backoff =
+      [self.testStorage.lastRequestBodyRetryDate timeIntervalSinceDate:uploadDate];
+  XCTAssertEqualWithAccuracy(backoff, 15 * 60, 5);
+}
+
 - (void)testUploadTarget_WhenThereAreBothStoredBatchAndEvents_ThenRemoveBatchAndBatchThenAllEvents {
   // 0. Generate test events.
   // 0.1. Generate and store and an event.
@@ -788,6 +1137,12 @@ typedef NS_ENUM(NSInteger, GDTNextRequestWaitTimeSource) {
                              XCTAssertNil(eventSelector.selectedEventIDs);
                              XCTAssertNil(eventSelector.selectedMappingIDs);
                              XCTAssertNil(eventSelector.selectedQosTiers);
+                             XCTAssertEqual(eventSelector.maxEventCount,
+                                            kGDTCCTUploadBatchMaxEventCount);
+                             XCTAssertEqual(eventSelector.maxBatchSizeBytes,
+                                            kGDTCCTUploadBatchMaxSizeBytes);
+                             XCTAssertEqual(eventSelector.order,
+                                            GDTCORStorageEventSelectorOrderPriorityFirst);
                            }];
 }
 
@@ -1042,6 +1397,27 @@ typedef NS_ENUM(NSInteger, GDTNextRequestWaitTimeSource) {
       [self expectationWithDescription:@"removeBatchAndDeleteEventsExpectation"];
 }
 
+/** Configures the test storage to report events until the given number of batches is created, and
+ * to put a single new event in each batch. */
+- (void)configureStorageToBatchSingleEvents:(NSInteger)batchCount {
+  __block NSInteger createdBatchCount = 0;
+  self.testStorage.hasEventsForTargetHandler =
+      ^(GDTCORTarget target, GDTCCTTestStorageHasEventsCompletion _Nonnull completion) {
+        completion(createdBatchCount < batchCount);
+      };
+
+  __weak __auto_type weakSelf = self;
+  self.testStorage.batchWithEventSelectorHandler =
+      ^(GDTCORStorageEventSelector *_Nullable eventSelector, NSDate *_Nullable expiration,
+        GDTCORStorageBatchBlock _Nullable completion) {
+        createdBatchCount++;
+        [weakSelf.generator generateEvent:GDTCOREventQoSFast];
+        [weakSelf.testStorage defaultBatchWithEventSelector:eventSelector
+                                            batchExpiration:expiration
+                                                 onComplete:completion];
+      };
+}
+
 - (void)waitForUploadOperationsToFinish:(GDTCCTUploader *)uploader {
   XCTAssert([self.uploader waitForUploadFinishedWithTimeout:1]);
 }
@@ -28,7 +28,9 @@ NS_ASSUME_NONNULL_BEGIN
 /// @param data The given data to parse.
 /// @param outError If the return value is `nil`, an ``NSError`` indicating why the parsing
 /// operation failed.
-/// @return An instance of ``gdt_cct_BatchedLogRequest``.
+/// @return An instance of ``gdt_cct_BatchedLogRequest``. The source extension of each log event
+/// is attached as its callback argument, so the request must be released with
+/// `GDTCCTReleaseBatchedLogRequest`.
 + (gdt_cct_BatchedLogRequest)requestWithData:(NSData *)data error:(NSError **)outError;
 
 /// Parses the client metrics proto from the provided data.
@@ -20,6 +20,78 @@
 #import <nanopb/pb_decode.h>
 #import <nanopb/pb_encode.h>
 
+/** Field number of `BatchedLogRequest.log_request`. */
+static const uint32_t kLogRequestFieldNumber = 1;
+
+/** Field number of `LogRequest.log_event`. */
+static const uint32_t kLogEventFieldNumber = 3;
+
+/** Field number of `LogEvent.source_extension`. */
+static const uint32_t kSourceExtensionFieldNumber = 6;
+
+/** Advances the stream to the next field with the given number and opens a substream over its
+ * length-delimited value.
+ *
+ * @return false if the stream contains no more such fields or is malformed.
+ */
+static bool GDTCCTTestNextField(pb_istream_t *stream, uint32_t fieldNumber,
+                                pb_istream_t *substream) {
+  pb_wire_type_t wireType;
+  uint32_t tag;
+  bool eof;
+  while (pb_decode_tag(stream, &wireType, &tag, &eof)) {
+    if (tag == fieldNumber && wireType == PB_WT_STRING) {
+      return pb_make_string_substream(stream, substream);
+    }
+    if (!pb_skip_field(stream, wireType)) {
+      return false;
+    }
+  }
+  return false;
+}
+
+/** Skips the unread bytes of the substream and continues the stream after it. */
+static void GDTCCTTestCloseSubstream(pb_istream_t *stream, pb_istream_t *substream) {
+  pb_read(substream, NULL, substream->bytes_left);
+  pb_close_string_substream(stream, substream);
+}
+
+/** Reads the source extension of a log event. nanopb skips the field when decoding because the
+ * library encodes it with a callback.
+ */
+static NSData *GDTCCTTestReadSourceExtension(pb_istream_t *eventStream) {
+  pb_istream_t bytesStream;
+  if (!GDTCCTTestNextField(eventStream, kSourceExtensionFieldNumber, &bytesStream)) {
+    return [NSData data];
+  }
+  NSMutableData *data = [NSMutableData dataWithLength:bytesStream.bytes_left];
+  pb_read(&bytesStream, data.mutableBytes, data.length);
+  GDTCCTTestCloseSubstream(eventStream, &bytesStream);
+  return data;
+}
+
+/** Attaches the source extension of each encoded log event to the decoded log event as its
+ * callback argument, the way GDTCCTConstructLogEvent does.
+ */
+static void GDTCCTTestDecodeSourceExtensions(NSData *data, gdt_cct_BatchedLogRequest *request) {
+  pb_istream_t stream = pb_istream_from_buffer([data bytes], [data length]);
+  pb_istream_t requestStream;
+  for (pb_size_t i = 0; i < request->log_request_count &&
+                        GDTCCTTestNextField(&stream, kLogRequestFieldNumber, &requestStream);
+       i++) {
+    gdt_cct_LogRequest *logRequest = &request->log_request[i];
+    pb_istream_t eventStream;
+    for (pb_size_t j = 0; j < logRequest->log_event_count &&
+                          GDTCCTTestNextField(&requestStream, kLogEventFieldNumber, &eventStream);
+         j++) {
+      NSData *sourceExtension = GDTCCTTestReadSourceExtension(&eventStream);
+      logRequest->log_event[j].source_extension.arg = (__bridge_retained void *)sourceExtension;
+      GDTCCTTestCloseSubstream(&requestStream, &eventStream);
+    }
+    GDTCCTTestCloseSubstream(&stream, &requestStream);
+  }
+}
+
 @implementation GDTCCTTestRequestParser
 
 + (gdt_cct_BatchedLogRequest)requestWithData:(NSData *)data error:(NSError **)outError {
@@ -32,7 +104,9 @@
                                       code:-1
                                   userInfo:@{@"nanopb error" : nanopbError}];
     }
+    return request;
   }
+  GDTCCTTestDecodeSourceExtensions(data, &request);
   return request;
 }
 
@@ -49,8 +123,7 @@
 
       GDTCOREvent *decodedEvent = [[GDTCOREvent alloc] initWithMappingID:mappingID
                                                                   target:kGDTCORTargetTest];
-      decodedEvent.dataObject = [NSData dataWithBytes:event.source_extension->bytes
-                                               length:event.source_extension->size];
+      decodedEvent.dataObject = (__bridge NSData *)event.source_extension.arg;
 
       [events addObject:decodedEvent];
     }
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCCTTests/Unit/Helpers/NSData+GDTCCTGunzip.h"
+
+#import <zlib.h>
+
+@implementation NSData (GDTCCTGunzip)
+
+- (nullable NSData *)gunzippedData {
+  z_stream stream;
+  bzero(&stream, sizeof(z_stream));
+  int windowBits = 15 + 16;  // Expect a gzip header.
+  if (inflateInit2(&stream, windowBits) != Z_OK) {
+    return nil;
+  }
+
+  NSMutableData *result = [NSMutableData data];
+  unsigned char output[1024];
+  stream.next_in = (unsigned char *)self.bytes;
+  stream.avail_in = (uInt)self.length;
+  int retCode;
+  do {
+    stream.next_out = output;
+    stream.avail_out = sizeof(output);
+    retCode = inflate(&stream, Z_NO_FLUSH);
+    [result appendBytes:output length:sizeof(output) - stream.avail_out];
+  } while (retCode == Z_OK);
+  inflateEnd(&stream);
+
+  return retCode == Z_STREAM_END ? result : nil;
+}
+
+@end
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORBatchIDAllocator.h"
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORLibraryDataStore.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORConsoleLogger.h"
+
+const int64_t kGDTCORBatchIDAllocatorBlockSize = 100;
+
+@implementation GDTCORBatchIDAllocator {
+  /** The library data store persisting the high-water mark. */
+  GDTCORLibraryDataStore *_store;
+
+  /** The key of the high-water mark. */
+  NSString *_key;
+
+  /** The number of IDs to reserve by each write. */
+  int64_t _blockSize;
+
+  /** The ID to return next. */
+  int64_t _nextBatchID;
+
+  /** The end of the reserved range of IDs, exclusive. Negative until it is read from disk. */
+  int64_t _highWaterMark;
+}
+
+- (instancetype)initWithLibraryDataStore:(GDTCORLibraryDataStore *)store
+                                     key:(NSString *)key
+                               blockSize:(int64_t)blockSize {
+  self = [super init];
+  if (self) {
+    _store = store;
+    _key = [key copy];
+    _blockSize = MAX(blockSize, 1);
+    _highWaterMark = -1;
+  }
+  return self;
+}
+
+- (nullable NSNumber *)nextBatchID {
+  if (_highWaterMark < 0) {
+    _highWaterMark = [self readHighWaterMark];
+    _nextBatchID = _highWaterMark;
+  }
+  if (_nextBatchID >= _highWaterMark && ![self writeHighWaterMark:_nextBatchID + _blockSize]) {
+    return nil;
+  }
+  return @(_nextBatchID++);
+}
+
+- (void)reset {
+  _highWaterMark = -1;
+}
+
+#pragma mark - Private helper methods
+
+/** Returns the persisted high-water mark, or 0 if there is none. */
+- (int64_t)readHighWaterMark {
+  NSData *data = [_store dataForKey:_key];
+  if (data.length == sizeof(int64_t)) {
+    int64_t highWaterMark;
+    [data getBytes:&highWaterMark length:sizeof(highWaterMark)];
+    return MAX((int64_t)CFSwapInt64LittleToHost(highWaterMark), 0);
+  } else if (data.length == sizeof(int32_t)) {
+    // The counter of previous versions holds the next batch ID.
+    int32_t counter;
+    [data getBytes:&counter length:sizeof(counter)];
+    return MAX(counter, 0);
+  }
+  return 0;
+}
+
+/** Persists a new high-water mark, reserving the IDs below it. The mark is synced to disk before
+ * any ID of the new block is handed out, so that a crash can't make the next launch reuse them.
+ */
+- (BOOL)writeHighWaterMark:(int64_t)highWaterMark {
+  int64_t littleEndianHighWaterMark = CFSwapInt64HostToLittle(highWaterMark);
+  NSData *data = [NSData dataWithBytes:&littleEndianHighWaterMark length:sizeof(int64_t)];
+  NSError *error;
+  if (![_store setData:data forKey:_key error:&error]) {
+    GDTCORLogDebug(@"Error writing the batch ID high-water mark: %@", error);
+    return NO;
+  }
+  if (![_store synchronize]) {
+    GDTCORLogDebug(@"%@", @"Error syncing the batch ID high-water mark.");
+    return NO;
+  }
+  _highWaterMark = highWaterMark;
+  return YES;
+}
+
+@end
@@ -0,0 +1,429 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORBatchJournal.h"
+
+#import <fcntl.h>
+#import <unistd.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORRecordFrame.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORConsoleLogger.h"
+
+/** The value every journal record starts with, "GDTJ" when read as little-endian bytes. */
+static const uint32_t kJournalRecordMagic = 0x4A544447;
+
+/** The journal is rewritten once it is larger than this and mostly made of closed batches. */
+static const uint64_t kJournalCompactionThreshold = 256 * 1024;
+
+/** The types of journal records. */
+typedef NS_ENUM(uint8_t, GDTCORBatchJournalRecordType) {
+  /** The body is a batch: ID, target, expiration and event file names. */
+  GDTCORBatchJournalRecordTypeCreated = 1,
+
+  /** The body is the ID of a batch whose events were uploaded. */
+  GDTCORBatchJournalRecordTypeCommitted = 2,
+
+  /** The body is the ID of a batch whose events were returned to the storage. */
+  GDTCORBatchJournalRecordTypeAborted = 3,
+};
+
+#pragma mark - Record encoding
+
+/** Encodes the body of a created batch record, or returns nil if a file name is too long. */
+static NSData *_Nullable GDTCORJournalBatchBody(GDTCORBatchJournalBatch *batch) {
+  NSMutableData *body = [[NSMutableData alloc] init];
+  GDTCORAppendUInt64(body, (uint64_t)batch.batchID.longLongValue);
+  GDTCORAppendUInt32(body, (uint32_t)batch.target);
+  GDTCORAppendUInt64(body, (uint64_t)(int64_t)(batch.expirationDate.timeIntervalSince1970 * 1000));
+  GDTCORAppendUInt32(body, (uint32_t)batch.eventFilenames.count);
+  for (NSString *filename in batch.eventFilenames) {
+    NSData *utf8 = [filename dataUsingEncoding:NSUTF8StringEncoding];
+    if (utf8.length > UINT16_MAX) {
+      return nil;
+    }
+    GDTCORAppendUInt16(body, (uint16_t)utf8.length);
+    [body appendData:utf8];
+  }
+  return body;
+}
+
+/** Decodes the body of a created batch record, or returns nil if it is malformed. */
+static GDTCORBatchJournalBatch *_Nullable GDTCORJournalBatchFromBody(const uint8_t *bytes,
+                                                                     NSUInteger length) {
+  NSUInteger cursor = 0;
+  if (length < sizeof(uint64_t) * 2 + sizeof(uint32_t) * 2) {
+    return nil;
+  }
+  int64_t batchID = (int64_t)GDTCORReadUInt64(bytes + cursor);
+  cursor += sizeof(uint64_t);
+  GDTCORTarget target = (GDTCORTarget)GDTCORReadUInt32(bytes + cursor);
+  cursor += sizeof(uint32_t);
+  int64_t expirationMillis = (int64_t)GDTCORReadUInt64(bytes + cursor);
+  cursor += sizeof(uint64_t);
+  uint32_t count = GDTCORReadUInt32(bytes + cursor);
+  cursor += sizeof(uint32_t);
+
+  NSMutableArray<NSString *> *filenames = [[NSMutableArray alloc] init];
+  for (uint32_t i = 0; i < count; i++) {
+    if (length - cursor < sizeof(uint16_t)) {
+      return nil;
+    }
+    uint16_t filenameLength = GDTCORReadUInt16(bytes + cursor);
+    cursor += sizeof(uint16_t);
+    if (length - cursor < filenameLength) {
+      return nil;
+    }
+    NSString *filename = [[NSString alloc] initWithBytes:bytes + cursor
+                                                  length:filenameLength
+                                                encoding:NSUTF8StringEncoding];
+    cursor += filenameLength;
+    if (filename == nil) {
+      return nil;
+    }
+    [filenames addObject:filename];
+  }
+  return [[GDTCORBatchJournalBatch alloc]
+      initWithBatchID:@(batchID)
+               target:target
+       expirationDate:[NSDate dateWithTimeIntervalSince1970:expirationMillis / 1000.0]
+       eventFilenames:filenames];
+}
+
+#pragma mark - GDTCORBatchJournalBatch
+
+@implementation GDTCORBatchJournalBatch
+
+- (instancetype)initWithBatchID:(NSNumber *)batchID
+                         target:(GDTCORTarget)target
+                 expirationDate:(NSDate *)expirationDate
+                 eventFilenames:(NSArray<NSString *> *)eventFilenames {
+  self = [super init];
+  if (self) {
+    _batchID = batchID;
+    _target = target;
+    _expirationDate = expirationDate;
+    _eventFilenames = [eventFilenames copy];
+  }
+  return self;
+}
+
+@end
+
+#pragma mark - GDTCORBatchJournal
+
+@implementation GDTCORBatchJournal {
+  /** The path of the journal file. */
+  NSString *_path;
+
+  /** The size tracker to update when the journal file changes. */
+  GDTCORDirectorySizeTracker *_sizeTracker;
+
+  /** The descriptor of the journal file opened for appending, or -1. */
+  int _fileDescriptor;
+
+  /** The size of the journal file. */
+  uint64_t _fileSize;
+
+  /** The length of the start of the journal file made of intact records. */
+  uint64_t _intactLength;
+
+  /** The bytes of the journal file taken by the records of open batches. */
+  uint64_t _liveBytes;
+
+  /** YES if the replayed journal file holds records of closed batches or a torn record. */
+  BOOL _needsCompaction;
+
+  /** The open batches keyed by batch ID. */
+  NSMutableDictionary<NSNumber *, GDTCORBatchJournalBatch *> *_batches;
+
+  /** The length of the record of each open batch keyed by batch ID. */
+  NSMutableDictionary<NSNumber *, NSNumber *> *_recordLengths;
+
+  /** The event file names of the open batches keyed by target. */
+  NSMutableDictionary<NSNumber *, NSMutableSet<NSString *> *> *_batchedFilenames;
+}
+
+- (instancetype)initWithPath:(NSString *)path
+                 sizeTracker:(GDTCORDirectorySizeTracker *)sizeTracker {
+  self = [super init];
+  if (self) {
+    _path = [path copy];
+    _sizeTracker = sizeTracker;
+    _fileDescriptor = -1;
+    _batches = [[NSMutableDictionary alloc] init];
+    _recordLengths = [[NSMutableDictionary alloc] init];
+    _batchedFilenames = [[NSMutableDictionary alloc] init];
+  }
+  return self;
+}
+
+- (void)dealloc {
+  [self closeFile];
+}
+
+- (NSArray<GDTCORBatchJournalBatch *> *)load {
+  if (_isLoaded) {
+    return @[];
+  }
+  _isLoaded = YES;
+
+  NSData *data = [NSData dataWithContentsOfFile:_path options:NSDataReadingMappedIfSafe error:nil];
+  const uint8_t *bytes = data.bytes;
+  uint64_t offset = 0;
+  BOOL hasClosedBatches = NO;
+  NSMutableArray<GDTCORBatchJournalBatch *> *committedBatches = [[NSMutableArray alloc] init];
+  uint8_t type;
+  NSRange bodyRange;
+  while (GDTCORReadRecordFrame(bytes, data.length, offset, kJournalRecordMagic, &type,
+                               &bodyRange)) {
+    uint64_t recordLength = NSMaxRange(bodyRange) - offset;
+    offset = NSMaxRange(bodyRange);
+    if (type == GDTCORBatchJournalRecordTypeCreated) {
+      GDTCORBatchJournalBatch *batch =
+          GDTCORJournalBatchFromBody(bytes + bodyRange.location, bodyRange.length);
+      if (batch) {
+        [self openBatch:batch recordLength:recordLength];
+      }
+      continue;
+    }
+    hasClosedBatches = YES;
+    if (bodyRange.length < sizeof(uint64_t)) {
+      continue;
+    }
+    NSNumber *batchID = @((int64_t)GDTCORReadUInt64(bytes + bodyRange.location));
+    GDTCORBatchJournalBatch *batch = [self closeBatchWithID:batchID];
+    if (batch && type == GDTCORBatchJournalRecordTypeCommitted) {
+      [committedBatches addObject:batch];
+    }
+  }
+  _fileSize = data.length;
+  _intactLength = offset;
+
+  // A record torn by a crash, as well as the records of closed batches, are compacted away by the
+  // next -compactIfNeeded, once the client acted on the committed batches.
+  if (hasClosedBatches || offset < data.length) {
+    GDTCORLogDebug(@"The batch journal needs compaction, %llu of %lu bytes are valid", offset,
+                   (unsigned long)data.length);
+    _needsCompaction = YES;
+  }
+  return committedBatches;
+}
+
+- (void)unload {
+  [self closeFile];
+  [_batches removeAllObjects];
+  [_recordLengths removeAllObjects];
+  [_batchedFilenames removeAllObjects];
+  _fileSize = 0;
+  _intactLength = 0;
+  _liveBytes = 0;
+  _needsCompaction = NO;
+  _isLoaded = NO;
+}
+
+- (BOOL)createBatch:(GDTCORBatchJournalBatch *)batch error:(NSError **)outError {
+  [self load];
+  NSData *body = GDTCORJournalBatchBody(batch);
+  if (body == nil) {
+    if (outError) {
+      *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENAMETOOLONG userInfo:nil];
+    }
+    return NO;
+  }
+  NSData *frame = GDTCORRecordFrame(kJournalRecordMagic, GDTCORBatchJournalRecordTypeCreated, body);
+  if (![self appendFrame:frame error:outError]) {
+    return NO;
+  }
+  [self openBatch:batch recordLength:frame.length];
+  return YES;
+}
+
+- (nullable GDTCORBatchJournalBatch *)commitBatchWithID:(NSNumber *)batchID {
+  return [self closeBatchWithID:batchID recordType:GDTCORBatchJournalRecordTypeCommitted];
+}
+
+- (nullable GDTCORBatchJournalBatch *)abortBatchWithID:(NSNumber *)batchID {
+  return [self closeBatchWithID:batchID recordType:GDTCORBatchJournalRecordTypeAborted];
+}
+
+- (NSArray<GDTCORBatchJournalBatch *> *)openBatches {
+  [self load];
+  return _batches.allValues;
+}
+
+- (BOOL)isEventFileBatched:(NSString *)eventFilename target:(GDTCORTarget)target {
+  [self load];
+  return [_batchedFilenames[@(target)] containsObject:eventFilename];
+}
+
+- (void)compactIfNeeded {
+  if (_fileSize == 0) {
+    return;
+  }
+  if (_needsCompaction || _batches.count == 0 ||
+      (_fileSize > kJournalCompactionThreshold && _fileSize > _liveBytes * 2)) {
+    [self rewrite];
+  }
+}
+
+#pragma mark - Private helper methods
+
+/** Appends a closing record of the open batch and closes it. The batch is closed even if the record
+ * couldn't be written, as the client is going to act on it either way.
+ */
+- (nullable GDTCORBatchJournalBatch *)closeBatchWithID:(NSNumber *)batchID
+                                            recordType:(GDTCORBatchJournalRecordType)type {
+  [self load];
+  if (_batches[batchID] == nil) {
+    return nil;
+  }
+  NSMutableData *body = [[NSMutableData alloc] init];
+  GDTCORAppendUInt64(body, (uint64_t)batchID.longLongValue);
+  NSError *error;
+  if (![self appendFrame:GDTCORRecordFrame(kJournalRecordMagic, type, body) error:&error]) {
+    GDTCORLogDebug(@"The closing record of batch %@ couldn't be written: %@", batchID, error);
+  }
+  return [self closeBatchWithID:batchID];
+}
+
+/** Adds the batch to the open batches. */
+- (void)openBatch:(GDTCORBatchJournalBatch *)batch recordLength:(uint64_t)recordLength {
+  [self closeBatchWithID:batch.batchID];
+  _batches[batch.batchID] = batch;
+  _recordLengths[batch.batchID] = @(recordLength);
+  _liveBytes += recordLength;
+  NSMutableSet<NSString *> *filenames = _batchedFilenames[@(batch.target)];
+  if (filenames == nil) {
+    filenames = [[NSMutableSet alloc] init];
+    _batchedFilenames[@(batch.target)] = filenames;
+  }
+  [filenames addObjectsFromArray:batch.eventFilenames];
+}
+
+/** Removes and returns the open batch with the ID, if any. */
+- (nullable GDTCORBatchJournalBatch *)closeBatchWithID:(NSNumber *)batchID {
+  GDTCORBatchJournalBatch *batch = _batches[batchID];
+  if (batch == nil) {
+    return nil;
+  }
+  [_batches removeObjectForKey:batchID];
+  _liveBytes -= _recordLengths[batchID].unsignedLongLongValue;
+  [_recordLengths removeObjectForKey:batchID];
+  NSMutableSet<NSString *> *filenames = _batchedFilenames[@(batch.target)];
+  for (NSString *filename in batch.eventFilenames) {
+    [filenames removeObject:filename];
+  }
+  return batch;
+}
+
+/** Appends a frame to the journal file and syncs it to disk. */
+- (BOOL)appendFrame:(NSData *)frame error:(NSError **)outError {
+  if (_fileDescriptor < 0) {
+    [[NSFileManager defaultManager]
+              createDirectoryAtPath:[_path stringByDeletingLastPathComponent]
+        withIntermediateDirectories:YES
+                         attributes:nil
+                              error:nil];
+    _fileDescriptor = open(_path.fileSystemRepresentation, O_WRONLY | O_APPEND | O_CREAT, 0600);
+    if (_fileDescriptor < 0) {
+      if (outError) {
+        *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+      }
+      return NO;
+    }
+  }
+
+  // A record torn by a crash is cut off first, as records appended after it wouldn't be replayed.
+  if (_intactLength < _fileSize) {
+    if (ftruncate(_fileDescriptor, (off_t)_intactLength) != 0) {
+      if (outError) {
+        *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+      }
+      return NO;
+    }
+    [_sizeTracker fileWasRemovedAtPath:_path withSize:_fileSize - _intactLength];
+    _fileSize = _intactLength;
+  }
+
+  const uint8_t *bytes = frame.bytes;
+  NSUInteger remaining = frame.length;
+  while (remaining > 0) {
+    ssize_t written = write(_fileDescriptor, bytes, remaining);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      int writeError = errno;
+      if (ftruncate(_fileDescriptor, (off_t)_fileSize) != 0) {
+        GDTCORLogDebug(@"Failed to truncate a partially written journal record: %d", errno);
+      }
+      if (outError) {
+        *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:writeError userInfo:nil];
+      }
+      return NO;
+    }
+    bytes += written;
+    remaining -= (NSUInteger)written;
+  }
+  if (fsync(_fileDescriptor) != 0) {
+    GDTCORLogDebug(@"Failed to sync the batch journal: %d", errno);
+  }
+  _fileSize += frame.length;
+  _intactLength = _fileSize;
+  [_sizeTracker fileWasAddedAtPath:_path withSize:frame.length];
+  return YES;
+}
+
+/** Replaces the journal file with the records of the open batches, or removes it if there are none.
+ */
+- (void)rewrite {
+  [self closeFile];
+  NSMutableData *data = [[NSMutableData alloc] initWithCapacity:(NSUInteger)_liveBytes];
+  NSArray<NSNumber *> *batchIDs = [_batches.allKeys sortedArrayUsingSelector:@selector(compare:)];
+  for (NSNumber *batchID in batchIDs) {
+    NSData *body = GDTCORJournalBatchBody(_batches[batchID]);
+    if (body) {
+      [data appendData:GDTCORRecordFrame(kJournalRecordMagic, GDTCORBatchJournalRecordTypeCreated,
+                                         body)];
+    }
+  }
+
+  NSError *error;
+  BOOL success = data.length == 0
+                     ? [[NSFileManager defaultManager] removeItemAtPath:_path error:&error]
+                     : [data writeToFile:_path options:NSDataWritingAtomic error:&error];
+  if (!success && data.length > 0) {
+    GDTCORLogDebug(@"The batch journal couldn't be compacted: %@", error);
+    return;
+  }
+  [_sizeTracker fileWasRemovedAtPath:_path withSize:_fileSize];
+  [_sizeTracker fileWasAddedAtPath:_path withSize:data.length];
+  _fileSize = data.length;
+  _intactLength = data.length;
+  _liveBytes = data.length;
+  _needsCompaction = NO;
+}
+
+/** Closes the journal file descriptor, if open. */
+- (void)closeFile {
+  if (_fileDescriptor >= 0) {
+    close(_fileDescriptor);
+    _fileDescriptor = -1;
+  }
+}
+
+@end
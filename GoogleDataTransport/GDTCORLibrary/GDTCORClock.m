@@ -18,6 +18,8 @@
 
 #import <sys/sysctl.h>
 
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORClock_Private.h"
+
 // Using a monotonic clock is necessary because CFAbsoluteTimeGetCurrent(), NSDate, and related all
 // are subject to drift. That it to say, multiple consecutive calls do not always result in a
 // time that is in the future. Clocks may be adjusted by the user, NTP, or any number of external
@@ -85,6 +87,20 @@ static int64_t UptimeInNanoseconds(void) {
   return self;
 }
 
+- (instancetype)initWithTimeMillis:(int64_t)timeMillis
+             timezoneOffsetSeconds:(int64_t)timezoneOffsetSeconds
+         kernelBootTimeNanoseconds:(int64_t)kernelBootTimeNanoseconds
+                 uptimeNanoseconds:(int64_t)uptimeNanoseconds {
+  self = [super init];
+  if (self) {
+    _timeMillis = timeMillis;
+    _timezoneOffsetSeconds = timezoneOffsetSeconds;
+    _kernelBootTimeNanoseconds = kernelBootTimeNanoseconds;
+    _uptimeNanoseconds = uptimeNanoseconds;
+  }
+  return self;
+}
+
 + (GDTCORClock *)snapshot {
   return [[GDTCORClock alloc] init];
 }
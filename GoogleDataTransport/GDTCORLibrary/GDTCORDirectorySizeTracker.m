@@ -15,30 +15,46 @@
  */
 
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageSizeBudget.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORConsoleLogger.h"
 
+NSString *const kGDTCORDirectorySizeTrackerSizeFileName = @".gdt_directory_size";
+
 @interface GDTCORDirectorySizeTracker ()
 
-/** The observed directory path. */
-@property(nonatomic, readonly) NSString *directoryPath;
+/** The path of the file persisting the content size of the observed directory. */
+@property(nonatomic, readonly) NSString *sizeFilePath;
 
 /** The cached content size of the observed directory. */
 @property(nonatomic, nullable) NSNumber *cachedSizeBytes;
 
+/** YES if the size file contains the cached size. */
+@property(nonatomic) BOOL isCachedSizePersisted;
+
+/** The size budget to report the changes of the cached size to. */
+@property(nonatomic, readonly, nullable) GDTCORStorageSizeBudget *sizeBudget;
+
 @end
 
 @implementation GDTCORDirectorySizeTracker
 
 - (instancetype)initWithDirectoryPath:(NSString *)path {
+  return [self initWithDirectoryPath:path sizeBudget:nil];
+}
+
+- (instancetype)initWithDirectoryPath:(NSString *)path
+                           sizeBudget:(nullable GDTCORStorageSizeBudget *)sizeBudget {
   self = [super init];
   if (self) {
     _directoryPath = path;
+    _sizeFilePath = [path stringByAppendingPathComponent:kGDTCORDirectorySizeTrackerSizeFileName];
+    _sizeBudget = sizeBudget;
   }
   return self;
 }
 
 - (GDTCORStorageSizeBytes)directoryContentSize {
-  if (self.cachedSizeBytes == nil) {
+  if (self.cachedSizeBytes == nil && ![self loadPersistedSize]) {
     self.cachedSizeBytes = @([self calculateDirectoryContentSize]);
   }
 
@@ -50,8 +66,12 @@
     // Ignore because the file is not inside the directory.
     return;
   }
+  if (self.cachedSizeBytes == nil && ![self loadPersistedSize]) {
+    // The file is accounted for once the size is calculated from the directory content.
+    return;
+  }
 
-  self.cachedSizeBytes = @([self directoryContentSize] + fileSize);
+  [self setCachedSize:self.cachedSizeBytes.unsignedLongLongValue + fileSize];
 }
 
 - (void)fileWasRemovedAtPath:(NSString *)path withSize:(GDTCORStorageSizeBytes)fileSize {
@@ -59,12 +79,34 @@
     // Ignore because the file is not inside the directory.
     return;
   }
+  if (self.cachedSizeBytes == nil && ![self loadPersistedSize]) {
+    // The file is accounted for once the size is calculated from the directory content.
+    return;
+  }
 
-  self.cachedSizeBytes = @([self directoryContentSize] - fileSize);
+  GDTCORStorageSizeBytes size = self.cachedSizeBytes.unsignedLongLongValue;
+  [self setCachedSize:size > fileSize ? size - fileSize : 0];
 }
 
 - (void)resetCachedSize {
   self.cachedSizeBytes = nil;
+  self.isCachedSizePersisted = NO;
+  [[NSFileManager defaultManager] removeItemAtPath:self.sizeFilePath error:nil];
+}
+
+- (void)persistCachedSize {
+  if (self.cachedSizeBytes == nil || self.isCachedSizePersisted) {
+    return;
+  }
+
+  uint64_t size = CFSwapInt64HostToLittle(self.cachedSizeBytes.unsignedLongLongValue);
+  NSData *data = [NSData dataWithBytes:&size length:sizeof(size)];
+  NSError *error;
+  if ([data writeToFile:self.sizeFilePath options:NSDataWritingAtomic error:&error]) {
+    self.isCachedSizePersisted = YES;
+  } else {
+    GDTCORLogDebug(@"Failed to persist the directory size: %@", error);
+  }
 }
 
 - (GDTCORStorageSizeBytes)calculateDirectoryContentSize {
@@ -102,4 +144,64 @@
   return fileSize.unsignedLongLongValue;
 }
 
+#if !NDEBUG
+- (BOOL)reconcileCachedSize {
+  if (self.cachedSizeBytes == nil) {
+    return YES;
+  }
+
+  GDTCORStorageSizeBytes cachedSize = self.cachedSizeBytes.unsignedLongLongValue;
+  GDTCORStorageSizeBytes actualSize = [self calculateDirectoryContentSize];
+  if (cachedSize != actualSize) {
+    GDTCORLogWarning(GDTCORMCWStorageSizeDrift,
+                     @"The tracked size of %@ is %llu bytes, but its content size is %llu bytes.",
+                     self.directoryPath, cachedSize, actualSize);
+    return NO;
+  }
+  return YES;
+}
+#endif  // !NDEBUG
+
+#pragma mark - Private helper methods
+
+- (void)setCachedSizeBytes:(nullable NSNumber *)cachedSizeBytes {
+  GDTCORStorageSizeBytes oldSize = _cachedSizeBytes.unsignedLongLongValue;
+  GDTCORStorageSizeBytes newSize = cachedSizeBytes.unsignedLongLongValue;
+  _cachedSizeBytes = cachedSizeBytes;
+  if (newSize > oldSize) {
+    [self.sizeBudget addSize:newSize - oldSize];
+  } else if (newSize < oldSize) {
+    [self.sizeBudget removeSize:oldSize - newSize];
+  }
+}
+
+/** Updates the cached size and discards the persisted size, which is now stale. */
+- (void)setCachedSize:(GDTCORStorageSizeBytes)size {
+  self.cachedSizeBytes = @(size);
+  [self removePersistedSize];
+}
+
+/** Caches the size read from the size file.
+ * @return YES if there was a valid size file.
+ */
+- (BOOL)loadPersistedSize {
+  NSData *data = [NSData dataWithContentsOfFile:self.sizeFilePath];
+  uint64_t size;
+  if (data.length != sizeof(size)) {
+    return NO;
+  }
+  [data getBytes:&size length:sizeof(size)];
+  self.cachedSizeBytes = @(CFSwapInt64LittleToHost(size));
+  self.isCachedSizePersisted = YES;
+  return YES;
+}
+
+/** Removes the size file if the cached size may have been persisted. */
+- (void)removePersistedSize {
+  if (self.isCachedSizePersisted) {
+    [[NSFileManager defaultManager] removeItemAtPath:self.sizeFilePath error:nil];
+    self.isCachedSizePersisted = NO;
+  }
+}
+
 @end
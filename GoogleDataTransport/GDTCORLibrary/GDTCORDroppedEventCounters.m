@@ -0,0 +1,135 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDroppedEventCounters.h"
+
+#import <stdatomic.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
+
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORLogSourceMetrics.h"
+
+/** The number of drop reasons known to this version, which is the number of counters in a row. It
+ * is an enum constant, as it sizes the counters array.
+ */
+enum { kDropReasonCount = GDTCOREventDropReasonServerError + 1 };
+
+/** The counters of the events of a log source dropped for each reason. */
+@interface GDTCORDroppedEventCountersRow : NSObject
+
+/** Adds the count to the counter of the reason. */
+- (void)addCount:(uint64_t)count forReason:(GDTCOREventDropReason)reason;
+
+/** Resets the counters and returns the non-zero counts keyed by reason, or nil if there are none.
+ */
+- (nullable NSDictionary<NSNumber *, NSNumber *> *)drainCounts;
+
+@end
+
+@implementation GDTCORDroppedEventCountersRow {
+  /** The counters indexed by drop reason. */
+  _Atomic(uint64_t) _counts[kDropReasonCount];
+}
+
+- (instancetype)init {
+  self = [super init];
+  if (self) {
+    for (NSInteger reason = 0; reason < kDropReasonCount; reason++) {
+      atomic_init(&_counts[reason], 0);
+    }
+  }
+  return self;
+}
+
+- (void)addCount:(uint64_t)count forReason:(GDTCOREventDropReason)reason {
+  if (reason < 0 || reason >= kDropReasonCount) {
+    reason = GDTCOREventDropReasonUnknown;
+  }
+  atomic_fetch_add(&_counts[reason], count);
+}
+
+- (nullable NSDictionary<NSNumber *, NSNumber *> *)drainCounts {
+  NSMutableDictionary<NSNumber *, NSNumber *> *counts;
+  for (NSInteger reason = 0; reason < kDropReasonCount; reason++) {
+    uint64_t count = atomic_exchange(&_counts[reason], 0);
+    if (count > 0) {
+      counts = counts ?: [[NSMutableDictionary alloc] init];
+      counts[@(reason)] = @(count);
+    }
+  }
+  return counts;
+}
+
+@end
+
+@implementation GDTCORDroppedEventCounters {
+  /** The rows of counters keyed by log source. Guarded by synchronizing on the dictionary. */
+  NSMutableDictionary<NSString *, GDTCORDroppedEventCountersRow *> *_rows;
+}
+
+- (instancetype)init {
+  self = [super init];
+  if (self) {
+    _rows = [[NSMutableDictionary alloc] init];
+  }
+  return self;
+}
+
+- (void)addEvents:(NSArray<GDTCOREvent *> *)events droppedForReason:(GDTCOREventDropReason)reason {
+  for (GDTCOREvent *event in events) {
+    // Dropped events with a `nil` or empty mapping ID (log source) are not recorded.
+    if (event.mappingID.length == 0) {
+      continue;
+    }
+    [[self rowForLogSource:event.mappingID] addCount:1 forReason:reason];
+  }
+}
+
+- (nullable GDTCORLogSourceMetrics *)drainLogSourceMetrics {
+  NSDictionary<NSString *, GDTCORDroppedEventCountersRow *> *rows;
+  @synchronized(_rows) {
+    rows = [_rows copy];
+  }
+  NSMutableDictionary<NSString *, NSDictionary<NSNumber *, NSNumber *> *> *countsByLogSource =
+      [[NSMutableDictionary alloc] init];
+  [rows enumerateKeysAndObjectsUsingBlock:^(NSString *logSource, GDTCORDroppedEventCountersRow *row,
+                                            BOOL *stop) {
+    NSDictionary<NSNumber *, NSNumber *> *counts = [row drainCounts];
+    if (counts) {
+      countsByLogSource[logSource] = counts;
+    }
+  }];
+  if (countsByLogSource.count == 0) {
+    return nil;
+  }
+  return [GDTCORLogSourceMetrics metricsWithDroppedEventCounterByLogSource:countsByLogSource];
+}
+
+#pragma mark - Private helper methods
+
+/** Returns the row of the log source, creating it on the first drop. */
+- (GDTCORDroppedEventCountersRow *)rowForLogSource:(NSString *)logSource {
+  @synchronized(_rows) {
+    GDTCORDroppedEventCountersRow *row = _rows[logSource];
+    if (row == nil) {
+      row = [[GDTCORDroppedEventCountersRow alloc] init];
+      _rows[[logSource copy]] = row;
+    }
+    return row;
+  }
+}
+
+@end
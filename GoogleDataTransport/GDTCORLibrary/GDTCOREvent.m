@@ -60,6 +60,22 @@
   return [self initWithMappingID:mappingID productData:nil target:target];
 }
 
+- (instancetype)initWithEventID:(NSString *)eventID
+                      mappingID:(nullable NSString *)mappingID
+                    productData:(nullable GDTCORProductData *)productData
+                         target:(GDTCORTarget)target
+      serializedDataObjectBytes:(NSData *)serializedDataObjectBytes {
+  self = [super init];
+  if (self) {
+    _eventID = [eventID copy];
+    _mappingID = [mappingID copy];
+    _productData = productData;
+    _target = target;
+    _serializedDataObjectBytes = serializedDataObjectBytes;
+  }
+  return self;
+}
+
 - (instancetype)copy {
   GDTCOREvent *copy = [[GDTCOREvent alloc] initWithMappingID:_mappingID
                                                  productData:_productData
@@ -0,0 +1,313 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventRecordCodec.h"
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORPlatform.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORRecordFrame.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORClock.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORProductData.h"
+
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORClock_Private.h"
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCOREvent_Private.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+const uint32_t kGDTCOREventRecordMagic = 0x45544447;
+
+const uint8_t kGDTCOREventRecordVersion = 1;
+
+NSString *const GDTCOREventRecordErrorDomain = @"GDTCOREventRecord";
+
+/** The flags marking which of the optional event properties are present in a record. */
+typedef NS_OPTIONS(uint8_t, GDTCOREventRecordFlag) {
+  GDTCOREventRecordFlagClockSnapshot = 1 << 0,
+  GDTCOREventRecordFlagExpirationDate = 1 << 1,
+  GDTCOREventRecordFlagMappingID = 1 << 2,
+  GDTCOREventRecordFlagCustomBytes = 1 << 3,
+  GDTCOREventRecordFlagProductData = 1 << 4,
+};
+
+/** The length of the fixed record header. */
+static const NSUInteger kRecordHeaderLength = 4 + 1 + 1 + 1 + 1 + 4 + 8 * 4 + 8;
+
+static void GDTCORSetError(NSError *_Nullable *_Nullable outError,
+                           GDTCOREventRecordError code,
+                           NSString *reason) {
+  if (outError) {
+    *outError = [NSError errorWithDomain:GDTCOREventRecordErrorDomain
+                                    code:code
+                                userInfo:@{NSLocalizedFailureReasonErrorKey : reason}];
+  }
+}
+
+#pragma mark - Writing
+
+static void GDTCORRecordAppendData(NSMutableData *data, NSData *_Nullable value) {
+  GDTCORAppendUInt32(data, (uint32_t)value.length);
+  if (value.length > 0) {
+    [data appendData:value];
+  }
+}
+
+NSData *_Nullable GDTCOREncodeEventRecord(GDTCOREvent *event, NSError *_Nullable *_Nullable error) {
+  NSData *eventIDData = [event.eventID dataUsingEncoding:NSUTF8StringEncoding];
+  NSData *mappingIDData = [event.mappingID dataUsingEncoding:NSUTF8StringEncoding];
+  NSData *payload = event.serializedDataObjectBytes;
+  if (payload == nil || eventIDData.length > UINT16_MAX || payload.length > UINT32_MAX ||
+      mappingIDData.length > UINT32_MAX || event.customBytes.length > UINT32_MAX) {
+    GDTCORSetError(error, GDTCOREventRecordErrorInvalidEvent, @"The event can't be encoded.");
+    return nil;
+  }
+
+  GDTCOREventRecordFlag flags = 0;
+  GDTCORClock *clock = event.clockSnapshot;
+  flags |= clock ? GDTCOREventRecordFlagClockSnapshot : 0;
+  flags |= event.expirationDate ? GDTCOREventRecordFlagExpirationDate : 0;
+  flags |= event.mappingID ? GDTCOREventRecordFlagMappingID : 0;
+  flags |= event.customBytes ? GDTCOREventRecordFlagCustomBytes : 0;
+  flags |= event.productData ? GDTCOREventRecordFlagProductData : 0;
+
+  NSMutableData *record = [[NSMutableData alloc]
+      initWithCapacity:kRecordHeaderLength + eventIDData.length + mappingIDData.length +
+                       event.customBytes.length + payload.length + 5 * sizeof(uint32_t)];
+  GDTCORAppendUInt32(record, kGDTCOREventRecordMagic);
+  GDTCORAppendUInt8(record, kGDTCOREventRecordVersion);
+  GDTCORAppendUInt8(record, flags);
+  GDTCORAppendUInt8(record, (uint8_t)event.qosTier);
+  GDTCORAppendUInt8(record, 0);
+  GDTCORAppendUInt32(record, (uint32_t)(int32_t)event.target);
+  GDTCORAppendUInt64(record, (uint64_t)clock.timeMillis);
+  GDTCORAppendUInt64(record, (uint64_t)clock.timezoneOffsetSeconds);
+  GDTCORAppendUInt64(record, (uint64_t)clock.kernelBootTimeNanoseconds);
+  GDTCORAppendUInt64(record, (uint64_t)clock.uptimeNanoseconds);
+  double expiration = event.expirationDate ? event.expirationDate.timeIntervalSince1970 : 0;
+  uint64_t expirationBits;
+  memcpy(&expirationBits, &expiration, sizeof(expirationBits));
+  GDTCORAppendUInt64(record, expirationBits);
+
+  GDTCORAppendUInt16(record, (uint16_t)eventIDData.length);
+  [record appendData:eventIDData];
+  GDTCORRecordAppendData(record, mappingIDData);
+  GDTCORRecordAppendData(record, event.customBytes);
+  if (event.productData) {
+    GDTCORAppendUInt32(record, sizeof(int32_t));
+    GDTCORAppendUInt32(record, (uint32_t)event.productData.productID);
+  } else {
+    GDTCORAppendUInt32(record, 0);
+  }
+  GDTCORRecordAppendData(record, payload);
+  return record;
+}
+
+#pragma mark - Reading
+
+/** A cursor over the bytes of a record. */
+typedef struct {
+  const uint8_t *bytes;
+  NSUInteger length;
+  NSUInteger offset;
+} GDTCOREventRecordReader;
+
+/** Advances the cursor past a field of the given length, returning the field's first byte, or
+ * NULL if the record is too short to hold the field.
+ */
+static const uint8_t *_Nullable GDTCORRecordReadField(GDTCOREventRecordReader *reader,
+                                                      NSUInteger length) {
+  if (reader->length - reader->offset < length) {
+    return NULL;
+  }
+  const uint8_t *field = reader->bytes + reader->offset;
+  reader->offset += length;
+  return field;
+}
+
+static BOOL GDTCORRecordReadUInt8(GDTCOREventRecordReader *reader, uint8_t *value) {
+  const uint8_t *field = GDTCORRecordReadField(reader, sizeof(*value));
+  if (field == NULL) {
+    return NO;
+  }
+  *value = field[0];
+  return YES;
+}
+
+static BOOL GDTCORRecordReadUInt16(GDTCOREventRecordReader *reader, uint16_t *value) {
+  const uint8_t *field = GDTCORRecordReadField(reader, sizeof(*value));
+  if (field == NULL) {
+    return NO;
+  }
+  *value = GDTCORReadUInt16(field);
+  return YES;
+}
+
+static BOOL GDTCORRecordReadUInt32(GDTCOREventRecordReader *reader, uint32_t *value) {
+  const uint8_t *field = GDTCORRecordReadField(reader, sizeof(*value));
+  if (field == NULL) {
+    return NO;
+  }
+  *value = GDTCORReadUInt32(field);
+  return YES;
+}
+
+static BOOL GDTCORRecordReadUInt64(GDTCOREventRecordReader *reader, uint64_t *value) {
+  const uint8_t *field = GDTCORRecordReadField(reader, sizeof(*value));
+  if (field == NULL) {
+    return NO;
+  }
+  *value = GDTCORReadUInt64(field);
+  return YES;
+}
+
+/** Reads a field of the given length as data, pointing to a range of the record's data. */
+static NSData *_Nullable GDTCORRecordReadData(GDTCOREventRecordReader *reader,
+                                              NSData *recordData,
+                                              NSUInteger length) {
+  if (reader->length - reader->offset < length) {
+    return nil;
+  }
+  if (length == 0) {
+    return [NSData data];
+  }
+  // The slice references the record bytes instead of copying them. Its deallocator keeps the
+  // record, which may be a mapped file, alive for as long as the slice is used.
+  NSData *data = [[NSData alloc] initWithBytesNoCopy:(void *)(reader->bytes + reader->offset)
+                                              length:length
+                                         deallocator:^(void *bytes, NSUInteger sliceLength) {
+                                           (void)recordData;
+                                         }];
+  reader->offset += length;
+  return data;
+}
+
+static NSString *_Nullable GDTCORRecordReadString(GDTCOREventRecordReader *reader,
+                                                  NSUInteger length) {
+  if (reader->length - reader->offset < length) {
+    return nil;
+  }
+  NSString *string = [[NSString alloc] initWithBytes:reader->bytes + reader->offset
+                                              length:length
+                                            encoding:NSUTF8StringEncoding];
+  reader->offset += length;
+  return string;
+}
+
+BOOL GDTCORIsEventRecord(NSData *data) {
+  if (data.length < sizeof(kGDTCOREventRecordMagic)) {
+    return NO;
+  }
+  return GDTCORReadUInt32(data.bytes) == kGDTCOREventRecordMagic;
+}
+
+GDTCOREvent *_Nullable GDTCORDecodeEventRecord(NSData *data, NSError *_Nullable *_Nullable error) {
+  if (!GDTCORIsEventRecord(data)) {
+    // Events stored by previous versions of the library are keyed archives.
+    NSError *archiveError;
+    GDTCOREvent *event =
+        (GDTCOREvent *)GDTCORDecodeArchive([GDTCOREvent class], data, &archiveError);
+    if (error) {
+      *error = archiveError;
+    }
+    return event;
+  }
+
+  // The decoded data objects are slices of the record, which must not change under them.
+  data = [data copy];
+  GDTCOREventRecordReader reader = {.bytes = data.bytes, .length = data.length, .offset = 4};
+  uint8_t version, flags, qosTier, reserved;
+  uint32_t target;
+  uint64_t timeMillis, timezoneOffsetSeconds, kernelBootTimeNanoseconds, uptimeNanoseconds;
+  uint64_t expirationBits;
+  if (!GDTCORRecordReadUInt8(&reader, &version)) {
+    GDTCORSetError(error, GDTCOREventRecordErrorCorruptRecord, @"The record is truncated.");
+    return nil;
+  }
+  if (version > kGDTCOREventRecordVersion) {
+    GDTCORSetError(error, GDTCOREventRecordErrorUnsupportedVersion,
+                   @"The record version is not supported.");
+    return nil;
+  }
+  uint16_t eventIDLength;
+  uint32_t mappingIDLength, customBytesLength, productDataLength, payloadLength;
+  NSString *eventID;
+  NSString *mappingID;
+  NSData *customBytes;
+  uint32_t productID = 0;
+  NSData *payload;
+  BOOL isValid =
+      GDTCORRecordReadUInt8(&reader, &flags) && GDTCORRecordReadUInt8(&reader, &qosTier) &&
+      GDTCORRecordReadUInt8(&reader, &reserved) && GDTCORRecordReadUInt32(&reader, &target) &&
+      GDTCORRecordReadUInt64(&reader, &timeMillis) &&
+      GDTCORRecordReadUInt64(&reader, &timezoneOffsetSeconds) &&
+      GDTCORRecordReadUInt64(&reader, &kernelBootTimeNanoseconds) &&
+      GDTCORRecordReadUInt64(&reader, &uptimeNanoseconds) &&
+      GDTCORRecordReadUInt64(&reader, &expirationBits) &&
+      GDTCORRecordReadUInt16(&reader, &eventIDLength) &&
+      (eventID = GDTCORRecordReadString(&reader, eventIDLength)) != nil &&
+      GDTCORRecordReadUInt32(&reader, &mappingIDLength) &&
+      (mappingID = GDTCORRecordReadString(&reader, mappingIDLength)) != nil &&
+      GDTCORRecordReadUInt32(&reader, &customBytesLength) &&
+      (customBytes = GDTCORRecordReadData(&reader, data, customBytesLength)) != nil &&
+      GDTCORRecordReadUInt32(&reader, &productDataLength) &&
+      (productDataLength == 0 ||
+       (productDataLength == sizeof(productID) && GDTCORRecordReadUInt32(&reader, &productID))) &&
+      GDTCORRecordReadUInt32(&reader, &payloadLength) &&
+      (payload = GDTCORRecordReadData(&reader, data, payloadLength)) != nil;
+  if (!isValid) {
+    GDTCORSetError(error, GDTCOREventRecordErrorCorruptRecord, @"The record is malformed.");
+    return nil;
+  }
+
+  GDTCORProductData *productData =
+      (flags & GDTCOREventRecordFlagProductData)
+          ? [[GDTCORProductData alloc] initWithProductID:(int32_t)productID]
+          : nil;
+  GDTCOREvent *event = [[GDTCOREvent alloc]
+                initWithEventID:eventID
+                      mappingID:(flags & GDTCOREventRecordFlagMappingID) ? mappingID : nil
+                    productData:productData
+                         target:(GDTCORTarget)(int32_t)target
+      serializedDataObjectBytes:payload];
+  event.qosTier = (GDTCOREventQoS)qosTier;
+  if (flags & GDTCOREventRecordFlagClockSnapshot) {
+    event.clockSnapshot =
+        [[GDTCORClock alloc] initWithTimeMillis:(int64_t)timeMillis
+                          timezoneOffsetSeconds:(int64_t)timezoneOffsetSeconds
+                      kernelBootTimeNanoseconds:(int64_t)kernelBootTimeNanoseconds
+                              uptimeNanoseconds:(int64_t)uptimeNanoseconds];
+  }
+  if (flags & GDTCOREventRecordFlagExpirationDate) {
+    double expiration;
+    memcpy(&expiration, &expirationBits, sizeof(expiration));
+    event.expirationDate = [NSDate dateWithTimeIntervalSince1970:expiration];
+  }
+  if (flags & GDTCOREventRecordFlagCustomBytes) {
+    event.customBytes = customBytes;
+  }
+  return event;
+}
+
+GDTCOREvent *_Nullable GDTCORDecodeEventRecordAtPath(NSString *path,
+                                                     NSError *_Nullable *_Nullable error) {
+  NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:error];
+  if (data == nil) {
+    // Reading the file failed and `error` will be populated.
+    return nil;
+  }
+  return GDTCORDecodeEventRecord(data, error);
+}
+
+NS_ASSUME_NONNULL_END
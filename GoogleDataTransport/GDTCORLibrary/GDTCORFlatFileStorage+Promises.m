@@ -22,12 +22,16 @@
 #import "FBLPromises.h"
 #endif
 
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORLibraryDataStore.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORPlatform.h"
 
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORMetricsMetadata.h"
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORStorageMetadata.h"
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORUploadBatch.h"
 
+/** The library data key of the metrics metadata. */
+static NSString *const kMetricsMetadataKey = @"metrics_metadata";
+
 @implementation GDTCORFlatFileStorage (Promises)
 
 - (FBLPromise<NSSet<NSNumber *> *> *)batchIDsForTarget:(GDTCORTarget)target {
@@ -83,31 +87,62 @@
   return [FBLPromise
       onQueue:self.storageQueue
         async:^(FBLPromiseFulfillBlock _Nonnull fulfill, FBLPromiseRejectBlock _Nonnull reject) {
-          [self batchWithEventSelector:eventSelector
-                       batchExpiration:expiration
-                            onComplete:^(NSNumber *_Nullable newBatchID,
-                                         NSSet<GDTCOREvent *> *_Nullable batchEvents) {
-                              if (newBatchID == nil || batchEvents == nil) {
-                                reject([self genericRejectedPromiseErrorWithReason:
-                                                 @"There are no events for the selector."]);
-                              } else {
-                                fulfill([[GDTCORUploadBatch alloc] initWithBatchID:newBatchID
-                                                                            events:batchEvents]);
-                              }
-                            }];
+          [self uploadBatchWithEventSelector:eventSelector
+                             batchExpiration:expiration
+                                  onComplete:^(GDTCORUploadBatch *_Nullable batch) {
+                                    if (batch == nil) {
+                                      reject([self genericRejectedPromiseErrorWithReason:
+                                                       @"There are no events for the selector."]);
+                                    } else {
+                                      fulfill(batch);
+                                    }
+                                  }];
         }];
 }
 
+- (FBLPromise<GDTCORUploadBatch *> *)pendingBatchWithEventSelector:
+    (GDTCORStorageEventSelector *)eventSelector {
+  return [FBLPromise
+      onQueue:self.storageQueue
+        async:^(FBLPromiseFulfillBlock _Nonnull fulfill, FBLPromiseRejectBlock _Nonnull reject) {
+          [self pendingBatchWithEventSelector:eventSelector
+                                   onComplete:^(GDTCORUploadBatch *_Nullable batch) {
+                                     if (batch == nil) {
+                                       reject([self genericRejectedPromiseErrorWithReason:
+                                                        @"There is no open batch to resume."]);
+                                     } else {
+                                       fulfill(batch);
+                                     }
+                                   }];
+        }];
+}
+
+- (FBLPromise<NSNull *> *)storeRequestBody:(NSData *)requestBody
+                                forBatchID:(NSNumber *)batchID
+                                 retryDate:(NSDate *)retryDate {
+  return [FBLPromise onQueue:self.storageQueue
+         wrapErrorCompletion:^(FBLPromiseErrorCompletion _Nonnull handler) {
+           [self storeRequestBody:requestBody
+                       forBatchID:batchID
+                        retryDate:retryDate
+                       onComplete:handler];
+         }];
+}
+
 - (FBLPromise<NSNull *> *)fetchAndUpdateMetricsWithHandler:
     (GDTCORMetricsMetadata * (^)(GDTCORMetricsMetadata *_Nullable fetchedMetadata,
                                  NSError *_Nullable fetchError))handler {
   return FBLPromise.doOn(self.storageQueue, ^id {
     // Fetch the stored metrics metadata.
     NSError *decodeError;
-    NSString *metricsMetadataPath =
-        [[[self class] libraryDataStoragePath] stringByAppendingPathComponent:@"metrics_metadata"];
-    GDTCORMetricsMetadata *decodedMetadata = (GDTCORMetricsMetadata *)GDTCORDecodeArchiveAtPath(
-        GDTCORMetricsMetadata.class, metricsMetadataPath, &decodeError);
+    GDTCORMetricsMetadata *decodedMetadata;
+    NSData *encodedStoredMetadata = [self.libraryDataStore dataForKey:kMetricsMetadataKey];
+    if (encodedStoredMetadata) {
+      decodedMetadata = (GDTCORMetricsMetadata *)GDTCORDecodeArchive(
+          GDTCORMetricsMetadata.class, encodedStoredMetadata, &decodeError);
+    } else {
+      decodeError = [self genericRejectedPromiseErrorWithReason:@"No metrics metadata is stored."];
+    }
 
     // Update the metadata using the retrieved metadata.
     GDTCORMetricsMetadata *updatedMetadata = handler(decodedMetadata, decodeError);
@@ -125,10 +160,11 @@
         return encodeError;
       }
 
-      // - Write the encoded metadata to disk.
+      // - Write the encoded metadata to the library data store.
       NSError *writeError;
-      BOOL writeResult = GDTCORWriteDataToFile(encodedMetadata, metricsMetadataPath, &writeError);
-      if (writeResult == NO || writeError) {
+      if (![self.libraryDataStore setData:encodedMetadata
+                                   forKey:kMetricsMetadataKey
+                                    error:&writeError]) {
         return writeError;
       }
     }
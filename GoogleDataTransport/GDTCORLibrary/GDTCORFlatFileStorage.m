@@ -16,24 +16,41 @@
 
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORFlatFileStorage.h"
 
+#import <zlib.h>
+
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORAssert.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventRecordCodec.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORLifecycle.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORPlatform.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEventSelector.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEvictionPolicy.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORConsoleLogger.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
 
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCOREvent_Private.h"
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORRegistrar_Private.h"
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORSegmentedLogStorage.h"
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORUploadBatch.h"
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORUploadCoordinator.h"
 
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORBatchIDAllocator.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORBatchJournal.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORFlatFileStoragePartition.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORLibraryDataStore.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORRecordFrame.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageDurabilityPolicy.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEventIndex.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageSizeBudget.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
 /** A library data key this class uses to track batchIDs. */
 static NSString *const gBatchIDCounterKey = @"GDTCORFlatFileStorageBatchIDCounter";
 
+/** The name of the file holding the library data. */
+static NSString *const kLibraryDataStoreFileName = @"gdt_library_data_store";
+
 /** The separator used between metadata elements in filenames. */
 static NSString *const kMetadataSeparator = @"-";
 
@@ -55,26 +72,199 @@ NSString *const GDTCORFlatFileStorageErrorDomain = @"GDTCORFlatFileStorage";
 
 const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
 
+const uint64_t kGDTCORFlatFileStorageRequestBodiesSizeLimit = 2 * 1000 * 1000;  // 2 MB.
+
+const NSTimeInterval kGDTCORFlatFileStorageRequestBodyMaxAge = 5 * 60;  // 5 minutes.
+
+/** The value every stored request body starts with, "GDTB" when read as little-endian bytes. */
+static const uint32_t kRequestBodyMagic = 0x42544447;
+
+/** The length of the header of a stored request body: magic, CRC-32 and retry time in milliseconds
+ * since 1970. The CRC-32 covers the retry time and the body.
+ */
+static const NSUInteger kRequestBodyHeaderLength =
+    sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint64_t);
+
+/** The offset of the retry time in the header of a stored request body. */
+static const NSUInteger kRequestBodyRetryTimeOffset = sizeof(uint32_t) + sizeof(uint32_t);
+
+/** Returns the CRC-32 of the stored request body data following the CRC-32 itself. */
+static uint32_t GDTCORStoredRequestBodyCRC(const uint8_t *bytes, NSUInteger length) {
+  return (uint32_t)crc32(0, bytes + kRequestBodyRetryTimeOffset,
+                         (uInt)(length - kRequestBodyRetryTimeOffset));
+}
+
+/** Prepends the header carrying the retry date and the CRC-32 of the request body to it. */
+static NSData *GDTCOREncodeStoredRequestBody(NSData *requestBody, NSDate *retryDate) {
+  NSMutableData *data =
+      [[NSMutableData alloc] initWithCapacity:kRequestBodyHeaderLength + requestBody.length];
+  GDTCORAppendUInt32(data, kRequestBodyMagic);
+  GDTCORAppendUInt32(data, 0);
+  GDTCORAppendUInt64(data, (uint64_t)MAX(retryDate.timeIntervalSince1970 * 1000, 0));
+  [data appendData:requestBody];
+  uint32_t crc = CFSwapInt32HostToLittle(GDTCORStoredRequestBodyCRC(data.bytes, data.length));
+  [data replaceBytesInRange:NSMakeRange(sizeof(uint32_t), sizeof(uint32_t)) withBytes:&crc];
+  return data;
+}
+
+/** Returns the request body of the stored data and its retry date, or nil if it is damaged. */
+static NSData *_Nullable GDTCORDecodeStoredRequestBody(NSData *data, NSDate **outRetryDate) {
+  const uint8_t *bytes = data.bytes;
+  if (data.length <= kRequestBodyHeaderLength || GDTCORReadUInt32(bytes) != kRequestBodyMagic ||
+      GDTCORReadUInt32(bytes + sizeof(uint32_t)) !=
+          GDTCORStoredRequestBodyCRC(bytes, data.length)) {
+    return nil;
+  }
+  uint64_t retryTimeMillis = GDTCORReadUInt64(bytes + kRequestBodyRetryTimeOffset);
+  *outRetryDate = [NSDate dateWithTimeIntervalSince1970:retryTimeMillis / 1000.0];
+  return [data subdataWithRange:NSMakeRange(kRequestBodyHeaderLength,
+                                            data.length - kRequestBodyHeaderLength)];
+}
+
 @interface GDTCORFlatFileStorage ()
 
-/** An instance of the size tracker to keep track of the disk space consumed by the storage. */
-@property(nonatomic, readonly) GDTCORDirectorySizeTracker *sizeTracker;
+/** The sum of the sizes tracked by the partitions and the library data size tracker, capped by
+ * the storage size limit.
+ */
+@property(nonatomic, readonly) GDTCORStorageSizeBudget *sizeBudget;
+
+/** The size tracker of the library data directory. Only accessed on the storage queue. */
+@property(nonatomic, readonly) GDTCORDirectorySizeTracker *libraryDataSizeTracker;
+
+/** The allocator of batch IDs. Only accessed on the storage queue. */
+@property(nonatomic, readonly) GDTCORBatchIDAllocator *batchIDAllocator;
+
+/** The partitions created so far. */
+@property(nonatomic, readonly) NSArray<GDTCORFlatFileStoragePartition *> *partitions;
+
+/** Removes the event files of the partition with the given names, keeping its size tracker up to
+ * date. Must be called on the queue of the partition.
+ */
+- (void)removeEventFilesNamed:(NSArray<NSString *> *)filenames
+                  inPartition:(GDTCORFlatFileStoragePartition *)partition;
+
+@end
+
+/** Reads the events of a flat file storage batch from the event data directory on demand. */
+@interface GDTCORFlatFileBatchEventSource : NSObject <GDTCORUploadBatchEventSource>
+
+/** The paths of the batched event files. */
+@property(nonatomic, readonly) NSArray<NSString *> *paths;
+
+/** The storage that removes the event files that can't be decoded. */
+@property(nonatomic, readonly, weak) GDTCORFlatFileStorage *storage;
+
+/** The partition of the target the events belong to. */
+@property(nonatomic, readonly) GDTCORFlatFileStoragePartition *partition;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Instantiates a source of the events at the given paths of the partition. */
+- (instancetype)initWithPaths:(NSArray<NSString *> *)paths
+                      storage:(GDTCORFlatFileStorage *)storage
+                    partition:(GDTCORFlatFileStoragePartition *)partition NS_DESIGNATED_INITIALIZER;
+
+/** Decodes the event at the path, returns nil if the file can't be decoded. */
++ (nullable GDTCOREvent *)eventAtPath:(NSString *)path;
+
+@end
+
+@implementation GDTCORFlatFileBatchEventSource
+
+- (instancetype)initWithPaths:(NSArray<NSString *> *)paths
+                      storage:(GDTCORFlatFileStorage *)storage
+                    partition:(GDTCORFlatFileStoragePartition *)partition {
+  self = [super init];
+  if (self) {
+    _paths = [paths copy];
+    _storage = storage;
+    _partition = partition;
+  }
+  return self;
+}
+
++ (nullable GDTCOREvent *)eventAtPath:(NSString *)path {
+  NSError *error;
+  GDTCOREvent *event = GDTCORDecodeEventRecordAtPath(path, &error);
+  if (event == nil || error) {
+    GDTCORLogDebug(@"Error deserializing event: %@", error);
+    return nil;
+  }
+  return event;
+}
+
+- (NSUInteger)eventCount {
+  return _paths.count;
+}
+
+- (void)enumerateEventsUsingBlock:(void (^)(GDTCOREvent *event, BOOL *stop))block {
+  BOOL stop = NO;
+  for (NSString *path in _paths) {
+    @autoreleasepool {
+      GDTCOREvent *event = [GDTCORFlatFileBatchEventSource eventAtPath:path];
+      if (event == nil) {
+        // The event data directory of the target is only modified on its queue.
+        GDTCORFlatFileStorage *storage = _storage;
+        GDTCORFlatFileStoragePartition *partition = _partition;
+        dispatch_async(partition.queue, ^{
+          [storage removeEventFilesNamed:@[ [path lastPathComponent] ] inPartition:partition];
+        });
+        continue;
+      }
+      block(event, &stop);
+    }
+    if (stop) {
+      break;
+    }
+  }
+}
 
 @end
 
-@implementation GDTCORFlatFileStorage
+@implementation GDTCORFlatFileStorage {
+  /** The partitions by target. Guarded by synchronizing on the dictionary. */
+  NSMutableDictionary<NSNumber *, GDTCORFlatFileStoragePartition *> *_partitions;
+
+  /** The targets of the known open batches by batch ID. Guarded by synchronizing on the
+   * dictionary.
+   */
+  NSMutableDictionary<NSNumber *, NSNumber *> *_batchTargets;
+
+  /** YES once the first reservation started loading the sizes of all the size trackers. Guarded by
+   * synchronizing on the size estimates.
+   */
+  BOOL _isStorageSizeLoadStarted;
+
+  /** The sizes counted in the size budget for the trackers whose size isn't loaded yet, by tracked
+   * directory path. Guarded by synchronizing on the dictionary.
+   */
+  NSMutableDictionary<NSString *, NSNumber *> *_sizeEstimates;
+
+  /** The tracked directory paths of the size trackers whose size was loaded. Guarded by
+   * synchronizing on the size estimates.
+   */
+  NSMutableSet<NSString *> *_directoryPathsWithLoadedSize;
+}
 
-@synthesize sizeTracker = _sizeTracker;
+@synthesize libraryDataSizeTracker = _libraryDataSizeTracker;
+@synthesize libraryDataStore = _libraryDataStore;
+@synthesize batchIDAllocator = _batchIDAllocator;
 @synthesize delegate = _delegate;
 
 + (void)load {
+  // The segmented log storage takes the place of this storage if the app opts in to it.
+  id<GDTCORStorageProtocol> storage = [GDTCORSegmentedLogStorage
+      sharedInstanceEnabledByInfoDictionary:[NSBundle mainBundle].infoDictionary];
+  if (storage == nil) {
+    storage = [self sharedInstance];
+  }
 #if !NDEBUG
-  [[GDTCORRegistrar sharedInstance] registerStorage:[self sharedInstance] target:kGDTCORTargetTest];
+  [[GDTCORRegistrar sharedInstance] registerStorage:storage target:kGDTCORTargetTest];
 #endif  // !NDEBUG
-  [[GDTCORRegistrar sharedInstance] registerStorage:[self sharedInstance] target:kGDTCORTargetCCT];
-  [[GDTCORRegistrar sharedInstance] registerStorage:[self sharedInstance] target:kGDTCORTargetFLL];
-  [[GDTCORRegistrar sharedInstance] registerStorage:[self sharedInstance] target:kGDTCORTargetCSH];
-  [[GDTCORRegistrar sharedInstance] registerStorage:[self sharedInstance] target:kGDTCORTargetINT];
+  [[GDTCORRegistrar sharedInstance] registerStorage:storage target:kGDTCORTargetCCT];
+  [[GDTCORRegistrar sharedInstance] registerStorage:storage target:kGDTCORTargetFLL];
+  [[GDTCORRegistrar sharedInstance] registerStorage:storage target:kGDTCORTargetCSH];
+  [[GDTCORRegistrar sharedInstance] registerStorage:storage target:kGDTCORTargetINT];
 }
 
 + (instancetype)sharedInstance {
@@ -92,16 +282,53 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
     _storageQueue =
         dispatch_queue_create("com.google.GDTCORFlatFileStorage", DISPATCH_QUEUE_SERIAL);
     _uploadCoordinator = [GDTCORUploadCoordinator sharedInstance];
+    _sizeBudget = [[GDTCORStorageSizeBudget alloc] initWithLimit:kGDTCORFlatFileStorageSizeLimit];
+    _durabilityPolicy = [[GDTCORStorageDurabilityPolicy alloc] init];
+    _partitions = [[NSMutableDictionary alloc] init];
+    _batchTargets = [[NSMutableDictionary alloc] init];
+    _sizeEstimates = [[NSMutableDictionary alloc] init];
+    _directoryPathsWithLoadedSize = [[NSMutableSet alloc] init];
   }
   return self;
 }
 
-- (GDTCORDirectorySizeTracker *)sizeTracker {
-  if (_sizeTracker == nil) {
-    _sizeTracker =
-        [[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:GDTCORRootDirectory().path];
+- (GDTCORDirectorySizeTracker *)libraryDataSizeTracker {
+  if (_libraryDataSizeTracker == nil) {
+    _libraryDataSizeTracker = [[GDTCORDirectorySizeTracker alloc]
+        initWithDirectoryPath:[[self class] libraryDataStoragePath]
+                   sizeBudget:self.sizeBudget];
+  }
+  return _libraryDataSizeTracker;
+}
+
+- (GDTCORLibraryDataStore *)libraryDataStore {
+  if (_libraryDataStore == nil) {
+    NSString *path = [[[self class] libraryDataStoragePath]
+        stringByAppendingPathComponent:kLibraryDataStoreFileName];
+    _libraryDataStore =
+        [[GDTCORLibraryDataStore alloc] initWithPath:path sizeTracker:self.libraryDataSizeTracker];
   }
-  return _sizeTracker;
+  return _libraryDataStore;
+}
+
+- (GDTCORBatchIDAllocator *)batchIDAllocator {
+  if (_batchIDAllocator == nil) {
+    _batchIDAllocator =
+        [[GDTCORBatchIDAllocator alloc] initWithLibraryDataStore:self.libraryDataStore
+                                                             key:gBatchIDCounterKey
+                                                       blockSize:kGDTCORBatchIDAllocatorBlockSize];
+  }
+  return _batchIDAllocator;
+}
+
+- (NSArray<GDTCORFlatFileStoragePartition *> *)partitions {
+  @synchronized(_partitions) {
+    return _partitions.allValues;
+  }
+}
+
+- (dispatch_queue_t)queueForTarget:(GDTCORTarget)target {
+  return [self partitionForTarget:target].queue;
 }
 
 #pragma mark - GDTCORStorageProtocol
@@ -134,59 +361,92 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
                   bgID = GDTCORBackgroundIdentifierInvalid;
                 }];
 
-  dispatch_async(_storageQueue, ^{
-    // Check that a backend implementation is available for this target.
-    GDTCORTarget target = event.target;
-    NSString *filePath = [GDTCORFlatFileStorage pathForTarget:target
-                                                      eventID:event.eventID
-                                                      qosTier:@(event.qosTier)
-                                               expirationDate:event.expirationDate
-                                                    mappingID:event.mappingID];
+  GDTCORFlatFileStoragePartition *partition = [self partitionForTarget:event.target];
+  dispatch_async(partition.queue, ^{
     NSError *error;
-    NSData *encodedEvent = GDTCOREncodeArchive(event, nil, &error);
-    if (error) {
-      completion(NO, error);
-      return;
-    }
+    BOOL wasWritten = [self writeEvent:event inPartition:partition error:&error];
+    completion(wasWritten, error);
 
-    // Check storage size limit before storing the event.
-    uint64_t resultingStorageSize = self.sizeTracker.directoryContentSize + encodedEvent.length;
-    if (resultingStorageSize > kGDTCORFlatFileStorageSizeLimit) {
-      NSError *error = [NSError
-          errorWithDomain:GDTCORFlatFileStorageErrorDomain
-                     code:GDTCORFlatFileStorageErrorSizeLimitReached
-                 userInfo:@{
-                   NSLocalizedFailureReasonErrorKey : @"Storage size limit has been reached."
-                 }];
-      if (self.delegate != nil) {
-        GDTCORLogDebug(@"Delegate notified that event with mapping ID %@ was dropped.",
-                       event.mappingID);
-        [self.delegate storage:self didDropEvent:event];
-      }
-      completion(NO, error);
-      return;
+    // Check the QoS, if it's high priority, notify the target that it has a high priority event.
+    if (wasWritten && event.qosTier == GDTCOREventQoSFast) {
+      // TODO: Remove a direct dependency on the upload coordinator.
+      [self.uploadCoordinator forceUploadForTarget:event.target];
     }
 
-    // Write the encoded event to the file.
-    BOOL writeResult = GDTCORWriteDataToFile(encodedEvent, filePath, &error);
-    if (writeResult == NO || error) {
-      GDTCORLogDebug(@"Attempt to write archive failed: path:%@ error:%@", filePath, error);
-      completion(NO, error);
-      return;
-    } else {
-      GDTCORLogDebug(@"Writing archive succeeded: %@", filePath);
-      completion(YES, nil);
+    // Cancel or end the associated background task if it's still valid.
+    [[GDTCORApplication sharedApplication] endBackgroundTask:bgID];
+    bgID = GDTCORBackgroundIdentifierInvalid;
+  });
+}
+
+- (void)storeEvents:(NSArray<GDTCOREvent *> *)events
+         onComplete:(void (^_Nullable)(NSUInteger storedEventCount,
+                                       NSError *_Nullable error))completion {
+  GDTCORLogDebug(@"Saving %lu events", (unsigned long)events.count);
+  __block NSError *lastError;
+  NSMutableDictionary<NSNumber *, NSMutableArray<GDTCOREvent *> *> *targetToEvents =
+      [[NSMutableDictionary alloc] init];
+  for (GDTCOREvent *event in events) {
+    if (event.serializedDataObjectBytes == nil) {
+      GDTCORLogDebug(@"%@", @"The event had no data, so it was not saved.");
+      lastError = [NSError errorWithDomain:NSInternalInconsistencyException code:-1 userInfo:nil];
+      continue;
     }
+    NSMutableArray<GDTCOREvent *> *targetEvents = targetToEvents[@(event.target)];
+    if (targetEvents == nil) {
+      targetEvents = [[NSMutableArray alloc] init];
+      targetToEvents[@(event.target)] = targetEvents;
+    }
+    [targetEvents addObject:event];
+  }
 
-    // Notify size tracker.
-    [self.sizeTracker fileWasAddedAtPath:filePath withSize:encodedEvent.length];
+  __block GDTCORBackgroundIdentifier bgID = GDTCORBackgroundIdentifierInvalid;
+  bgID = [[GDTCORApplication sharedApplication]
+      beginBackgroundTaskWithName:@"GDTStorage"
+                expirationHandler:^{
+                  // End the background task if it's still valid.
+                  [[GDTCORApplication sharedApplication] endBackgroundTask:bgID];
+                  bgID = GDTCORBackgroundIdentifierInvalid;
+                }];
 
-    // Check the QoS, if it's high priority, notify the target that it has a high priority event.
-    if (event.qosTier == GDTCOREventQoSFast) {
-      // TODO: Remove a direct dependency on the upload coordinator.
-      [self.uploadCoordinator forceUploadForTarget:target];
-    }
+  // The events of each target are written in one pass on the queue of its partition.
+  __block NSUInteger storedEventCount = 0;
+  NSObject *countLock = [[NSObject alloc] init];
+  dispatch_group_t group = dispatch_group_create();
+  [targetToEvents enumerateKeysAndObjectsUsingBlock:^(NSNumber *target,
+                                                      NSArray<GDTCOREvent *> *targetEvents,
+                                                      BOOL *stop) {
+    GDTCORFlatFileStoragePartition *partition = [self partitionForTarget:target.integerValue];
+    dispatch_group_async(group, partition.queue, ^{
+      NSUInteger writtenEventCount = 0;
+      NSError *error;
+      BOOL hasFastEvent = NO;
+      for (GDTCOREvent *event in targetEvents) {
+        @autoreleasepool {
+          NSError *eventError;
+          if ([self writeEvent:event inPartition:partition error:&eventError]) {
+            writtenEventCount++;
+            hasFastEvent = hasFastEvent || event.qosTier == GDTCOREventQoSFast;
+          } else {
+            error = eventError ?: error;
+          }
+        }
+      }
+      @synchronized(countLock) {
+        storedEventCount += writtenEventCount;
+        lastError = error ?: lastError;
+      }
+      if (hasFastEvent) {
+        // TODO: Remove a direct dependency on the upload coordinator.
+        [self.uploadCoordinator forceUploadForTarget:partition.target];
+      }
+    });
+  }];
 
+  dispatch_group_notify(group, _storageQueue, ^{
+    if (completion) {
+      completion(storedEventCount, lastError);
+    }
     // Cancel or end the associated background task if it's still valid.
     [[GDTCORApplication sharedApplication] endBackgroundTask:bgID];
     bgID = GDTCORBackgroundIdentifierInvalid;
@@ -198,85 +458,192 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
                     onComplete:
                         (nonnull void (^)(NSNumber *_Nullable batchID,
                                           NSSet<GDTCOREvent *> *_Nullable events))onComplete {
-  dispatch_queue_t queue = _storageQueue;
-  void (^onPathsForTargetComplete)(NSNumber *, NSSet<NSString *> *_Nonnull) = ^(
-      NSNumber *batchID, NSSet<NSString *> *_Nonnull paths) {
-    dispatch_async(queue, ^{
-      NSMutableSet<GDTCOREvent *> *events = [[NSMutableSet alloc] init];
-      for (NSString *eventPath in paths) {
-        NSError *error;
-        GDTCOREvent *event =
-            (GDTCOREvent *)GDTCORDecodeArchiveAtPath([GDTCOREvent class], eventPath, &error);
-        if (event == nil || error) {
-          GDTCORLogDebug(@"Error deserializing event: %@", error);
-          [[NSFileManager defaultManager] removeItemAtPath:eventPath error:nil];
-          continue;
-        } else {
-          NSString *fileName = [eventPath lastPathComponent];
-          NSString *batchPath =
-              [GDTCORFlatFileStorage batchPathForTarget:eventSelector.selectedTarget
-                                                batchID:batchID
-                                         expirationDate:expiration];
-          [[NSFileManager defaultManager] createDirectoryAtPath:batchPath
-                                    withIntermediateDirectories:YES
-                                                     attributes:nil
-                                                          error:nil];
-          NSString *destinationPath = [batchPath stringByAppendingPathComponent:fileName];
-          error = nil;
-          [[NSFileManager defaultManager] moveItemAtPath:eventPath
-                                                  toPath:destinationPath
-                                                   error:&error];
-          if (error) {
-            GDTCORLogDebug(@"An event file wasn't moveable into the batch directory: %@", error);
-          }
-          [events addObject:event];
-        }
+  GDTCORFlatFileStoragePartition *partition =
+      [self partitionForTarget:eventSelector.selectedTarget];
+  void (^onReserveComplete)(NSNumber *_Nullable, NSArray<NSString *> *_Nullable) = ^(
+      NSNumber *_Nullable batchID, NSArray<NSString *> *_Nullable batchedPaths) {
+    if (batchID == nil) {
+      if (onComplete) {
+        onComplete(nil, nil);
+      }
+      return;
+    }
+    // The block API hands out the decoded events, so read them right away.
+    NSMutableSet<GDTCOREvent *> *events = [[NSMutableSet alloc] init];
+    for (NSString *eventPath in batchedPaths) {
+      GDTCOREvent *event = [GDTCORFlatFileBatchEventSource eventAtPath:eventPath];
+      if (event) {
+        [events addObject:event];
+      } else {
+        [self removeEventFilesNamed:@[ [eventPath lastPathComponent] ] inPartition:partition];
       }
+    }
+    if (events.count == 0) {
+      [self syncThreadUnsafeRemoveBatchWithID:batchID deleteEvents:YES inPartition:partition];
       if (onComplete) {
-        if (events.count == 0) {
-          onComplete(nil, nil);
-        } else {
-          onComplete(batchID, events);
-        }
+        onComplete(nil, nil);
       }
-    });
+      return;
+    }
+    if (onComplete) {
+      onComplete(batchID, events);
+    }
   };
 
-  void (^onBatchIDFetchComplete)(NSNumber *) = ^(NSNumber *batchID) {
-    dispatch_async(queue, ^{
-      if (batchID == nil) {
-        if (onComplete) {
-          onComplete(nil, nil);
-          return;
-        }
-      }
-      [self pathsForTarget:eventSelector.selectedTarget
-                  eventIDs:eventSelector.selectedEventIDs
-                  qosTiers:eventSelector.selectedQosTiers
-                mappingIDs:eventSelector.selectedMappingIDs
-                onComplete:^(NSSet<NSString *> *_Nonnull paths) {
-                  onPathsForTargetComplete(batchID, paths);
-                }];
-    });
-  };
+  [self reserveBatchWithEventSelector:eventSelector
+                      batchExpiration:expiration
+                           onComplete:onReserveComplete];
+}
 
-  [self nextBatchID:^(NSNumber *_Nullable batchID) {
+- (void)uploadBatchWithEventSelector:(GDTCORStorageEventSelector *)eventSelector
+                     batchExpiration:(NSDate *)expiration
+                          onComplete:(void (^)(GDTCORUploadBatch *_Nullable batch))onComplete {
+  GDTCORFlatFileStoragePartition *partition =
+      [self partitionForTarget:eventSelector.selectedTarget];
+  void (^onReserveComplete)(NSNumber *_Nullable, NSArray<NSString *> *_Nullable) = ^(
+      NSNumber *_Nullable batchID, NSArray<NSString *> *_Nullable batchedPaths) {
     if (batchID == nil) {
-      if (onComplete) {
-        onComplete(nil, nil);
+      onComplete(nil);
+      return;
+    }
+    GDTCORFlatFileBatchEventSource *eventSource =
+        [[GDTCORFlatFileBatchEventSource alloc] initWithPaths:batchedPaths
+                                                      storage:self
+                                                    partition:partition];
+    onComplete([[GDTCORUploadBatch alloc] initWithBatchID:batchID eventSource:eventSource]);
+  };
+
+  [self reserveBatchWithEventSelector:eventSelector
+                      batchExpiration:expiration
+                           onComplete:onReserveComplete];
+}
+
+- (void)pendingBatchWithEventSelector:(GDTCORStorageEventSelector *)eventSelector
+                          onComplete:(void (^)(GDTCORUploadBatch *_Nullable batch))onComplete {
+  GDTCORTarget target = eventSelector.selectedTarget;
+  GDTCORFlatFileStoragePartition *partition = [self partitionForTarget:target];
+  dispatch_async(partition.queue, ^{
+    // Batch IDs are allocated in increasing order, so the lowest one is the oldest batch.
+    NSArray<GDTCORBatchJournalBatch *> *openBatches =
+        [[[self batchJournalOfPartition:partition] openBatches]
+            sortedArrayUsingComparator:^NSComparisonResult(GDTCORBatchJournalBatch *batch1,
+                                                           GDTCORBatchJournalBatch *batch2) {
+              return [batch1.batchID compare:batch2.batchID];
+            }];
+    GDTCORBatchJournalBatch *oldestBatch;
+    for (GDTCORBatchJournalBatch *batch in openBatches) {
+      if ([self isBatch:batch selectedByQosTiers:eventSelector.selectedQosTiers]) {
+        oldestBatch = batch;
+        break;
       }
-    } else {
-      onBatchIDFetchComplete(batchID);
+      // The batch was formed under other conditions, its events are batched again once allowed.
+      GDTCORLogDebug(@"Dissolving batch %@, its QoS tiers can't be uploaded now", batch.batchID);
+      [self syncThreadUnsafeRemoveBatchWithID:batch.batchID deleteEvents:NO inPartition:partition];
     }
-  }];
+    if (oldestBatch == nil) {
+      onComplete(nil);
+      return;
+    }
+    NSMutableArray<NSString *> *eventPaths =
+        [[NSMutableArray alloc] initWithCapacity:oldestBatch.eventFilenames.count];
+    for (NSString *filename in oldestBatch.eventFilenames) {
+      [eventPaths addObject:[self pathOfEventFileNamed:filename inPartition:partition]];
+    }
+    GDTCORFlatFileBatchEventSource *eventSource =
+        [[GDTCORFlatFileBatchEventSource alloc] initWithPaths:eventPaths
+                                                      storage:self
+                                                    partition:partition];
+    GDTCORUploadBatch *batch = [[GDTCORUploadBatch alloc] initWithBatchID:oldestBatch.batchID
+                                                              eventSource:eventSource];
+    NSString *requestBodyPath = [partition requestBodyPathForBatchID:oldestBatch.batchID];
+    NSData *storedRequestBody = [NSData dataWithContentsOfFile:requestBodyPath];
+    if (storedRequestBody) {
+      NSDate *retryDate;
+      NSData *requestBody = GDTCORDecodeStoredRequestBody(storedRequestBody, &retryDate);
+      if (requestBody == nil) {
+        GDTCORLogDebug(@"Removing the damaged request body of batch %@", batch.batchID);
+        [self removeRequestBodyAtPath:requestBodyPath inPartition:partition];
+      } else if (-retryDate.timeIntervalSinceNow > kGDTCORFlatFileStorageRequestBodyMaxAge) {
+        // The request time in the body would be stale, so the request is built again.
+        GDTCORLogDebug(@"Removing the outdated request body of batch %@", batch.batchID);
+        [self removeRequestBodyAtPath:requestBodyPath inPartition:partition];
+      } else {
+        batch = [batch batchWithRequestBody:requestBody];
+      }
+    }
+    GDTCORLogDebug(@"Resuming batch %@ of target %ld", batch.batchID, (long)target);
+    onComplete(batch);
+  });
+}
+
+- (void)storeRequestBody:(NSData *)requestBody
+              forBatchID:(NSNumber *)batchID
+               retryDate:(NSDate *)retryDate
+              onComplete:(void (^)(NSError *_Nullable error))onComplete {
+  GDTCORFlatFileStoragePartition *partition = [self partitionOfBatchWithID:batchID];
+  if (partition == nil) {
+    onComplete([self batchNotFoundErrorWithBatchID:batchID]);
+    return;
+  }
+  dispatch_async(partition.queue, ^{
+    // The batch may have been closed in the meantime, e.g. because it expired.
+    if ([self partitionOfBatchWithID:batchID] == nil) {
+      onComplete([self batchNotFoundErrorWithBatchID:batchID]);
+      return;
+    }
+    [self removeRequestBodyOfBatchWithID:batchID inPartition:partition];
+    NSData *storedRequestBody = GDTCOREncodeStoredRequestBody(requestBody, retryDate);
+    uint64_t length = storedRequestBody.length;
+    uint64_t limit = kGDTCORFlatFileStorageRequestBodiesSizeLimit;
+    // Keep the bodies of the target within their limit, then make room in the storage size limit,
+    // dropping the bodies of the oldest batches in both cases.
+    if (length > limit || ![self trimRequestBodiesOfPartition:partition toSize:limit - length] ||
+        ![self reserveStorageSize:length removingRequestBodiesOfPartition:partition]) {
+      onComplete([NSError
+          errorWithDomain:GDTCORFlatFileStorageErrorDomain
+                     code:GDTCORFlatFileStorageErrorSizeLimitReached
+                 userInfo:@{
+                   NSLocalizedFailureReasonErrorKey : @"There is no room for the request body."
+                 }]);
+      return;
+    }
+    NSString *requestBodyPath = [partition requestBodyPathForBatchID:batchID];
+    NSError *error;
+    if (GDTCORWriteDataToFile(storedRequestBody, requestBodyPath, &error)) {
+      [partition.sizeTracker fileWasAddedAtPath:requestBodyPath withSize:length];
+    }
+    [self.sizeBudget removeSize:length];
+    onComplete(error);
+  });
 }
 
 - (void)removeBatchWithID:(nonnull NSNumber *)batchID
              deleteEvents:(BOOL)deleteEvents
                onComplete:(void (^_Nullable)(void))onComplete {
-  dispatch_async(_storageQueue, ^{
-    [self syncThreadUnsafeRemoveBatchWithID:batchID deleteEvents:deleteEvents];
+  GDTCORFlatFileStoragePartition *partition = [self partitionOfBatchWithID:batchID];
+  if (partition) {
+    dispatch_async(partition.queue, ^{
+      [self syncThreadUnsafeRemoveBatchWithID:batchID
+                                 deleteEvents:deleteEvents
+                                  inPartition:partition];
+      if (onComplete) {
+        onComplete();
+      }
+    });
+    return;
+  }
 
+  // The target of the batch is unknown until its batch journal is loaded, e.g. after a restart, so
+  // the batch is looked up in every partition.
+  dispatch_group_t group = dispatch_group_create();
+  for (GDTCORFlatFileStoragePartition *partition in [self allPartitions]) {
+    dispatch_group_async(group, partition.queue, ^{
+      [self syncThreadUnsafeRemoveBatchWithID:batchID
+                                 deleteEvents:deleteEvents
+                                  inPartition:partition];
+    });
+  }
+  dispatch_group_notify(group, _storageQueue, ^{
     if (onComplete) {
       onComplete();
     }
@@ -285,26 +652,19 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
 
 - (void)batchIDsForTarget:(GDTCORTarget)target
                onComplete:(nonnull void (^)(NSSet<NSNumber *> *_Nullable))onComplete {
-  dispatch_async(_storageQueue, ^{
-    NSFileManager *fileManager = [NSFileManager defaultManager];
-    NSError *error;
-    NSArray<NSString *> *batchPaths =
-        [fileManager contentsOfDirectoryAtPath:[GDTCORFlatFileStorage batchDataStoragePath]
-                                         error:&error];
-    if (error || batchPaths.count == 0) {
+  GDTCORFlatFileStoragePartition *partition = [self partitionForTarget:target];
+  dispatch_async(partition.queue, ^{
+    NSArray<GDTCORBatchJournalBatch *> *openBatches =
+        [[self batchJournalOfPartition:partition] openBatches];
+    if (openBatches.count == 0) {
       if (onComplete) {
         onComplete(nil);
       }
       return;
     }
     NSMutableSet<NSNumber *> *batchIDs = [[NSMutableSet alloc] init];
-    for (NSString *path in batchPaths) {
-      NSDictionary<NSString *, id> *components = [self batchComponentsFromFilename:path];
-      NSNumber *targetNumber = components[kGDTCORBatchComponentsTargetKey];
-      NSNumber *batchID = components[kGDTCORBatchComponentsBatchIDKey];
-      if (batchID != nil && targetNumber.intValue == target) {
-        [batchIDs addObject:batchID];
-      }
+    for (GDTCORBatchJournalBatch *batch in openBatches) {
+      [batchIDs addObject:batch.batchID];
     }
     if (onComplete) {
       onComplete(batchIDs);
@@ -316,11 +676,9 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
           onFetchComplete:(nonnull void (^)(NSData *_Nullable, NSError *_Nullable))onFetchComplete
               setNewValue:(NSData *_Nullable (^_Nullable)(void))setValueBlock {
   dispatch_async(_storageQueue, ^{
-    NSString *dataPath = [[[self class] libraryDataStoragePath] stringByAppendingPathComponent:key];
-    NSError *error;
-    NSData *data = [NSData dataWithContentsOfFile:dataPath options:0 error:&error];
+    NSData *data = [self.libraryDataStore dataForKey:key];
     if (onFetchComplete) {
-      onFetchComplete(data, error);
+      onFetchComplete(data, data ? nil : [self libraryDataNotFoundErrorWithKey:key]);
     }
     if (setValueBlock) {
       NSData *newValue = setValueBlock();
@@ -328,11 +686,7 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
       // the implicit return value will be the block itself. The compiler doesn't detect this.
       if (newValue != nil && [newValue isKindOfClass:[NSData class]] && newValue.length) {
         NSError *newValueError;
-        if ([newValue writeToFile:dataPath options:NSDataWritingAtomic error:&newValueError]) {
-          // Update storage size.
-          [self.sizeTracker fileWasRemovedAtPath:dataPath withSize:data.length];
-          [self.sizeTracker fileWasAddedAtPath:dataPath withSize:newValue.length];
-        } else {
+        if (![self.libraryDataStore setData:newValue forKey:key error:&newValueError]) {
           GDTCORLogDebug(@"Error writing new value in libraryDataForKey: %@", newValueError);
         }
       }
@@ -351,10 +705,7 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
   }
   dispatch_async(_storageQueue, ^{
     NSError *error;
-    NSString *dataPath = [[[self class] libraryDataStoragePath] stringByAppendingPathComponent:key];
-    if ([data writeToFile:dataPath options:NSDataWritingAtomic error:&error]) {
-      [self.sizeTracker fileWasAddedAtPath:dataPath withSize:data.length];
-    }
+    [self.libraryDataStore setData:data forKey:key error:&error];
     if (onComplete) {
       onComplete(error);
     }
@@ -365,32 +716,18 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
                      onComplete:(nonnull void (^)(NSError *_Nullable error))onComplete {
   dispatch_async(_storageQueue, ^{
     NSError *error;
-    NSString *dataPath = [[[self class] libraryDataStoragePath] stringByAppendingPathComponent:key];
-    GDTCORStorageSizeBytes fileSize =
-        [self.sizeTracker fileSizeAtURL:[NSURL fileURLWithPath:dataPath]];
-
-    if ([[NSFileManager defaultManager] fileExistsAtPath:dataPath]) {
-      if ([[NSFileManager defaultManager] removeItemAtPath:dataPath error:&error]) {
-        [self.sizeTracker fileWasRemovedAtPath:dataPath withSize:fileSize];
-      }
-      if (onComplete) {
-        onComplete(error);
-      }
+    [self.libraryDataStore removeDataForKey:key error:&error];
+    if (onComplete) {
+      onComplete(error);
     }
   });
 }
 
 - (void)hasEventsForTarget:(GDTCORTarget)target onComplete:(void (^)(BOOL hasEvents))onComplete {
-  dispatch_async(_storageQueue, ^{
-    NSFileManager *fileManager = [NSFileManager defaultManager];
-    NSString *targetPath = [NSString
-        stringWithFormat:@"%@/%ld", [GDTCORFlatFileStorage eventDataStoragePath], (long)target];
-    [fileManager createDirectoryAtPath:targetPath
-           withIntermediateDirectories:YES
-                            attributes:nil
-                                 error:nil];
-    NSDirectoryEnumerator *enumerator = [fileManager enumeratorAtPath:targetPath];
-    BOOL hasEventAtLeastOneEvent = [enumerator nextObject] != nil;
+  GDTCORFlatFileStoragePartition *partition = [self partitionForTarget:target];
+  dispatch_async(partition.queue, ^{
+    [self loadEventIndexOfPartitionIfNeeded:partition];
+    BOOL hasEventAtLeastOneEvent = [partition.eventIndex countForTarget:target] > 0;
     if (onComplete) {
       onComplete(hasEventAtLeastOneEvent);
     }
@@ -398,140 +735,156 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
 }
 
 - (void)checkForExpirations {
-  dispatch_async(_storageQueue, ^{
-    GDTCORLogDebug(@"%@", @"Checking for expired events and batches");
-    NSTimeInterval now = [NSDate date].timeIntervalSince1970;
-    NSFileManager *fileManager = [NSFileManager defaultManager];
-
-    // TODO: Storage may not have enough context to remove batches because a batch may be being
-    // uploaded but the storage has not context of it.
-
-    // Find expired batches and move their events back to the main storage.
-    // If a batch contains expired events they are expected to be removed further in the method
-    // together with other expired events in the main storage.
-    NSString *batchDataPath = [GDTCORFlatFileStorage batchDataStoragePath];
-    NSArray<NSString *> *batchDataPaths = [fileManager contentsOfDirectoryAtPath:batchDataPath
-                                                                           error:nil];
-    for (NSString *path in batchDataPaths) {
-      @autoreleasepool {
-        NSString *fileName = [path lastPathComponent];
-        NSDictionary<NSString *, id> *batchComponents = [self batchComponentsFromFilename:fileName];
-        NSDate *expirationDate = batchComponents[kGDTCORBatchComponentsExpirationKey];
-        NSNumber *batchID = batchComponents[kGDTCORBatchComponentsBatchIDKey];
-        if (expirationDate != nil && expirationDate.timeIntervalSince1970 < now && batchID != nil) {
-          NSNumber *batchID = batchComponents[kGDTCORBatchComponentsBatchIDKey];
-          // Move all events from the expired batch back to the main storage.
-          [self syncThreadUnsafeRemoveBatchWithID:batchID deleteEvents:NO];
-        }
-      }
-    }
+  // Each target is checked on its own queue.
+  for (GDTCORFlatFileStoragePartition *partition in [self allPartitions]) {
+    dispatch_async(partition.queue, ^{
+      [self checkForExpirationsInPartition:partition];
+    });
+  }
+}
 
-    // Find expired events and remove them from the storage.
-    NSMutableSet<GDTCOREvent *> *expiredEvents = [NSMutableSet set];
-    NSString *eventDataPath = [GDTCORFlatFileStorage eventDataStoragePath];
-    NSDirectoryEnumerator *enumerator = [fileManager enumeratorAtPath:eventDataPath];
-    NSString *path;
-
-    while (YES) {
-      @autoreleasepool {
-        // Call `[enumerator nextObject]` under autorelease pool to make sure all autoreleased
-        // objects created under the hood are released on each iteration end to avoid unnecessary
-        // memory growth.
-        path = [enumerator nextObject];
-        if (path == nil) {
-          break;
-        }
+- (void)storageSizeWithCallback:(void (^)(uint64_t storageSize))onComplete {
+  if (!onComplete) {
+    return;
+  }
 
-        NSString *fileName = [path lastPathComponent];
-        NSDictionary<NSString *, id> *eventComponents = [self eventComponentsFromFilename:fileName];
-        NSDate *expirationDate = eventComponents[kGDTCOREventComponentsExpirationKey];
-        if (expirationDate != nil && expirationDate.timeIntervalSince1970 < now) {
-          NSString *pathToDelete = [eventDataPath stringByAppendingPathComponent:path];
-
-          // Decode the expired event from the path to be deleted.
-          NSError *decodeError;
-          GDTCOREvent *event = (GDTCOREvent *)GDTCORDecodeArchiveAtPath([GDTCOREvent class],
-                                                                        pathToDelete, &decodeError);
-          if (event == nil || decodeError) {
-            GDTCORLogDebug(@"Error deserializing event while checking for expired events: %@",
-                           decodeError);
-            event = nil;
-          }
+  // The size budget is exact once every size tracker calculated or loaded its size in place of its
+  // estimate, which happens on the queue owning the tracker.
+  dispatch_group_t group = dispatch_group_create();
+  for (GDTCORFlatFileStoragePartition *partition in [self allPartitions]) {
+    dispatch_group_async(group, partition.queue, ^{
+      [self loadSizeOfTracker:partition.sizeTracker];
+    });
+  }
+  dispatch_group_async(group, _storageQueue, ^{
+    [self loadSizeOfTracker:self.libraryDataSizeTracker];
+  });
+  dispatch_group_notify(group, _storageQueue, ^{
+    onComplete(self.sizeBudget.totalSize);
+  });
+}
 
-          // Remove the path to be deleted, adding the decoded event to the
-          // event set if the removal was successful.
-          NSError *removeError;
-          [fileManager removeItemAtPath:pathToDelete error:&removeError];
-          if (removeError != nil) {
-            GDTCORLogDebug(@"There was an error deleting an expired item: %@", removeError);
-          } else {
-            GDTCORLogDebug(@"Item deleted because it expired: %@", pathToDelete);
-            if (event) {
-              [expiredEvents addObject:event];
-            }
-          }
-        }
-      }
+#pragma mark - Partitions
+
+/** Returns the partition of the target, creating it if needed. */
+- (GDTCORFlatFileStoragePartition *)partitionForTarget:(GDTCORTarget)target {
+  @synchronized(_partitions) {
+    GDTCORFlatFileStoragePartition *partition = _partitions[@(target)];
+    if (partition == nil) {
+      partition = [[GDTCORFlatFileStoragePartition alloc]
+          initWithTarget:target
+           eventDataPath:[GDTCORFlatFileStorage eventDataPathForTarget:target]
+              sizeBudget:self.sizeBudget];
+      _partitions[@(target)] = partition;
     }
+    return partition;
+  }
+}
 
-    if (self.delegate != nil && [expiredEvents count] > 0) {
-      GDTCORLogDebug(@"Delegate notified that %@ events were dropped.", @(expiredEvents.count));
-      [self.delegate storage:self didRemoveExpiredEvents:[expiredEvents copy]];
+/** Returns the partitions of every target that has an event data directory, as well as the ones
+ * created so far.
+ */
+- (NSArray<GDTCORFlatFileStoragePartition *> *)allPartitions {
+  NSArray<NSString *> *targetDirectories = [[NSFileManager defaultManager]
+      contentsOfDirectoryAtPath:[GDTCORFlatFileStorage eventDataStoragePath]
+                          error:nil];
+  for (NSString *targetDirectory in targetDirectories) {
+    GDTCORTarget target = (GDTCORTarget)targetDirectory.integerValue;
+    if ([targetDirectory isEqualToString:[@(target) stringValue]]) {
+      [self partitionForTarget:target];
     }
+  }
+  return self.partitions;
+}
 
-    [self.sizeTracker resetCachedSize];
-  });
+/** Returns the partition of the open batch with the ID, or nil if the batch is not known. */
+- (nullable GDTCORFlatFileStoragePartition *)partitionOfBatchWithID:(NSNumber *)batchID {
+  NSNumber *target;
+  @synchronized(_batchTargets) {
+    target = _batchTargets[batchID];
+  }
+  return target ? [self partitionForTarget:(GDTCORTarget)target.integerValue] : nil;
 }
 
-- (void)storageSizeWithCallback:(void (^)(uint64_t storageSize))onComplete {
-  if (!onComplete) {
-    return;
+/** Records the target of an open batch, or forgets it if the target is nil. */
+- (void)setTarget:(nullable NSNumber *)target ofBatchWithID:(NSNumber *)batchID {
+  @synchronized(_batchTargets) {
+    _batchTargets[batchID] = target;
   }
+}
 
-  dispatch_async(_storageQueue, ^{
-    onComplete([self.sizeTracker directoryContentSize]);
-  });
+/** Adds the size of the partition to the size budget. The first time, the sizes of the other
+ * partitions and of the library data are counted in the budget too, so that no reservation is made
+ * against a partial total. Each of them is counted at an estimate until it is loaded on the queue
+ * owning its size tracker, which replaces the estimate. Nothing waits for another queue. Must be
+ * called on the queue of the partition.
+ */
+- (void)loadStorageSizeIfNeededInPartition:(GDTCORFlatFileStoragePartition *)partition {
+  [self loadSizeOfTracker:partition.sizeTracker];
+  @synchronized(_sizeEstimates) {
+    if (_isStorageSizeLoadStarted) {
+      return;
+    }
+    _isStorageSizeLoadStarted = YES;
+    for (GDTCORFlatFileStoragePartition *otherPartition in [self allPartitions]) {
+      if (otherPartition == partition) {
+        continue;
+      }
+      [self estimateSizeOfTracker:otherPartition.sizeTracker];
+      dispatch_async(otherPartition.queue, ^{
+        [self loadSizeOfTracker:otherPartition.sizeTracker];
+      });
+    }
+    [self estimateSizeOfTracker:self.libraryDataSizeTracker];
+    dispatch_async(_storageQueue, ^{
+      [self loadSizeOfTracker:self.libraryDataSizeTracker];
+    });
+  }
 }
 
-#pragma mark - Private not thread safe methods
-/** Looks for directory paths containing events for a batch with the specified ID.
- * @param batchID A batch ID.
- * @param outError A pointer to `NSError *` to assign as possible error to.
- * @return An array of an array of paths to directories for event batches with a specified batch ID
- * or `nil` in the case of an error. Usually returns a single path but potentially return more in
- * cases when the app is terminated while uploading a batch.
- */
-- (nullable NSArray<NSString *> *)batchDirPathsForBatchID:(NSNumber *)batchID
-                                                    error:(NSError **_Nonnull)outError {
-  NSFileManager *fileManager = [NSFileManager defaultManager];
-  NSError *error;
-  NSArray<NSString *> *batches =
-      [fileManager contentsOfDirectoryAtPath:[GDTCORFlatFileStorage batchDataStoragePath]
-                                       error:&error];
-  if (batches == nil) {
-    *outError = error;
-    GDTCORLogDebug(@"Failed to find event file paths for batchID: %@, error: %@", batchID, error);
-    return nil;
+/** Counts the size of a tracker whose size isn't loaded yet in the size budget. The estimate is
+ * the persisted size if there is one, or the content size of the directory otherwise. It is
+ * conservative: the owner of the tracker can't store anything before loading the size, so the
+ * directory can only shrink until then. Must be called while synchronizing on the size estimates.
+ */
+- (void)estimateSizeOfTracker:(GDTCORDirectorySizeTracker *)tracker {
+  NSString *path = tracker.directoryPath;
+  if ([_directoryPathsWithLoadedSize containsObject:path] || _sizeEstimates[path] != nil) {
+    return;
   }
+  GDTCORStorageSizeBytes estimate =
+      [[[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:path] directoryContentSize];
+  _sizeEstimates[path] = @(estimate);
+  [self.sizeBudget addSize:estimate];
+}
 
-  NSMutableArray<NSString *> *batchDirPaths = [NSMutableArray array];
-  for (NSString *path in batches) {
-    NSDictionary<NSString *, id> *components = [self batchComponentsFromFilename:path];
-    NSNumber *pathBatchID = components[kGDTCORBatchComponentsBatchIDKey];
-    if ([pathBatchID isEqual:batchID]) {
-      NSString *batchDirPath =
-          [[GDTCORFlatFileStorage batchDataStoragePath] stringByAppendingPathComponent:path];
-      [batchDirPaths addObject:batchDirPath];
+/** Adds the size of the tracker to the size budget, in place of its estimate if it was counted at
+ * one. Must be called on the queue owning the tracker.
+ */
+- (void)loadSizeOfTracker:(GDTCORDirectorySizeTracker *)tracker {
+  [tracker directoryContentSize];
+  @synchronized(_sizeEstimates) {
+    NSString *path = tracker.directoryPath;
+    [_directoryPathsWithLoadedSize addObject:path];
+    NSNumber *estimate = _sizeEstimates[path];
+    if (estimate != nil) {
+      [_sizeEstimates removeObjectForKey:path];
+      [self.sizeBudget removeSize:estimate.unsignedLongLongValue];
     }
   }
-
-  return [batchDirPaths copy];
 }
 
-/** Makes a copy of the contents of a directory to a directory at the specified path.*/
-- (BOOL)moveContentsOfDirectoryAtPath:(NSString *)sourcePath
-                                   to:(NSString *)destinationPath
-                                error:(NSError **_Nonnull)outError {
+#pragma mark - Private not thread safe methods
+
+/** Moves the event files directly inside a directory to their shard directories in the
+ * partition. Subdirectories, hidden files and the batch journal are left in place.
+ *
+ * @param movedPaths If not nil, populated with the destination paths of the moved files.
+ */
+- (BOOL)moveEventFilesInDirectoryAtPath:(NSString *)sourcePath
+                            toPartition:(GDTCORFlatFileStoragePartition *)partition
+                             movedPaths:(nullable NSMutableArray<NSString *> *)movedPaths
+                                  error:(NSError **_Nonnull)outError {
   NSFileManager *fileManager = [NSFileManager defaultManager];
 
   NSError *error;
@@ -543,16 +896,32 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
   }
 
   NSMutableArray<NSError *> *errors = [NSMutableArray array];
-  for (NSString *path in contentsPaths) {
-    NSString *contentDestinationPath = [destinationPath stringByAppendingPathComponent:path];
-    NSString *contentSourcePath = [sourcePath stringByAppendingPathComponent:path];
-
-    NSError *moveError;
-    if (![fileManager moveItemAtPath:contentSourcePath
-                              toPath:contentDestinationPath
-                               error:&moveError] &&
-        moveError) {
-      [errors addObject:moveError];
+  for (NSString *filename in contentsPaths) {
+    @autoreleasepool {
+      if ([filename hasPrefix:@"."] ||
+          [filename isEqualToString:kGDTCORFlatFileStoragePartitionBatchJournalName]) {
+        continue;
+      }
+      NSString *contentSourcePath = [sourcePath stringByAppendingPathComponent:filename];
+      BOOL isDirectory = NO;
+      if (![fileManager fileExistsAtPath:contentSourcePath isDirectory:&isDirectory] ||
+          isDirectory) {
+        continue;
+      }
+      NSString *contentDestinationPath = [self pathOfEventFileNamed:filename
+                                                        inPartition:partition];
+      [fileManager createDirectoryAtPath:[contentDestinationPath stringByDeletingLastPathComponent]
+             withIntermediateDirectories:YES
+                              attributes:nil
+                                   error:nil];
+      NSError *moveError;
+      if ([fileManager moveItemAtPath:contentSourcePath
+                               toPath:contentDestinationPath
+                                error:&moveError]) {
+        [movedPaths addObject:contentDestinationPath];
+      } else if (moveError) {
+        [errors addObject:moveError];
+      }
     }
   }
 
@@ -567,64 +936,477 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
   }
 }
 
+/** Closes the batch with the ID if it is open in the partition. Must be called on the queue of the
+ * partition.
+ */
 - (void)syncThreadUnsafeRemoveBatchWithID:(nonnull NSNumber *)batchID
-                             deleteEvents:(BOOL)deleteEvents {
-  NSError *error;
-  NSArray<NSString *> *batchDirPaths = [self batchDirPathsForBatchID:batchID error:&error];
+                             deleteEvents:(BOOL)deleteEvents
+                              inPartition:(GDTCORFlatFileStoragePartition *)partition {
+  GDTCORBatchJournal *batchJournal = [self batchJournalOfPartition:partition];
+  if (deleteEvents) {
+    // The commit is recorded first, so that a crash while deleting the events can't lead to them
+    // being uploaded again.
+    GDTCORBatchJournalBatch *batch = [batchJournal commitBatchWithID:batchID];
+    if (batch == nil) {
+      return;
+    }
+    [self setTarget:nil ofBatchWithID:batchID];
+    [self removeEventFilesNamed:batch.eventFilenames inPartition:partition];
+    [self removeRequestBodyOfBatchWithID:batchID inPartition:partition];
+    GDTCORLogDebug(@"Batch removed: %@", batchID);
+  } else {
+    GDTCORBatchJournalBatch *batch = [batchJournal abortBatchWithID:batchID];
+    if (batch == nil) {
+      return;
+    }
+    [self setTarget:nil ofBatchWithID:batchID];
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    for (NSString *filename in batch.eventFilenames) {
+      NSString *eventPath = [self pathOfEventFileNamed:filename inPartition:partition];
+      if ([fileManager fileExistsAtPath:eventPath]) {
+        [self indexEventAtPath:eventPath inPartition:partition];
+      }
+    }
+    [self removeRequestBodyOfBatchWithID:batchID inPartition:partition];
+    GDTCORLogDebug(@"Batched events of batch %@ returned to the storage", batchID);
+  }
+  [batchJournal compactIfNeeded];
+}
 
-  if (batchDirPaths == nil) {
-    return;
+- (void)removeEventFilesNamed:(NSArray<NSString *> *)filenames
+                  inPartition:(GDTCORFlatFileStoragePartition *)partition {
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  for (NSString *filename in filenames) {
+    @autoreleasepool {
+      NSString *eventPath = [self pathOfEventFileNamed:filename inPartition:partition];
+      NSDictionary<NSFileAttributeKey, id> *attributes =
+          [fileManager attributesOfItemAtPath:eventPath error:nil];
+      if (attributes == nil) {
+        continue;
+      }
+      NSError *error;
+      if ([fileManager removeItemAtPath:eventPath error:&error]) {
+        [partition.sizeTracker fileWasRemovedAtPath:eventPath withSize:[attributes fileSize]];
+      } else {
+        GDTCORLogDebug(@"Failed to remove batched event at path: %@ error: %@", eventPath, error);
+      }
+    }
+  }
+}
+
+/** Returns YES if the events of the batch all belong to the given QoS tiers, nil meaning any. The
+ * QoS tier of an event is part of its file name.
+ */
+- (BOOL)isBatch:(GDTCORBatchJournalBatch *)batch
+    selectedByQosTiers:(nullable NSSet<NSNumber *> *)qosTiers {
+  if (qosTiers == nil) {
+    return YES;
+  }
+  for (NSString *filename in batch.eventFilenames) {
+    NSNumber *qosTier =
+        [self eventComponentsFromFilename:filename][kGDTCOREventComponentsQoSTierKey];
+    if (qosTier == nil || ![qosTiers containsObject:qosTier]) {
+      return NO;
+    }
+  }
+  return YES;
+}
+
+/** Removes the request body stored for the batch, if any. Must be called on the queue of the
+ * partition.
+ */
+- (void)removeRequestBodyOfBatchWithID:(NSNumber *)batchID
+                           inPartition:(GDTCORFlatFileStoragePartition *)partition {
+  [self removeRequestBodyAtPath:[partition requestBodyPathForBatchID:batchID]
+                    inPartition:partition];
+}
+
+/** Removes the request body file at the path, if it exists. Must be called on the queue of the
+ * partition. Every request body is removed through here, whether it is outdated, damaged, trimmed
+ * or evicted. Stored bodies carry no metrics, so removing one only costs building the request
+ * again.
+ *
+ * @return The size of the removed file, 0 if no file was removed.
+ */
+- (uint64_t)removeRequestBodyAtPath:(NSString *)requestBodyPath
+                        inPartition:(GDTCORFlatFileStoragePartition *)partition {
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSDictionary<NSFileAttributeKey, id> *attributes =
+      [fileManager attributesOfItemAtPath:requestBodyPath error:nil];
+  if (attributes == nil || ![fileManager removeItemAtPath:requestBodyPath error:nil]) {
+    return 0;
+  }
+  [partition.sizeTracker fileWasRemovedAtPath:requestBodyPath withSize:[attributes fileSize]];
+  return [attributes fileSize];
+}
+
+/** Returns the paths of the request bodies stored in the partition, oldest batch first. Must be
+ * called on the queue of the partition.
+ */
+- (NSArray<NSString *> *)requestBodyPathsOfPartition:(GDTCORFlatFileStoragePartition *)partition {
+  NSString *requestBodiesPath = [partition.eventDataPath
+      stringByAppendingPathComponent:kGDTCORFlatFileStoragePartitionRequestBodiesDirectoryName];
+  NSMutableArray<NSString *> *filenames = [[NSMutableArray alloc] init];
+  for (NSString *filename in [[NSFileManager defaultManager]
+           contentsOfDirectoryAtPath:requestBodiesPath
+                               error:nil]) {
+    if (![filename hasPrefix:@"."]) {
+      [filenames addObject:filename];
+    }
+  }
+  [filenames sortUsingComparator:^NSComparisonResult(NSString *filename1, NSString *filename2) {
+    return [@(filename1.longLongValue) compare:@(filename2.longLongValue)];
+  }];
+  NSMutableArray<NSString *> *paths = [[NSMutableArray alloc] initWithCapacity:filenames.count];
+  for (NSString *filename in filenames) {
+    [paths addObject:[requestBodiesPath stringByAppendingPathComponent:filename]];
   }
+  return paths;
+}
 
+/** Removes the request bodies of the oldest batches of the partition until the remaining ones take
+ * at most the given size. Must be called on the queue of the partition.
+ *
+ * @return NO if the remaining bodies couldn't be brought within the size.
+ */
+- (BOOL)trimRequestBodiesOfPartition:(GDTCORFlatFileStoragePartition *)partition
+                              toSize:(uint64_t)size {
   NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSArray<NSString *> *paths = [self requestBodyPathsOfPartition:partition];
+  uint64_t totalSize = 0;
+  for (NSString *path in paths) {
+    totalSize += [[fileManager attributesOfItemAtPath:path error:nil] fileSize];
+  }
+  for (NSString *path in paths) {
+    if (totalSize <= size) {
+      break;
+    }
+    totalSize -= MIN(totalSize, [self removeRequestBodyAtPath:path inPartition:partition]);
+  }
+  return totalSize <= size;
+}
 
-  void (^removeBatchDir)(NSString *batchDirPath) = ^(NSString *batchDirPath) {
+/** Reserves the size in the storage size limit, removing the request bodies of the oldest batches
+ * of the partition to make room if needed. Must be called on the queue of the partition.
+ *
+ * @return YES if the size was reserved.
+ */
+- (BOOL)reserveStorageSize:(uint64_t)length
+    removingRequestBodiesOfPartition:(GDTCORFlatFileStoragePartition *)partition {
+  [self loadStorageSizeIfNeededInPartition:partition];
+  if ([self.sizeBudget reserveSize:length]) {
+    return YES;
+  }
+  for (NSString *path in [self requestBodyPathsOfPartition:partition]) {
+    GDTCORLogDebug(@"Removing request body to make room in the storage: %@", path);
+    [self removeRequestBodyAtPath:path inPartition:partition];
+    if ([self.sizeBudget reserveSize:length]) {
+      return YES;
+    }
+  }
+  return NO;
+}
+
+/** Returns the batch journal of the partition, replaying it first if needed. Must be called on the
+ * queue of the partition.
+ */
+- (GDTCORBatchJournal *)batchJournalOfPartition:(GDTCORFlatFileStoragePartition *)partition {
+  if (!partition.batchJournal.isLoaded) {
+    [self recoverBatchesOfPartition:partition];
+  }
+  return partition.batchJournal;
+}
+
+/** Replays the batch journal of the partition and finishes what a crash may have interrupted: the
+ * remaining event files of committed batches are deleted, and the events of the batch directories
+ * left by earlier versions of the storage are returned to the event data directory. The event files
+ * stored directly in the event data directory by earlier versions are moved to their shards first.
+ */
+- (void)recoverBatchesOfPartition:(GDTCORFlatFileStoragePartition *)partition {
+  [self moveFlatEventFilesToShardsOfPartition:partition];
+  GDTCORBatchJournal *batchJournal = partition.batchJournal;
+  @synchronized(_batchTargets) {
+    [_batchTargets removeObjectsForKeys:[_batchTargets allKeysForObject:@(partition.target)]];
+  }
+  for (GDTCORBatchJournalBatch *batch in [batchJournal load]) {
+    [self removeEventFilesNamed:batch.eventFilenames inPartition:partition];
+  }
+  [batchJournal compactIfNeeded];
+  NSMutableSet<NSString *> *openBatchIDs = [[NSMutableSet alloc] init];
+  for (GDTCORBatchJournalBatch *batch in [batchJournal openBatches]) {
+    [self setTarget:@(partition.target) ofBatchWithID:batch.batchID];
+    [openBatchIDs addObject:batch.batchID.stringValue];
+  }
+
+  // Remove the request bodies of the batches closed by a crash before their body was.
+  NSString *requestBodiesPath = [partition.eventDataPath
+      stringByAppendingPathComponent:kGDTCORFlatFileStoragePartitionRequestBodiesDirectoryName];
+  for (NSString *filename in [[NSFileManager defaultManager]
+           contentsOfDirectoryAtPath:requestBodiesPath
+                               error:nil]) {
+    if (![openBatchIDs containsObject:filename]) {
+      [self removeRequestBodyAtPath:[requestBodiesPath stringByAppendingPathComponent:filename]
+                        inPartition:partition];
+    }
+  }
+
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSString *batchDataPath = [GDTCORFlatFileStorage batchDataStoragePath];
+  for (NSString *batchDirName in [fileManager contentsOfDirectoryAtPath:batchDataPath error:nil]) {
+    NSString *batchDirPath = [batchDataPath stringByAppendingPathComponent:batchDirName];
+    BOOL isDirectory = NO;
+    if (![fileManager fileExistsAtPath:batchDirPath isDirectory:&isDirectory] || !isDirectory) {
+      continue;
+    }
+    NSDictionary<NSString *, id> *components = [self batchComponentsFromFilename:batchDirName];
+    NSNumber *target = components[kGDTCORBatchComponentsTargetKey];
+    if (target == nil || target.integerValue != partition.target) {
+      continue;
+    }
+    NSMutableArray<NSString *> *movedPaths = [NSMutableArray array];
     NSError *error;
-    if ([fileManager removeItemAtPath:batchDirPath error:&error]) {
-      GDTCORLogDebug(@"Batch removed at path: %@", batchDirPath);
-    } else {
-      GDTCORLogDebug(@"Failed to remove batch at path: %@", batchDirPath);
+    if (![self moveEventFilesInDirectoryAtPath:batchDirPath
+                                   toPartition:partition
+                                    movedPaths:movedPaths
+                                         error:&error]) {
+      GDTCORLogDebug(@"Error encountered whilst moving events back: %@", error);
     }
-  };
+    for (NSString *movedPath in movedPaths) {
+      NSDictionary<NSFileAttributeKey, id> *attributes =
+          [fileManager attributesOfItemAtPath:movedPath error:nil];
+      [partition.sizeTracker fileWasAddedAtPath:movedPath withSize:[attributes fileSize]];
+      [self indexEventAtPath:movedPath
+                  storedDate:[attributes fileModificationDate]
+                        size:[attributes fileSize]
+                 inPartition:partition];
+    }
+    // The events that couldn't be moved back, e.g. because of a conflicting file, are removed.
+    [fileManager removeItemAtPath:batchDirPath error:nil];
+  }
+}
 
-  for (NSString *batchDirPath in batchDirPaths) {
-    @autoreleasepool {
-      if (deleteEvents) {
-        removeBatchDir(batchDirPath);
-      } else {
-        NSString *batchDirName = [batchDirPath lastPathComponent];
-        NSDictionary<NSString *, id> *components = [self batchComponentsFromFilename:batchDirName];
-        NSString *targetValue = [components[kGDTCORBatchComponentsTargetKey] stringValue];
-        NSString *destinationPath;
-        if (targetValue) {
-          destinationPath = [[GDTCORFlatFileStorage eventDataStoragePath]
-              stringByAppendingPathComponent:targetValue];
-        }
+/** Moves the event files stored directly in the event data directory of the partition, as done by
+ * earlier versions of the storage, to their shard directories. The files stay in the directory, so
+ * its tracked size doesn't change. A file conflicting with one in its shard is a leftover copy and
+ * is removed.
+ */
+- (void)moveFlatEventFilesToShardsOfPartition:(GDTCORFlatFileStoragePartition *)partition {
+  NSError *error;
+  if ([self moveEventFilesInDirectoryAtPath:partition.eventDataPath
+                                toPartition:partition
+                                 movedPaths:nil
+                                      error:&error]) {
+    return;
+  }
+  GDTCORLogDebug(@"Error encountered whilst moving events to their shards: %@", error);
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  for (NSString *filename in [fileManager contentsOfDirectoryAtPath:partition.eventDataPath
+                                                              error:nil]) {
+    NSString *path = [partition.eventDataPath stringByAppendingPathComponent:filename];
+    NSString *shardedPath = [self pathOfEventFileNamed:filename inPartition:partition];
+    if ([fileManager fileExistsAtPath:shardedPath]) {
+      uint64_t fileSize = [[fileManager attributesOfItemAtPath:path error:nil] fileSize];
+      if ([fileManager removeItemAtPath:path error:nil]) {
+        [partition.sizeTracker fileWasRemovedAtPath:path withSize:fileSize];
+      }
+    }
+  }
+}
 
-        // `- [NSFileManager moveItemAtPath:toPath:error:]` method fails if an item by the
-        // destination path already exists (which usually is the case for the current method). Move
-        // the events one by one instead.
-        if (destinationPath && [self moveContentsOfDirectoryAtPath:batchDirPath
-                                                                to:destinationPath
-                                                             error:&error]) {
-          GDTCORLogDebug(@"Batched events at path: %@ moved back to the storage: %@", batchDirPath,
-                         destinationPath);
-        } else {
-          GDTCORLogDebug(@"Error encountered whilst moving events back: %@", error);
-        }
+/** Removes the expired batches and events of the partition. Must be called on the queue of the
+ * partition.
+ */
+- (void)checkForExpirationsInPartition:(GDTCORFlatFileStoragePartition *)partition {
+  GDTCORLogDebug(@"Checking for expired events and batches of target %ld", (long)partition.target);
+  NSTimeInterval now = [NSDate date].timeIntervalSince1970;
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+
+  // TODO: Storage may not have enough context to remove batches because a batch may be being
+  // uploaded but the storage has not context of it.
+
+  // Find expired batches and return their events to the main storage.
+  // If a batch contains expired events they are expected to be removed further in the method
+  // together with other expired events in the main storage.
+  for (GDTCORBatchJournalBatch *batch in [[self batchJournalOfPartition:partition] openBatches]) {
+    if (batch.expirationDate.timeIntervalSince1970 < now) {
+      [self syncThreadUnsafeRemoveBatchWithID:batch.batchID deleteEvents:NO inPartition:partition];
+    }
+  }
 
-        // Even if not all events where moved back to the storage, there is not much can be done at
-        // this point, so cleanup batch directory now to avoid cluttering.
-        removeBatchDir(batchDirPath);
+  // Find expired events through the expiration index and remove them from the storage. Only the
+  // elapsed expiration buckets are visited and no event is read.
+  [self loadEventIndexOfPartitionIfNeeded:partition];
+  NSMutableSet<GDTCOREvent *> *expiredEvents = [NSMutableSet set];
+  NSArray<GDTCORStorageEventIndexEntry *> *expiredEntries =
+      [partition.eventIndex entriesExpiredBeforeDate:[NSDate dateWithTimeIntervalSince1970:now]];
+  for (GDTCORStorageEventIndexEntry *entry in expiredEntries) {
+    @autoreleasepool {
+      NSError *removeError;
+      [fileManager removeItemAtPath:entry.path error:&removeError];
+      [partition.eventIndex removeEntryWithEventID:entry.eventID target:entry.target];
+      if (removeError != nil) {
+        GDTCORLogDebug(@"There was an error deleting an expired item: %@", removeError);
+      } else {
+        GDTCORLogDebug(@"Item deleted because it expired: %@", entry.path);
+        [partition.sizeTracker fileWasRemovedAtPath:entry.path withSize:entry.size];
+        [expiredEvents addObject:[self eventFromIndexEntry:entry]];
       }
     }
   }
 
-  [self.sizeTracker resetCachedSize];
+  if (self.delegate != nil && [expiredEvents count] > 0) {
+    GDTCORLogDebug(@"Delegate notified that %@ events were dropped.", @(expiredEvents.count));
+    [self.delegate storage:self didRemoveExpiredEvents:[expiredEvents copy]];
+  }
 }
 
 #pragma mark - Private helper methods
 
+/** Returns an error for a library data key without value, in the domain of the file read errors
+ * returned when each key had its own file.
+ */
+- (NSError *)libraryDataNotFoundErrorWithKey:(NSString *)key {
+  NSString *reason = [NSString stringWithFormat:@"There is no library data for key %@.", key];
+  return [NSError errorWithDomain:NSCocoaErrorDomain
+                             code:NSFileReadNoSuchFileError
+                         userInfo:@{NSLocalizedFailureReasonErrorKey : reason}];
+}
+
+/** Returns an error for a batch that is not open. */
+- (NSError *)batchNotFoundErrorWithBatchID:(NSNumber *)batchID {
+  NSString *reason = [NSString stringWithFormat:@"Batch %@ is not open.", batchID];
+  return [NSError errorWithDomain:GDTCORFlatFileStorageErrorDomain
+                             code:GDTCORFlatFileStorageErrorBatchNotFound
+                         userInfo:@{NSLocalizedFailureReasonErrorKey : reason}];
+}
+
+/** Encodes the event and writes it to a file in the partition, making room for it in the storage
+ * size limit if the eviction policy allows. Must be called on the queue of the partition.
+ *
+ * @param event The event to write.
+ * @param partition The partition of the target of the event.
+ * @param error The error to populate if the event couldn't be written.
+ * @return YES if the event was written.
+ */
+- (BOOL)writeEvent:(GDTCOREvent *)event
+       inPartition:(GDTCORFlatFileStoragePartition *)partition
+             error:(NSError **)error {
+  NSString *filePath = [GDTCORFlatFileStorage pathForTarget:event.target
+                                                    eventID:event.eventID
+                                                    qosTier:@(event.qosTier)
+                                             expirationDate:event.expirationDate
+                                                  mappingID:event.mappingID];
+  NSData *encodedEvent = GDTCOREncodeEventRecord(event, error);
+  if (encodedEvent == nil) {
+    return NO;
+  }
+
+  // Reserve room for the event in the storage size limit before storing it, making room for it
+  // if the eviction policy allows.
+  if (![self reserveStorageSize:encodedEvent.length forEvent:event inPartition:partition]) {
+    if (error) {
+      *error = [NSError
+          errorWithDomain:GDTCORFlatFileStorageErrorDomain
+                     code:GDTCORFlatFileStorageErrorSizeLimitReached
+                 userInfo:@{
+                   NSLocalizedFailureReasonErrorKey : @"Storage size limit has been reached."
+                 }];
+    }
+    if (self.delegate != nil) {
+      GDTCORLogDebug(@"Delegate notified that event with mapping ID %@ was dropped.",
+                     event.mappingID);
+      [self.delegate storage:self didDropEvent:event];
+    }
+    return NO;
+  }
+
+  // Write the encoded event to the file.
+  NSError *writeError;
+  GDTCORStorageDurability durability = [self.durabilityPolicy durabilityForEvent:event];
+  BOOL writeResult =
+      GDTCORWriteDataToFileWithDurability(encodedEvent, filePath, durability, &writeError);
+  if (writeResult == NO || writeError) {
+    GDTCORLogDebug(@"Attempt to write archive failed: path:%@ error:%@", filePath, writeError);
+    [self.sizeBudget removeSize:encodedEvent.length];
+    if (error) {
+      *error = writeError;
+    }
+    return NO;
+  }
+  GDTCORLogDebug(@"Writing archive succeeded: %@", filePath);
+  if (durability == GDTCORStorageDurabilityRelaxed) {
+    [partition.unsyncedEventPaths addObject:filePath];
+  }
+
+  // Notify size tracker, which accounts for the event in the size budget, and release the
+  // reserved size.
+  [partition.sizeTracker fileWasAddedAtPath:filePath withSize:encodedEvent.length];
+  [self.sizeBudget removeSize:encodedEvent.length];
+
+  [self indexEventAtPath:filePath
+              storedDate:[NSDate date]
+                    size:encodedEvent.length
+             inPartition:partition];
+  return YES;
+}
+
+/** Records a new batch of the events matching the selector in the batch journal of their target.
+ * The events are neither read nor moved, so forming a batch only costs a single journal record.
+ *
+ * @param onComplete Called on the queue of the target with the ID of the new batch and the paths of
+ * the batched event files, or with nil values if there were no events to batch.
+ */
+- (void)reserveBatchWithEventSelector:(GDTCORStorageEventSelector *)eventSelector
+                      batchExpiration:(NSDate *)expiration
+                           onComplete:(void (^)(NSNumber *_Nullable batchID,
+                                                NSArray<NSString *> *_Nullable batchedPaths))
+                                          onComplete {
+  GDTCORTarget target = eventSelector.selectedTarget;
+  GDTCORFlatFileStoragePartition *partition = [self partitionForTarget:target];
+  void (^onPathsForTargetComplete)(NSNumber *, NSArray<NSString *> *_Nonnull) = ^(
+      NSNumber *batchID, NSArray<NSString *> *_Nonnull paths) {
+    if (paths.count == 0) {
+      onComplete(nil, nil);
+      return;
+    }
+    NSMutableArray<NSString *> *filenames = [[NSMutableArray alloc] initWithCapacity:paths.count];
+    for (NSString *eventPath in paths) {
+      [filenames addObject:[eventPath lastPathComponent]];
+    }
+    GDTCORBatchJournalBatch *batch = [[GDTCORBatchJournalBatch alloc] initWithBatchID:batchID
+                                                                               target:target
+                                                                       expirationDate:expiration
+                                                                       eventFilenames:filenames];
+    NSError *error;
+    if (![[self batchJournalOfPartition:partition] createBatch:batch error:&error]) {
+      GDTCORLogDebug(@"The batch couldn't be recorded in the batch journal: %@", error);
+      onComplete(nil, nil);
+      return;
+    }
+    [self setTarget:@(target) ofBatchWithID:batchID];
+    for (NSString *eventPath in paths) {
+      [self unindexEventAtPath:eventPath inPartition:partition];
+    }
+    onComplete(batchID, paths);
+  };
+
+  // The batch ID is allocated on the storage queue, the batch is formed on the queue of the target.
+  dispatch_async(_storageQueue, ^{
+    NSNumber *batchID = [self.batchIDAllocator nextBatchID];
+    if (batchID == nil) {
+      dispatch_async(partition.queue, ^{
+        onComplete(nil, nil);
+      });
+      return;
+    }
+    [self pathsForEventSelector:eventSelector
+                    inPartition:partition
+                     onComplete:^(NSArray<NSString *> *_Nonnull paths) {
+                       onPathsForTargetComplete(batchID, paths);
+                     }];
+  });
+}
+
 + (NSString *)eventDataStoragePath {
   static NSString *eventDataPath;
   static dispatch_once_t onceToken;
@@ -674,13 +1456,15 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
   return libraryDataPath;
 }
 
-+ (NSString *)batchPathForTarget:(GDTCORTarget)target
-                         batchID:(NSNumber *)batchID
-                  expirationDate:(NSDate *)expirationDate {
-  return
-      [NSString stringWithFormat:@"%@/%ld%@%@%@%llu", [GDTCORFlatFileStorage batchDataStoragePath],
-                                 (long)target, kMetadataSeparator, batchID, kMetadataSeparator,
-                                 ((uint64_t)expirationDate.timeIntervalSince1970)];
++ (NSString *)batchJournalPathForTarget:(GDTCORTarget)target {
+  return [[GDTCORFlatFileStorage eventDataPathForTarget:target]
+      stringByAppendingPathComponent:kGDTCORFlatFileStoragePartitionBatchJournalName];
+}
+
+/** Returns the directory of the event files of the target. */
++ (NSString *)eventDataPathForTarget:(GDTCORTarget)target {
+  return [NSString
+      stringWithFormat:@"%@/%ld", [GDTCORFlatFileStorage eventDataStoragePath], (long)target];
 }
 
 + (NSString *)pathForTarget:(GDTCORTarget)target
@@ -691,11 +1475,29 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
   NSMutableCharacterSet *allowedChars = [[NSCharacterSet alphanumericCharacterSet] mutableCopy];
   [allowedChars addCharactersInString:kMetadataSeparator];
   mappingID = [mappingID stringByAddingPercentEncodingWithAllowedCharacters:allowedChars];
-  return [NSString stringWithFormat:@"%@/%ld/%@%@%@%@%llu%@%@",
-                                    [GDTCORFlatFileStorage eventDataStoragePath], (long)target,
-                                    eventID, kMetadataSeparator, qosTier, kMetadataSeparator,
-                                    ((uint64_t)expirationDate.timeIntervalSince1970),
-                                    kMetadataSeparator, mappingID];
+  NSString *filename =
+      [NSString stringWithFormat:@"%@%@%@%@%llu%@%@", eventID, kMetadataSeparator, qosTier,
+                                 kMetadataSeparator,
+                                 ((uint64_t)expirationDate.timeIntervalSince1970),
+                                 kMetadataSeparator, mappingID];
+  return [NSString pathWithComponents:@[
+    [GDTCORFlatFileStorage eventDataPathForTarget:target],
+    [GDTCORFlatFileStoragePartition shardPathComponentForEventID:eventID], filename
+  ]];
+}
+
+/** Returns the path of the event file with the name in the shard of its event in the partition. */
+- (NSString *)pathOfEventFileNamed:(NSString *)filename
+                       inPartition:(GDTCORFlatFileStoragePartition *)partition {
+  NSRange separatorRange = [filename rangeOfString:kMetadataSeparator];
+  NSString *eventID = separatorRange.location == NSNotFound
+                          ? filename
+                          : [filename substringToIndex:separatorRange.location];
+  return [NSString
+      pathWithComponents:@[
+        partition.eventDataPath,
+        [GDTCORFlatFileStoragePartition shardPathComponentForEventID:eventID], filename
+      ]];
 }
 
 - (void)pathsForTarget:(GDTCORTarget)target
@@ -704,83 +1506,266 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
             mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
             onComplete:(void (^)(NSSet<NSString *> *paths))onComplete {
   void (^completion)(NSSet<NSString *> *) = onComplete == nil ? ^(NSSet<NSString *> *paths){} : onComplete;
-  dispatch_async(_storageQueue, ^{
-    NSMutableSet<NSString *> *paths = [[NSMutableSet alloc] init];
-    NSFileManager *fileManager = [NSFileManager defaultManager];
-    NSString *targetPath = [NSString
-        stringWithFormat:@"%@/%ld", [GDTCORFlatFileStorage eventDataStoragePath], (long)target];
-    [fileManager createDirectoryAtPath:targetPath
-           withIntermediateDirectories:YES
-                            attributes:nil
-                                 error:nil];
+  GDTCORFlatFileStoragePartition *partition = [self partitionForTarget:target];
+  dispatch_async(partition.queue, ^{
+    [self loadEventIndexOfPartitionIfNeeded:partition];
+    NSArray<GDTCORStorageEventIndexEntry *> *entries =
+        [partition.eventIndex entriesForTarget:target
+                                      eventIDs:eventIDs
+                                      qosTiers:qosTiers
+                                    mappingIDs:mappingIDs];
+    NSMutableSet<NSString *> *paths = [[NSMutableSet alloc] initWithCapacity:entries.count];
+    for (GDTCORStorageEventIndexEntry *entry in entries) {
+      [paths addObject:entry.path];
+    }
+    completion(paths);
+  });
+}
+
+/** Reserves room for an event of the given length in the storage size limit, evicting the stored
+ * events of its target chosen by the eviction policy until it fits. Events of other targets are
+ * never evicted, so that a busy target can only displace its own events. Batched events are never
+ * evicted. Must be called on the queue of the partition.
+ *
+ * @return YES if the size was reserved, in which case the caller must remove it from the size
+ * budget once the event file is accounted for.
+ */
+- (BOOL)reserveStorageSize:(uint64_t)length
+                  forEvent:(GDTCOREvent *)event
+               inPartition:(GDTCORFlatFileStoragePartition *)partition {
+  // The stored request bodies are only a cache, so they are dropped before any event.
+  if ([self reserveStorageSize:length removingRequestBodiesOfPartition:partition]) {
+    return YES;
+  }
+  id<GDTCORStorageEvictionPolicy> evictionPolicy = self.evictionPolicy;
+  if (evictionPolicy == nil) {
+    return NO;
+  }
+
+  // The candidates are described by the metadata kept in the index, so no event file is read.
+  NSMapTable<GDTCORStorageEvictionCandidate *, GDTCORStorageEventIndexEntry *> *entries =
+      [NSMapTable strongToStrongObjectsMapTable];
+  NSMutableArray<GDTCORStorageEvictionCandidate *> *candidates = [[NSMutableArray alloc] init];
+  [self loadEventIndexOfPartitionIfNeeded:partition];
+  NSArray<GDTCORStorageEventIndexEntry *> *storedEntries =
+      [partition.eventIndex entriesForTarget:partition.target
+                                    eventIDs:nil
+                                    qosTiers:nil
+                                  mappingIDs:nil];
+  for (GDTCORStorageEventIndexEntry *entry in storedEntries) {
+    GDTCORStorageEvictionCandidate *candidate = [[GDTCORStorageEvictionCandidate alloc]
+        initWithTarget:entry.target
+               eventID:entry.eventID
+               qosTier:entry.qosTier
+             mappingID:entry.mappingID
+            storedDate:entry.storedDate
+                  size:entry.size];
+    [entries setObject:entry forKey:candidate];
+    [candidates addObject:candidate];
+  }
+
+  NSArray<GDTCORStorageEvictionCandidate *> *candidatesToEvict =
+      [evictionPolicy candidatesToEvictFromCandidates:candidates forEvent:event];
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  for (GDTCORStorageEvictionCandidate *candidate in candidatesToEvict) {
+    GDTCORStorageEventIndexEntry *entry = [entries objectForKey:candidate];
+    if (entry == nil) {
+      continue;
+    }
     NSError *error;
-    NSArray<NSString *> *dirPaths = [fileManager contentsOfDirectoryAtPath:targetPath error:&error];
-    if (error) {
-      GDTCORLogDebug(@"There was an error reading the contents of the target path: %@", error);
-      completion(paths);
-      return;
+    if (![fileManager removeItemAtPath:entry.path error:&error]) {
+      GDTCORLogDebug(@"Failed to evict event at path: %@ error: %@", entry.path, error);
+      continue;
     }
-    BOOL checkingIDs = eventIDs.count > 0;
-    BOOL checkingQosTiers = qosTiers.count > 0;
-    BOOL checkingMappingIDs = mappingIDs.count > 0;
-    BOOL checkingAnything = checkingIDs == NO && checkingQosTiers == NO && checkingMappingIDs == NO;
-    for (NSString *path in dirPaths) {
-      // Skip hidden files that are created as part of atomic file creation.
-      if ([path hasPrefix:@"."]) {
-        continue;
-      }
-      NSString *filePath = [targetPath stringByAppendingPathComponent:path];
-      if (checkingAnything) {
-        [paths addObject:filePath];
-        continue;
-      }
-      NSString *filename = [path lastPathComponent];
-      NSDictionary<NSString *, id> *eventComponents = [self eventComponentsFromFilename:filename];
-      if (!eventComponents) {
-        GDTCORLogDebug(@"There was an error reading the filename components: %@", eventComponents);
-        continue;
-      }
-      NSString *eventID = eventComponents[kGDTCOREventComponentsEventIDKey];
-      NSNumber *qosTier = eventComponents[kGDTCOREventComponentsQoSTierKey];
-      NSString *mappingID = eventComponents[kGDTCOREventComponentsMappingIDKey];
-
-      NSNumber *eventIDMatch = checkingIDs ? @([eventIDs containsObject:eventID]) : nil;
-      NSNumber *qosTierMatch = checkingQosTiers ? @([qosTiers containsObject:qosTier]) : nil;
-      NSNumber *mappingIDMatch =
-          checkingMappingIDs
-              ? @([mappingIDs containsObject:[mappingID stringByRemovingPercentEncoding]])
-              : nil;
-      if ((eventIDMatch == nil || eventIDMatch.boolValue) &&
-          (qosTierMatch == nil || qosTierMatch.boolValue) &&
-          (mappingIDMatch == nil || mappingIDMatch.boolValue)) {
-        [paths addObject:filePath];
-      }
+    GDTCORLogDebug(@"Evicted event: %@", entry.eventID);
+    [self unindexEventAtPath:entry.path inPartition:partition];
+    [partition.sizeTracker fileWasRemovedAtPath:entry.path withSize:entry.size];
+    // The delegate accounts for the evicted event like a dropped event, from its index entry.
+    if (self.delegate != nil) {
+      [self.delegate storage:self didDropEvent:[self eventFromIndexEntry:entry]];
     }
-    completion(paths);
+    if ([self.sizeBudget reserveSize:length]) {
+      return YES;
+    }
+  }
+  return NO;
+}
+
+/** Finds the paths of the events matching the selector in the partition, applying its order and
+ * limits. The dates and sizes of the events are taken from their index entries.
+ *
+ * @param onComplete Called on the queue of the partition with the selected paths.
+ */
+- (void)pathsForEventSelector:(GDTCORStorageEventSelector *)eventSelector
+                  inPartition:(GDTCORFlatFileStoragePartition *)partition
+                   onComplete:(void (^)(NSArray<NSString *> *paths))onComplete {
+  dispatch_async(partition.queue, ^{
+    GDTCORTarget target = eventSelector.selectedTarget;
+    [self loadEventIndexOfPartitionIfNeeded:partition];
+    NSArray<GDTCORStorageEventIndexEntry *> *entries =
+        [partition.eventIndex entriesForTarget:target
+                                      eventIDs:eventSelector.selectedEventIDs
+                                      qosTiers:eventSelector.selectedQosTiers
+                                    mappingIDs:eventSelector.selectedMappingIDs];
+    if ([eventSelector isBounded]) {
+      entries = [self selectEntries:entries selector:eventSelector];
+    }
+    NSMutableArray<NSString *> *paths = [[NSMutableArray alloc] initWithCapacity:entries.count];
+    for (GDTCORStorageEventIndexEntry *entry in entries) {
+      [paths addObject:entry.path];
+    }
+    onComplete(paths);
   });
 }
 
-- (void)nextBatchID:(void (^)(NSNumber *_Nullable batchID))nextBatchID {
-  __block int32_t lastBatchID = -1;
-  [self libraryDataForKey:gBatchIDCounterKey
-      onFetchComplete:^(NSData *_Nullable data, NSError *_Nullable getValueError) {
-        if (!getValueError) {
-          [data getBytes:(void *)&lastBatchID length:sizeof(int32_t)];
-        }
-        if (data == nil) {
-          lastBatchID = 0;
-        }
-        if (nextBatchID) {
-          nextBatchID(@(lastBatchID));
-        }
-      }
-      setNewValue:^NSData *_Nullable(void) {
-        if (lastBatchID != -1) {
-          int32_t incrementedValue = lastBatchID + 1;
-          return [NSData dataWithBytes:&incrementedValue length:sizeof(int32_t)];
-        }
-        return nil;
+/** Orders the entries by the date their event was stored and applies the order and limits of the
+ * selector. The size of an event is the size of its file.
+ */
+- (NSArray<GDTCORStorageEventIndexEntry *> *)
+    selectEntries:(NSArray<GDTCORStorageEventIndexEntry *> *)entries
+         selector:(GDTCORStorageEventSelector *)eventSelector {
+  NSArray<GDTCORStorageEventIndexEntry *> *oldestFirstEntries = [entries
+      sortedArrayUsingComparator:^NSComparisonResult(GDTCORStorageEventIndexEntry *entry1,
+                                                     GDTCORStorageEventIndexEntry *entry2) {
+        return [entry1.storedDate compare:entry2.storedDate];
       }];
+  return [eventSelector selectCandidates:oldestFirstEntries
+                                 qosTier:^GDTCOREventQoS(GDTCORStorageEventIndexEntry *entry) {
+                                   return entry.qosTier;
+                                 }
+                                    size:^uint64_t(GDTCORStorageEventIndexEntry *entry) {
+                                      return entry.size;
+                                    }];
+}
+
+/** Populates the event index of the partition from its event data directory, once. Must be called
+ * on the queue of the partition.
+ */
+- (void)loadEventIndexOfPartitionIfNeeded:(GDTCORFlatFileStoragePartition *)partition {
+  GDTCORTarget target = partition.target;
+  if ([partition.eventIndex isTargetLoaded:target]) {
+    return;
+  }
+  // The batch journal is replayed first, as it may delete event files or return batched events.
+  [self batchJournalOfPartition:partition];
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSString *targetPath = partition.eventDataPath;
+  [fileManager createDirectoryAtPath:targetPath
+         withIntermediateDirectories:YES
+                          attributes:nil
+                               error:nil];
+  [partition.eventIndex markTargetLoaded:target];
+  // The shards are listed one at a time, so that only the names of the files in one shard are held
+  // in memory at once. The dates and sizes of the files are fetched with the listing.
+  NSArray<NSURLResourceKey> *keys = @[ NSURLContentModificationDateKey, NSURLFileSizeKey ];
+  for (NSString *shardPath in [partition shardPaths]) {
+    @autoreleasepool {
+      NSArray<NSURL *> *fileURLs =
+          [fileManager contentsOfDirectoryAtURL:[NSURL fileURLWithPath:shardPath]
+                     includingPropertiesForKeys:keys
+                                        options:0
+                                          error:nil];
+      for (NSURL *fileURL in fileURLs) {
+        NSDictionary<NSURLResourceKey, id> *values = [fileURL resourceValuesForKeys:keys
+                                                                              error:nil];
+        NSNumber *fileSize = values[NSURLFileSizeKey];
+        [self indexEventAtPath:[shardPath stringByAppendingPathComponent:fileURL.lastPathComponent]
+                    storedDate:values[NSURLContentModificationDateKey]
+                          size:fileSize.unsignedLongLongValue
+                   inPartition:partition];
+      }
+    }
+  }
+}
+
+/** Creates an event carrying the metadata of an index entry, but not its payload. It stands in for
+ * a removed event when reporting it to the delegate, which only accounts for its mapping ID.
+ */
+- (GDTCOREvent *)eventFromIndexEntry:(GDTCORStorageEventIndexEntry *)entry {
+  GDTCOREvent *event = [[GDTCOREvent alloc] initWithEventID:entry.eventID
+                                                  mappingID:entry.mappingID
+                                                productData:nil
+                                                     target:entry.target
+                                  serializedDataObjectBytes:[NSData data]];
+  event.qosTier = entry.qosTier;
+  event.expirationDate = entry.expirationDate;
+  return event;
+}
+
+/** Adds the event file at the path to the index, if the index of the partition is loaded. The
+ * date and size of the event are read from the attributes of the file.
+ */
+- (void)indexEventAtPath:(NSString *)path inPartition:(GDTCORFlatFileStoragePartition *)partition {
+  if (![partition.eventIndex isTargetLoaded:partition.target]) {
+    return;
+  }
+  NSDictionary<NSFileAttributeKey, id> *attributes =
+      [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil];
+  [self indexEventAtPath:path
+              storedDate:[attributes fileModificationDate]
+                    size:[attributes fileSize]
+             inPartition:partition];
+}
+
+/** Adds the event file at the path to the index, if the index of the partition is loaded.
+ *
+ * @param storedDate The date the event was stored. A missing date sorts the event first.
+ * @param size The size of the event file.
+ */
+- (void)indexEventAtPath:(NSString *)path
+              storedDate:(nullable NSDate *)storedDate
+                    size:(uint64_t)size
+             inPartition:(GDTCORFlatFileStoragePartition *)partition {
+  GDTCORTarget target = partition.target;
+  if (![partition.eventIndex isTargetLoaded:target]) {
+    return;
+  }
+  NSString *filename = [path lastPathComponent];
+  // Skip hidden files that are created as part of atomic file creation, and the batch journal.
+  if ([filename hasPrefix:@"."] ||
+      [filename isEqualToString:kGDTCORFlatFileStoragePartitionBatchJournalName]) {
+    return;
+  }
+  // Batched events stay in the event data directory but are not available until returned.
+  if ([[self batchJournalOfPartition:partition] isEventFileBatched:filename target:target]) {
+    return;
+  }
+  NSDictionary<NSString *, id> *eventComponents = [self eventComponentsFromFilename:filename];
+  if (!eventComponents) {
+    GDTCORLogDebug(@"There was an error reading the filename components: %@", filename);
+    return;
+  }
+  NSString *mappingID = eventComponents[kGDTCOREventComponentsMappingIDKey];
+  NSNumber *qosTier = eventComponents[kGDTCOREventComponentsQoSTierKey];
+  GDTCORStorageEventIndexEntry *entry = [[GDTCORStorageEventIndexEntry alloc]
+      initWithTarget:target
+             eventID:eventComponents[kGDTCOREventComponentsEventIDKey]
+             qosTier:(GDTCOREventQoS)qosTier.integerValue
+           mappingID:[mappingID stringByRemovingPercentEncoding] ?: mappingID
+      expirationDate:eventComponents[kGDTCOREventComponentsExpirationKey]
+                path:path
+          storedDate:storedDate ?: [NSDate distantPast]
+                size:size];
+  [partition.eventIndex addEntry:entry];
+}
+
+/** Removes the event file at the path from the index of the partition. */
+- (void)unindexEventAtPath:(NSString *)path
+               inPartition:(GDTCORFlatFileStoragePartition *)partition {
+  NSString *eventID =
+      [self eventComponentsFromFilename:[path lastPathComponent]][kGDTCOREventComponentsEventIDKey];
+  if (eventID) {
+    [partition.eventIndex removeEntryWithEventID:eventID target:partition.target];
+  }
+}
+
+- (void)nextBatchID:(void (^)(NSNumber *_Nullable batchID))nextBatchID {
+  dispatch_async(_storageQueue, ^{
+    NSNumber *batchID = [self.batchIDAllocator nextBatchID];
+    if (nextBatchID) {
+      nextBatchID(batchID);
+    }
+  });
 }
 
 - (nullable NSDictionary<NSString *, id> *)eventComponentsFromFilename:(NSString *)fileName {
@@ -810,7 +1795,7 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
   NSArray<NSString *> *components = [fileName componentsSeparatedByString:kMetadataSeparator];
   if (components.count == 3) {
     NSNumber *target = @(components[0].integerValue);
-    NSNumber *batchID = @(components[1].integerValue);
+    NSNumber *batchID = @(components[1].longLongValue);
     NSDate *expirationDate = [NSDate dateWithTimeIntervalSince1970:components[2].doubleValue];
     if (target == nil || batchID == nil || expirationDate == nil) {
       GDTCORLogDebug(@"There was an error parsing the batch filename components: %@", components);
@@ -829,21 +1814,76 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
 #pragma mark - GDTCORLifecycleProtocol
 
 - (void)appWillBackground:(GDTCORApplication *)app {
-  dispatch_async(_storageQueue, ^{
-    // Immediately request a background task to run until the end of the current queue of work,
-    // and cancel it once the work is done.
-    __block GDTCORBackgroundIdentifier bgID =
-        [app beginBackgroundTaskWithName:@"GDTStorage"
-                       expirationHandler:^{
-                         [app endBackgroundTask:bgID];
-                         bgID = GDTCORBackgroundIdentifierInvalid;
-                       }];
+  // Request a background task to run until the work queued on the partitions and the storage queue
+  // is done, and end it once all of it is.
+  __block GDTCORBackgroundIdentifier bgID =
+      [app beginBackgroundTaskWithName:@"GDTStorage"
+                     expirationHandler:^{
+                       [app endBackgroundTask:bgID];
+                       bgID = GDTCORBackgroundIdentifierInvalid;
+                     }];
+  dispatch_group_t group = dispatch_group_create();
+  for (GDTCORFlatFileStoragePartition *partition in self.partitions) {
+    dispatch_group_async(group, partition.queue, ^{
+      [self syncRelaxedEventFilesOfPartition:partition];
+      [self persistSizeOfTracker:partition.sizeTracker];
+    });
+  }
+  dispatch_group_async(group, _storageQueue, ^{
+    [self.libraryDataStore synchronize];
+    [self persistSizeOfTracker:self.libraryDataSizeTracker];
+  });
+  dispatch_group_notify(group, _storageQueue, ^{
     // End the background task if it's still valid.
     [app endBackgroundTask:bgID];
     bgID = GDTCORBackgroundIdentifierInvalid;
   });
 }
 
+- (void)appWillTerminate:(GDTCORApplication *)application {
+  for (GDTCORFlatFileStoragePartition *partition in self.partitions) {
+    dispatch_sync(partition.queue, ^{
+      [self syncRelaxedEventFilesOfPartition:partition];
+      [self persistSizeOfTracker:partition.sizeTracker];
+    });
+  }
+  dispatch_sync(_storageQueue, ^{
+    [self.libraryDataStore synchronize];
+    [self persistSizeOfTracker:self.libraryDataSizeTracker];
+  });
+}
+
+/** Syncs the event files written with relaxed durability to disk, flushing the drive once for all
+ * of them. Files removed since they were written are skipped. Must be called on the queue of the
+ * partition.
+ */
+- (void)syncRelaxedEventFilesOfPartition:(GDTCORFlatFileStoragePartition *)partition {
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSMutableArray<NSString *> *paths =
+      [[NSMutableArray alloc] initWithCapacity:partition.unsyncedEventPaths.count];
+  for (NSString *path in partition.unsyncedEventPaths) {
+    if ([fileManager fileExistsAtPath:path]) {
+      [paths addObject:path];
+    }
+  }
+  NSError *error;
+  if (paths.count > 0 && !GDTCORSyncFilesAtPaths(paths, &error)) {
+    GDTCORLogDebug(@"Syncing event files failed: error:%@", error);
+  }
+  [partition.unsyncedEventPaths removeAllObjects];
+}
+
+/** Persists the size tracked by the tracker, so that the next launch doesn't have to calculate it.
+ * In debug builds the tracked size is checked against the disk usage first. Must be called on the
+ * queue owning the tracker.
+ */
+- (void)persistSizeOfTracker:(GDTCORDirectorySizeTracker *)sizeTracker {
+#if !NDEBUG
+  [sizeTracker reconcileCachedSize];
+#endif  // !NDEBUG
+  [sizeTracker persistCachedSize];
+}
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORFlatFileStoragePartition.h"
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORBatchJournal.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEventIndex.h"
+
+NSString *const kGDTCORFlatFileStoragePartitionBatchJournalName = @"gdt_batch_journal";
+
+NSString *const kGDTCORFlatFileStoragePartitionRequestBodiesDirectoryName = @"gdt_request_bodies";
+
+const NSUInteger kGDTCORFlatFileStoragePartitionShardFanout = 16;
+
+@implementation GDTCORFlatFileStoragePartition
+
+- (instancetype)initWithTarget:(GDTCORTarget)target
+                 eventDataPath:(NSString *)eventDataPath
+                    sizeBudget:(GDTCORStorageSizeBudget *)sizeBudget {
+  self = [super init];
+  if (self) {
+    _target = target;
+    NSString *queueLabel =
+        [NSString stringWithFormat:@"com.google.GDTCORFlatFileStorage.%ld", (long)target];
+    _queue = dispatch_queue_create(queueLabel.UTF8String, DISPATCH_QUEUE_SERIAL);
+    _eventDataPath = [eventDataPath copy];
+    _eventIndex = [[GDTCORStorageEventIndex alloc] init];
+    _sizeTracker = [[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:_eventDataPath
+                                                                  sizeBudget:sizeBudget];
+    NSString *batchJournalPath = [_eventDataPath
+        stringByAppendingPathComponent:kGDTCORFlatFileStoragePartitionBatchJournalName];
+    _batchJournal = [[GDTCORBatchJournal alloc] initWithPath:batchJournalPath
+                                                 sizeTracker:_sizeTracker];
+    _unsyncedEventPaths = [[NSMutableSet alloc] init];
+  }
+  return self;
+}
+
++ (NSString *)shardPathComponentForEventID:(NSString *)eventID {
+  // 32-bit FNV-1a, which is stable across launches unlike -[NSString hash].
+  uint32_t hash = 2166136261u;
+  for (const char *byte = eventID.UTF8String; byte && *byte; byte++) {
+    hash = (hash ^ (uint8_t)*byte) * 16777619u;
+  }
+  return [NSString stringWithFormat:@"%x/%x", hash % kGDTCORFlatFileStoragePartitionShardFanout,
+                                    (hash / kGDTCORFlatFileStoragePartitionShardFanout) %
+                                        kGDTCORFlatFileStoragePartitionShardFanout];
+}
+
+- (NSArray<NSString *> *)shardPaths {
+  NSUInteger fanout = kGDTCORFlatFileStoragePartitionShardFanout;
+  NSMutableArray<NSString *> *shardPaths =
+      [[NSMutableArray alloc] initWithCapacity:fanout * fanout];
+  for (NSUInteger i = 0; i < fanout; i++) {
+    for (NSUInteger j = 0; j < fanout; j++) {
+      [shardPaths addObject:[_eventDataPath stringByAppendingFormat:@"/%lx/%lx", (unsigned long)i,
+                                                                    (unsigned long)j]];
+    }
+  }
+  return shardPaths;
+}
+
+- (NSString *)requestBodyPathForBatchID:(NSNumber *)batchID {
+  return [NSString pathWithComponents:@[
+    _eventDataPath, kGDTCORFlatFileStoragePartitionRequestBodiesDirectoryName, batchID.stringValue
+  ]];
+}
+
+@end
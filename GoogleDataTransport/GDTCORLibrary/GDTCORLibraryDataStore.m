@@ -0,0 +1,352 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORLibraryDataStore.h"
+
+#import <fcntl.h>
+#import <unistd.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORRecordFrame.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORConsoleLogger.h"
+
+/** The value every store record starts with, "GDTL" when read as little-endian bytes. */
+static const uint32_t kLibraryDataRecordMagic = 0x4C544447;
+
+/** The store file is rewritten once it is larger than this and mostly made of stale records. */
+static const uint64_t kLibraryDataStoreCompactionThreshold = 64 * 1024;
+
+/** The types of store records. */
+typedef NS_ENUM(uint8_t, GDTCORLibraryDataRecordType) {
+  /** The body is the length of the key, the key and the value. */
+  GDTCORLibraryDataRecordTypeSet = 1,
+
+  /** The body is the key whose value was removed. */
+  GDTCORLibraryDataRecordTypeRemoved = 2,
+};
+
+#pragma mark - Record encoding
+
+/** Encodes the frame of a set record, or returns nil if the key is too long. */
+static NSData *_Nullable GDTCORLibraryDataSetFrame(NSString *key, NSData *value) {
+  NSData *utf8 = [key dataUsingEncoding:NSUTF8StringEncoding];
+  if (utf8.length == 0 || utf8.length > UINT16_MAX) {
+    return nil;
+  }
+  NSMutableData *body =
+      [NSMutableData dataWithCapacity:sizeof(uint16_t) + utf8.length + value.length];
+  GDTCORAppendUInt16(body, (uint16_t)utf8.length);
+  [body appendData:utf8];
+  [body appendData:value];
+  return GDTCORRecordFrame(kLibraryDataRecordMagic, GDTCORLibraryDataRecordTypeSet, body);
+}
+
+#pragma mark - GDTCORLibraryDataStore
+
+@implementation GDTCORLibraryDataStore {
+  /** The size tracker to update when the files of the directory change. */
+  GDTCORDirectorySizeTracker *_sizeTracker;
+
+  /** The descriptor of the store file opened for appending, or -1. */
+  int _fileDescriptor;
+
+  /** YES if records were appended since the store file was last synced. */
+  BOOL _hasUnsyncedRecords;
+
+  /** The size of the store file. */
+  uint64_t _fileSize;
+
+  /** The bytes of the store file taken by the records of the current values. */
+  uint64_t _liveBytes;
+
+  /** The current values keyed by key. */
+  NSMutableDictionary<NSString *, NSData *> *_values;
+
+  /** The length of the record of each current value keyed by key. */
+  NSMutableDictionary<NSString *, NSNumber *> *_recordLengths;
+}
+
+- (instancetype)initWithPath:(NSString *)path
+                 sizeTracker:(GDTCORDirectorySizeTracker *)sizeTracker {
+  self = [super init];
+  if (self) {
+    _path = [path copy];
+    _sizeTracker = sizeTracker;
+    _fileDescriptor = -1;
+    _values = [[NSMutableDictionary alloc] init];
+    _recordLengths = [[NSMutableDictionary alloc] init];
+  }
+  return self;
+}
+
+- (void)dealloc {
+  [self closeFile];
+}
+
+- (void)load {
+  if (_isLoaded) {
+    return;
+  }
+  _isLoaded = YES;
+
+  NSData *data = [NSData dataWithContentsOfFile:_path options:NSDataReadingMappedIfSafe error:nil];
+  const uint8_t *bytes = data.bytes;
+  uint64_t offset = 0;
+  uint8_t type;
+  NSRange bodyRange;
+  while (GDTCORReadRecordFrame(bytes, data.length, offset, kLibraryDataRecordMagic, &type,
+                               &bodyRange)) {
+    uint64_t recordLength = NSMaxRange(bodyRange) - offset;
+    offset = NSMaxRange(bodyRange);
+    const uint8_t *body = bytes + bodyRange.location;
+    if (type == GDTCORLibraryDataRecordTypeSet) {
+      if (bodyRange.length < sizeof(uint16_t)) {
+        continue;
+      }
+      uint16_t keyLength = GDTCORReadUInt16(body);
+      if (bodyRange.length - sizeof(uint16_t) < keyLength) {
+        continue;
+      }
+      NSString *key = [[NSString alloc] initWithBytes:body + sizeof(uint16_t)
+                                               length:keyLength
+                                             encoding:NSUTF8StringEncoding];
+      NSUInteger valueOffset = sizeof(uint16_t) + keyLength;
+      if (key) {
+        // The value is copied, as the mapped file is replaced by compaction.
+        NSData *value = [NSData dataWithBytes:body + valueOffset
+                                       length:bodyRange.length - valueOffset];
+        [self cacheData:value forKey:key recordLength:recordLength];
+      }
+    } else if (type == GDTCORLibraryDataRecordTypeRemoved) {
+      NSString *key = [[NSString alloc] initWithBytes:body
+                                               length:bodyRange.length
+                                             encoding:NSUTF8StringEncoding];
+      if (key) {
+        [self uncacheDataForKey:key];
+      }
+    }
+  }
+  _fileSize = data.length;
+  [self migrateLegacyFiles];
+
+  // A record torn by a crash, as well as overwritten and removed values, are compacted away.
+  if (offset < data.length || _fileSize > _liveBytes) {
+    GDTCORLogDebug(@"Compacting the library data store, %llu of %llu bytes are live", _liveBytes,
+                   _fileSize);
+    [self rewrite];
+  }
+}
+
+- (void)unload {
+  [self closeFile];
+  [_values removeAllObjects];
+  [_recordLengths removeAllObjects];
+  _hasUnsyncedRecords = NO;
+  _fileSize = 0;
+  _liveBytes = 0;
+  _isLoaded = NO;
+}
+
+- (nullable NSData *)dataForKey:(NSString *)key {
+  [self load];
+  return _values[key];
+}
+
+- (BOOL)setData:(NSData *)data forKey:(NSString *)key error:(NSError **)outError {
+  [self load];
+  NSData *frame = GDTCORLibraryDataSetFrame(key, data);
+  if (frame == nil) {
+    if (outError) {
+      *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENAMETOOLONG userInfo:nil];
+    }
+    return NO;
+  }
+  if (![self appendFrame:frame error:outError]) {
+    return NO;
+  }
+  [self cacheData:[data copy] forKey:key recordLength:frame.length];
+  [self compactIfNeeded];
+  return YES;
+}
+
+- (BOOL)removeDataForKey:(NSString *)key error:(NSError **)outError {
+  [self load];
+  if (_values[key] == nil) {
+    return YES;
+  }
+  NSData *body = [key dataUsingEncoding:NSUTF8StringEncoding];
+  NSData *frame =
+      GDTCORRecordFrame(kLibraryDataRecordMagic, GDTCORLibraryDataRecordTypeRemoved, body);
+  if (![self appendFrame:frame error:outError]) {
+    return NO;
+  }
+  [self uncacheDataForKey:key];
+  [self compactIfNeeded];
+  return YES;
+}
+
+- (BOOL)synchronize {
+  if (_fileDescriptor >= 0 && _hasUnsyncedRecords) {
+    if (fsync(_fileDescriptor) != 0) {
+      GDTCORLogDebug(@"Failed to sync the library data store: %d", errno);
+      return NO;
+    }
+    _hasUnsyncedRecords = NO;
+  }
+  return YES;
+}
+
+#pragma mark - Private helper methods
+
+/** Sets the cached value of the key. */
+- (void)cacheData:(NSData *)data forKey:(NSString *)key recordLength:(uint64_t)recordLength {
+  [self uncacheDataForKey:key];
+  _values[key] = data;
+  _recordLengths[key] = @(recordLength);
+  _liveBytes += recordLength;
+}
+
+/** Removes the cached value of the key, if any. */
+- (void)uncacheDataForKey:(NSString *)key {
+  if (_values[key] == nil) {
+    return;
+  }
+  [_values removeObjectForKey:key];
+  _liveBytes -= _recordLengths[key].unsignedLongLongValue;
+  [_recordLengths removeObjectForKey:key];
+}
+
+/** Moves the files previous versions wrote for each key into the store. A value already in the
+ * store is newer than the file, which a crash may have left behind after an earlier migration.
+ */
+- (void)migrateLegacyFiles {
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSString *directoryPath = [_path stringByDeletingLastPathComponent];
+  for (NSString *filename in [fileManager contentsOfDirectoryAtPath:directoryPath error:nil]) {
+    if ([filename hasPrefix:@"."] || [filename isEqualToString:_path.lastPathComponent]) {
+      continue;
+    }
+    NSString *filePath = [directoryPath stringByAppendingPathComponent:filename];
+    NSDictionary<NSFileAttributeKey, id> *attributes =
+        [fileManager attributesOfItemAtPath:filePath error:nil];
+    if (![attributes[NSFileType] isEqual:NSFileTypeRegular]) {
+      continue;
+    }
+    NSData *data = [NSData dataWithContentsOfFile:filePath];
+    if (data.length > 0 && _values[filename] == nil) {
+      NSError *error;
+      NSData *frame = GDTCORLibraryDataSetFrame(filename, data);
+      if (frame == nil || ![self appendFrame:frame error:&error]) {
+        GDTCORLogDebug(@"The library data file %@ couldn't be migrated: %@", filename, error);
+        continue;
+      }
+      [self cacheData:data forKey:filename recordLength:frame.length];
+    }
+    GDTCORStorageSizeBytes fileSize = [_sizeTracker fileSizeAtURL:[NSURL fileURLWithPath:filePath]];
+    if ([fileManager removeItemAtPath:filePath error:nil]) {
+      [_sizeTracker fileWasRemovedAtPath:filePath withSize:fileSize];
+    }
+  }
+}
+
+/** Rewrites the store file once it is mostly made of stale records. */
+- (void)compactIfNeeded {
+  if (_fileSize > kLibraryDataStoreCompactionThreshold && _fileSize > _liveBytes * 2) {
+    [self rewrite];
+  }
+}
+
+/** Appends a frame to the store file. */
+- (BOOL)appendFrame:(NSData *)frame error:(NSError **)outError {
+  if (_fileDescriptor < 0) {
+    [[NSFileManager defaultManager]
+              createDirectoryAtPath:[_path stringByDeletingLastPathComponent]
+        withIntermediateDirectories:YES
+                         attributes:nil
+                              error:nil];
+    _fileDescriptor = open(_path.fileSystemRepresentation, O_WRONLY | O_APPEND | O_CREAT, 0600);
+    if (_fileDescriptor < 0) {
+      if (outError) {
+        *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+      }
+      return NO;
+    }
+  }
+
+  const uint8_t *bytes = frame.bytes;
+  NSUInteger remaining = frame.length;
+  while (remaining > 0) {
+    ssize_t written = write(_fileDescriptor, bytes, remaining);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      int writeError = errno;
+      if (ftruncate(_fileDescriptor, (off_t)_fileSize) != 0) {
+        GDTCORLogDebug(@"Failed to truncate a partially written library data record: %d", errno);
+      }
+      if (outError) {
+        *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:writeError userInfo:nil];
+      }
+      return NO;
+    }
+    bytes += written;
+    remaining -= (NSUInteger)written;
+  }
+  _hasUnsyncedRecords = YES;
+  _fileSize += frame.length;
+  [_sizeTracker fileWasAddedAtPath:_path withSize:frame.length];
+  return YES;
+}
+
+/** Replaces the store file with a record of each current value, or removes it if there are none.
+ */
+- (void)rewrite {
+  [self closeFile];
+  NSMutableData *data = [[NSMutableData alloc] initWithCapacity:(NSUInteger)_liveBytes];
+  NSMutableDictionary<NSString *, NSNumber *> *recordLengths = [[NSMutableDictionary alloc] init];
+  NSArray<NSString *> *keys = [_values.allKeys sortedArrayUsingSelector:@selector(compare:)];
+  for (NSString *key in keys) {
+    NSData *frame = GDTCORLibraryDataSetFrame(key, _values[key]);
+    [data appendData:frame];
+    recordLengths[key] = @(frame.length);
+  }
+
+  NSError *error;
+  BOOL success = data.length == 0
+                     ? [[NSFileManager defaultManager] removeItemAtPath:_path error:&error]
+                     : [data writeToFile:_path options:NSDataWritingAtomic error:&error];
+  if (!success && data.length > 0) {
+    GDTCORLogDebug(@"The library data store couldn't be compacted: %@", error);
+    return;
+  }
+  [_sizeTracker fileWasRemovedAtPath:_path withSize:_fileSize];
+  [_sizeTracker fileWasAddedAtPath:_path withSize:data.length];
+  _recordLengths = recordLengths;
+  _hasUnsyncedRecords = NO;
+  _fileSize = data.length;
+  _liveBytes = data.length;
+}
+
+/** Closes the store file descriptor, if open. */
+- (void)closeFile {
+  if (_fileDescriptor >= 0) {
+    close(_fileDescriptor);
+    _fileDescriptor = -1;
+  }
+}
+
+@end
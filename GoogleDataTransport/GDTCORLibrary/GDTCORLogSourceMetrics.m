@@ -68,6 +68,11 @@ typedef NSDictionary<NSNumber *, NSNumber *> GDTCORDroppedEventCounter;
   return [[self alloc] initWithDroppedEventCounterByLogSource:[eventCounterByLogSource copy]];
 }
 
++ (instancetype)metricsWithDroppedEventCounterByLogSource:
+    (NSDictionary<NSString *, GDTCORDroppedEventCounter *> *)droppedEventCounterByLogSource {
+  return [[self alloc] initWithDroppedEventCounterByLogSource:droppedEventCounterByLogSource];
+}
+
 - (instancetype)initWithDroppedEventCounterByLogSource:
     (NSDictionary<NSString *, GDTCORDroppedEventCounter *> *)droppedEventCounterByLogSource {
   self = [super init];
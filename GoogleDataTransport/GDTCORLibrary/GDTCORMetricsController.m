@@ -22,9 +22,12 @@
 #import "FBLPromises.h"
 #endif
 
+#import <stdatomic.h>
+
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORConsoleLogger.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
 
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDroppedEventCounters.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORRegistrar.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageProtocol.h"
 
@@ -34,13 +37,27 @@
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORMetricsMetadata.h"
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORStorageMetadata.h"
 
+const NSTimeInterval kGDTCORMetricsControllerFlushInterval = 10;
+
 @interface GDTCORMetricsController ()
 /// The underlying storage object where metrics are stored.
 @property(nonatomic) id<GDTCORStoragePromiseProtocol> storage;
 
 @end
 
-@implementation GDTCORMetricsController
+@implementation GDTCORMetricsController {
+  /// The dropped events counted since the last flush.
+  GDTCORDroppedEventCounters *_droppedEventCounters;
+
+  /// The interval after which counted dropped events are flushed.
+  NSTimeInterval _flushInterval;
+
+  /// The queue on which scheduled flushes run.
+  dispatch_queue_t _flushQueue;
+
+  /// YES while a flush is scheduled but hasn't started draining the counters.
+  atomic_bool _isFlushScheduled;
+}
 
 + (void)load {
 #if GDT_TEST
@@ -64,9 +81,19 @@
 }
 
 - (instancetype)initWithStorage:(id<GDTCORStoragePromiseProtocol>)storage {
+  return [self initWithStorage:storage flushInterval:kGDTCORMetricsControllerFlushInterval];
+}
+
+- (instancetype)initWithStorage:(id<GDTCORStoragePromiseProtocol>)storage
+                  flushInterval:(NSTimeInterval)flushInterval {
   self = [super init];
   if (self) {
     _storage = storage;
+    _droppedEventCounters = [[GDTCORDroppedEventCounters alloc] init];
+    _flushInterval = flushInterval;
+    _flushQueue =
+        dispatch_queue_create("com.google.GDTCORMetricsController", DISPATCH_QUEUE_SERIAL);
+    atomic_init(&_isFlushScheduled, false);
   }
   return self;
 }
@@ -78,11 +105,20 @@
     return [FBLPromise resolvedWith:nil];
   }
 
+  // The events are only counted in memory; the counts are written to storage by the next flush.
+  [_droppedEventCounters addEvents:[events allObjects] droppedForReason:reason];
+  [self scheduleFlush];
+  return [FBLPromise resolvedWith:nil];
+}
+
+- (FBLPromise<NSNull *> *)flushDroppedEventCounters {
+  GDTCORLogSourceMetrics *logSourceMetrics = [_droppedEventCounters drainLogSourceMetrics];
+  if (logSourceMetrics == nil) {
+    return [FBLPromise resolvedWith:nil];
+  }
+
   __auto_type handler = ^GDTCORMetricsMetadata *(GDTCORMetricsMetadata *_Nullable metricsMetadata,
                                                  NSError *_Nullable fetchError) {
-    GDTCORLogSourceMetrics *logSourceMetrics =
-        [GDTCORLogSourceMetrics metricsWithEvents:[events allObjects] droppedForReason:reason];
-
     if (metricsMetadata) {
       GDTCORLogSourceMetrics *updatedLogSourceMetrics = [metricsMetadata.logSourceMetrics
           logSourceMetricsByMergingWithLogSourceMetrics:logSourceMetrics];
@@ -98,7 +134,10 @@
     }
   };
 
-  return [_storage fetchAndUpdateMetricsWithHandler:handler];
+  return [_storage fetchAndUpdateMetricsWithHandler:handler].recover(^id(NSError *error) {
+    GDTCORLogDebug(@"Error flushing dropped event counters: %@", error);
+    return nil;
+  });
 }
 
 - (nonnull FBLPromise<GDTCORMetrics *> *)getAndResetMetrics {
@@ -115,7 +154,10 @@
                                                  logSourceMetrics:[GDTCORLogSourceMetrics metrics]];
   };
 
-  return [_storage fetchAndUpdateMetricsWithHandler:handler]
+  return [self flushDroppedEventCounters]
+      .then(^FBLPromise *(NSNull *__unused _) {
+        return [self.storage fetchAndUpdateMetricsWithHandler:handler];
+      })
       .validate(^BOOL(NSNull *__unused _) {
         // Break and reject the promise chain when storage contains no metrics
         // metadata.
@@ -182,7 +224,37 @@
     }
   };
 
-  return [_storage fetchAndUpdateMetricsWithHandler:handler];
+  // The counted dropped events are flushed first, so that the offered metrics are compared with
+  // metadata that accounts for them.
+  return [self flushDroppedEventCounters].then(^FBLPromise *(NSNull *__unused _) {
+    return [self.storage fetchAndUpdateMetricsWithHandler:handler];
+  });
+}
+
+#pragma mark - GDTCORLifecycleProtocol
+
+- (void)appWillBackground:(GDTCORApplication *)app {
+  [self flushDroppedEventCounters];
+}
+
+- (void)appWillTerminate:(GDTCORApplication *)application {
+  [self flushDroppedEventCounters];
+}
+
+#pragma mark - Private helper methods
+
+/// Schedules a flush after the flush interval, unless one is already scheduled.
+- (void)scheduleFlush {
+  if (atomic_exchange(&_isFlushScheduled, true)) {
+    return;
+  }
+  dispatch_time_t deadline =
+      dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_flushInterval * NSEC_PER_SEC));
+  dispatch_after(deadline, _flushQueue, ^{
+    // Events dropped from now on schedule the next flush.
+    atomic_store(&self->_isFlushScheduled, false);
+    [self flushDroppedEventCounters];
+  });
 }
 
 #pragma mark - GDTCORStorageDelegate
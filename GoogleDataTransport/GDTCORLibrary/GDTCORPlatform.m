@@ -16,7 +16,9 @@
 
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORPlatform.h"
 
+#import <fcntl.h>
 #import <sys/sysctl.h>
+#import <unistd.h>
 
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORAssert.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORReachability.h"
@@ -257,6 +259,119 @@ BOOL GDTCORWriteDataToFile(NSData *data, NSString *filePath, NSError *_Nullable
   return result;
 }
 
+/** Returns an error describing the current `errno`. */
+static NSError *GDTCORPOSIXError(NSString *path) {
+  return [NSError errorWithDomain:NSPOSIXErrorDomain
+                             code:errno
+                         userInfo:@{NSFilePathErrorKey : path}];
+}
+
+BOOL GDTCORSyncFileAtPath(NSString *path, NSError *_Nullable *outError) {
+  int fd = open(path.fileSystemRepresentation, O_RDONLY);
+  if (fd < 0) {
+    if (outError) {
+      *outError = GDTCORPOSIXError(path);
+    }
+    return NO;
+  }
+  // fsync only hands the data to the drive on Apple platforms, F_FULLFSYNC flushes the drive too.
+  BOOL result = NO;
+#if defined(F_FULLFSYNC)
+  result = fcntl(fd, F_FULLFSYNC) == 0;
+#endif  // defined(F_FULLFSYNC)
+  if (!result) {
+    result = fsync(fd) == 0;
+  }
+  if (!result && outError) {
+    *outError = GDTCORPOSIXError(path);
+  }
+  close(fd);
+  return result;
+}
+
+BOOL GDTCORSyncFilesAtPaths(NSArray<NSString *> *paths, NSError *_Nullable *outError) {
+  BOOL result = YES;
+  int lastSyncedFD = -1;
+  for (NSString *path in paths) {
+    int fd = open(path.fileSystemRepresentation, O_RDONLY);
+    if (fd < 0 || fsync(fd) != 0) {
+      if (result && outError) {
+        *outError = GDTCORPOSIXError(path);
+      }
+      result = NO;
+      if (fd >= 0) {
+        close(fd);
+      }
+      continue;
+    }
+    if (lastSyncedFD >= 0) {
+      close(lastSyncedFD);
+    }
+    lastSyncedFD = fd;
+  }
+#if defined(F_FULLFSYNC)
+  // A full sync flushes the drive, including the data of every file synced above.
+  if (lastSyncedFD >= 0 && fcntl(lastSyncedFD, F_FULLFSYNC) != 0) {
+    if (result && outError) {
+      *outError = GDTCORPOSIXError(paths.lastObject);
+    }
+    result = NO;
+  }
+#endif  // defined(F_FULLFSYNC)
+  if (lastSyncedFD >= 0) {
+    close(lastSyncedFD);
+  }
+  return result;
+}
+
+BOOL GDTCORWriteDataToFileWithDurability(NSData *data,
+                                         NSString *filePath,
+                                         GDTCORStorageDurability durability,
+                                         NSError *_Nullable *outError) {
+  switch (durability) {
+    case GDTCORStorageDurabilityAtomic:
+      return GDTCORWriteDataToFile(data, filePath, outError);
+
+    case GDTCORStorageDurabilityRelaxed: {
+      NSString *directoryPath = [filePath stringByDeletingLastPathComponent];
+      if (![[NSFileManager defaultManager] createDirectoryAtPath:directoryPath
+                                     withIntermediateDirectories:YES
+                                                      attributes:nil
+                                                           error:outError]) {
+        return NO;
+      }
+      return [data writeToFile:filePath options:0 error:outError];
+    }
+
+    case GDTCORStorageDurabilitySynced: {
+      // The data is synced under a hidden temporary name, renamed, and the rename is synced by
+      // syncing the directory.
+      NSString *directoryPath = [filePath stringByDeletingLastPathComponent];
+      NSString *temporaryPath = [directoryPath
+          stringByAppendingPathComponent:[NSString stringWithFormat:@".%@.tmp",
+                                                                    filePath.lastPathComponent]];
+      if (![[NSFileManager defaultManager] createDirectoryAtPath:directoryPath
+                                     withIntermediateDirectories:YES
+                                                      attributes:nil
+                                                           error:outError] ||
+          ![data writeToFile:temporaryPath options:0 error:outError] ||
+          !GDTCORSyncFileAtPath(temporaryPath, outError)) {
+        [[NSFileManager defaultManager] removeItemAtPath:temporaryPath error:nil];
+        return NO;
+      }
+      if (rename(temporaryPath.fileSystemRepresentation, filePath.fileSystemRepresentation) != 0) {
+        if (outError) {
+          *outError = GDTCORPOSIXError(filePath);
+        }
+        [[NSFileManager defaultManager] removeItemAtPath:temporaryPath error:nil];
+        return NO;
+      }
+      return GDTCORSyncFileAtPath(directoryPath, outError);
+    }
+  }
+  return GDTCORWriteDataToFile(data, filePath, outError);
+}
+
 @interface GDTCORApplication ()
 /**
  Private flag to match the existing `readonly` public flag. This will be accurate for all platforms,
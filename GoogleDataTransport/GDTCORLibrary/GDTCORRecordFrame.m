@@ -0,0 +1,105 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORRecordFrame.h"
+
+#import <zlib.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+const NSUInteger kGDTCORRecordFrameHeaderLength =
+    sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint32_t);
+
+#pragma mark - Little-endian integers
+
+void GDTCORAppendUInt8(NSMutableData *data, uint8_t value) {
+  [data appendBytes:&value length:sizeof(value)];
+}
+
+void GDTCORAppendUInt16(NSMutableData *data, uint16_t value) {
+  value = CFSwapInt16HostToLittle(value);
+  [data appendBytes:&value length:sizeof(value)];
+}
+
+void GDTCORAppendUInt32(NSMutableData *data, uint32_t value) {
+  value = CFSwapInt32HostToLittle(value);
+  [data appendBytes:&value length:sizeof(value)];
+}
+
+void GDTCORAppendUInt64(NSMutableData *data, uint64_t value) {
+  value = CFSwapInt64HostToLittle(value);
+  [data appendBytes:&value length:sizeof(value)];
+}
+
+uint16_t GDTCORReadUInt16(const uint8_t *bytes) {
+  uint16_t value;
+  memcpy(&value, bytes, sizeof(value));
+  return CFSwapInt16LittleToHost(value);
+}
+
+uint32_t GDTCORReadUInt32(const uint8_t *bytes) {
+  uint32_t value;
+  memcpy(&value, bytes, sizeof(value));
+  return CFSwapInt32LittleToHost(value);
+}
+
+uint64_t GDTCORReadUInt64(const uint8_t *bytes) {
+  uint64_t value;
+  memcpy(&value, bytes, sizeof(value));
+  return CFSwapInt64LittleToHost(value);
+}
+
+#pragma mark - Record frames
+
+NSData *GDTCORRecordFrame(uint32_t magic, uint8_t type, NSData *body) {
+  NSMutableData *frame =
+      [NSMutableData dataWithCapacity:kGDTCORRecordFrameHeaderLength + body.length];
+  GDTCORAppendUInt32(frame, magic);
+  GDTCORAppendUInt8(frame, type);
+  GDTCORAppendUInt32(frame, (uint32_t)body.length);
+  GDTCORAppendUInt32(frame, (uint32_t)crc32(0, body.bytes, (uInt)body.length));
+  [frame appendData:body];
+  return frame;
+}
+
+BOOL GDTCORReadRecordFrame(const uint8_t *bytes,
+                           uint64_t length,
+                           uint64_t offset,
+                           uint32_t magic,
+                           uint8_t *outType,
+                           NSRange *outBodyRange) {
+  if (offset > length || length - offset < kGDTCORRecordFrameHeaderLength) {
+    return NO;
+  }
+  const uint8_t *header = bytes + offset;
+  uint32_t frameMagic = GDTCORReadUInt32(header);
+  uint8_t type = header[sizeof(uint32_t)];
+  uint32_t bodyLength = GDTCORReadUInt32(header + sizeof(uint32_t) + sizeof(uint8_t));
+  uint32_t checksum = GDTCORReadUInt32(header + sizeof(uint32_t) * 2 + sizeof(uint8_t));
+  if (frameMagic != magic || bodyLength == 0 ||
+      length - offset - kGDTCORRecordFrameHeaderLength < bodyLength) {
+    return NO;
+  }
+  if ((uint32_t)crc32(0, header + kGDTCORRecordFrameHeaderLength, bodyLength) != checksum) {
+    return NO;
+  }
+  *outType = type;
+  *outBodyRange =
+      NSMakeRange((NSUInteger)(offset + kGDTCORRecordFrameHeaderLength), bodyLength);
+  return YES;
+}
+
+NS_ASSUME_NONNULL_END
@@ -147,6 +147,15 @@ id<GDTCORMetricsControllerProtocol> _Nullable GDTCORMetricsControllerInstanceFor
 #pragma mark - GDTCORLifecycleProtocol
 
 - (void)appWillBackground:(nonnull GDTCORApplication *)app {
+  // Metrics controllers are signaled first, so that the metrics they flush are written before the
+  // storages prepare for the app to be suspended. A controller may be registered for many targets.
+  NSSet<id<GDTCORMetricsControllerProtocol>> *metricsControllers =
+      [NSSet setWithArray:[self.targetToMetricsController allValues]];
+  for (id<GDTCORMetricsControllerProtocol> metricsController in metricsControllers) {
+    if ([metricsController respondsToSelector:@selector(appWillBackground:)]) {
+      [(id<GDTCORLifecycleProtocol>)metricsController appWillBackground:app];
+    }
+  }
   NSArray<id<GDTCORUploader>> *uploaders = [self.targetToUploader allValues];
   for (id<GDTCORUploader> uploader in uploaders) {
     if ([uploader respondsToSelector:@selector(appWillBackground:)]) {
@@ -177,6 +186,14 @@ id<GDTCORMetricsControllerProtocol> _Nullable GDTCORMetricsControllerInstanceFor
 }
 
 - (void)appWillTerminate:(nonnull GDTCORApplication *)app {
+  // Metrics controllers are signaled first, as in -appWillBackground:.
+  NSSet<id<GDTCORMetricsControllerProtocol>> *metricsControllers =
+      [NSSet setWithArray:[self.targetToMetricsController allValues]];
+  for (id<GDTCORMetricsControllerProtocol> metricsController in metricsControllers) {
+    if ([metricsController respondsToSelector:@selector(appWillTerminate:)]) {
+      [(id<GDTCORLifecycleProtocol>)metricsController appWillTerminate:app];
+    }
+  }
   NSArray<id<GDTCORUploader>> *uploaders = [self.targetToUploader allValues];
   for (id<GDTCORUploader> uploader in uploaders) {
     if ([uploader respondsToSelector:@selector(appWillTerminate:)]) {
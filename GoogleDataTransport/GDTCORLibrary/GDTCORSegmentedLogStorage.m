@@ -0,0 +1,1489 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORSegmentedLogStorage.h"
+
+#import <fcntl.h>
+#import <unistd.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORAssert.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventRecordCodec.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORPlatform.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORRecordFrame.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORConsoleLogger.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
+
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCOREvent_Private.h"
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORUploadBatch.h"
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORUploadCoordinator.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+const uint64_t kGDTCORSegmentedLogStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
+
+const uint64_t kGDTCORSegmentedLogStorageSegmentSizeLimit = 512 * 1024;  // 512 KB.
+
+const uint64_t kGDTCORSegmentedLogStorageGroupCommitByteThreshold = 64 * 1024;  // 64 KB.
+
+NSString *const GDTCORSegmentedLogStorageErrorDomain = @"GDTCORSegmentedLogStorage";
+
+NSString *const kGDTCORSegmentedLogStorageEnabledKey = @"GDTCORSegmentedLogStorageEnabled";
+
+NSString *const kGDTCORSegmentedLogStorageGroupCommitWindowKey =
+    @"GDTCORSegmentedLogStorageGroupCommitWindow";
+
+/** The file extension of segment files. */
+static NSString *const kSegmentFileExtension = @"log";
+
+/** The value every record frame starts with, "GDTR" when read as little-endian bytes. */
+static const uint32_t kRecordMagic = 0x52544447;
+
+/** A head segment is compacted once less than 1/kCompactionRatio of its bytes are live. */
+static const uint64_t kCompactionRatio = 4;
+
+/** The number of events a batch event source reads per dispatch onto the storage queue. */
+static const NSUInteger kBatchReadChunkSize = 64;
+
+/** The key of the storage queue specific value, the storage owning the queue. */
+static char kStorageQueueKey;
+
+/** The types of records stored in a segment. */
+typedef NS_ENUM(uint8_t, GDTCORSegmentRecordType) {
+  /** The body is an event: QoS tier, expiration, event ID, mapping ID and the event record. */
+  GDTCORSegmentRecordTypeEvent = 1,
+
+  /** The body is the ID of an event that has been removed. */
+  GDTCORSegmentRecordTypeTombstone = 2,
+};
+
+#pragma mark - Record encoding
+
+/** Appends a uint16 length-prefixed UTF-8 string. Returns NO if the string is too long. */
+static BOOL GDTCORAppendString(NSMutableData *data, NSString *string) {
+  NSData *utf8 = [string dataUsingEncoding:NSUTF8StringEncoding];
+  if (utf8.length > UINT16_MAX) {
+    return NO;
+  }
+  GDTCORAppendUInt16(data, (uint16_t)utf8.length);
+  [data appendData:utf8];
+  return YES;
+}
+
+/** Reads a uint16 length-prefixed UTF-8 string and advances the cursor past it. */
+static NSString *_Nullable GDTCORReadString(const uint8_t *bytes,
+                                            NSUInteger length,
+                                            NSUInteger *cursor) {
+  if (length - *cursor < sizeof(uint16_t)) {
+    return nil;
+  }
+  uint16_t stringLength = GDTCORReadUInt16(bytes + *cursor);
+  *cursor += sizeof(uint16_t);
+  if (length - *cursor < stringLength) {
+    return nil;
+  }
+  NSString *string = [[NSString alloc] initWithBytes:bytes + *cursor
+                                              length:stringLength
+                                            encoding:NSUTF8StringEncoding];
+  *cursor += stringLength;
+  return string;
+}
+
+#pragma mark - GDTCORSegmentedLogEntry
+
+/** The location and metadata of a live event record. */
+@interface GDTCORSegmentedLogEntry : NSObject
+
+/** The ID of the event. */
+@property(nonatomic, copy) NSString *eventID;
+
+/** The mapping ID of the event. */
+@property(nonatomic, copy) NSString *mappingID;
+
+/** The QoS tier of the event. */
+@property(nonatomic) GDTCOREventQoS qosTier;
+
+/** The expiration of the event as a 1970-relative time interval. */
+@property(nonatomic) int64_t expiration;
+
+/** The segment containing the record. */
+@property(nonatomic) uint64_t segmentID;
+
+/** The offset of the record frame within the segment. */
+@property(nonatomic) uint64_t offset;
+
+/** The length of the record frame. */
+@property(nonatomic) uint64_t length;
+
+/** The batch the event is part of, or nil if it's not batched. */
+@property(nonatomic, nullable) NSNumber *batchID;
+
+@end
+
+@implementation GDTCORSegmentedLogEntry
+@end
+
+/** Builds the body of an event record. */
+static NSData *_Nullable GDTCORSegmentEventBody(GDTCOREvent *event, NSError **outError) {
+  NSError *error;
+  NSData *record = GDTCOREncodeEventRecord(event, &error);
+  if (record == nil) {
+    *outError = error;
+    return nil;
+  }
+  NSMutableData *body = [NSMutableData dataWithCapacity:record.length + 64];
+  GDTCORAppendUInt8(body, (uint8_t)event.qosTier);
+  GDTCORAppendUInt64(body, (uint64_t)(int64_t)event.expirationDate.timeIntervalSince1970);
+  if (!GDTCORAppendString(body, event.eventID) || !GDTCORAppendString(body, event.mappingID)) {
+    NSString *reason = @"The event ID or mapping ID is too long.";
+    *outError = [NSError errorWithDomain:GDTCORSegmentedLogStorageErrorDomain
+                                    code:GDTCORSegmentedLogStorageErrorWriteFailed
+                                userInfo:@{NSLocalizedFailureReasonErrorKey : reason}];
+    return nil;
+  }
+  [body appendData:record];
+  return body;
+}
+
+/** Parses the metadata of an event record body.
+ *
+ * @param outPayloadRange If not NULL, populated with the range of the event record in the body.
+ * @return An entry without a location, or nil if the body is malformed.
+ */
+static GDTCORSegmentedLogEntry *_Nullable GDTCORSegmentEntryFromEventBody(
+    const uint8_t *body, NSUInteger length, NSRange *_Nullable outPayloadRange) {
+  NSUInteger cursor = 0;
+  if (length < sizeof(uint8_t) + sizeof(uint64_t)) {
+    return nil;
+  }
+  uint8_t qosTier = body[cursor];
+  cursor += sizeof(uint8_t);
+  int64_t expiration = (int64_t)GDTCORReadUInt64(body + cursor);
+  cursor += sizeof(uint64_t);
+  NSString *eventID = GDTCORReadString(body, length, &cursor);
+  NSString *mappingID = eventID ? GDTCORReadString(body, length, &cursor) : nil;
+  if (eventID == nil || mappingID == nil) {
+    return nil;
+  }
+  GDTCORSegmentedLogEntry *entry = [[GDTCORSegmentedLogEntry alloc] init];
+  entry.eventID = eventID;
+  entry.mappingID = mappingID;
+  entry.qosTier = qosTier;
+  entry.expiration = expiration;
+  if (outPayloadRange) {
+    *outPayloadRange = NSMakeRange(cursor, length - cursor);
+  }
+  return entry;
+}
+
+/** Builds the body of a tombstone record. */
+static NSData *GDTCORSegmentTombstoneBody(NSString *eventID) {
+  NSMutableData *body = [NSMutableData data];
+  GDTCORAppendString(body, eventID);
+  return body;
+}
+
+#pragma mark - GDTCORSegmentedLogTarget
+
+/** The log and index of a single target. */
+@interface GDTCORSegmentedLogTarget : NSObject
+
+/** The target. */
+@property(nonatomic, readonly) GDTCORTarget target;
+
+/** Live events keyed by event ID. */
+@property(nonatomic, readonly) NSMutableDictionary<NSString *, GDTCORSegmentedLogEntry *> *entries;
+
+/** The segments of the log in ascending order. */
+@property(nonatomic, readonly) NSMutableArray<NSNumber *> *segmentIDs;
+
+/** The size of each segment in bytes. */
+@property(nonatomic, readonly) NSMutableDictionary<NSNumber *, NSNumber *> *segmentSizes;
+
+/** The number of live events of each segment. */
+@property(nonatomic, readonly) NSMutableDictionary<NSNumber *, NSNumber *> *liveCounts;
+
+/** The number of bytes taken by the live events of each segment. */
+@property(nonatomic, readonly) NSMutableDictionary<NSNumber *, NSNumber *> *liveBytes;
+
+/** The file descriptor records are appended to, or -1 if no segment is open. */
+@property(nonatomic) int activeFileDescriptor;
+
+/** The segment `activeFileDescriptor` refers to. */
+@property(nonatomic) uint64_t activeSegmentID;
+
+- (instancetype)initWithTarget:(GDTCORTarget)target;
+
+/** Starts tracking a segment with no records. */
+- (void)addSegment:(uint64_t)segmentID;
+
+/** Stops tracking a segment. */
+- (void)removeSegment:(uint64_t)segmentID;
+
+/** Adds an entry to the index, replacing an existing entry with the same event ID. */
+- (void)addEntry:(GDTCORSegmentedLogEntry *)entry;
+
+/** Removes the entry with the given event ID from the index. */
+- (void)removeEntryForEventID:(NSString *)eventID;
+
+@end
+
+@implementation GDTCORSegmentedLogTarget
+
+- (instancetype)initWithTarget:(GDTCORTarget)target {
+  self = [super init];
+  if (self) {
+    _target = target;
+    _entries = [[NSMutableDictionary alloc] init];
+    _segmentIDs = [[NSMutableArray alloc] init];
+    _segmentSizes = [[NSMutableDictionary alloc] init];
+    _liveCounts = [[NSMutableDictionary alloc] init];
+    _liveBytes = [[NSMutableDictionary alloc] init];
+    _activeFileDescriptor = -1;
+  }
+  return self;
+}
+
+- (void)addSegment:(uint64_t)segmentID {
+  NSNumber *key = @(segmentID);
+  [_segmentIDs addObject:key];
+  _segmentSizes[key] = @0;
+  _liveCounts[key] = @0;
+  _liveBytes[key] = @0;
+}
+
+- (void)removeSegment:(uint64_t)segmentID {
+  NSNumber *key = @(segmentID);
+  [_segmentIDs removeObject:key];
+  [_segmentSizes removeObjectForKey:key];
+  [_liveCounts removeObjectForKey:key];
+  [_liveBytes removeObjectForKey:key];
+}
+
+- (void)addEntry:(GDTCORSegmentedLogEntry *)entry {
+  [self removeEntryForEventID:entry.eventID];
+  _entries[entry.eventID] = entry;
+  NSNumber *key = @(entry.segmentID);
+  _liveCounts[key] = @(_liveCounts[key].unsignedLongLongValue + 1);
+  _liveBytes[key] = @(_liveBytes[key].unsignedLongLongValue + entry.length);
+}
+
+- (void)removeEntryForEventID:(NSString *)eventID {
+  GDTCORSegmentedLogEntry *entry = _entries[eventID];
+  if (entry == nil) {
+    return;
+  }
+  [_entries removeObjectForKey:eventID];
+  NSNumber *key = @(entry.segmentID);
+  _liveCounts[key] = @(_liveCounts[key].unsignedLongLongValue - 1);
+  _liveBytes[key] = @(_liveBytes[key].unsignedLongLongValue - entry.length);
+}
+
+@end
+
+#pragma mark - GDTCORSegmentedLogBatch
+
+/** An in-flight batch of events. */
+@interface GDTCORSegmentedLogBatch : NSObject
+
+/** The ID of the batch. */
+@property(nonatomic) NSNumber *batchID;
+
+/** The target of the batched events. */
+@property(nonatomic) GDTCORTarget target;
+
+/** The time after which the batch is dissolved by -checkForExpirations. */
+@property(nonatomic) NSDate *expirationDate;
+
+/** The IDs of the batched events in log order. */
+@property(nonatomic, copy) NSArray<NSString *> *eventIDs;
+
+@end
+
+@implementation GDTCORSegmentedLogBatch
+@end
+
+#pragma mark - GDTCORSegmentedLogPendingEvent
+
+/** An event waiting to be written by a group commit. */
+@interface GDTCORSegmentedLogPendingEvent : NSObject
+
+/** The event to write. */
+@property(nonatomic) GDTCOREvent *event;
+
+/** The encoded record frame of the event. */
+@property(nonatomic) NSData *frame;
+
+/** The block to call once the event has been written, or has failed to. */
+@property(nonatomic, copy) void (^completion)(BOOL wasWritten, NSError *_Nullable error);
+
+@end
+
+@implementation GDTCORSegmentedLogPendingEvent
+@end
+
+#pragma mark - GDTCORSegmentedLogBatchEventSource
+
+/** Reads the events of a batch from the segments on demand. The events are read in chunks on the
+ * storage queue, so no more than a chunk of decoded events is held at a time. When enumerated on
+ * the storage queue itself, the chunks are read in place instead of dispatching onto it.
+ */
+@interface GDTCORSegmentedLogBatchEventSource : NSObject <GDTCORUploadBatchEventSource>
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Instantiates a source of the given events of a batch of the storage. */
+- (instancetype)initWithStorage:(GDTCORSegmentedLogStorage *)storage
+                        batchID:(NSNumber *)batchID
+                       eventIDs:(NSArray<NSString *> *)eventIDs NS_DESIGNATED_INITIALIZER;
+
+@end
+
+@interface GDTCORSegmentedLogStorage ()
+
+- (NSArray<GDTCOREvent *> *)syncThreadUnsafeReadEventsWithIDs:(NSArray<NSString *> *)eventIDs
+                                                      ofBatch:(NSNumber *)batchID;
+
+@end
+
+@implementation GDTCORSegmentedLogBatchEventSource {
+  /** The storage the events are read from. */
+  GDTCORSegmentedLogStorage *_storage;
+
+  /** The ID of the batch. */
+  NSNumber *_batchID;
+
+  /** The IDs of the batched events in log order. */
+  NSArray<NSString *> *_eventIDs;
+}
+
+- (instancetype)initWithStorage:(GDTCORSegmentedLogStorage *)storage
+                        batchID:(NSNumber *)batchID
+                       eventIDs:(NSArray<NSString *> *)eventIDs {
+  self = [super init];
+  if (self) {
+    _storage = storage;
+    _batchID = batchID;
+    _eventIDs = [eventIDs copy];
+  }
+  return self;
+}
+
+- (NSUInteger)eventCount {
+  return _eventIDs.count;
+}
+
+- (void)enumerateEventsUsingBlock:(void (^)(GDTCOREvent *event, BOOL *stop))block {
+  GDTCORSegmentedLogStorage *storage = _storage;
+  NSNumber *batchID = _batchID;
+  BOOL stop = NO;
+  NSUInteger location = 0;
+  while (!stop && location < _eventIDs.count) {
+    NSRange range = NSMakeRange(location, MIN(kBatchReadChunkSize, _eventIDs.count - location));
+    location = NSMaxRange(range);
+    NSArray<NSString *> *eventIDs = [_eventIDs subarrayWithRange:range];
+    @autoreleasepool {
+      __block NSArray<GDTCOREvent *> *events;
+      if (dispatch_get_specific(&kStorageQueueKey) == (__bridge void *)storage) {
+        events = [storage syncThreadUnsafeReadEventsWithIDs:eventIDs ofBatch:batchID];
+      } else {
+        dispatch_sync(storage.storageQueue, ^{
+          events = [storage syncThreadUnsafeReadEventsWithIDs:eventIDs ofBatch:batchID];
+        });
+      }
+      for (GDTCOREvent *event in events) {
+        block(event, &stop);
+        if (stop) {
+          break;
+        }
+      }
+    }
+  }
+}
+
+@end
+
+#pragma mark - GDTCORSegmentedLogStorage
+
+@implementation GDTCORSegmentedLogStorage {
+  /** The logs of each target, keyed by target. Only accessed on the storage queue. */
+  NSMutableDictionary<NSNumber *, GDTCORSegmentedLogTarget *> *_targets;
+
+  /** The in-flight batches keyed by batch ID. Only accessed on the storage queue. */
+  NSMutableDictionary<NSNumber *, GDTCORSegmentedLogBatch *> *_batches;
+
+  /** The ID the next batch will get. */
+  int64_t _nextBatchID;
+
+  /** The bytes taken by segments and library data. */
+  uint64_t _storageSize;
+
+  /** YES once the segments on disk have been replayed into the index. */
+  BOOL _loaded;
+
+  /** The events waiting for the next group commit, in the order they were stored. */
+  NSMutableArray<GDTCORSegmentedLogPendingEvent *> *_pendingEvents;
+
+  /** The bytes taken by the frames of the pending events. */
+  uint64_t _pendingBytes;
+
+  /** Incremented by each group commit, so that the timer of a committed group can be ignored. */
+  uint64_t _groupCommitGeneration;
+}
+
+@synthesize delegate = _delegate;
+
++ (instancetype)sharedInstance {
+  static GDTCORSegmentedLogStorage *sharedStorage;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    sharedStorage = [[GDTCORSegmentedLogStorage alloc] init];
+  });
+  return sharedStorage;
+}
+
++ (nullable instancetype)sharedInstanceEnabledByInfoDictionary:
+    (nullable NSDictionary<NSString *, id> *)infoDictionary {
+  id enabled = infoDictionary[kGDTCORSegmentedLogStorageEnabledKey];
+  if (![enabled respondsToSelector:@selector(boolValue)] || ![enabled boolValue]) {
+    return nil;
+  }
+  GDTCORSegmentedLogStorage *storage = [self sharedInstance];
+  id groupCommitWindow = infoDictionary[kGDTCORSegmentedLogStorageGroupCommitWindowKey];
+  if ([groupCommitWindow respondsToSelector:@selector(doubleValue)]) {
+    storage.groupCommitWindow = MAX([groupCommitWindow doubleValue], 0);
+  }
+  return storage;
+}
+
+- (instancetype)init {
+  self = [super init];
+  if (self) {
+    _storageQueue =
+        dispatch_queue_create("com.google.GDTCORSegmentedLogStorage", DISPATCH_QUEUE_SERIAL);
+    dispatch_queue_set_specific(_storageQueue, &kStorageQueueKey, (__bridge void *)self, NULL);
+    _uploadCoordinator = [GDTCORUploadCoordinator sharedInstance];
+    _targets = [[NSMutableDictionary alloc] init];
+    _batches = [[NSMutableDictionary alloc] init];
+    _pendingEvents = [[NSMutableArray alloc] init];
+    _groupCommitByteThreshold = kGDTCORSegmentedLogStorageGroupCommitByteThreshold;
+  }
+  return self;
+}
+
+- (void)dealloc {
+  for (GDTCORSegmentedLogTarget *log in _targets.allValues) {
+    [self closeActiveSegmentOfTarget:log];
+  }
+}
+
+#pragma mark - GDTCORStorageProtocol
+
+- (void)storeEvent:(GDTCOREvent *)event
+        onComplete:(void (^_Nullable)(BOOL wasWritten, NSError *_Nullable error))completion {
+  GDTCORLogDebug(@"Saving event: %@", event);
+  if (event == nil || event.serializedDataObjectBytes == nil) {
+    GDTCORLogDebug(@"%@", @"The event was nil, so it was not saved.");
+    if (completion) {
+      completion(NO, [NSError errorWithDomain:NSInternalInconsistencyException
+                                         code:-1
+                                     userInfo:nil]);
+    }
+    return;
+  }
+
+  __block GDTCORBackgroundIdentifier bgID = GDTCORBackgroundIdentifierInvalid;
+  bgID = [[GDTCORApplication sharedApplication]
+      beginBackgroundTaskWithName:@"GDTStorage"
+                expirationHandler:^{
+                  // End the background task if it's still valid.
+                  [[GDTCORApplication sharedApplication] endBackgroundTask:bgID];
+                  bgID = GDTCORBackgroundIdentifierInvalid;
+                }];
+
+  void (^onStored)(BOOL, NSError *_Nullable) = ^(BOOL wasWritten, NSError *_Nullable error) {
+    GDTCORLogDebug(@"event %@ stored. success:%@ error:%@", event, wasWritten ? @"YES" : @"NO",
+                   error);
+    if (completion) {
+      completion(wasWritten, error);
+    }
+
+    // Check the QoS, if it's high priority, notify the target that it has a high priority event.
+    if (wasWritten && event.qosTier == GDTCOREventQoSFast) {
+      [self.uploadCoordinator forceUploadForTarget:event.target];
+    }
+
+    // Cancel or end the associated background task if it's still valid.
+    [[GDTCORApplication sharedApplication] endBackgroundTask:bgID];
+    bgID = GDTCORBackgroundIdentifierInvalid;
+  };
+
+  dispatch_async(_storageQueue, ^{
+    if (self.groupCommitWindow > 0) {
+      [self syncThreadUnsafeEnqueueEvent:event completion:onStored];
+      return;
+    }
+    NSError *error;
+    BOOL wasWritten = [self syncThreadUnsafeStoreEvent:event error:&error];
+    onStored(wasWritten, error);
+  });
+}
+
+- (void)batchWithEventSelector:(nonnull GDTCORStorageEventSelector *)eventSelector
+               batchExpiration:(nonnull NSDate *)expiration
+                    onComplete:
+                        (nonnull void (^)(NSNumber *_Nullable batchID,
+                                          NSSet<GDTCOREvent *> *_Nullable events))onComplete {
+  dispatch_async(_storageQueue, ^{
+    GDTCORSegmentedLogBatch *batch =
+        [self syncThreadUnsafeReserveBatchWithEventSelector:eventSelector
+                                            batchExpiration:expiration];
+    // The block API hands out the decoded events, so read them right away.
+    NSArray<GDTCOREvent *> *events =
+        batch ? [self syncThreadUnsafeReadEventsWithIDs:batch.eventIDs ofBatch:batch.batchID] : @[];
+    if (events.count == 0) {
+      if (batch) {
+        [self syncThreadUnsafeRemoveBatchWithID:batch.batchID deleteEvents:NO];
+      }
+      onComplete(nil, nil);
+      return;
+    }
+    onComplete(batch.batchID, [NSSet setWithArray:events]);
+  });
+}
+
+- (void)uploadBatchWithEventSelector:(GDTCORStorageEventSelector *)eventSelector
+                     batchExpiration:(NSDate *)expiration
+                          onComplete:(void (^)(GDTCORUploadBatch *_Nullable batch))onComplete {
+  dispatch_async(_storageQueue, ^{
+    GDTCORSegmentedLogBatch *batch =
+        [self syncThreadUnsafeReserveBatchWithEventSelector:eventSelector
+                                            batchExpiration:expiration];
+    if (batch == nil) {
+      onComplete(nil);
+      return;
+    }
+    GDTCORSegmentedLogBatchEventSource *eventSource =
+        [[GDTCORSegmentedLogBatchEventSource alloc] initWithStorage:self
+                                                            batchID:batch.batchID
+                                                           eventIDs:batch.eventIDs];
+    onComplete([[GDTCORUploadBatch alloc] initWithBatchID:batch.batchID eventSource:eventSource]);
+  });
+}
+
+- (void)removeBatchWithID:(nonnull NSNumber *)batchID
+             deleteEvents:(BOOL)deleteEvents
+               onComplete:(void (^_Nullable)(void))onComplete {
+  dispatch_async(_storageQueue, ^{
+    [self syncThreadUnsafeRemoveBatchWithID:batchID deleteEvents:deleteEvents];
+
+    if (onComplete) {
+      onComplete();
+    }
+  });
+}
+
+- (void)batchIDsForTarget:(GDTCORTarget)target
+               onComplete:(nonnull void (^)(NSSet<NSNumber *> *_Nullable))onComplete {
+  dispatch_async(_storageQueue, ^{
+    NSMutableSet<NSNumber *> *batchIDs = [[NSMutableSet alloc] init];
+    [self->_batches enumerateKeysAndObjectsUsingBlock:^(
+                        NSNumber *batchID, GDTCORSegmentedLogBatch *batch, BOOL *stop) {
+      if (batch.target == target) {
+        [batchIDs addObject:batchID];
+      }
+    }];
+    if (onComplete) {
+      onComplete(batchIDs);
+    }
+  });
+}
+
+- (void)libraryDataForKey:(nonnull NSString *)key
+          onFetchComplete:(nonnull void (^)(NSData *_Nullable, NSError *_Nullable))onFetchComplete
+              setNewValue:(NSData *_Nullable (^_Nullable)(void))setValueBlock {
+  dispatch_async(_storageQueue, ^{
+    [self loadIfNeeded];
+    NSString *dataPath = [[[self class] libraryDataStoragePath] stringByAppendingPathComponent:key];
+    NSError *error;
+    NSData *data = [NSData dataWithContentsOfFile:dataPath options:0 error:&error];
+    if (onFetchComplete) {
+      onFetchComplete(data, error);
+    }
+    if (setValueBlock) {
+      NSData *newValue = setValueBlock();
+      // The -isKindOfClass check is necessary because without an explicit 'return nil' in the block
+      // the implicit return value will be the block itself. The compiler doesn't detect this.
+      if (newValue != nil && [newValue isKindOfClass:[NSData class]] && newValue.length) {
+        NSError *newValueError;
+        if ([newValue writeToFile:dataPath options:NSDataWritingAtomic error:&newValueError]) {
+          self->_storageSize = self->_storageSize - data.length + newValue.length;
+        } else {
+          GDTCORLogDebug(@"Error writing new value in libraryDataForKey: %@", newValueError);
+        }
+      }
+    }
+  });
+}
+
+- (void)storeLibraryData:(NSData *)data
+                  forKey:(nonnull NSString *)key
+              onComplete:(nullable void (^)(NSError *_Nullable error))onComplete {
+  if (!data || data.length <= 0) {
+    if (onComplete) {
+      onComplete([NSError errorWithDomain:NSInternalInconsistencyException code:-1 userInfo:nil]);
+    }
+    return;
+  }
+  dispatch_async(_storageQueue, ^{
+    [self loadIfNeeded];
+    NSError *error;
+    NSString *dataPath = [[[self class] libraryDataStoragePath] stringByAppendingPathComponent:key];
+    uint64_t previousSize = [self fileSizeAtPath:dataPath];
+    if ([data writeToFile:dataPath options:NSDataWritingAtomic error:&error]) {
+      self->_storageSize = self->_storageSize - previousSize + data.length;
+    }
+    if (onComplete) {
+      onComplete(error);
+    }
+  });
+}
+
+- (void)removeLibraryDataForKey:(nonnull NSString *)key
+                     onComplete:(nonnull void (^)(NSError *_Nullable error))onComplete {
+  dispatch_async(_storageQueue, ^{
+    [self loadIfNeeded];
+    NSError *error;
+    NSString *dataPath = [[[self class] libraryDataStoragePath] stringByAppendingPathComponent:key];
+    uint64_t fileSize = [self fileSizeAtPath:dataPath];
+    if ([[NSFileManager defaultManager] fileExistsAtPath:dataPath] &&
+        [[NSFileManager defaultManager] removeItemAtPath:dataPath error:&error]) {
+      self->_storageSize -= fileSize;
+    }
+    if (onComplete) {
+      onComplete(error);
+    }
+  });
+}
+
+- (void)hasEventsForTarget:(GDTCORTarget)target onComplete:(void (^)(BOOL hasEvents))onComplete {
+  dispatch_async(_storageQueue, ^{
+    [self loadIfNeeded];
+    BOOL hasEventAtLeastOneEvent = NO;
+    for (GDTCORSegmentedLogEntry *entry in self->_targets[@(target)].entries.objectEnumerator) {
+      if (entry.batchID == nil) {
+        hasEventAtLeastOneEvent = YES;
+        break;
+      }
+    }
+    if (onComplete) {
+      onComplete(hasEventAtLeastOneEvent);
+    }
+  });
+}
+
+- (void)checkForExpirations {
+  dispatch_async(_storageQueue, ^{
+    GDTCORLogDebug(@"%@", @"Checking for expired events and batches");
+    [self loadIfNeeded];
+    NSTimeInterval now = [NSDate date].timeIntervalSince1970;
+
+    // Dissolve expired batches. Expired events of a dissolved batch are removed below.
+    for (NSNumber *batchID in self->_batches.allKeys) {
+      if (self->_batches[batchID].expirationDate.timeIntervalSince1970 < now) {
+        [self syncThreadUnsafeRemoveBatchWithID:batchID deleteEvents:NO];
+      }
+    }
+
+    // The delegate only accounts for the mapping IDs of the expired events, so they are reported
+    // from the index without reading them from the segments.
+    NSMutableSet<GDTCOREvent *> *expiredEvents = [NSMutableSet set];
+    for (GDTCORSegmentedLogTarget *log in self->_targets.allValues) {
+      NSMutableArray<GDTCORSegmentedLogEntry *> *expiredEntries = [[NSMutableArray alloc] init];
+      for (GDTCORSegmentedLogEntry *entry in log.entries.objectEnumerator) {
+        if (entry.batchID != nil || entry.expiration >= now) {
+          continue;
+        }
+        GDTCOREvent *event = [[GDTCOREvent alloc] initWithEventID:entry.eventID
+                                                        mappingID:entry.mappingID
+                                                      productData:nil
+                                                           target:log.target
+                                        serializedDataObjectBytes:[NSData data]];
+        event.qosTier = entry.qosTier;
+        event.expirationDate = [NSDate dateWithTimeIntervalSince1970:entry.expiration];
+        [expiredEvents addObject:event];
+        [expiredEntries addObject:entry];
+      }
+      [self removeEntries:expiredEntries fromTarget:log];
+    }
+
+    if (self.delegate != nil && [expiredEvents count] > 0) {
+      GDTCORLogDebug(@"Delegate notified that %@ events were dropped.", @(expiredEvents.count));
+      [self.delegate storage:self didRemoveExpiredEvents:[expiredEvents copy]];
+    }
+  });
+}
+
+- (void)storageSizeWithCallback:(void (^)(uint64_t storageSize))onComplete {
+  if (!onComplete) {
+    return;
+  }
+
+  dispatch_async(_storageQueue, ^{
+    [self loadIfNeeded];
+    onComplete(self->_storageSize);
+  });
+}
+
+#pragma mark - Private not thread safe methods
+
+/** Replays the segments on disk into the index. Must be called before accessing `_targets`. */
+- (void)loadIfNeeded {
+  if (_loaded) {
+    return;
+  }
+  _loaded = YES;
+
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSString *segmentDataPath = [[self class] segmentDataStoragePath];
+  for (NSString *targetName in [fileManager contentsOfDirectoryAtPath:segmentDataPath error:nil]) {
+    if ([targetName hasPrefix:@"."]) {
+      continue;
+    }
+    GDTCORSegmentedLogTarget *log = [self logForTarget:(GDTCORTarget)targetName.integerValue];
+    NSString *targetPath = [segmentDataPath stringByAppendingPathComponent:targetName];
+    NSMutableArray<NSNumber *> *segmentIDs = [[NSMutableArray alloc] init];
+    for (NSString *fileName in [fileManager contentsOfDirectoryAtPath:targetPath error:nil]) {
+      if ([fileName.pathExtension isEqualToString:kSegmentFileExtension]) {
+        [segmentIDs addObject:@(strtoull(fileName.UTF8String, NULL, 10))];
+      }
+    }
+    [segmentIDs sortUsingSelector:@selector(compare:)];
+    for (NSNumber *segmentID in segmentIDs) {
+      [self replaySegment:segmentID.unsignedLongLongValue ofTarget:log];
+    }
+    [self reclaimSegmentsOfTarget:log];
+  }
+
+  NSString *libraryDataPath = [[self class] libraryDataStoragePath];
+  for (NSString *key in [fileManager contentsOfDirectoryAtPath:libraryDataPath error:nil]) {
+    _storageSize += [self fileSizeAtPath:[libraryDataPath stringByAppendingPathComponent:key]];
+  }
+}
+
+/** Adds the records of a segment to the index, truncating any torn or corrupt tail. */
+- (void)replaySegment:(uint64_t)segmentID ofTarget:(GDTCORSegmentedLogTarget *)log {
+  NSString *path = [[self class] segmentPathForTarget:log.target segmentID:segmentID];
+  [log addSegment:segmentID];
+  uint64_t validLength = 0;
+  uint64_t fileLength = 0;
+  @autoreleasepool {
+    NSError *error;
+    NSData *data = [NSData dataWithContentsOfFile:path
+                                          options:NSDataReadingMappedIfSafe
+                                            error:&error];
+    if (data == nil) {
+      GDTCORLogDebug(@"Segment %@ could not be read and will be reclaimed: %@", path, error);
+    }
+    const uint8_t *bytes = data.bytes;
+    fileLength = data.length;
+    uint8_t type;
+    NSRange bodyRange;
+    while (GDTCORReadRecordFrame(bytes, fileLength, validLength, kRecordMagic, &type,
+                                 &bodyRange)) {
+      uint64_t frameLength = kGDTCORRecordFrameHeaderLength + bodyRange.length;
+      if (type == GDTCORSegmentRecordTypeEvent) {
+        GDTCORSegmentedLogEntry *entry =
+            GDTCORSegmentEntryFromEventBody(bytes + bodyRange.location, bodyRange.length, NULL);
+        if (entry) {
+          entry.segmentID = segmentID;
+          entry.offset = validLength;
+          entry.length = frameLength;
+          // A record appearing twice was relocated during compaction, the later copy wins.
+          [log addEntry:entry];
+        }
+      } else if (type == GDTCORSegmentRecordTypeTombstone) {
+        NSUInteger cursor = 0;
+        NSString *eventID = GDTCORReadString(bytes + bodyRange.location, bodyRange.length, &cursor);
+        if (eventID) {
+          [log removeEntryForEventID:eventID];
+        }
+      }
+      validLength += frameLength;
+    }
+  }
+
+  if (validLength < fileLength) {
+    GDTCORLogDebug(@"Truncating %llu bytes of torn or corrupt records from segment %@",
+                   fileLength - validLength, path);
+    if (truncate(path.fileSystemRepresentation, (off_t)validLength) != 0) {
+      GDTCORLogDebug(@"Failed to truncate segment %@: %d", path, errno);
+    }
+  }
+  log.segmentSizes[@(segmentID)] = @(validLength);
+  _storageSize += validLength;
+}
+
+- (GDTCORSegmentedLogTarget *)logForTarget:(GDTCORTarget)target {
+  GDTCORSegmentedLogTarget *log = _targets[@(target)];
+  if (log == nil) {
+    log = [[GDTCORSegmentedLogTarget alloc] initWithTarget:target];
+    _targets[@(target)] = log;
+  }
+  return log;
+}
+
+- (BOOL)syncThreadUnsafeStoreEvent:(GDTCOREvent *)event error:(NSError **)outError {
+  [self loadIfNeeded];
+  NSData *frame = [self syncThreadUnsafeFrameForEvent:event error:outError];
+  if (frame == nil) {
+    return NO;
+  }
+  GDTCORSegmentedLogTarget *log = [self logForTarget:event.target];
+  uint64_t segmentID;
+  uint64_t offset;
+  if (![self appendFrames:frame toTarget:log segmentID:&segmentID offset:&offset error:outError]) {
+    return NO;
+  }
+  [self indexEvent:event frameLength:frame.length segmentID:segmentID offset:offset ofTarget:log];
+  return YES;
+}
+
+/** Encodes the record frame of an event, or returns nil and notifies the delegate if storing it
+ * would exceed the storage size limit.
+ */
+- (nullable NSData *)syncThreadUnsafeFrameForEvent:(GDTCOREvent *)event error:(NSError **)outError {
+  NSData *body = GDTCORSegmentEventBody(event, outError);
+  if (body == nil) {
+    return nil;
+  }
+  NSData *frame = GDTCORRecordFrame(kRecordMagic, GDTCORSegmentRecordTypeEvent, body);
+
+  // Check storage size limit before storing the event, counting the events yet to be committed.
+  if (_storageSize + _pendingBytes + frame.length > kGDTCORSegmentedLogStorageSizeLimit) {
+    *outError = [NSError
+        errorWithDomain:GDTCORSegmentedLogStorageErrorDomain
+                   code:GDTCORSegmentedLogStorageErrorSizeLimitReached
+               userInfo:@{
+                 NSLocalizedFailureReasonErrorKey : @"Storage size limit has been reached."
+               }];
+    if (self.delegate != nil) {
+      GDTCORLogDebug(@"Delegate notified that event with mapping ID %@ was dropped.",
+                     event.mappingID);
+      [self.delegate storage:self didDropEvent:event];
+    }
+    return nil;
+  }
+  return frame;
+}
+
+/** Adds the index entry of an event whose frame has been appended to a segment. */
+- (void)indexEvent:(GDTCOREvent *)event
+       frameLength:(uint64_t)frameLength
+         segmentID:(uint64_t)segmentID
+            offset:(uint64_t)offset
+          ofTarget:(GDTCORSegmentedLogTarget *)log {
+  GDTCORSegmentedLogEntry *entry = [[GDTCORSegmentedLogEntry alloc] init];
+  entry.eventID = event.eventID;
+  entry.mappingID = event.mappingID;
+  entry.qosTier = event.qosTier;
+  entry.expiration = (int64_t)event.expirationDate.timeIntervalSince1970;
+  entry.segmentID = segmentID;
+  entry.offset = offset;
+  entry.length = frameLength;
+  [log addEntry:entry];
+}
+
+#pragma mark - Group commit
+
+/** Adds an event to the pending group. The group is committed once it reaches the byte threshold,
+ * or when the window started by its first event ends.
+ */
+- (void)syncThreadUnsafeEnqueueEvent:(GDTCOREvent *)event
+                          completion:(void (^)(BOOL, NSError *_Nullable))completion {
+  [self loadIfNeeded];
+  NSError *error;
+  NSData *frame = [self syncThreadUnsafeFrameForEvent:event error:&error];
+  if (frame == nil) {
+    completion(NO, error);
+    return;
+  }
+  GDTCORSegmentedLogPendingEvent *pendingEvent = [[GDTCORSegmentedLogPendingEvent alloc] init];
+  pendingEvent.event = event;
+  pendingEvent.frame = frame;
+  pendingEvent.completion = completion;
+  [_pendingEvents addObject:pendingEvent];
+  _pendingBytes += frame.length;
+
+  if (_pendingBytes >= self.groupCommitByteThreshold) {
+    [self syncThreadUnsafeCommitPendingEvents];
+  } else if (_pendingEvents.count == 1) {
+    uint64_t generation = _groupCommitGeneration;
+    dispatch_time_t deadline =
+        dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.groupCommitWindow * NSEC_PER_SEC));
+    dispatch_after(deadline, _storageQueue, ^{
+      if (self->_groupCommitGeneration == generation) {
+        [self syncThreadUnsafeCommitPendingEvents];
+      }
+    });
+  }
+}
+
+/** Appends the frames of the pending events of each target with a single write, syncs them to
+ * disk, and then indexes the events and calls their completions. A group larger than a segment is
+ * written in segment-sized chunks.
+ */
+- (void)syncThreadUnsafeCommitPendingEvents {
+  if (_pendingEvents.count == 0) {
+    return;
+  }
+  NSArray<GDTCORSegmentedLogPendingEvent *> *pendingEvents = _pendingEvents;
+  _pendingEvents = [[NSMutableArray alloc] init];
+  _pendingBytes = 0;
+  _groupCommitGeneration++;
+
+  NSMutableDictionary<NSNumber *, NSMutableArray<GDTCORSegmentedLogPendingEvent *> *>
+      *pendingEventsByTarget = [[NSMutableDictionary alloc] init];
+  for (GDTCORSegmentedLogPendingEvent *pendingEvent in pendingEvents) {
+    NSNumber *targetKey = @(pendingEvent.event.target);
+    if (pendingEventsByTarget[targetKey] == nil) {
+      pendingEventsByTarget[targetKey] = [[NSMutableArray alloc] init];
+    }
+    [pendingEventsByTarget[targetKey] addObject:pendingEvent];
+  }
+
+  for (NSNumber *targetKey in pendingEventsByTarget) {
+    GDTCORSegmentedLogTarget *log = [self logForTarget:targetKey.integerValue];
+    NSArray<GDTCORSegmentedLogPendingEvent *> *targetEvents = pendingEventsByTarget[targetKey];
+    NSUInteger location = 0;
+    while (location < targetEvents.count) {
+      NSMutableData *frames = [[NSMutableData alloc] init];
+      NSUInteger end = location;
+      while (end < targetEvents.count &&
+             (frames.length == 0 || frames.length + targetEvents[end].frame.length <=
+                                        kGDTCORSegmentedLogStorageSegmentSizeLimit)) {
+        [frames appendData:targetEvents[end].frame];
+        end++;
+      }
+      NSArray<GDTCORSegmentedLogPendingEvent *> *chunk =
+          [targetEvents subarrayWithRange:NSMakeRange(location, end - location)];
+      location = end;
+
+      NSError *error;
+      uint64_t segmentID = 0;
+      uint64_t offset = 0;
+      BOOL wasWritten = [self appendFrames:frames
+                                  toTarget:log
+                                 segmentID:&segmentID
+                                    offset:&offset
+                                     error:&error];
+      if (wasWritten && fsync(log.activeFileDescriptor) != 0) {
+        GDTCORLogDebug(@"Failed to sync a group commit: %d", errno);
+      }
+      for (GDTCORSegmentedLogPendingEvent *pendingEvent in chunk) {
+        if (wasWritten) {
+          [self indexEvent:pendingEvent.event
+               frameLength:pendingEvent.frame.length
+                 segmentID:segmentID
+                    offset:offset
+                  ofTarget:log];
+          offset += pendingEvent.frame.length;
+        }
+        pendingEvent.completion(wasWritten, error);
+      }
+    }
+  }
+}
+
+- (void)syncThreadUnsafeRemoveBatchWithID:(nonnull NSNumber *)batchID
+                             deleteEvents:(BOOL)deleteEvents {
+  GDTCORSegmentedLogBatch *batch = _batches[batchID];
+  if (batch == nil) {
+    return;
+  }
+  [_batches removeObjectForKey:batchID];
+
+  GDTCORSegmentedLogTarget *log = [self logForTarget:batch.target];
+  NSMutableArray<GDTCORSegmentedLogEntry *> *entriesToRemove = [[NSMutableArray alloc] init];
+  for (NSString *eventID in batch.eventIDs) {
+    GDTCORSegmentedLogEntry *entry = log.entries[eventID];
+    if (![entry.batchID isEqual:batchID]) {
+      continue;
+    }
+    if (deleteEvents) {
+      [entriesToRemove addObject:entry];
+    } else {
+      entry.batchID = nil;
+    }
+  }
+  [self removeEntries:entriesToRemove fromTarget:log];
+  GDTCORLogDebug(@"Batch %@ removed, events deleted: %@", batchID, deleteEvents ? @"YES" : @"NO");
+}
+
+/** Marks the unbatched entries matching the selector as part of a new batch. Nothing is read from
+ * the segments.
+ *
+ * @return The new batch, or nil if no events match the selector.
+ */
+- (nullable GDTCORSegmentedLogBatch *)
+    syncThreadUnsafeReserveBatchWithEventSelector:(GDTCORStorageEventSelector *)eventSelector
+                                  batchExpiration:(NSDate *)expiration {
+  [self loadIfNeeded];
+  GDTCORSegmentedLogTarget *log = [self logForTarget:eventSelector.selectedTarget];
+  NSArray<GDTCORSegmentedLogEntry *> *entries = [self entriesOfTarget:log
+                                                     matchingSelector:eventSelector];
+  if ([eventSelector isBounded]) {
+    NSArray<GDTCORSegmentedLogEntry *> *selectedEntries = [eventSelector
+        selectCandidates:entries
+                 qosTier:^GDTCOREventQoS(GDTCORSegmentedLogEntry *entry) {
+                   return entry.qosTier;
+                 }
+                    size:^uint64_t(GDTCORSegmentedLogEntry *entry) {
+                      return entry.length;
+                    }];
+    // Keep the selected entries in log order, so that reading them stays sequential.
+    NSSet<GDTCORSegmentedLogEntry *> *selectedSet = [NSSet setWithArray:selectedEntries];
+    NSMutableArray<GDTCORSegmentedLogEntry *> *logOrderedEntries =
+        [[NSMutableArray alloc] initWithCapacity:selectedEntries.count];
+    for (GDTCORSegmentedLogEntry *entry in entries) {
+      if ([selectedSet containsObject:entry]) {
+        [logOrderedEntries addObject:entry];
+      }
+    }
+    entries = logOrderedEntries;
+  }
+  if (entries.count == 0) {
+    return nil;
+  }
+  NSNumber *batchID = @(_nextBatchID++);
+  NSMutableArray<NSString *> *eventIDs = [[NSMutableArray alloc] initWithCapacity:entries.count];
+  for (GDTCORSegmentedLogEntry *entry in entries) {
+    entry.batchID = batchID;
+    [eventIDs addObject:entry.eventID];
+  }
+  GDTCORSegmentedLogBatch *batch = [[GDTCORSegmentedLogBatch alloc] init];
+  batch.batchID = batchID;
+  batch.target = eventSelector.selectedTarget;
+  batch.expirationDate = expiration;
+  batch.eventIDs = eventIDs;
+  _batches[batchID] = batch;
+  return batch;
+}
+
+/** Reads and decodes the given events of a batch. Events that are no longer part of the batch are
+ * skipped, and events that can't be decoded are removed.
+ */
+- (NSArray<GDTCOREvent *> *)syncThreadUnsafeReadEventsWithIDs:(NSArray<NSString *> *)eventIDs
+                                                      ofBatch:(NSNumber *)batchID {
+  GDTCORSegmentedLogBatch *batch = _batches[batchID];
+  if (batch == nil) {
+    return @[];
+  }
+  GDTCORSegmentedLogTarget *log = [self logForTarget:batch.target];
+  NSMutableArray<GDTCOREvent *> *events = [[NSMutableArray alloc] initWithCapacity:eventIDs.count];
+  NSMutableArray<GDTCORSegmentedLogEntry *> *unreadableEntries = [[NSMutableArray alloc] init];
+  NSMutableDictionary<NSNumber *, NSData *> *segmentCache = [[NSMutableDictionary alloc] init];
+  for (NSString *eventID in eventIDs) {
+    GDTCORSegmentedLogEntry *entry = log.entries[eventID];
+    if (![entry.batchID isEqual:batchID]) {
+      continue;
+    }
+    @autoreleasepool {
+      NSError *error;
+      GDTCOREvent *event = [self readEventForEntry:entry
+                                          ofTarget:log
+                                      segmentCache:segmentCache
+                                             error:&error];
+      if (event == nil) {
+        GDTCORLogDebug(@"Error deserializing event: %@", error);
+        [unreadableEntries addObject:entry];
+        continue;
+      }
+      [events addObject:event];
+    }
+  }
+  [segmentCache removeAllObjects];
+  [self removeEntries:unreadableEntries fromTarget:log];
+  return events;
+}
+
+/** Returns the unbatched entries matching the selector in log order. */
+- (NSArray<GDTCORSegmentedLogEntry *> *)entriesOfTarget:(GDTCORSegmentedLogTarget *)log
+                                       matchingSelector:(GDTCORStorageEventSelector *)selector {
+  NSSet<NSString *> *eventIDs = selector.selectedEventIDs;
+  NSSet<NSNumber *> *qosTiers = selector.selectedQosTiers;
+  NSSet<NSString *> *mappingIDs = selector.selectedMappingIDs;
+  NSMutableArray<GDTCORSegmentedLogEntry *> *candidates = [[NSMutableArray alloc] init];
+  if (eventIDs.count > 0) {
+    for (NSString *eventID in eventIDs) {
+      GDTCORSegmentedLogEntry *entry = log.entries[eventID];
+      if (entry) {
+        [candidates addObject:entry];
+      }
+    }
+  } else {
+    [candidates addObjectsFromArray:log.entries.allValues];
+  }
+
+  NSMutableArray<GDTCORSegmentedLogEntry *> *entries = [[NSMutableArray alloc] init];
+  for (GDTCORSegmentedLogEntry *entry in candidates) {
+    if (entry.batchID != nil ||
+        (qosTiers.count > 0 && ![qosTiers containsObject:@(entry.qosTier)]) ||
+        (mappingIDs.count > 0 && ![mappingIDs containsObject:entry.mappingID])) {
+      continue;
+    }
+    [entries addObject:entry];
+  }
+  // Log order is the order the events were stored in, and reading in it keeps the segment access
+  // sequential.
+  [entries sortUsingComparator:^NSComparisonResult(GDTCORSegmentedLogEntry *entry1,
+                                                   GDTCORSegmentedLogEntry *entry2) {
+    if (entry1.segmentID != entry2.segmentID) {
+      return entry1.segmentID < entry2.segmentID ? NSOrderedAscending : NSOrderedDescending;
+    }
+    if (entry1.offset != entry2.offset) {
+      return entry1.offset < entry2.offset ? NSOrderedAscending : NSOrderedDescending;
+    }
+    return NSOrderedSame;
+  }];
+  return entries;
+}
+
+/** Reads and decodes the event of an entry.
+ *
+ * @param segmentCache Segments mapped by previous reads, keyed by segment ID.
+ */
+- (nullable GDTCOREvent *)readEventForEntry:(GDTCORSegmentedLogEntry *)entry
+                                   ofTarget:(GDTCORSegmentedLogTarget *)log
+                               segmentCache:
+                                   (NSMutableDictionary<NSNumber *, NSData *> *)segmentCache
+                                      error:(NSError **)outError {
+  NSNumber *segmentKey = @(entry.segmentID);
+  NSData *segmentData = segmentCache[segmentKey];
+  if (segmentData == nil) {
+    NSString *path = [[self class] segmentPathForTarget:log.target segmentID:entry.segmentID];
+    segmentData = [NSData dataWithContentsOfFile:path
+                                         options:NSDataReadingMappedIfSafe
+                                           error:outError];
+    if (segmentData == nil) {
+      return nil;
+    }
+    segmentCache[segmentKey] = segmentData;
+  }
+
+  uint8_t type;
+  NSRange bodyRange;
+  NSRange payloadRange;
+  if (!GDTCORReadRecordFrame(segmentData.bytes, segmentData.length, entry.offset, kRecordMagic,
+                             &type, &bodyRange) ||
+      type != GDTCORSegmentRecordTypeEvent ||
+      !GDTCORSegmentEntryFromEventBody((const uint8_t *)segmentData.bytes + bodyRange.location,
+                                       bodyRange.length, &payloadRange)) {
+    *outError = [NSError errorWithDomain:GDTCORSegmentedLogStorageErrorDomain
+                                    code:-1
+                                userInfo:@{
+                                  NSLocalizedFailureReasonErrorKey : @"The event record is corrupt."
+                                }];
+    return nil;
+  }
+  NSRange recordRange =
+      NSMakeRange(bodyRange.location + payloadRange.location, payloadRange.length);
+  NSData *payload = [segmentData subdataWithRange:recordRange];
+  return GDTCORDecodeEventRecord(payload, outError);
+}
+
+/** Appends tombstones for the given entries, removes them from the index and reclaims segments
+ * that no longer contain live events.
+ */
+- (void)removeEntries:(NSArray<GDTCORSegmentedLogEntry *> *)entries
+           fromTarget:(GDTCORSegmentedLogTarget *)log {
+  if (entries.count == 0) {
+    return;
+  }
+  NSMutableData *frames = [[NSMutableData alloc] init];
+  for (GDTCORSegmentedLogEntry *entry in entries) {
+    [frames appendData:GDTCORRecordFrame(kRecordMagic, GDTCORSegmentRecordTypeTombstone,
+                                         GDTCORSegmentTombstoneBody(entry.eventID))];
+  }
+  NSError *error;
+  if (![self appendFrames:frames toTarget:log segmentID:NULL offset:NULL error:&error]) {
+    GDTCORLogDebug(@"Failed to append tombstones, the events may be restored on restart: %@",
+                   error);
+  }
+  for (GDTCORSegmentedLogEntry *entry in entries) {
+    [log removeEntryForEventID:entry.eventID];
+  }
+  [self reclaimSegmentsOfTarget:log];
+}
+
+/** Deletes segments from the head of the log that have no live events. A sparse head segment that
+ * isn't the last one has its live events relocated to the tail so that it can be deleted too.
+ * Segments are only ever deleted from the head so that a tombstone is never lost before the record
+ * it refers to.
+ */
+- (void)reclaimSegmentsOfTarget:(GDTCORSegmentedLogTarget *)log {
+  while (log.segmentIDs.count > 0) {
+    NSNumber *headKey = log.segmentIDs.firstObject;
+    uint64_t headID = headKey.unsignedLongLongValue;
+    uint64_t headSize = log.segmentSizes[headKey].unsignedLongLongValue;
+    if (log.liveCounts[headKey].unsignedLongLongValue == 0) {
+      if (log.activeFileDescriptor >= 0 && log.activeSegmentID == headID) {
+        [self closeActiveSegmentOfTarget:log];
+      }
+      NSString *path = [[self class] segmentPathForTarget:log.target segmentID:headID];
+      NSError *error;
+      if ([[NSFileManager defaultManager] fileExistsAtPath:path] &&
+          ![[NSFileManager defaultManager] removeItemAtPath:path error:&error]) {
+        GDTCORLogDebug(@"Failed to remove segment at path: %@ error: %@", path, error);
+        return;
+      }
+      GDTCORLogDebug(@"Segment reclaimed at path: %@", path);
+      _storageSize -= headSize;
+      [log removeSegment:headID];
+      continue;
+    }
+    if (log.segmentIDs.count > 1 &&
+        log.liveBytes[headKey].unsignedLongLongValue * kCompactionRatio < headSize &&
+        [self relocateEntriesOfSegment:headID ofTarget:log]) {
+      continue;
+    }
+    return;
+  }
+}
+
+/** Copies the live records of a segment to the tail of the log and points the index at them. */
+- (BOOL)relocateEntriesOfSegment:(uint64_t)segmentID ofTarget:(GDTCORSegmentedLogTarget *)log {
+  NSString *path = [[self class] segmentPathForTarget:log.target segmentID:segmentID];
+  NSMutableArray<GDTCORSegmentedLogEntry *> *entries = [[NSMutableArray alloc] init];
+  NSMutableData *frames = [[NSMutableData alloc] init];
+  @autoreleasepool {
+    NSError *error;
+    NSData *segmentData = [NSData dataWithContentsOfFile:path
+                                                 options:NSDataReadingMappedIfSafe
+                                                   error:&error];
+    if (segmentData == nil) {
+      GDTCORLogDebug(@"Failed to read segment for compaction: %@", error);
+      return NO;
+    }
+    for (GDTCORSegmentedLogEntry *entry in log.entries.objectEnumerator) {
+      if (entry.segmentID == segmentID && entry.offset + entry.length <= segmentData.length) {
+        [frames appendBytes:(const uint8_t *)segmentData.bytes + entry.offset length:entry.length];
+        [entries addObject:entry];
+      }
+    }
+  }
+
+  NSError *error;
+  uint64_t newSegmentID;
+  uint64_t offset;
+  if (![self appendFrames:frames
+                 toTarget:log
+                segmentID:&newSegmentID
+                   offset:&offset
+                    error:&error]) {
+    GDTCORLogDebug(@"Failed to relocate events during compaction: %@", error);
+    return NO;
+  }
+  for (GDTCORSegmentedLogEntry *entry in entries) {
+    [log removeEntryForEventID:entry.eventID];
+    entry.segmentID = newSegmentID;
+    entry.offset = offset;
+    offset += entry.length;
+    [log addEntry:entry];
+  }
+  GDTCORLogDebug(@"Relocated %@ events out of segment: %@", @(entries.count), path);
+  return YES;
+}
+
+/** Appends frames to the active segment of the target, starting a new segment if the active one is
+ * full. Frames are never split across segments. A failed write is truncated away so that it can't
+ * hide records appended later.
+ *
+ * @param outSegmentID Populated with the segment the frames were written to.
+ * @param outOffset Populated with the offset of the first frame.
+ */
+- (BOOL)appendFrames:(NSData *)frames
+            toTarget:(GDTCORSegmentedLogTarget *)log
+           segmentID:(nullable uint64_t *)outSegmentID
+              offset:(nullable uint64_t *)outOffset
+               error:(NSError **)outError {
+  if (![self openActiveSegmentOfTarget:log forAppendingLength:frames.length error:outError]) {
+    return NO;
+  }
+  NSNumber *segmentKey = @(log.activeSegmentID);
+  uint64_t offset = log.segmentSizes[segmentKey].unsignedLongLongValue;
+  const uint8_t *bytes = frames.bytes;
+  NSUInteger remaining = frames.length;
+  while (remaining > 0) {
+    ssize_t written = write(log.activeFileDescriptor, bytes, remaining);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      int writeError = errno;
+      if (ftruncate(log.activeFileDescriptor, (off_t)offset) != 0) {
+        GDTCORLogDebug(@"Failed to truncate a partially written frame: %d", errno);
+      }
+      *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:writeError userInfo:nil];
+      return NO;
+    }
+    bytes += written;
+    remaining -= (NSUInteger)written;
+  }
+  log.segmentSizes[segmentKey] = @(offset + frames.length);
+  _storageSize += frames.length;
+  if (outSegmentID) {
+    *outSegmentID = log.activeSegmentID;
+  }
+  if (outOffset) {
+    *outOffset = offset;
+  }
+  return YES;
+}
+
+/** Makes sure the target has an open segment with room for the given number of bytes. */
+- (BOOL)openActiveSegmentOfTarget:(GDTCORSegmentedLogTarget *)log
+               forAppendingLength:(uint64_t)length
+                            error:(NSError **)outError {
+  BOOL (^hasRoom)(NSNumber *) = ^BOOL(NSNumber *segmentKey) {
+    uint64_t size = log.segmentSizes[segmentKey].unsignedLongLongValue;
+    return size == 0 || size + length <= kGDTCORSegmentedLogStorageSegmentSizeLimit;
+  };
+  if (log.activeFileDescriptor >= 0) {
+    if (hasRoom(@(log.activeSegmentID))) {
+      return YES;
+    }
+    [self closeActiveSegmentOfTarget:log];
+  }
+
+  NSNumber *lastSegmentKey = log.segmentIDs.lastObject;
+  uint64_t segmentID = 0;
+  if (lastSegmentKey != nil) {
+    segmentID = lastSegmentKey.unsignedLongLongValue + (hasRoom(lastSegmentKey) ? 0 : 1);
+  }
+  NSString *path = [[self class] segmentPathForTarget:log.target segmentID:segmentID];
+  [[NSFileManager defaultManager] createDirectoryAtPath:[path stringByDeletingLastPathComponent]
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+  int fileDescriptor =
+      open(path.fileSystemRepresentation, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fileDescriptor < 0) {
+    *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+    GDTCORLogDebug(@"Failed to open segment at path: %@ error: %@", path, *outError);
+    return NO;
+  }
+  log.activeFileDescriptor = fileDescriptor;
+  log.activeSegmentID = segmentID;
+  if (lastSegmentKey == nil || lastSegmentKey.unsignedLongLongValue != segmentID) {
+    [log addSegment:segmentID];
+  }
+  return YES;
+}
+
+- (void)closeActiveSegmentOfTarget:(GDTCORSegmentedLogTarget *)log {
+  if (log.activeFileDescriptor >= 0) {
+    close(log.activeFileDescriptor);
+    log.activeFileDescriptor = -1;
+  }
+}
+
+- (uint64_t)fileSizeAtPath:(NSString *)path {
+  NSDictionary<NSFileAttributeKey, id> *attributes =
+      [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil];
+  return [attributes fileSize];
+}
+
+#pragma mark - Private helper methods
+
++ (NSString *)segmentDataStoragePath {
+  static NSString *segmentDataPath;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    segmentDataPath =
+        [NSString stringWithFormat:@"%@/%@/gdt_segment_data", GDTCORRootDirectory().path,
+                                   NSStringFromClass([self class])];
+  });
+  NSError *error;
+  [[NSFileManager defaultManager] createDirectoryAtPath:segmentDataPath
+                            withIntermediateDirectories:YES
+                                             attributes:0
+                                                  error:&error];
+  GDTCORAssert(error == nil, @"Creating the segment data path failed: %@", error);
+  return segmentDataPath;
+}
+
++ (NSString *)libraryDataStoragePath {
+  static NSString *libraryDataPath;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    libraryDataPath =
+        [NSString stringWithFormat:@"%@/%@/gdt_library_data", GDTCORRootDirectory().path,
+                                   NSStringFromClass([self class])];
+  });
+  NSError *error;
+  [[NSFileManager defaultManager] createDirectoryAtPath:libraryDataPath
+                            withIntermediateDirectories:YES
+                                             attributes:0
+                                                  error:&error];
+  GDTCORAssert(error == nil, @"Creating the library data path failed: %@", error);
+  return libraryDataPath;
+}
+
++ (NSString *)segmentPathForTarget:(GDTCORTarget)target segmentID:(uint64_t)segmentID {
+  return [NSString stringWithFormat:@"%@/%ld/%llu.%@", [self segmentDataStoragePath], (long)target,
+                                    segmentID, kSegmentFileExtension];
+}
+
+#pragma mark - GDTCORLifecycleProtocol
+
+- (void)appWillBackground:(GDTCORApplication *)app {
+  dispatch_async(_storageQueue, ^{
+    // Immediately request a background task to run until the end of the current queue of work,
+    // and cancel it once the work is done.
+    __block GDTCORBackgroundIdentifier bgID =
+        [app beginBackgroundTaskWithName:@"GDTStorage"
+                       expirationHandler:^{
+                         [app endBackgroundTask:bgID];
+                         bgID = GDTCORBackgroundIdentifierInvalid;
+                       }];
+    [self syncThreadUnsafeCommitPendingEvents];
+    // Make the appended records durable before the app may be suspended.
+    for (GDTCORSegmentedLogTarget *log in self->_targets.allValues) {
+      if (log.activeFileDescriptor >= 0) {
+        fsync(log.activeFileDescriptor);
+      }
+    }
+    // End the background task if it's still valid.
+    [app endBackgroundTask:bgID];
+    bgID = GDTCORBackgroundIdentifierInvalid;
+  });
+}
+
+- (void)appWillTerminate:(GDTCORApplication *)application {
+  dispatch_sync(_storageQueue, ^{
+    [self syncThreadUnsafeCommitPendingEvents];
+    for (GDTCORSegmentedLogTarget *log in self->_targets.allValues) {
+      if (log.activeFileDescriptor >= 0) {
+        fsync(log.activeFileDescriptor);
+      }
+      [self closeActiveSegmentOfTarget:log];
+    }
+  });
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
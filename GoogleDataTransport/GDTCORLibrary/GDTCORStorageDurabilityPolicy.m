@@ -0,0 +1,67 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageDurabilityPolicy.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@implementation GDTCORStorageDurabilityPolicy {
+  /** The durability of the events of each target. */
+  NSMutableDictionary<NSNumber *, NSNumber *> *_targetDurabilities;
+
+  /** The durability of the events of each QoS tier. */
+  NSMutableDictionary<NSNumber *, NSNumber *> *_qosTierDurabilities;
+}
+
+- (instancetype)init {
+  self = [super init];
+  if (self) {
+    _defaultDurability = GDTCORStorageDurabilityAtomic;
+    _targetDurabilities = [[NSMutableDictionary alloc] init];
+    _qosTierDurabilities = [[NSMutableDictionary alloc] init];
+  }
+  return self;
+}
+
+- (void)setDurability:(GDTCORStorageDurability)durability forTarget:(GDTCORTarget)target {
+  @synchronized(self) {
+    _targetDurabilities[@(target)] = @(durability);
+  }
+}
+
+- (void)setDurability:(GDTCORStorageDurability)durability forQoSTier:(GDTCOREventQoS)qosTier {
+  @synchronized(self) {
+    _qosTierDurabilities[@(qosTier)] = @(durability);
+  }
+}
+
+- (GDTCORStorageDurability)durabilityForEvent:(GDTCOREvent *)event {
+  NSNumber *targetDurability;
+  NSNumber *qosTierDurability;
+  @synchronized(self) {
+    targetDurability = _targetDurabilities[@(event.target)];
+    qosTierDurability = _qosTierDurabilities[@(event.qosTier)];
+  }
+  if (targetDurability == nil && qosTierDurability == nil) {
+    return self.defaultDurability;
+  }
+  return (GDTCORStorageDurability)MAX(targetDurability.integerValue,
+                                      qosTierDurability.integerValue);
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
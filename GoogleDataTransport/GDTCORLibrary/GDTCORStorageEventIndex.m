@@ -0,0 +1,264 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEventIndex.h"
+
+const NSTimeInterval kGDTCORStorageEventIndexExpirationBucketWidth = 60;
+
+/** Returns the expiration bucket of a date. */
+static NSUInteger GDTCORExpirationBucket(NSDate *date) {
+  NSTimeInterval time = MAX(date.timeIntervalSince1970, 0);
+  return (NSUInteger)(time / kGDTCORStorageEventIndexExpirationBucketWidth);
+}
+
+@implementation GDTCORStorageEventIndexEntry
+
+- (instancetype)initWithTarget:(GDTCORTarget)target
+                       eventID:(NSString *)eventID
+                       qosTier:(GDTCOREventQoS)qosTier
+                     mappingID:(NSString *)mappingID
+                expirationDate:(NSDate *)expirationDate
+                          path:(NSString *)path
+                    storedDate:(NSDate *)storedDate
+                          size:(uint64_t)size {
+  self = [super init];
+  if (self) {
+    _target = target;
+    _eventID = [eventID copy];
+    _qosTier = qosTier;
+    _mappingID = [mappingID copy];
+    _expirationDate = expirationDate;
+    _path = [path copy];
+    _storedDate = storedDate;
+    _size = size;
+  }
+  return self;
+}
+
+@end
+
+/** The indexed events of a single target. */
+@interface GDTCORStorageTargetEventIndex : NSObject
+
+/** The entries keyed by event ID. */
+@property(nonatomic, readonly)
+    NSMutableDictionary<NSString *, GDTCORStorageEventIndexEntry *> *entriesByEventID;
+
+/** The event IDs keyed by QoS tier. */
+@property(nonatomic, readonly)
+    NSMutableDictionary<NSNumber *, NSMutableSet<NSString *> *> *eventIDsByQoSTier;
+
+/** The event IDs keyed by mapping ID. */
+@property(nonatomic, readonly)
+    NSMutableDictionary<NSString *, NSMutableSet<NSString *> *> *eventIDsByMappingID;
+
+/** The event IDs keyed by expiration bucket. */
+@property(nonatomic, readonly)
+    NSMutableDictionary<NSNumber *, NSMutableSet<NSString *> *> *eventIDsByExpirationBucket;
+
+/** The expiration buckets that contain events, in ascending order. */
+@property(nonatomic, readonly) NSMutableIndexSet *expirationBuckets;
+
+@end
+
+@implementation GDTCORStorageTargetEventIndex
+
+- (instancetype)init {
+  self = [super init];
+  if (self) {
+    _entriesByEventID = [[NSMutableDictionary alloc] init];
+    _eventIDsByQoSTier = [[NSMutableDictionary alloc] init];
+    _eventIDsByMappingID = [[NSMutableDictionary alloc] init];
+    _eventIDsByExpirationBucket = [[NSMutableDictionary alloc] init];
+    _expirationBuckets = [[NSMutableIndexSet alloc] init];
+  }
+  return self;
+}
+
+@end
+
+@implementation GDTCORStorageEventIndex {
+  /** The per-target indexes keyed by target. */
+  NSMutableDictionary<NSNumber *, GDTCORStorageTargetEventIndex *> *_targetIndexes;
+
+  /** The targets whose index has been populated. */
+  NSMutableSet<NSNumber *> *_loadedTargets;
+}
+
+- (instancetype)init {
+  self = [super init];
+  if (self) {
+    _targetIndexes = [[NSMutableDictionary alloc] init];
+    _loadedTargets = [[NSMutableSet alloc] init];
+  }
+  return self;
+}
+
+- (BOOL)isTargetLoaded:(GDTCORTarget)target {
+  return [_loadedTargets containsObject:@(target)];
+}
+
+- (void)markTargetLoaded:(GDTCORTarget)target {
+  [_loadedTargets addObject:@(target)];
+}
+
+- (void)addEntry:(GDTCORStorageEventIndexEntry *)entry {
+  [self removeEntryWithEventID:entry.eventID target:entry.target];
+
+  GDTCORStorageTargetEventIndex *targetIndex = _targetIndexes[@(entry.target)];
+  if (targetIndex == nil) {
+    targetIndex = [[GDTCORStorageTargetEventIndex alloc] init];
+    _targetIndexes[@(entry.target)] = targetIndex;
+  }
+  targetIndex.entriesByEventID[entry.eventID] = entry;
+
+  NSMutableSet<NSString *> *qosTierEventIDs = targetIndex.eventIDsByQoSTier[@(entry.qosTier)];
+  if (qosTierEventIDs == nil) {
+    qosTierEventIDs = [[NSMutableSet alloc] init];
+    targetIndex.eventIDsByQoSTier[@(entry.qosTier)] = qosTierEventIDs;
+  }
+  [qosTierEventIDs addObject:entry.eventID];
+
+  NSMutableSet<NSString *> *mappingIDEventIDs = targetIndex.eventIDsByMappingID[entry.mappingID];
+  if (mappingIDEventIDs == nil) {
+    mappingIDEventIDs = [[NSMutableSet alloc] init];
+    targetIndex.eventIDsByMappingID[entry.mappingID] = mappingIDEventIDs;
+  }
+  [mappingIDEventIDs addObject:entry.eventID];
+
+  NSUInteger bucket = GDTCORExpirationBucket(entry.expirationDate);
+  NSMutableSet<NSString *> *bucketEventIDs = targetIndex.eventIDsByExpirationBucket[@(bucket)];
+  if (bucketEventIDs == nil) {
+    bucketEventIDs = [[NSMutableSet alloc] init];
+    targetIndex.eventIDsByExpirationBucket[@(bucket)] = bucketEventIDs;
+    [targetIndex.expirationBuckets addIndex:bucket];
+  }
+  [bucketEventIDs addObject:entry.eventID];
+}
+
+- (nullable GDTCORStorageEventIndexEntry *)removeEntryWithEventID:(NSString *)eventID
+                                                           target:(GDTCORTarget)target {
+  GDTCORStorageTargetEventIndex *targetIndex = _targetIndexes[@(target)];
+  GDTCORStorageEventIndexEntry *entry = targetIndex.entriesByEventID[eventID];
+  if (entry == nil) {
+    return nil;
+  }
+  [targetIndex.entriesByEventID removeObjectForKey:eventID];
+
+  NSMutableSet<NSString *> *qosTierEventIDs = targetIndex.eventIDsByQoSTier[@(entry.qosTier)];
+  [qosTierEventIDs removeObject:eventID];
+  if (qosTierEventIDs.count == 0) {
+    [targetIndex.eventIDsByQoSTier removeObjectForKey:@(entry.qosTier)];
+  }
+
+  NSMutableSet<NSString *> *mappingIDEventIDs = targetIndex.eventIDsByMappingID[entry.mappingID];
+  [mappingIDEventIDs removeObject:eventID];
+  if (mappingIDEventIDs.count == 0) {
+    [targetIndex.eventIDsByMappingID removeObjectForKey:entry.mappingID];
+  }
+
+  NSUInteger bucket = GDTCORExpirationBucket(entry.expirationDate);
+  NSMutableSet<NSString *> *bucketEventIDs = targetIndex.eventIDsByExpirationBucket[@(bucket)];
+  [bucketEventIDs removeObject:eventID];
+  if (bucketEventIDs.count == 0) {
+    [targetIndex.eventIDsByExpirationBucket removeObjectForKey:@(bucket)];
+    [targetIndex.expirationBuckets removeIndex:bucket];
+  }
+  return entry;
+}
+
+- (NSUInteger)countForTarget:(GDTCORTarget)target {
+  return _targetIndexes[@(target)].entriesByEventID.count;
+}
+
+- (NSArray<GDTCORStorageEventIndexEntry *> *)
+    entriesForTarget:(GDTCORTarget)target
+            eventIDs:(nullable NSSet<NSString *> *)eventIDs
+            qosTiers:(nullable NSSet<NSNumber *> *)qosTiers
+          mappingIDs:(nullable NSSet<NSString *> *)mappingIDs {
+  GDTCORStorageTargetEventIndex *targetIndex = _targetIndexes[@(target)];
+  if (targetIndex == nil) {
+    return @[];
+  }
+
+  // Start from the smallest set of candidates any of the keys narrows the search down to.
+  NSSet<NSString *> *candidates = eventIDs.count > 0 ? eventIDs : nil;
+  if (candidates == nil && qosTiers.count > 0) {
+    candidates = [self unionOfEventIDsForKeys:qosTiers inDictionary:targetIndex.eventIDsByQoSTier];
+  }
+  if (mappingIDs.count > 0) {
+    NSSet<NSString *> *mappingIDCandidates =
+        [self unionOfEventIDsForKeys:mappingIDs inDictionary:targetIndex.eventIDsByMappingID];
+    if (candidates == nil || mappingIDCandidates.count < candidates.count) {
+      candidates = mappingIDCandidates;
+    }
+  }
+
+  NSMutableArray<GDTCORStorageEventIndexEntry *> *entries = [[NSMutableArray alloc] init];
+  id<NSFastEnumeration> enumerated =
+      candidates ? (id<NSFastEnumeration>)candidates : targetIndex.entriesByEventID.allKeys;
+  for (NSString *eventID in enumerated) {
+    GDTCORStorageEventIndexEntry *entry = targetIndex.entriesByEventID[eventID];
+    if (entry == nil || (eventIDs.count > 0 && ![eventIDs containsObject:eventID]) ||
+        (qosTiers.count > 0 && ![qosTiers containsObject:@(entry.qosTier)]) ||
+        (mappingIDs.count > 0 && ![mappingIDs containsObject:entry.mappingID])) {
+      continue;
+    }
+    [entries addObject:entry];
+  }
+  return entries;
+}
+
+- (NSArray<GDTCORStorageEventIndexEntry *> *)entriesExpiredBeforeDate:(NSDate *)date {
+  NSMutableArray<GDTCORStorageEventIndexEntry *> *entries = [[NSMutableArray alloc] init];
+  NSUInteger currentBucket = GDTCORExpirationBucket(date);
+  for (GDTCORStorageTargetEventIndex *targetIndex in _targetIndexes.allValues) {
+    // Only the buckets up to the current one are visited. All events of the earlier buckets have
+    // expired, while the current bucket may hold events that expire later on.
+    NSUInteger bucket = targetIndex.expirationBuckets.firstIndex;
+    while (bucket != NSNotFound && bucket <= currentBucket) {
+      for (NSString *eventID in targetIndex.eventIDsByExpirationBucket[@(bucket)]) {
+        GDTCORStorageEventIndexEntry *entry = targetIndex.entriesByEventID[eventID];
+        if ([entry.expirationDate compare:date] == NSOrderedAscending) {
+          [entries addObject:entry];
+        }
+      }
+      bucket = [targetIndex.expirationBuckets indexGreaterThanIndex:bucket];
+    }
+  }
+  return entries;
+}
+
+- (void)removeAllEntries {
+  [_targetIndexes removeAllObjects];
+  [_loadedTargets removeAllObjects];
+}
+
+#pragma mark - Private helper methods
+
+- (NSSet<NSString *> *)unionOfEventIDsForKeys:(NSSet *)keys
+                                 inDictionary:(NSDictionary<id, NSSet<NSString *> *> *)dictionary {
+  NSMutableSet<NSString *> *eventIDs = [[NSMutableSet alloc] init];
+  for (id key in keys) {
+    NSSet<NSString *> *keyEventIDs = dictionary[key];
+    if (keyEventIDs) {
+      [eventIDs unionSet:keyEventIDs];
+    }
+  }
+  return eventIDs;
+}
+
+@end
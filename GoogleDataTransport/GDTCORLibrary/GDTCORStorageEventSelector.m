@@ -16,6 +16,23 @@
 
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEventSelector.h"
 
+NSInteger GDTCORQoSTierPriorityRank(GDTCOREventQoS qosTier) {
+  switch (qosTier) {
+    case GDTCOREventQoSFast:
+      return 0;
+    case GDTCOREventQosDefault:
+      return 1;
+    case GDTCOREventQoSWifiOnly:
+      return 2;
+    case GDTCOREventQoSDaily:
+      return 3;
+    case GDTCOREventQoSTelemetry:
+      return 4;
+    default:
+      return 5;
+  }
+}
+
 @implementation GDTCORStorageEventSelector
 
 + (instancetype)eventSelectorForTarget:(GDTCORTarget)target {
@@ -26,14 +43,75 @@
                       eventIDs:(nullable NSSet<NSString *> *)eventIDs
                     mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
                       qosTiers:(nullable NSSet<NSNumber *> *)qosTiers {
+  return [self initWithTarget:target
+                     eventIDs:eventIDs
+                   mappingIDs:mappingIDs
+                     qosTiers:qosTiers
+                maxEventCount:0
+            maxBatchSizeBytes:0
+                        order:GDTCORStorageEventSelectorOrderOldestFirst];
+}
+
+- (instancetype)initWithTarget:(GDTCORTarget)target
+                      eventIDs:(nullable NSSet<NSString *> *)eventIDs
+                    mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
+                      qosTiers:(nullable NSSet<NSNumber *> *)qosTiers
+                 maxEventCount:(NSUInteger)maxEventCount
+             maxBatchSizeBytes:(uint64_t)maxBatchSizeBytes
+                         order:(GDTCORStorageEventSelectorOrder)order {
   self = [super init];
   if (self) {
     _selectedTarget = target;
     _selectedEventIDs = eventIDs;
     _selectedMappingIDs = mappingIDs;
     _selectedQosTiers = qosTiers;
+    _maxEventCount = maxEventCount;
+    _maxBatchSizeBytes = maxBatchSizeBytes;
+    _order = order;
   }
   return self;
 }
 
+- (BOOL)isBounded {
+  return _maxEventCount > 0 || _maxBatchSizeBytes > 0;
+}
+
+- (NSArray *)selectCandidates:(NSArray *)candidates
+                      qosTier:(GDTCOREventQoS (^)(id candidate))qosTier
+                         size:(uint64_t (^)(id candidate))size {
+  NSArray *orderedCandidates = candidates;
+  if (_order == GDTCORStorageEventSelectorOrderPriorityFirst) {
+    // The sort is stable, so candidates of the same tier stay oldest first.
+    orderedCandidates = [candidates
+        sortedArrayWithOptions:NSSortStable
+               usingComparator:^NSComparisonResult(id candidate1, id candidate2) {
+                 NSInteger rank1 = GDTCORQoSTierPriorityRank(qosTier(candidate1));
+                 NSInteger rank2 = GDTCORQoSTierPriorityRank(qosTier(candidate2));
+                 if (rank1 == rank2) {
+                   return NSOrderedSame;
+                 }
+                 return rank1 < rank2 ? NSOrderedAscending : NSOrderedDescending;
+               }];
+  }
+  if (![self isBounded]) {
+    return orderedCandidates;
+  }
+
+  NSMutableArray *selected = [[NSMutableArray alloc] init];
+  uint64_t selectedBytes = 0;
+  for (id candidate in orderedCandidates) {
+    if (_maxEventCount > 0 && selected.count >= _maxEventCount) {
+      break;
+    }
+    uint64_t candidateSize = size(candidate);
+    if (_maxBatchSizeBytes > 0 && selected.count > 0 &&
+        selectedBytes + candidateSize > _maxBatchSizeBytes) {
+      break;
+    }
+    [selected addObject:candidate];
+    selectedBytes += candidateSize;
+  }
+  return selected;
+}
+
 @end
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEvictionPolicy.h"
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEventSelector.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Orders candidates by the time they were stored, earliest first. */
+static NSComparisonResult GDTCORCompareStoredDates(GDTCORStorageEvictionCandidate *candidate1,
+                                                   GDTCORStorageEvictionCandidate *candidate2) {
+  return [candidate1.storedDate compare:candidate2.storedDate];
+}
+
+@implementation GDTCORStorageEvictionCandidate
+
+- (instancetype)initWithTarget:(GDTCORTarget)target
+                       eventID:(NSString *)eventID
+                       qosTier:(GDTCOREventQoS)qosTier
+                     mappingID:(NSString *)mappingID
+                    storedDate:(NSDate *)storedDate
+                          size:(uint64_t)size {
+  self = [super init];
+  if (self) {
+    _target = target;
+    _eventID = [eventID copy];
+    _qosTier = qosTier;
+    _mappingID = [mappingID copy];
+    _storedDate = storedDate;
+    _size = size;
+  }
+  return self;
+}
+
+@end
+
+@implementation GDTCOROldestFirstEvictionPolicy
+
+- (NSArray<GDTCORStorageEvictionCandidate *> *)
+    candidatesToEvictFromCandidates:(NSArray<GDTCORStorageEvictionCandidate *> *)candidates
+                           forEvent:(GDTCOREvent *)event {
+  return [candidates sortedArrayUsingComparator:^NSComparisonResult(
+                         GDTCORStorageEvictionCandidate *candidate1,
+                         GDTCORStorageEvictionCandidate *candidate2) {
+    return GDTCORCompareStoredDates(candidate1, candidate2);
+  }];
+}
+
+@end
+
+@implementation GDTCORLowestQoSFirstEvictionPolicy
+
+- (NSArray<GDTCORStorageEvictionCandidate *> *)
+    candidatesToEvictFromCandidates:(NSArray<GDTCORStorageEvictionCandidate *> *)candidates
+                           forEvent:(GDTCOREvent *)event {
+  NSInteger eventRank = GDTCORQoSTierPriorityRank(event.qosTier);
+  NSMutableArray<GDTCORStorageEvictionCandidate *> *evictable = [[NSMutableArray alloc] init];
+  for (GDTCORStorageEvictionCandidate *candidate in candidates) {
+    if (GDTCORQoSTierPriorityRank(candidate.qosTier) >= eventRank) {
+      [evictable addObject:candidate];
+    }
+  }
+  [evictable sortUsingComparator:^NSComparisonResult(GDTCORStorageEvictionCandidate *candidate1,
+                                                     GDTCORStorageEvictionCandidate *candidate2) {
+    NSInteger rank1 = GDTCORQoSTierPriorityRank(candidate1.qosTier);
+    NSInteger rank2 = GDTCORQoSTierPriorityRank(candidate2.qosTier);
+    if (rank1 != rank2) {
+      return rank1 > rank2 ? NSOrderedAscending : NSOrderedDescending;
+    }
+    return GDTCORCompareStoredDates(candidate1, candidate2);
+  }];
+  return evictable;
+}
+
+@end
+
+@implementation GDTCORLargestLogSourceFirstEvictionPolicy
+
+- (NSArray<GDTCORStorageEvictionCandidate *> *)
+    candidatesToEvictFromCandidates:(NSArray<GDTCORStorageEvictionCandidate *> *)candidates
+                           forEvent:(GDTCOREvent *)event {
+  NSMutableDictionary<NSString *, NSNumber *> *sizeByMappingID = [[NSMutableDictionary alloc] init];
+  for (GDTCORStorageEvictionCandidate *candidate in candidates) {
+    uint64_t size = sizeByMappingID[candidate.mappingID].unsignedLongLongValue;
+    sizeByMappingID[candidate.mappingID] = @(size + candidate.size);
+  }
+  return [candidates sortedArrayUsingComparator:^NSComparisonResult(
+                         GDTCORStorageEvictionCandidate *candidate1,
+                         GDTCORStorageEvictionCandidate *candidate2) {
+    if (![candidate1.mappingID isEqualToString:candidate2.mappingID]) {
+      uint64_t size1 = sizeByMappingID[candidate1.mappingID].unsignedLongLongValue;
+      uint64_t size2 = sizeByMappingID[candidate2.mappingID].unsignedLongLongValue;
+      if (size1 != size2) {
+        return size1 > size2 ? NSOrderedAscending : NSOrderedDescending;
+      }
+      // Keep the events of a mapping ID together when two mapping IDs take the same storage.
+      return [candidate1.mappingID compare:candidate2.mappingID];
+    }
+    return GDTCORCompareStoredDates(candidate1, candidate2);
+  }];
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
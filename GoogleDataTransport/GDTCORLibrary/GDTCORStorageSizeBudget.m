@@ -0,0 +1,61 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageSizeBudget.h"
+
+#import <stdatomic.h>
+
+@implementation GDTCORStorageSizeBudget {
+  /** The total size. */
+  _Atomic(uint64_t) _totalSize;
+}
+
+- (instancetype)initWithLimit:(GDTCORStorageSizeBytes)limit {
+  self = [super init];
+  if (self) {
+    _limit = limit;
+    atomic_init(&_totalSize, 0);
+  }
+  return self;
+}
+
+- (GDTCORStorageSizeBytes)totalSize {
+  return atomic_load(&_totalSize);
+}
+
+- (BOOL)reserveSize:(GDTCORStorageSizeBytes)size {
+  uint64_t totalSize = atomic_load(&_totalSize);
+  do {
+    if (size > _limit || totalSize > _limit - size) {
+      return NO;
+    }
+  } while (!atomic_compare_exchange_weak(&_totalSize, &totalSize, totalSize + size));
+  return YES;
+}
+
+- (void)addSize:(GDTCORStorageSizeBytes)size {
+  atomic_fetch_add(&_totalSize, size);
+}
+
+- (void)removeSize:(GDTCORStorageSizeBytes)size {
+  uint64_t totalSize = atomic_load(&_totalSize);
+  uint64_t newTotalSize;
+  do {
+    newTotalSize = totalSize > size ? totalSize - size : 0;
+  } while (!atomic_compare_exchange_weak(&_totalSize, &totalSize, newTotalSize));
+}
+
+@end
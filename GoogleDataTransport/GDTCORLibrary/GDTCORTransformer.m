@@ -57,6 +57,88 @@
             onComplete:(void (^_Nullable)(BOOL wasWritten, NSError *_Nullable error))completion {
   GDTCORAssert(event, @"You can't write a nil event");
 
+  dispatch_block_t endBackgroundTask = [self beginBackgroundTask];
+  __auto_type completionWrapper = ^(BOOL wasWritten, NSError *_Nullable error) {
+    if (completion) {
+      completion(wasWritten, error);
+    }
+    endBackgroundTask();
+  };
+
+  dispatch_async(_eventWritingQueue, ^{
+    GDTCOREvent *transformedEvent = [self applyTransformers:transformers toEvent:event];
+    if (!transformedEvent) {
+      completionWrapper(NO, nil);
+      return;
+    }
+
+    id<GDTCORStorageProtocol> storage =
+        [GDTCORRegistrar sharedInstance].targetToStorage[@(event.target)];
+
+    [storage storeEvent:transformedEvent onComplete:completionWrapper];
+  });
+}
+
+- (void)transformEvents:(NSArray<GDTCOREvent *> *)events
+       withTransformers:(NSArray<id<GDTCOREventTransformer>> *)transformers
+             onComplete:(void (^_Nullable)(NSUInteger writtenEventCount,
+                                           NSError *_Nullable error))completion {
+  GDTCORAssert(events, @"You can't write nil events");
+
+  dispatch_block_t endBackgroundTask = [self beginBackgroundTask];
+  dispatch_async(_eventWritingQueue, ^{
+    // Group the transformed events by target, as each target has its own storage.
+    NSMutableDictionary<NSNumber *, NSMutableArray<GDTCOREvent *> *> *targetToEvents =
+        [[NSMutableDictionary alloc] init];
+    for (GDTCOREvent *event in events) {
+      GDTCOREvent *transformedEvent = [self applyTransformers:transformers toEvent:event];
+      if (!transformedEvent) {
+        continue;
+      }
+      NSMutableArray<GDTCOREvent *> *targetEvents = targetToEvents[@(event.target)];
+      if (targetEvents == nil) {
+        targetEvents = [[NSMutableArray alloc] init];
+        targetToEvents[@(event.target)] = targetEvents;
+      }
+      [targetEvents addObject:transformedEvent];
+    }
+
+    // The counters are only accessed on the transformer queue.
+    __block NSUInteger writtenEventCount = 0;
+    __block NSError *lastError;
+    dispatch_group_t group = dispatch_group_create();
+    [targetToEvents enumerateKeysAndObjectsUsingBlock:^(NSNumber *target,
+                                                        NSArray<GDTCOREvent *> *targetEvents,
+                                                        BOOL *stop) {
+      id<GDTCORStorageProtocol> storage =
+          [GDTCORRegistrar sharedInstance].targetToStorage[target];
+      [self storeEvents:targetEvents
+              inStorage:storage
+                  group:group
+             onComplete:^(NSUInteger storedEventCount, NSError *_Nullable error) {
+               dispatch_async(self->_eventWritingQueue, ^{
+                 writtenEventCount += storedEventCount;
+                 lastError = error ?: lastError;
+               });
+             }];
+    }];
+
+    dispatch_group_notify(group, self->_eventWritingQueue, ^{
+      if (completion) {
+        completion(writtenEventCount, lastError);
+      }
+      endBackgroundTask();
+    });
+  });
+}
+
+#pragma mark - Private helper methods
+
+/** Begins a background task for the work of the transformer.
+ *
+ * @return A block ending the background task, to be called once the work is done.
+ */
+- (dispatch_block_t)beginBackgroundTask {
   __block GDTCORBackgroundIdentifier bgID = GDTCORBackgroundIdentifierInvalid;
   __auto_type __weak weakApplication = self.application;
   bgID = [self.application beginBackgroundTaskWithName:@"GDTTransformer"
@@ -64,12 +146,7 @@
                                        [weakApplication endBackgroundTask:bgID];
                                        bgID = GDTCORBackgroundIdentifierInvalid;
                                      }];
-
-  __auto_type completionWrapper = ^(BOOL wasWritten, NSError *_Nullable error) {
-    if (completion) {
-      completion(wasWritten, error);
-    }
-
+  return ^{
     if (bgID != GDTCORBackgroundIdentifierInvalid) {
       // The work is done, cancel the background task if it's valid.
       [weakApplication endBackgroundTask:bgID];
@@ -79,30 +156,60 @@
     }
     bgID = GDTCORBackgroundIdentifierInvalid;
   };
+}
 
-  dispatch_async(_eventWritingQueue, ^{
-    GDTCOREvent *transformedEvent = event;
-    for (id<GDTCOREventTransformer> transformer in transformers) {
-      if ([transformer respondsToSelector:@selector(transformGDTEvent:)]) {
-        GDTCORLogDebug(@"Applying a transformer to event %@", event);
-        transformedEvent = [transformer transformGDTEvent:event];
-        if (!transformedEvent) {
-          completionWrapper(NO, nil);
-          return;
-        }
-      } else {
-        GDTCORLogError(GDTCORMCETransformerDoesntImplementTransform,
-                       @"Transformer doesn't implement transformGDTEvent: %@", transformer);
-        completionWrapper(NO, nil);
-        return;
+/** Applies the transformers to the event. Must be called on the transformer queue.
+ *
+ * @return The transformed event, or nil if the event was dropped.
+ */
+- (nullable GDTCOREvent *)applyTransformers:(NSArray<id<GDTCOREventTransformer>> *)transformers
+                                    toEvent:(GDTCOREvent *)event {
+  GDTCOREvent *transformedEvent = event;
+  for (id<GDTCOREventTransformer> transformer in transformers) {
+    if ([transformer respondsToSelector:@selector(transformGDTEvent:)]) {
+      GDTCORLogDebug(@"Applying a transformer to event %@", event);
+      transformedEvent = [transformer transformGDTEvent:event];
+      if (!transformedEvent) {
+        return nil;
       }
+    } else {
+      GDTCORLogError(GDTCORMCETransformerDoesntImplementTransform,
+                     @"Transformer doesn't implement transformGDTEvent: %@", transformer);
+      return nil;
     }
+  }
+  return transformedEvent;
+}
 
-    id<GDTCORStorageProtocol> storage =
-        [GDTCORRegistrar sharedInstance].targetToStorage[@(event.target)];
-
-    [storage storeEvent:transformedEvent onComplete:completionWrapper];
-  });
+/** Stores the events in the storage, in bulk if the storage supports it. The group is entered
+ * until the completion has been called. The events are dropped if there's no storage.
+ */
+- (void)storeEvents:(NSArray<GDTCOREvent *> *)events
+          inStorage:(nullable id<GDTCORStorageProtocol>)storage
+              group:(dispatch_group_t)group
+         onComplete:(void (^)(NSUInteger storedEventCount, NSError *_Nullable error))onComplete {
+  if (storage == nil) {
+    GDTCORLogDebug(@"No storage is registered for the target of %lu events.",
+                   (unsigned long)events.count);
+    return;
+  }
+  if ([storage respondsToSelector:@selector(storeEvents:onComplete:)]) {
+    dispatch_group_enter(group);
+    [storage storeEvents:events
+              onComplete:^(NSUInteger storedEventCount, NSError *_Nullable error) {
+                onComplete(storedEventCount, error);
+                dispatch_group_leave(group);
+              }];
+    return;
+  }
+  for (GDTCOREvent *event in events) {
+    dispatch_group_enter(group);
+    [storage storeEvent:event
+             onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+               onComplete(wasWritten ? 1 : 0, error);
+               dispatch_group_leave(group);
+             }];
+  }
 }
 
 @end
@@ -67,6 +67,24 @@
   [self sendDataEvent:event onComplete:nil];
 }
 
+- (void)sendTelemetryEvents:(NSArray<GDTCOREvent *> *)events
+                 onComplete:(void (^_Nullable)(NSUInteger writtenEventCount,
+                                               NSError *_Nullable error))completion {
+  for (GDTCOREvent *event in events) {
+    event.qosTier = GDTCOREventQoSTelemetry;
+  }
+  [self sendEvents:events onComplete:completion];
+}
+
+- (void)sendDataEvents:(NSArray<GDTCOREvent *> *)events
+            onComplete:(void (^_Nullable)(NSUInteger writtenEventCount,
+                                          NSError *_Nullable error))completion {
+  for (GDTCOREvent *event in events) {
+    GDTCORAssert(event.qosTier != GDTCOREventQoSTelemetry, @"Use -sendTelemetryEvents, please.");
+  }
+  [self sendEvents:events onComplete:completion];
+}
+
 - (GDTCOREvent *)eventForTransport {
   return [[GDTCOREvent alloc] initWithMappingID:_mappingID target:_target];
 }
@@ -93,6 +111,29 @@
                                 onComplete:completion];
 }
 
+/** Sends the given events through the transport pipeline together. All the events share the same
+ * clock snapshot, taken when they're sent.
+ *
+ * @param events The events to send.
+ * @param completion A block that will be called when all the events have been written or dropped.
+ */
+- (void)sendEvents:(NSArray<GDTCOREvent *> *)events
+        onComplete:(void (^_Nullable)(NSUInteger writtenEventCount,
+                                      NSError *_Nullable error))completion {
+  GDTCORAssert(events, @"You can't send nil events");
+  GDTCORClock *clockSnapshot = [GDTCORClock snapshot];
+  NSMutableArray<GDTCOREvent *> *copiedEvents =
+      [[NSMutableArray alloc] initWithCapacity:events.count];
+  for (GDTCOREvent *event in events) {
+    GDTCOREvent *copiedEvent = [event copy];
+    copiedEvent.clockSnapshot = clockSnapshot;
+    [copiedEvents addObject:copiedEvent];
+  }
+  [self.transformerInstance transformEvents:copiedEvents
+                           withTransformers:_transformers
+                                 onComplete:completion];
+}
+
 #pragma mark - Force Category Linking
 
 extern void GDTCORInclude_GDTCORLogSourceMetrics_Internal_Category(void);
@@ -16,15 +16,85 @@
 
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORUploadBatch.h"
 
-@implementation GDTCORUploadBatch
+NS_ASSUME_NONNULL_BEGIN
+
+@implementation GDTCORUploadBatch {
+  /** The source of the events read on demand, if any. */
+  id<GDTCORUploadBatchEventSource> _Nullable _eventSource;
+
+  /** The events held in memory, in addition to the ones of the event source. */
+  NSSet<GDTCOREvent *> *_inMemoryEvents;
+}
 
 - (instancetype)initWithBatchID:(NSNumber *)batchID events:(NSSet<GDTCOREvent *> *)events {
+  return [self initWithBatchID:batchID eventSource:nil inMemoryEvents:events requestBody:nil];
+}
+
+- (instancetype)initWithBatchID:(NSNumber *)batchID
+                    eventSource:(id<GDTCORUploadBatchEventSource>)eventSource {
+  return [self initWithBatchID:batchID
+                   eventSource:eventSource
+                inMemoryEvents:[NSSet set]
+                   requestBody:nil];
+}
+
+- (instancetype)initWithBatchID:(NSNumber *)batchID
+                    eventSource:(nullable id<GDTCORUploadBatchEventSource>)eventSource
+                 inMemoryEvents:(NSSet<GDTCOREvent *> *)inMemoryEvents
+                    requestBody:(nullable NSData *)requestBody {
   self = [super init];
   if (self) {
     _batchID = batchID;
-    _events = events;
+    _eventSource = eventSource;
+    _inMemoryEvents = inMemoryEvents;
+    _requestBody = [requestBody copy];
   }
   return self;
 }
 
+- (NSSet<GDTCOREvent *> *)events {
+  if (_eventSource == nil) {
+    return _inMemoryEvents;
+  }
+  NSMutableSet<GDTCOREvent *> *events = [[NSMutableSet alloc] initWithCapacity:self.eventCount];
+  [self enumerateEventsUsingBlock:^(GDTCOREvent *_Nonnull event, BOOL *_Nonnull stop) {
+    [events addObject:event];
+  }];
+  return events;
+}
+
+- (NSUInteger)eventCount {
+  return _eventSource.eventCount + _inMemoryEvents.count;
+}
+
+- (void)enumerateEventsUsingBlock:(void (^)(GDTCOREvent *event, BOOL *stop))block {
+  __block BOOL stop = NO;
+  [_eventSource enumerateEventsUsingBlock:^(GDTCOREvent *_Nonnull event, BOOL *_Nonnull stopPtr) {
+    block(event, &stop);
+    *stopPtr = stop;
+  }];
+  for (GDTCOREvent *event in _inMemoryEvents) {
+    if (stop) {
+      break;
+    }
+    block(event, &stop);
+  }
+}
+
+- (GDTCORUploadBatch *)batchByAddingEvent:(GDTCOREvent *)event {
+  return [[GDTCORUploadBatch alloc] initWithBatchID:_batchID
+                                        eventSource:_eventSource
+                                     inMemoryEvents:[_inMemoryEvents setByAddingObject:event]
+                                        requestBody:nil];
+}
+
+- (GDTCORUploadBatch *)batchWithRequestBody:(NSData *)requestBody {
+  return [[GDTCORUploadBatch alloc] initWithBatchID:_batchID
+                                        eventSource:_eventSource
+                                     inMemoryEvents:_inMemoryEvents
+                                        requestBody:requestBody];
+}
+
 @end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class GDTCORLibraryDataStore;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** The number of batch IDs reserved by each write of the high-water mark. */
+FOUNDATION_EXPORT const int64_t kGDTCORBatchIDAllocatorBlockSize;
+
+/** Allocates unique 64-bit batch IDs from memory. IDs are reserved in blocks, and only the end of
+ * the reserved range (the high-water mark) is persisted, so the library data store is written and
+ * synced once per block rather than once per batch. After a restart the allocation continues from
+ * the persisted high-water mark, skipping the IDs that were reserved but not used, which keeps the
+ * IDs unique across launches.
+ * This is an internal class designed to be used by `GDTCORFlatFileStorage`.
+ * NOTE: The class is not thread-safe. The client must take care of synchronization.
+ */
+@interface GDTCORBatchIDAllocator : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Instantiates an allocator.
+ *
+ * @param store The library data store persisting the high-water mark.
+ * @param key The key of the high-water mark. A value containing the 32-bit counter written by
+ * previous versions is read as a high-water mark.
+ * @param blockSize The number of IDs to reserve by each write.
+ */
+- (instancetype)initWithLibraryDataStore:(GDTCORLibraryDataStore *)store
+                                     key:(NSString *)key
+                               blockSize:(int64_t)blockSize NS_DESIGNATED_INITIALIZER;
+
+/** Returns the next batch ID, or nil if a new block of IDs was needed but couldn't be persisted. */
+- (nullable NSNumber *)nextBatchID;
+
+/** Discards the reserved IDs, so that the next ID is allocated from the persisted high-water mark.
+ */
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORTargets.h"
+
+@class GDTCORDirectorySizeTracker;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** A batch recorded in the batch journal. */
+@interface GDTCORBatchJournalBatch : NSObject
+
+/** The ID of the batch. */
+@property(nonatomic, readonly) NSNumber *batchID;
+
+/** The target of the batched events. */
+@property(nonatomic, readonly) GDTCORTarget target;
+
+/** The expiration date of the batch. */
+@property(nonatomic, readonly) NSDate *expirationDate;
+
+/** The file names of the batched events, which stay in the event data directory of the target. */
+@property(nonatomic, readonly) NSArray<NSString *> *eventFilenames;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Instantiates a batch. */
+- (instancetype)initWithBatchID:(NSNumber *)batchID
+                         target:(GDTCORTarget)target
+                 expirationDate:(NSDate *)expirationDate
+                 eventFilenames:(NSArray<NSString *> *)eventFilenames NS_DESIGNATED_INITIALIZER;
+
+@end
+
+/** A write-ahead journal of batch state. Creating, committing (the events were uploaded and are to
+ * be deleted) and aborting (the events are returned to the storage) a batch each append a single
+ * checksummed record that is synced to disk before the client acts on it, so a batch is either
+ * fully formed or not formed at all after a crash. The events are never moved; the journal only
+ * records which event files belong to which batch.
+ *
+ * The journal is replayed by `-load`. A torn record at the end, left by a crash during an append,
+ * is discarded. The journal is compacted to the records of the open batches on load, emptied once
+ * no batch is open, and rewritten when mostly made of records of closed batches.
+ * This is an internal class designed to be used by `GDTCORFlatFileStorage`.
+ * NOTE: The class is not thread-safe. The client must take care of synchronization.
+ */
+@interface GDTCORBatchJournal : NSObject
+
+/** YES once the journal has been replayed by `-load`. */
+@property(nonatomic, readonly) BOOL isLoaded;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Instantiates a journal.
+ *
+ * @param path The path of the journal file.
+ * @param sizeTracker The size tracker to update when the journal file changes.
+ */
+- (instancetype)initWithPath:(NSString *)path
+                 sizeTracker:(GDTCORDirectorySizeTracker *)sizeTracker NS_DESIGNATED_INITIALIZER;
+
+/** Replays the journal file into the open batches. The file is left as is, including the records
+ * of closed batches and a record torn by a crash, until the next `-compactIfNeeded`.
+ *
+ * @return The batches that were committed since the journal was last compacted. The client is
+ * expected to delete their remaining event files, which a crash may have left behind, and to call
+ * `-compactIfNeeded` afterwards.
+ */
+- (NSArray<GDTCORBatchJournalBatch *> *)load;
+
+/** Closes the journal file and discards the open batches, so that the journal is replayed from
+ * disk by the next `-load`.
+ */
+- (void)unload;
+
+/** Records a new open batch.
+ *
+ * @return NO if the record couldn't be written, in which case the batch is not open.
+ */
+- (BOOL)createBatch:(GDTCORBatchJournalBatch *)batch error:(NSError **)outError;
+
+/** Records that the events of the open batch were uploaded and closes it. The client deletes the
+ * event files afterwards.
+ *
+ * @return The closed batch, or nil if there is no open batch with the ID.
+ */
+- (nullable GDTCORBatchJournalBatch *)commitBatchWithID:(NSNumber *)batchID;
+
+/** Records that the events of the open batch are returned to the storage and closes it.
+ *
+ * @return The closed batch, or nil if there is no open batch with the ID.
+ */
+- (nullable GDTCORBatchJournalBatch *)abortBatchWithID:(NSNumber *)batchID;
+
+/** Returns the open batches. */
+- (NSArray<GDTCORBatchJournalBatch *> *)openBatches;
+
+/** Returns YES if the event file of the target belongs to an open batch. */
+- (BOOL)isEventFileBatched:(NSString *)eventFilename target:(GDTCORTarget)target;
+
+/** Compacts the journal if no batch is open, if it is mostly made of records of closed batches, or
+ * if `-load` replayed records of closed batches or a torn record.
+ * The client calls this after acting on closed batches, e.g. once the event files of a committed
+ * batch are deleted, so that no record is dropped before it is acted on.
+ */
+- (void)compactIfNeeded;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -18,15 +18,30 @@
 
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageProtocol.h"
 
+@class GDTCORStorageSizeBudget;
+
 NS_ASSUME_NONNULL_BEGIN
 
-/** The class calculates and caches the specified directory content size and uses add/remove signals
- *  from client the client to keep the size up to date without accessing file system.
+/** The name of the hidden file in the tracked directory that persists the content size across
+ * launches.
+ */
+FOUNDATION_EXPORT NSString *const kGDTCORDirectorySizeTrackerSizeFileName;
+
+/** The class calculates and caches the specified directory content size and uses add/remove
+ *  signals from the client to keep the size up to date without accessing file system.
+ *  The cached size can be persisted to a hidden file in the tracked directory, so that the next
+ *  launch doesn't have to enumerate the directory. The persisted size is discarded as soon as the
+ *  size changes, so a size that is not persisted again (e.g. because of a crash) is recalculated.
+ *  Every change of the cached size, including its calculation, is reported to the size budget, if
+ *  any, which sums the sizes of several trackers.
  *  This is an internal class designed to be used by `GDTCORFlatFileStorage`.
  *  NOTE: The class is not thread-safe. The client must take care of synchronization.
  */
 @interface GDTCORDirectorySizeTracker : NSObject
 
+/** The tracked directory path. */
+@property(nonatomic, readonly) NSString *directoryPath;
+
 - (instancetype)init NS_UNAVAILABLE;
 
 /** Initializes the object with a directory path.
@@ -34,7 +49,15 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (instancetype)initWithDirectoryPath:(NSString *)path;
 
-/** Returns a cached or calculates (if there is no cached) directory content size.
+/** Initializes the object with a directory path and a size budget.
+ * @param path The directory path to track content size.
+ * @param sizeBudget The size budget to report the changes of the cached size to.
+ */
+- (instancetype)initWithDirectoryPath:(NSString *)path
+                           sizeBudget:(nullable GDTCORStorageSizeBudget *)sizeBudget
+    NS_DESIGNATED_INITIALIZER;
+
+/** Returns a cached, persisted or calculates (if there is neither) directory content size.
  * @return The directory content size in bytes calculated based on `NSURLFileSizeKey`.
  */
 - (GDTCORStorageSizeBytes)directoryContentSize;
@@ -42,25 +65,37 @@ NS_ASSUME_NONNULL_BEGIN
 /** The client must call this method or `resetCachedSize` method each time a file or directory is
  * added to the tracked directory.
  *  @param path The path to the added file. If the path is outside the tracked directory then the
- *  @param fileSize The size of the added file.
  * method is no-op.
+ *  @param fileSize The size of the added file.
  */
 - (void)fileWasAddedAtPath:(NSString *)path withSize:(GDTCORStorageSizeBytes)fileSize;
 
 /** The client must call this method or `resetCachedSize` method each time a file or directory is
  * removed from the tracked directory.
  *  @param path The path to the removed file. If the path is outside the tracked directory then the
- *  @param fileSize The size of the removed file.
  * method is no-op.
+ *  @param fileSize The size of the removed file.
  */
 - (void)fileWasRemovedAtPath:(NSString *)path withSize:(GDTCORStorageSizeBytes)fileSize;
 
-/** Invalidates cached directory size. */
+/** Invalidates cached and persisted directory size. */
 - (void)resetCachedSize;
 
+/** Writes the cached size to the size file, if it is not persisted already. The client is
+ * expected to call the method when the app may be suspended or terminated.
+ */
+- (void)persistCachedSize;
+
 /** Returns URL resource value for `NSURLFileSizeKey` key for the specified URL. */
 - (GDTCORStorageSizeBytes)fileSizeAtURL:(NSURL *)fileURL;
 
+#if !NDEBUG
+/** Compares the cached size with the actual directory content size and logs any drift.
+ * @return YES if there is no cached size or it matches the directory content size.
+ */
+- (BOOL)reconcileCachedSize;
+#endif  // !NDEBUG
+
 @end
 
 NS_ASSUME_NONNULL_END
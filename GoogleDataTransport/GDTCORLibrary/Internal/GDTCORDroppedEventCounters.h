@@ -0,0 +1,52 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventDropReason.h"
+
+@class GDTCOREvent;
+@class GDTCORLogSourceMetrics;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** An in-memory table of the number of dropped events, keyed by log source and drop reason. Each
+ * log source has a row of counters, one per drop reason, that is created on its first drop and
+ * kept for the lifetime of the table. Only the lookup of a row takes a lock; the counters are
+ * updated and drained with atomic operations, so recording a drop is cheap enough to be done for
+ * each event.
+ * This is an internal class designed to be used by `GDTCORMetricsController`.
+ * NOTE: The class is thread-safe.
+ */
+@interface GDTCORDroppedEventCounters : NSObject
+
+/** Counts the events dropped for the reason. Events without a log source are not counted, and
+ * reasons unknown to this version are counted as `GDTCOREventDropReasonUnknown`.
+ *
+ * @param events The dropped events.
+ * @param reason The reason the events were dropped for.
+ */
+- (void)addEvents:(NSArray<GDTCOREvent *> *)events droppedForReason:(GDTCOREventDropReason)reason;
+
+/** Resets the counters and returns the counts they had.
+ *
+ * @return The log source metrics of the counted events, or nil if no event was counted.
+ */
+- (nullable GDTCORLogSourceMetrics *)drainLogSourceMetrics;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class GDTCOREvent;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** The value every event record starts with, "GDTE" when read as little-endian bytes. */
+FOUNDATION_EXPORT const uint32_t kGDTCOREventRecordMagic;
+
+/** The version of the event record format written by GDTCOREncodeEventRecord. */
+FOUNDATION_EXPORT const uint8_t kGDTCOREventRecordVersion;
+
+FOUNDATION_EXPORT NSString *const GDTCOREventRecordErrorDomain;
+
+typedef NS_ENUM(NSInteger, GDTCOREventRecordError) {
+  /** The event can't be encoded, e.g. it has no serialized data object bytes. */
+  GDTCOREventRecordErrorInvalidEvent = 0,
+
+  /** The record is truncated or malformed. */
+  GDTCOREventRecordErrorCorruptRecord = 1,
+
+  /** The record was written by a newer version of the format. */
+  GDTCOREventRecordErrorUnsupportedVersion = 2,
+};
+
+/** Returns YES if the data starts with an event record header. Data that doesn't is expected to be
+ * an NSKeyedArchiver archive written by a previous version of the library.
+ *
+ * @param data The data to check.
+ * @return YES if the data starts with kGDTCOREventRecordMagic.
+ */
+BOOL GDTCORIsEventRecord(NSData *data);
+
+/** Encodes an event as a compact binary record. Storage uses this instead of GDTCOREncodeArchive,
+ * as a keyed archive of an event is several times larger than the event and slower to decode.
+ *
+ * All integers are little-endian. The record is a fixed header followed by the length-prefixed
+ * variable-length fields:
+ *
+ *   uint32 magic, uint8 version, uint8 presence flags, uint8 QoS tier,
+ *   uint8 reserved, int32 target, int64 clock time millis, int64 clock timezone offset seconds,
+ *   int64 clock kernel boot time nanoseconds, int64 clock uptime nanoseconds, float64 expiration
+ *   as seconds since 1970,
+ *   uint16 length + UTF-8 event ID, uint32 length + UTF-8 mapping ID, uint32 length + custom bytes,
+ *   uint32 length + product data (int32 product ID), uint32 length + data object bytes.
+ *
+ * @param event The event to encode.
+ * @param error The error to populate if something goes wrong.
+ * @return The encoded record, or nil if the event can't be encoded.
+ */
+NSData *_Nullable GDTCOREncodeEventRecord(GDTCOREvent *event, NSError *_Nullable *_Nullable error);
+
+/** Decodes an event from an event record. Data that isn't an event record is decoded as a keyed
+ * archive with GDTCORDecodeArchive, so events stored by previous versions of the library can still
+ * be read.
+ *
+ * The data object and custom bytes of an event decoded from a record are slices of the record
+ * and retain it instead of copying the bytes out.
+ *
+ * @param data The record or archive data.
+ * @param error The error to populate if something goes wrong.
+ * @return The decoded event, or nil if the data can't be decoded.
+ */
+GDTCOREvent *_Nullable GDTCORDecodeEventRecord(NSData *data, NSError *_Nullable *_Nullable error);
+
+/** Decodes an event from the event record or keyed archive at the given path. The file is
+ * memory-mapped when it's safe, so the data object of the event is read from the mapping.
+ *
+ * @param path The path of the file containing the record.
+ * @param error The error to populate if something goes wrong.
+ * @return The decoded event, or nil if the file can't be read or decoded.
+ */
+GDTCOREvent *_Nullable GDTCORDecodeEventRecordAtPath(NSString *path,
+                                                     NSError *_Nullable *_Nullable error);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORTargets.h"
+
+@class GDTCORBatchJournal;
+@class GDTCORDirectorySizeTracker;
+@class GDTCORStorageEventIndex;
+@class GDTCORStorageSizeBudget;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** The name of the batch journal file in the event data directory of a target. */
+FOUNDATION_EXPORT NSString *const kGDTCORFlatFileStoragePartitionBatchJournalName;
+
+/** The name of the directory, in the event data directory of a target, of the request bodies
+ * stored for the open batches of the target.
+ */
+FOUNDATION_EXPORT NSString *const kGDTCORFlatFileStoragePartitionRequestBodiesDirectoryName;
+
+/** The number of shard directories at each of the two levels under the event data directory. */
+FOUNDATION_EXPORT const NSUInteger kGDTCORFlatFileStoragePartitionShardFanout;
+
+/** The part of the flat file storage that holds the events of a single target: their directory,
+ * the queue working on them, their index, the size tracker of their directory and the journal of
+ * their batches. The storage works on each target on its queue, so that e.g. forming a large batch
+ * for one target doesn't delay storing the events of another.
+ * This is an internal class designed to be used by `GDTCORFlatFileStorage`.
+ * NOTE: Except for `target`, `queue` and `eventDataPath`, the properties must only be accessed on
+ * the queue.
+ */
+@interface GDTCORFlatFileStoragePartition : NSObject
+
+/** The target of the events. */
+@property(nonatomic, readonly) GDTCORTarget target;
+
+/** The serial queue on which all the work on the events of the target occurs. */
+@property(nonatomic, readonly) dispatch_queue_t queue;
+
+/** The directory of the event files of the target. The event files are spread over two levels of
+ * shard directories under it, so that no single directory holds a large backlog.
+ */
+@property(nonatomic, readonly) NSString *eventDataPath;
+
+/** The index of the events in the directory. */
+@property(nonatomic, readonly) GDTCORStorageEventIndex *eventIndex;
+
+/** The size tracker of the directory, which reports to the size budget of the storage. */
+@property(nonatomic, readonly) GDTCORDirectorySizeTracker *sizeTracker;
+
+/** The journal of the batches of the target, stored in the directory. */
+@property(nonatomic, readonly) GDTCORBatchJournal *batchJournal;
+
+/** The paths of the event files written with relaxed durability that haven't been synced to disk
+ * yet. They are synced when the app goes to the background or terminates.
+ */
+@property(nonatomic, readonly) NSMutableSet<NSString *> *unsyncedEventPaths;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Instantiates a partition. No file is accessed until its properties are used.
+ *
+ * @param target The target of the events.
+ * @param eventDataPath The directory of the event files of the target.
+ * @param sizeBudget The size budget of the storage.
+ */
+- (instancetype)initWithTarget:(GDTCORTarget)target
+                 eventDataPath:(NSString *)eventDataPath
+                    sizeBudget:(GDTCORStorageSizeBudget *)sizeBudget NS_DESIGNATED_INITIALIZER;
+
+/** Returns the shard directory of an event relative to the event data directory, e.g. "a/3". The
+ * shard is picked by hashing the event ID, so it can be found from the ID alone.
+ *
+ * @param eventID The ID of the event.
+ * @return The relative path of the shard directory.
+ */
++ (NSString *)shardPathComponentForEventID:(NSString *)eventID;
+
+/** Returns the paths of all the shard directories of the event data directory, whether they exist
+ * or not, so that the event files can be visited one shard at a time.
+ */
+- (NSArray<NSString *> *)shardPaths;
+
+/** Returns the path of the request body stored for the batch. This path may not exist.
+ *
+ * @param batchID The ID of the batch.
+ * @return The path of the request body of the batch.
+ */
+- (NSString *)requestBodyPathForBatchID:(NSNumber *)batchID;
+
+@end
+
+NS_ASSUME_NONNULL_END
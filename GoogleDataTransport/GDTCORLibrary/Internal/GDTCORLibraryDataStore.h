@@ -0,0 +1,86 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class GDTCORDirectorySizeTracker;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** A key-value store of library data kept in a single log-structured file, with an in-memory cache
+ * of all the values. Setting or removing a value appends a single checksummed record to the file
+ * and updates the cache, so reads never go to disk after the first access and writes don't rewrite
+ * any file.
+ *
+ * The file is replayed by `-load`. A torn record at the end, left by a crash during an append, is
+ * discarded. The file is compacted to one record per key on load and rewritten once it is mostly
+ * made of overwritten or removed values. Files that previous versions wrote for each key into the
+ * directory of the store are moved into it on load.
+ * This is an internal class designed to be used by `GDTCORFlatFileStorage`.
+ * NOTE: The class is not thread-safe. The client must take care of synchronization.
+ */
+@interface GDTCORLibraryDataStore : NSObject
+
+/** The path of the store file. */
+@property(nonatomic, readonly) NSString *path;
+
+/** YES once the store file has been replayed by `-load`. */
+@property(nonatomic, readonly) BOOL isLoaded;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Instantiates a store.
+ *
+ * @param path The path of the store file. The other regular files in its directory, except hidden
+ * ones, are taken for the files of keys written by previous versions.
+ * @param sizeTracker The size tracker to update when the files of the directory change.
+ */
+- (instancetype)initWithPath:(NSString *)path
+                 sizeTracker:(GDTCORDirectorySizeTracker *)sizeTracker NS_DESIGNATED_INITIALIZER;
+
+/** Replays the store file into the cache, compacts it and migrates the per-key files, if any. */
+- (void)load;
+
+/** Closes the store file and discards the cache, so that the store is replayed from disk by the
+ * next `-load`.
+ */
+- (void)unload;
+
+/** Returns the cached value of the key, or nil if there is none. */
+- (nullable NSData *)dataForKey:(NSString *)key;
+
+/** Sets the value of the key.
+ *
+ * @return NO if the record couldn't be written, in which case the value is unchanged.
+ */
+- (BOOL)setData:(NSData *)data forKey:(NSString *)key error:(NSError **)outError;
+
+/** Removes the value of the key. Removing a key without value is a no-op.
+ *
+ * @return NO if the record couldn't be written, in which case the value is unchanged.
+ */
+- (BOOL)removeDataForKey:(NSString *)key error:(NSError **)outError;
+
+/** Syncs the appended records to disk. The client is expected to call the method when the app may
+ * be suspended or terminated, and after writing a value that must survive a crash.
+ *
+ * @return NO if the records couldn't be synced.
+ */
+- (BOOL)synchronize;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -34,6 +34,8 @@
 #import <CoreTelephony/CTTelephonyNetworkInfo.h>
 #endif
 
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageDurabilityPolicy.h"
+
 NS_ASSUME_NONNULL_BEGIN
 
 /** The GoogleDataTransport library version. */
@@ -172,6 +174,34 @@ id<NSSecureCoding> _Nullable GDTCORDecodeArchive(Class archiveClass,
  */
 BOOL GDTCORWriteDataToFile(NSData *data, NSString *filePath, NSError *_Nullable *outError);
 
+/** Writes the provided data to a file at the provided path with the given durability, see
+ * `GDTCORStorageDurability`. Intermediate directories will be created as needed.
+ *  @param data The file content.
+ *  @param filePath The path to the file to write the provided data.
+ *  @param durability How durably the file is written.
+ *  @param outError The error to populate if something goes wrong.
+ *  @return `YES` in the case of success, `NO` otherwise.
+ */
+BOOL GDTCORWriteDataToFileWithDurability(NSData *data,
+                                         NSString *filePath,
+                                         GDTCORStorageDurability durability,
+                                         NSError *_Nullable *outError);
+
+/** Syncs the content of the file or directory at the provided path to disk.
+ *  @param path The path of the file or directory.
+ *  @param outError The error to populate if something goes wrong.
+ *  @return `YES` in the case of success, `NO` otherwise.
+ */
+BOOL GDTCORSyncFileAtPath(NSString *path, NSError *_Nullable *outError);
+
+/** Syncs the content of several files to disk. Each file is synced with `fsync`, and the drive is
+ *  flushed once at the end, which is much cheaper than a full sync of each file.
+ *  @param paths The paths of the files.
+ *  @param outError The error to populate for the first file that couldn't be synced.
+ *  @return `YES` if all the files were synced, `NO` otherwise.
+ */
+BOOL GDTCORSyncFilesAtPaths(NSArray<NSString *> *paths, NSError *_Nullable *outError);
+
 /** A typedef identify background identifiers. */
 typedef volatile NSUInteger GDTCORBackgroundIdentifier;
 
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** The length of a record frame header: uint32 magic, uint8 record type, uint32 body length and
+ * uint32 body CRC-32.
+ */
+FOUNDATION_EXPORT const NSUInteger kGDTCORRecordFrameHeaderLength;
+
+/** Appends a byte to the data. */
+void GDTCORAppendUInt8(NSMutableData *data, uint8_t value);
+
+/** Appends an integer to the data as little-endian bytes. */
+void GDTCORAppendUInt16(NSMutableData *data, uint16_t value);
+
+/** Appends an integer to the data as little-endian bytes. */
+void GDTCORAppendUInt32(NSMutableData *data, uint32_t value);
+
+/** Appends an integer to the data as little-endian bytes. */
+void GDTCORAppendUInt64(NSMutableData *data, uint64_t value);
+
+/** Reads a little-endian integer. The bytes don't need to be aligned. */
+uint16_t GDTCORReadUInt16(const uint8_t *bytes);
+
+/** Reads a little-endian integer. The bytes don't need to be aligned. */
+uint32_t GDTCORReadUInt32(const uint8_t *bytes);
+
+/** Reads a little-endian integer. The bytes don't need to be aligned. */
+uint64_t GDTCORReadUInt64(const uint8_t *bytes);
+
+/** Wraps a record body into a frame that can be appended to an append-only file. The library data
+ * store, the batch journal and the segmented log share this framing, each with its own magic.
+ *
+ * @param magic The value identifying the kind of file the frame belongs to.
+ * @param type The type of the record, defined by the kind of file.
+ * @param body The body of the record. It must not be empty.
+ * @return The header followed by the body.
+ */
+NSData *GDTCORRecordFrame(uint32_t magic, uint8_t type, NSData *body);
+
+/** Validates the frame at the given offset and returns its type and the range of its body. A frame
+ * that is truncated, has another magic or doesn't match its checksum, e.g. because it was torn by
+ * a crash, is not read.
+ *
+ * @param bytes The bytes of the file.
+ * @param length The number of bytes of the file.
+ * @param offset The offset of the frame.
+ * @param magic The value the frame is expected to start with.
+ * @param outType The type of the record, set if the frame is valid.
+ * @param outBodyRange The range of the body in the bytes, set if the frame is valid.
+ * @return NO if there is no complete and intact frame at the offset.
+ */
+BOOL GDTCORReadRecordFrame(const uint8_t *bytes,
+                           uint64_t length,
+                           uint64_t offset,
+                           uint32_t magic,
+                           uint8_t *outType,
+                           NSRange *outBodyRange);
+
+NS_ASSUME_NONNULL_END
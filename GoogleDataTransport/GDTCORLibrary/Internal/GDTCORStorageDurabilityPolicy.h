@@ -0,0 +1,77 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORTargets.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** How durably an event file is written, from the cheapest to the most expensive. */
+typedef NS_ENUM(NSInteger, GDTCORStorageDurability) {
+  /** The file is written in place and left in the OS buffers. A crash may lose or truncate it. The
+   * storage syncs such files when the app goes to the background or terminates.
+   */
+  GDTCORStorageDurabilityRelaxed = 0,
+
+  /** The file is written to a temporary file which is then renamed, so that it's never seen
+   * partially written.
+   */
+  GDTCORStorageDurabilityAtomic = 1,
+
+  /** The file is written atomically and both the file and its directory are synced to disk before
+   * the write completes.
+   */
+  GDTCORStorageDurabilitySynced = 2,
+};
+
+/** Decides how durably each event is written by the storage. The durability can be set per target
+ * and per QoS tier. When both apply to an event, the more durable one is used. Events that no
+ * setting applies to use `defaultDurability`.
+ * This class is thread-safe.
+ */
+@interface GDTCORStorageDurabilityPolicy : NSObject
+
+/** The durability of the events no setting applies to. `GDTCORStorageDurabilityAtomic` by
+ * default.
+ */
+@property(atomic) GDTCORStorageDurability defaultDurability;
+
+/** Sets the durability of the events of a target.
+ *
+ * @param durability The durability.
+ * @param target The target.
+ */
+- (void)setDurability:(GDTCORStorageDurability)durability forTarget:(GDTCORTarget)target;
+
+/** Sets the durability of the events of a QoS tier.
+ *
+ * @param durability The durability.
+ * @param qosTier The QoS tier.
+ */
+- (void)setDurability:(GDTCORStorageDurability)durability forQoSTier:(GDTCOREventQoS)qosTier;
+
+/** Returns the durability to write the event with.
+ *
+ * @param event The event being stored.
+ * @return The durability of the event.
+ */
+- (GDTCORStorageDurability)durabilityForEvent:(GDTCOREvent *)event;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORTargets.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** The time span covered by each bucket of the expiration index. */
+FOUNDATION_EXPORT const NSTimeInterval kGDTCORStorageEventIndexExpirationBucketWidth;
+
+/** The metadata of a stored event that is needed to select it without reading it from disk. */
+@interface GDTCORStorageEventIndexEntry : NSObject
+
+/** The target of the event. */
+@property(nonatomic, readonly) GDTCORTarget target;
+
+/** The ID of the event. */
+@property(nonatomic, readonly) NSString *eventID;
+
+/** The QoS tier of the event. */
+@property(nonatomic, readonly) GDTCOREventQoS qosTier;
+
+/** The mapping ID of the event. */
+@property(nonatomic, readonly) NSString *mappingID;
+
+/** The expiration date of the event. */
+@property(nonatomic, readonly) NSDate *expirationDate;
+
+/** The path of the file containing the event. */
+@property(nonatomic, readonly) NSString *path;
+
+/** The date the event was stored, which is the modification date of its file. */
+@property(nonatomic, readonly) NSDate *storedDate;
+
+/** The size of the file containing the event. */
+@property(nonatomic, readonly) uint64_t size;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Instantiates an index entry. */
+- (instancetype)initWithTarget:(GDTCORTarget)target
+                       eventID:(NSString *)eventID
+                       qosTier:(GDTCOREventQoS)qosTier
+                     mappingID:(NSString *)mappingID
+                expirationDate:(NSDate *)expirationDate
+                          path:(NSString *)path
+                    storedDate:(NSDate *)storedDate
+                          size:(uint64_t)size NS_DESIGNATED_INITIALIZER;
+
+@end
+
+/** An in-memory index of stored events, keyed by target, event ID, QoS tier and mapping ID. It
+ * lets the storage answer event selector queries in O(matching events) without enumerating
+ * directories. Events are also bucketed by expiration date, so that finding the expired events
+ * only visits the buckets that have elapsed. The index of a target is populated lazily by the
+ * client, see `-markTargetLoaded:`.
+ * This is an internal class designed to be used by `GDTCORFlatFileStorage`.
+ * NOTE: The class is not thread-safe. The client must take care of synchronization.
+ */
+@interface GDTCORStorageEventIndex : NSObject
+
+/** Returns YES if the index of the target has been populated. */
+- (BOOL)isTargetLoaded:(GDTCORTarget)target;
+
+/** Marks the index of the target as populated. Until a target is loaded the client is expected to
+ * skip updating the index for it, as the events on disk will be picked up when loading it.
+ */
+- (void)markTargetLoaded:(GDTCORTarget)target;
+
+/** Adds an entry, replacing an existing entry with the same target and event ID. */
+- (void)addEntry:(GDTCORStorageEventIndexEntry *)entry;
+
+/** Removes and returns the entry with the given event ID, if any. */
+- (nullable GDTCORStorageEventIndexEntry *)removeEntryWithEventID:(NSString *)eventID
+                                                           target:(GDTCORTarget)target;
+
+/** Returns the number of indexed events of the target. */
+- (NSUInteger)countForTarget:(GDTCORTarget)target;
+
+/** Returns the entries matching all of the given parameters.
+ *
+ * @param target The target to look for.
+ * @param eventIDs The list of eventIDs to look for, or nil for any.
+ * @param qosTiers The list of qosTiers to look for, or nil for any.
+ * @param mappingIDs The list of mappingIDs to look for, or nil for any.
+ * @return The matching entries.
+ */
+- (NSArray<GDTCORStorageEventIndexEntry *> *)
+    entriesForTarget:(GDTCORTarget)target
+            eventIDs:(nullable NSSet<NSString *> *)eventIDs
+            qosTiers:(nullable NSSet<NSNumber *> *)qosTiers
+          mappingIDs:(nullable NSSet<NSString *> *)mappingIDs;
+
+/** Returns the entries of all loaded targets that expired before the given date. */
+- (NSArray<GDTCORStorageEventIndexEntry *> *)entriesExpiredBeforeDate:(NSDate *)date;
+
+/** Removes all entries and marks all targets as not loaded. */
+- (void)removeAllEntries;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -16,10 +16,27 @@
 
 #import <Foundation/Foundation.h>
 
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORTargets.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
+/** The order in which the events matching a selector are picked when the batch is bounded. */
+typedef NS_ENUM(NSInteger, GDTCORStorageEventSelectorOrder) {
+  /** The events stored earliest are picked first. */
+  GDTCORStorageEventSelectorOrderOldestFirst = 0,
+
+  /** Events of more urgent QoS tiers are picked first, see `GDTCORQoSTierPriorityRank`. The
+   * events stored earliest are picked first within a tier.
+   */
+  GDTCORStorageEventSelectorOrderPriorityFirst = 1,
+};
+
+/** Returns the rank of a QoS tier in priority order, lower ranks being more urgent: Fast, Default,
+ * WifiOnly, Daily, Telemetry, then Unknown.
+ */
+FOUNDATION_EXPORT NSInteger GDTCORQoSTierPriorityRank(GDTCOREventQoS qosTier);
+
 /** This class enables the finding of events by matching events with the properties of this class.
  */
 @interface GDTCORStorageEventSelector : NSObject
@@ -36,6 +53,17 @@ NS_ASSUME_NONNULL_BEGIN
 /** Finds all events matching the qosTiers in this list. */
 @property(nullable, readonly, nonatomic) NSSet<NSNumber *> *selectedQosTiers;
 
+/** The maximum number of events to select, or 0 for no limit. */
+@property(readonly, nonatomic) NSUInteger maxEventCount;
+
+/** The maximum number of stored bytes of the selected events, or 0 for no limit. An event larger
+ * than the limit is still selected on its own, so that it can't hold back the events after it.
+ */
+@property(readonly, nonatomic) uint64_t maxBatchSizeBytes;
+
+/** The order in which events are picked when the selection is bounded. */
+@property(readonly, nonatomic) GDTCORStorageEventSelectorOrder order;
+
 /** Initializes an event selector that will find all events for the given target.
  *
  * @param target The selected target.
@@ -56,6 +84,40 @@ NS_ASSUME_NONNULL_BEGIN
                     mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
                       qosTiers:(nullable NSSet<NSNumber *> *)qosTiers;
 
+/** Instantiates an event selector that selects a bounded number of events.
+ *
+ * @param target The selected target.
+ * @param eventIDs Optional param to find an event matching this eventID.
+ * @param mappingIDs Optional param to find events matching this mappingID.
+ * @param qosTiers Optional param to find events matching the given QoS tiers.
+ * @param maxEventCount The maximum number of events to select, or 0 for no limit.
+ * @param maxBatchSizeBytes The maximum number of stored bytes to select, or 0 for no limit.
+ * @param order The order in which the events are picked.
+ * @return An immutable event selector instance.
+ */
+- (instancetype)initWithTarget:(GDTCORTarget)target
+                      eventIDs:(nullable NSSet<NSString *> *)eventIDs
+                    mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
+                      qosTiers:(nullable NSSet<NSNumber *> *)qosTiers
+                 maxEventCount:(NSUInteger)maxEventCount
+             maxBatchSizeBytes:(uint64_t)maxBatchSizeBytes
+                         order:(GDTCORStorageEventSelectorOrder)order;
+
+/** Returns YES if the selector has an event count or byte limit. */
+- (BOOL)isBounded;
+
+/** Applies the order and limits of the selector to the events matching it. Used by storage
+ * implementations, which describe their events through the given blocks.
+ *
+ * @param candidates The events matching the selector, the events stored earliest first.
+ * @param qosTier Returns the QoS tier of a candidate.
+ * @param size Returns the number of stored bytes of a candidate.
+ * @return The selected candidates, in the order they were picked.
+ */
+- (NSArray *)selectCandidates:(NSArray *)candidates
+                      qosTier:(GDTCOREventQoS (^)(id candidate))qosTier
+                         size:(uint64_t (^)(id candidate))size;
+
 @end
 
 NS_ASSUME_NONNULL_END
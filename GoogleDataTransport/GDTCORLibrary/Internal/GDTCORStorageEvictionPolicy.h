@@ -0,0 +1,93 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORTargets.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** A stored event that may be evicted to make room for a new event. */
+@interface GDTCORStorageEvictionCandidate : NSObject
+
+/** The target of the event. */
+@property(nonatomic, readonly) GDTCORTarget target;
+
+/** The ID of the event. */
+@property(nonatomic, readonly) NSString *eventID;
+
+/** The QoS tier of the event. */
+@property(nonatomic, readonly) GDTCOREventQoS qosTier;
+
+/** The mapping ID of the event. */
+@property(nonatomic, readonly) NSString *mappingID;
+
+/** The time the event was stored. */
+@property(nonatomic, readonly) NSDate *storedDate;
+
+/** The number of bytes the event takes in storage. */
+@property(nonatomic, readonly) uint64_t size;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Instantiates an eviction candidate. */
+- (instancetype)initWithTarget:(GDTCORTarget)target
+                       eventID:(NSString *)eventID
+                       qosTier:(GDTCOREventQoS)qosTier
+                     mappingID:(NSString *)mappingID
+                    storedDate:(NSDate *)storedDate
+                          size:(uint64_t)size NS_DESIGNATED_INITIALIZER;
+
+@end
+
+/** Decides which stored events are evicted when storing a new event would exceed the storage size
+ * limit. The storage evicts the returned candidates in order until the new event fits, and drops
+ * the new event if it still doesn't fit. Evicted events are reported to the storage delegate like
+ * dropped events.
+ */
+@protocol GDTCORStorageEvictionPolicy <NSObject>
+
+/** Returns the candidates that may be evicted to make room for the event, in eviction order.
+ *
+ * @param candidates The stored events that aren't part of a batch.
+ * @param event The event being stored.
+ * @return The candidates to evict first, or an empty array to drop the new event instead.
+ */
+- (NSArray<GDTCORStorageEvictionCandidate *> *)
+    candidatesToEvictFromCandidates:(NSArray<GDTCORStorageEvictionCandidate *> *)candidates
+                           forEvent:(GDTCOREvent *)event;
+
+@end
+
+/** Evicts the events stored earliest first. */
+@interface GDTCOROldestFirstEvictionPolicy : NSObject <GDTCORStorageEvictionPolicy>
+@end
+
+/** Evicts the events of the least urgent QoS tier first, see `GDTCORQoSTierPriorityRank`, the
+ * events stored earliest first within a tier. Events more urgent than the new event are never
+ * evicted.
+ */
+@interface GDTCORLowestQoSFirstEvictionPolicy : NSObject <GDTCORStorageEvictionPolicy>
+@end
+
+/** Evicts the events of the mapping ID taking the most storage first, the events stored earliest
+ * first within a mapping ID.
+ */
+@interface GDTCORLargestLogSourceFirstEvictionPolicy : NSObject <GDTCORStorageEvictionPolicy>
+@end
+
+NS_ASSUME_NONNULL_END
@@ -126,6 +126,19 @@ typedef void (^GDTCORStorageBatchBlock)(NSNumber *_Nullable newBatchID,
  */
 - (void)storageSizeWithCallback:(void (^)(GDTCORStorageSizeBytes storageSize))onComplete;
 
+@optional
+
+/** Stores events in bulk, in one hop to the storage queue and under one background task, and calls
+ * onComplete once an attempt to store all of them has been made.
+ *
+ * @param events The events to store.
+ * @param completion The completion block to call with the number of events stored and the error of
+ * an event that couldn't be stored, if any.
+ */
+- (void)storeEvents:(NSArray<GDTCOREvent *> *)events
+         onComplete:(void (^_Nullable)(NSUInteger storedEventCount,
+                                       NSError *_Nullable error))completion;
+
 @end
 
 #pragma mark - GDTCORStoragePromiseProtocol
@@ -174,6 +187,29 @@ typedef void (^GDTCORStorageBatchBlock)(NSNumber *_Nullable newBatchID,
                                          (GDTCORStorageEventSelector *)eventSelector
                                             batchExpiration:(NSDate *)expiration;
 
+@optional
+
+/** Returns the oldest batch of the selected target left open by an earlier upload attempt, so that
+ * it can be resumed instead of being dissolved and formed again. A batch holding events of QoS
+ * tiers the selector doesn't select is dissolved instead. The batch carries the request body stored
+ * for it by `storeRequestBody:forBatchID:retryDate:`, if any and still recent.
+ *  @return A promise object that is resolved with the batch, and rejected if there is no open batch
+ * to resume for the target.
+ */
+- (FBLPromise<GDTCORUploadBatch *> *)pendingBatchWithEventSelector:
+    (GDTCORStorageEventSelector *)eventSelector;
+
+/** Stores the request body built for an open batch along with it, until the batch is removed. The
+ * body stays recent until a while after the retry date, the date the next upload attempt is due.
+ * The storage may drop the body earlier to make room, so it must not carry metrics: they would be
+ * lost along with it.
+ *  @return A promise object that is resolved once the body is stored, and rejected if it couldn't
+ * be stored.
+ */
+- (FBLPromise<NSNull *> *)storeRequestBody:(NSData *)requestBody
+                                forBatchID:(NSNumber *)batchID
+                                 retryDate:(NSDate *)retryDate;
+
 @end
 
 /** Retrieves the storage instance for the given target.
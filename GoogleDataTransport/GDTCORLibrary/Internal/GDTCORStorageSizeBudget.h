@@ -0,0 +1,61 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageSizeBytes.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** A running total of the sizes of several directories and a cap on it. Each directory is tracked
+ * by a `GDTCORDirectorySizeTracker` owned by its own queue, which reports the changes of its size
+ * here. The total is only updated with atomic operations, so checking the cap from one queue never
+ * waits on the work of another.
+ * This is an internal class designed to be used by `GDTCORFlatFileStorage`.
+ * NOTE: The class is thread-safe.
+ */
+@interface GDTCORStorageSizeBudget : NSObject
+
+/** The cap on the total size. */
+@property(nonatomic, readonly) GDTCORStorageSizeBytes limit;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Instantiates a budget with an empty total.
+ *
+ * @param limit The cap on the total size.
+ */
+- (instancetype)initWithLimit:(GDTCORStorageSizeBytes)limit NS_DESIGNATED_INITIALIZER;
+
+/** Returns the total size, including the reserved sizes. */
+- (GDTCORStorageSizeBytes)totalSize;
+
+/** Adds the size to the total if it stays within the limit. The reservation is released by
+ * `-removeSize:` once the stored data is accounted for by its size tracker, or couldn't be stored.
+ *
+ * @return YES if the size was reserved.
+ */
+- (BOOL)reserveSize:(GDTCORStorageSizeBytes)size;
+
+/** Adds the size to the total regardless of the limit. */
+- (void)addSize:(GDTCORStorageSizeBytes)size;
+
+/** Subtracts the size from the total, which doesn't go below 0. */
+- (void)removeSize:(GDTCORStorageSizeBytes)size;
+
+@end
+
+NS_ASSUME_NONNULL_END
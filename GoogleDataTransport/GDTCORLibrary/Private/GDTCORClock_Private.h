@@ -0,0 +1,31 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORClock.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface GDTCORClock ()
+
+/** Initializes a clock snapshot with the given values, e.g. to restore a stored snapshot. */
+- (instancetype)initWithTimeMillis:(int64_t)timeMillis
+             timezoneOffsetSeconds:(int64_t)timezoneOffsetSeconds
+         kernelBootTimeNanoseconds:(int64_t)kernelBootTimeNanoseconds
+                 uptimeNanoseconds:(int64_t)uptimeNanoseconds;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -28,6 +28,22 @@ NS_ASSUME_NONNULL_BEGIN
 /** Generates a unique event ID. */
 + (NSString *)nextEventID;
 
+/** Initializes an event restored from storage. Unlike the public initializers the values aren't
+ * validated, as with events decoded by -initWithCoder:.
+ *
+ * @param eventID The ID of the stored event.
+ * @param mappingID The mapping identifier.
+ * @param productData The product data the event is associated with.
+ * @param target The event's target identifier.
+ * @param serializedDataObjectBytes The serialized bytes of the event's data object.
+ * @return An instance of this class.
+ */
+- (instancetype)initWithEventID:(NSString *)eventID
+                      mappingID:(nullable NSString *)mappingID
+                    productData:(nullable GDTCORProductData *)productData
+                         target:(GDTCORTarget)target
+      serializedDataObjectBytes:(NSData *)serializedDataObjectBytes;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -21,8 +21,13 @@
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageProtocol.h"
 
 @class GDTCOREvent;
+@class GDTCORLibraryDataStore;
+@class GDTCORStorageDurabilityPolicy;
+@class GDTCORUploadBatch;
 @class GDTCORUploadCoordinator;
 
+@protocol GDTCORStorageEvictionPolicy;
+
 NS_ASSUME_NONNULL_BEGIN
 
 /** The event components eventID dictionary key. */
@@ -49,32 +54,70 @@ FOUNDATION_EXPORT NSString *const kGDTCORBatchComponentsExpirationKey;
 /** The maximum allowed disk space taken by the stored data. */
 FOUNDATION_EXPORT const uint64_t kGDTCORFlatFileStorageSizeLimit;
 
+/** The maximum allowed disk space taken by the request bodies stored for the batches of a target.
+ * The bodies are only a cache and carry no metrics, so the ones of the oldest batches are removed
+ * to stay within it, and they are removed before any event when the storage size limit is reached.
+ */
+FOUNDATION_EXPORT const uint64_t kGDTCORFlatFileStorageRequestBodiesSizeLimit;
+
+/** The time after the retry date of a stored request body after which it is no longer replayed, as
+ * the request time it carries is used by the backend to correct the clock of the device. The
+ * request is built again instead.
+ */
+FOUNDATION_EXPORT const NSTimeInterval kGDTCORFlatFileStorageRequestBodyMaxAge;
+
 FOUNDATION_EXPORT NSString *const GDTCORFlatFileStorageErrorDomain;
 
 typedef NS_ENUM(NSInteger, GDTCORFlatFileStorageError) {
-  GDTCORFlatFileStorageErrorSizeLimitReached = 0
+  GDTCORFlatFileStorageErrorSizeLimitReached = 0,
+  GDTCORFlatFileStorageErrorBatchNotFound = 1
 };
 
-/** Manages the storage of events. This class is thread-safe.
+/** Manages the storage of events. This class is thread-safe. The events of each target are
+ * stored, indexed, batched and size-tracked independently on a queue of their own, so that the
+ * work on one target doesn't delay the others. The storage size limit is shared by all targets.
  *
- * Event files will be stored as follows:
- * <app cache>/google-sdk-events/<classname>/gdt_event_data/<target>/<eventID>.<qosTier>.<mappingID>
+ * Event files will be stored as follows, where <shard> is two levels of directories picked by
+ * hashing the event ID:
+ * <app cache>/google-sdk-events/<classname>/gdt_event_data/<target>/<shard>/<eventID>.<qosTier>.
+ * <mappingID>
+ * Event files stored directly in gdt_event_data/<target> by earlier versions are moved to their
+ * shards when the target is first used.
  *
- * Library data will be stored as follows:
- * <app cache>/google-sdk-events/<classname>/gdt_library_data/<libraryDataKey>
+ * Library data will be stored in a single log-structured file:
+ * <app cache>/google-sdk-events/<classname>/gdt_library_data/gdt_library_data_store
+ * Files stored for each key in gdt_library_data by earlier versions are moved into it when the
+ * library data is first used.
  *
- * Batch data will be stored as follows:
- * <app
- * cache>/google-sdk-events/<classname>/gdt_batch_data/<target>.<batchID>/<eventID>.<qosTier>.<mappingID>
+ * Batched events stay in the event data directory, the batches of each target are recorded in a
+ * journal:
+ * <app cache>/google-sdk-events/<classname>/gdt_event_data/<target>/gdt_batch_journal
  */
 @interface GDTCORFlatFileStorage : NSObject <GDTCORStorageProtocol, GDTCORLifecycleProtocol>
 
-/** The queue on which all storage work will occur. */
+/** The queue on which the library data, batch ID and storage size work will occur. The events of
+ * each target are worked on the queue returned by `-queueForTarget:`.
+ */
 @property(nonatomic) dispatch_queue_t storageQueue;
 
 /** The upload coordinator instance used by this storage instance. */
 @property(nonatomic) GDTCORUploadCoordinator *uploadCoordinator;
 
+/** The policy choosing the stored events to evict when a new event doesn't fit in the storage
+ * size limit. If nil, which is the default, the new event is dropped instead.
+ */
+@property(nonatomic, nullable) id<GDTCORStorageEvictionPolicy> evictionPolicy;
+
+/** The policy choosing how durably each event file is written. By default every event is written
+ * atomically.
+ */
+@property(nonatomic) GDTCORStorageDurabilityPolicy *durabilityPolicy;
+
+/** The store of the library data, which is loaded on first access. Only accessed on the storage
+ * queue.
+ */
+@property(nonatomic, readonly) GDTCORLibraryDataStore *libraryDataStore;
+
 /** Creates and/or returns the storage singleton.
  *
  * @return The storage singleton.
@@ -99,12 +142,22 @@ typedef NS_ENUM(NSInteger, GDTCORFlatFileStorageError) {
  */
 + (NSString *)batchDataStoragePath;
 
-/** */
-+ (NSString *)batchPathForTarget:(GDTCORTarget)target
-                         batchID:(NSNumber *)batchID
-                  expirationDate:(NSDate *)expirationDate;
+/** Returns the path of the journal recording the batches of the target.
+ *
+ * @param target The target of the batches.
+ * @return The path of the journal recording the batches of the target.
+ */
++ (NSString *)batchJournalPathForTarget:(GDTCORTarget)target;
+
+/** Returns the serial queue on which the events of the target are stored, indexed and batched.
+ *
+ * @param target The target of the events.
+ * @return The queue of the target.
+ */
+- (dispatch_queue_t)queueForTarget:(GDTCORTarget)target;
 
-/** Returns a constructed storage path based on the given values. This path may not exist.
+/** Returns a constructed storage path based on the given values, in the shard directory of the
+ * event ID. This path may not exist.
  *
  * @param target The target, which is necessary to be given a path.
  * @param eventID The eventID.
@@ -119,6 +172,45 @@ typedef NS_ENUM(NSInteger, GDTCORFlatFileStorageError) {
              expirationDate:(NSDate *)expirationDate
                   mappingID:(NSString *)mappingID;
 
+/** Creates a batch of the events matching the selector by recording their files in the batch
+ * journal. Unlike `-batchWithEventSelector:batchExpiration:onComplete:` the events are not
+ * decoded, the returned batch reads them from their files when enumerated.
+ *
+ * @param eventSelector The event selector used to select the events to batch.
+ * @param expiration The expiration date of the batch.
+ * @param onComplete The callback with the new batch, or nil if there were no events to batch.
+ */
+- (void)uploadBatchWithEventSelector:(GDTCORStorageEventSelector *)eventSelector
+                     batchExpiration:(NSDate *)expiration
+                          onComplete:(void (^)(GDTCORUploadBatch *_Nullable batch))onComplete;
+
+/** Returns the oldest batch of the selected target left open by an earlier upload attempt, so that
+ * it can be resumed. Only a batch whose events all belong to the selected QoS tiers is resumed, the
+ * older batches are dissolved. The batch reads its events from their files when enumerated, and
+ * carries the request body stored for it, unless its retry date is more than
+ * `kGDTCORFlatFileStorageRequestBodyMaxAge` ago.
+ *
+ * @param eventSelector The selector of the target and QoS tiers that can be uploaded.
+ * @param onComplete The callback with the batch, or nil if no batch of the target can be resumed.
+ */
+- (void)pendingBatchWithEventSelector:(GDTCORStorageEventSelector *)eventSelector
+                          onComplete:(void (^)(GDTCORUploadBatch *_Nullable batch))onComplete;
+
+/** Stores the request body built for an open batch next to the events of its target, along with
+ * its CRC-32 so that a damaged body is never replayed. The body is removed along with the batch, or
+ * earlier if room is needed, see `kGDTCORFlatFileStorageRequestBodiesSizeLimit`.
+ *
+ * @param requestBody The request body.
+ * @param batchID The ID of the open batch.
+ * @param retryDate The date the next upload attempt is due, after the backoff the backend asked
+ * for. The age of the body is counted from it.
+ * @param onComplete The callback with the error if the body couldn't be stored.
+ */
+- (void)storeRequestBody:(NSData *)requestBody
+              forBatchID:(NSNumber *)batchID
+               retryDate:(NSDate *)retryDate
+              onComplete:(void (^)(NSError *_Nullable error))onComplete;
+
 /** Returns extant paths that match all of the given parameters.
  *
  * @param eventIDs The list of eventIDs to look for, or nil for any.
@@ -132,8 +224,9 @@ typedef NS_ENUM(NSInteger, GDTCORFlatFileStorageError) {
             mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
             onComplete:(void (^)(NSSet<NSString *> *paths))onComplete;
 
-/** Fetches the current batchID counter value from library storage, increments it, and sets the new
- * value. Returns nil if a batchID was not able to be created for some reason.
+/** Allocates the next 64-bit batchID in memory. Only the end of each reserved block of IDs is
+ * persisted, so that IDs stay unique across launches. Returns nil if a batchID was not able to be
+ * created for some reason.
  *
  * @param onComplete A block to execute when creating the next batchID is complete.
  */
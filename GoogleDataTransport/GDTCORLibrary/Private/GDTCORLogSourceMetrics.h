@@ -33,6 +33,13 @@ NS_ASSUME_NONNULL_BEGIN
 + (instancetype)metricsWithEvents:(NSArray<GDTCOREvent *> *)events
                  droppedForReason:(GDTCOREventDropReason)reason;
 
+/// Creates a log source metrics from counts of dropped events.
+/// @param droppedEventCounterByLogSource The number of dropped events for each drop reason
+/// (``GDTCOREventDropReason``), keyed by log source.
++ (instancetype)metricsWithDroppedEventCounterByLogSource:
+    (NSDictionary<NSString *, NSDictionary<NSNumber *, NSNumber *> *> *)
+        droppedEventCounterByLogSource;
+
 /// This API is unavailable.
 - (instancetype)init NS_UNAVAILABLE;
 
@@ -14,20 +14,39 @@
 
 #import <Foundation/Foundation.h>
 
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORLifecycle.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORMetricsControllerProtocol.h"
 
 @protocol GDTCORStoragePromiseProtocol;
 
 NS_ASSUME_NONNULL_BEGIN
 
-@interface GDTCORMetricsController : NSObject <GDTCORMetricsControllerProtocol>
+/// The default interval after which dropped events that were counted in memory are flushed to
+/// storage.
+FOUNDATION_EXPORT const NSTimeInterval kGDTCORMetricsControllerFlushInterval;
+
+/// Counts dropped events in memory and flushes the counts to storage after a flush interval, when
+/// the app is backgrounded or terminated, and before the stored metrics are read or updated.
+@interface GDTCORMetricsController : NSObject <GDTCORMetricsControllerProtocol,
+                                               GDTCORLifecycleProtocol>
 
 /// Returns the event metrics controller singleton.
 + (instancetype)sharedInstance;
 
+/// Creates a metrics controller flushing dropped event counts after the default flush interval.
+/// @param storage The storage object to read and write metrics data from.
+- (instancetype)initWithStorage:(id<GDTCORStoragePromiseProtocol>)storage;
+
 /// Designated initializer.
 /// @param storage The storage object to read and write metrics data from.
-- (instancetype)initWithStorage:(id<GDTCORStoragePromiseProtocol>)storage NS_DESIGNATED_INITIALIZER;
+/// @param flushInterval The interval after which dropped events counted in memory are flushed.
+- (instancetype)initWithStorage:(id<GDTCORStoragePromiseProtocol>)storage
+                  flushInterval:(NSTimeInterval)flushInterval NS_DESIGNATED_INITIALIZER;
+
+/// Flushes the dropped events counted in memory to storage.
+/// @return A promise resolving once the counts are flushed. It is never rejected; counts that
+/// couldn't be flushed are dropped.
+- (FBLPromise<NSNull *> *)flushDroppedEventCounters;
 
 /// This API is unavailable.
 - (instancetype)init NS_UNAVAILABLE;
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORLifecycle.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEventSelector.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageProtocol.h"
+
+@class GDTCOREvent;
+@class GDTCORUploadBatch;
+@class GDTCORUploadCoordinator;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** The maximum allowed disk space taken by the stored data. */
+FOUNDATION_EXPORT const uint64_t kGDTCORSegmentedLogStorageSizeLimit;
+
+/** The size after which the active segment of a target is sealed and a new one is started. */
+FOUNDATION_EXPORT const uint64_t kGDTCORSegmentedLogStorageSegmentSizeLimit;
+
+/** The default number of pending bytes at which a group commit is written. */
+FOUNDATION_EXPORT const uint64_t kGDTCORSegmentedLogStorageGroupCommitByteThreshold;
+
+FOUNDATION_EXPORT NSString *const GDTCORSegmentedLogStorageErrorDomain;
+
+/** The Info.plist key of a Boolean that opts the app in to the segmented log storage. When YES, the
+ * storage is registered for every target in place of `GDTCORFlatFileStorage`. Events stored by one
+ * storage are not moved to the other when the value changes.
+ */
+FOUNDATION_EXPORT NSString *const kGDTCORSegmentedLogStorageEnabledKey;
+
+/** The Info.plist key of a Number of seconds to use as the `groupCommitWindow` of the storage. */
+FOUNDATION_EXPORT NSString *const kGDTCORSegmentedLogStorageGroupCommitWindowKey;
+
+typedef NS_ENUM(NSInteger, GDTCORSegmentedLogStorageError) {
+  GDTCORSegmentedLogStorageErrorSizeLimitReached = 0,
+  GDTCORSegmentedLogStorageErrorWriteFailed = 1,
+};
+
+/** Manages the storage of events in append-only segment files. This class is thread-safe.
+ *
+ * Instead of writing one file per event, events are appended as framed records (magic, type,
+ * length, CRC-32, body) to size-bounded segment files:
+ * <app cache>/google-sdk-events/<classname>/gdt_segment_data/<target>/<segmentID>.log
+ *
+ * Removing an event appends a tombstone record. The in-memory index of live events is rebuilt by
+ * replaying the segments the first time the storage is used, and a torn record at the tail of a
+ * segment (e.g. after a crash mid-write) is truncated away. Segments are reclaimed from the head of
+ * the log once all of their events have been removed; a sparsely populated head segment has its
+ * remaining events relocated to the tail first.
+ *
+ * Forming a batch only marks the selected index entries as batched, the events are read from the
+ * segments when the batch is enumerated. Batches are tracked in memory only. Events of a batch
+ * that was in flight when the app was terminated become available for upload again on the next
+ * launch.
+ *
+ * Bursts of stored events can be coalesced into a group commit, see `groupCommitWindow`. The
+ * frames of a group are appended with a single write and synced to disk before the completion of
+ * each of its events is called.
+ *
+ * Library data will be stored as follows:
+ * <app cache>/google-sdk-events/<classname>/gdt_library_data/<libraryDataKey>
+ */
+@interface GDTCORSegmentedLogStorage : NSObject <GDTCORStorageProtocol, GDTCORLifecycleProtocol>
+
+/** The queue on which all storage work will occur. */
+@property(nonatomic, readonly) dispatch_queue_t storageQueue;
+
+/** The upload coordinator instance used by this storage instance. */
+@property(nonatomic) GDTCORUploadCoordinator *uploadCoordinator;
+
+/** The time events are held in memory waiting for more events to be committed with. Pending events
+ * are not visible to batches until they are committed. Defaults to 0, which writes each event as
+ * soon as it's stored without syncing it to disk.
+ */
+@property(nonatomic) NSTimeInterval groupCommitWindow;
+
+/** The number of pending bytes at which a group is committed without waiting for the window to
+ * end. Defaults to `kGDTCORSegmentedLogStorageGroupCommitByteThreshold`.
+ */
+@property(nonatomic) uint64_t groupCommitByteThreshold;
+
+/** Creates and/or returns the storage singleton. The singleton is only registered for the targets
+ * if the app opts in, see `kGDTCORSegmentedLogStorageEnabledKey`.
+ *
+ * @return The storage singleton.
+ */
++ (instancetype)sharedInstance;
+
+/** Returns the storage singleton configured by the given Info.plist, if it opts in to the storage.
+ *
+ * @param infoDictionary The Info.plist of the app.
+ * @return The storage singleton, or nil if `kGDTCORSegmentedLogStorageEnabledKey` isn't YES.
+ */
++ (nullable instancetype)sharedInstanceEnabledByInfoDictionary:
+    (nullable NSDictionary<NSString *, id> *)infoDictionary;
+
+/** Returns the base directory under which all segment files will be stored.
+ *
+ * @return The base directory under which all segment files will be stored.
+ */
++ (NSString *)segmentDataStoragePath;
+
+/** Returns the base directory under which all library data will be stored.
+ *
+ * @return The base directory under which all library data will be stored.
+ */
++ (NSString *)libraryDataStoragePath;
+
+/** Returns the path of a segment file. This path may not exist.
+ *
+ * @param target The target the segment belongs to.
+ * @param segmentID The sequence number of the segment.
+ * @return The path of the segment file.
+ */
++ (NSString *)segmentPathForTarget:(GDTCORTarget)target segmentID:(uint64_t)segmentID;
+
+/** Creates a batch of the events matching the selector without reading them. The returned batch
+ * reads the events from the segments on the storage queue when enumerated, or in place when it is
+ * enumerated on the storage queue.
+ *
+ * @param eventSelector The event selector used to select the events to batch.
+ * @param expiration The expiration date of the batch.
+ * @param onComplete The callback with the new batch, or nil if there were no events to batch.
+ */
+- (void)uploadBatchWithEventSelector:(GDTCORStorageEventSelector *)eventSelector
+                     batchExpiration:(NSDate *)expiration
+                          onComplete:(void (^)(GDTCORUploadBatch *_Nullable batch))onComplete;
+
+@end
+
+NS_ASSUME_NONNULL_END
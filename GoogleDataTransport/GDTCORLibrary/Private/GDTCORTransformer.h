@@ -52,6 +52,20 @@ NS_ASSUME_NONNULL_BEGIN
       withTransformers:(nullable NSArray<id<GDTCOREventTransformer>> *)transformers
             onComplete:(void (^_Nullable)(BOOL wasWritten, NSError *_Nullable error))completion;
 
+/** Writes the results of applying the given transformers' `transformGDTEvent:` method on the given
+ * events. The events are transformed in a single pass on the transformer queue, under a single
+ * background task, and handed to the storage of each target in bulk.
+ *
+ * @param events The events to apply transformers on.
+ * @param transformers The list of transformers to apply.
+ * @param completion A block to run when all the events were written to disk or dropped, with the
+ * number of events written and the error of an event that failed to be written, if any.
+ */
+- (void)transformEvents:(NSArray<GDTCOREvent *> *)events
+       withTransformers:(nullable NSArray<id<GDTCOREventTransformer>> *)transformers
+             onComplete:(void (^_Nullable)(NSUInteger writtenEventCount,
+                                           NSError *_Nullable error))completion;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -20,18 +20,55 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/// A source of batched events that reads the events from storage on demand, so that forming a
+/// batch doesn't require decoding its events and uploading it doesn't require holding all of them
+/// in memory at once.
+@protocol GDTCORUploadBatchEventSource <NSObject>
+
+/// The number of events reserved in the batch. Events that can't be read are skipped by
+/// `-enumerateEventsUsingBlock:`, so it may enumerate fewer events.
+@property(nonatomic, readonly) NSUInteger eventCount;
+
+/// Reads the events one at a time and passes each of them to the block. Can be called on any queue.
+- (void)enumerateEventsUsingBlock:(void (^)(GDTCOREvent *event, BOOL *stop))block;
+
+@end
+
 /// A data object representing a batch of events scheduled for upload.
 @interface GDTCORUploadBatch : NSObject
 
 /// An ID used to identify the batch in the storage.
 @property(nonatomic, readonly) NSNumber *batchID;
 
-/// The collection of the events in the batch.
+/// The collection of the events in the batch. When the batch is backed by an event source, all of
+/// the events are read into memory on each access, prefer `-enumerateEventsUsingBlock:`.
 @property(nonatomic, readonly) NSSet<GDTCOREvent *> *events;
 
+/// The number of events in the batch.
+@property(nonatomic, readonly) NSUInteger eventCount;
+
+/// The request body built for the batch by an earlier upload attempt, if the storage kept it. A
+/// batch carrying its request body can be sent again without reading its events.
+@property(nonatomic, readonly, nullable) NSData *requestBody;
+
 /// The default initializer. See also docs for the corresponding properties.
 - (instancetype)initWithBatchID:(NSNumber *)batchID events:(NSSet<GDTCOREvent *> *)events;
 
+/// Creates a batch whose events are read from the event source when enumerated.
+- (instancetype)initWithBatchID:(NSNumber *)batchID
+                    eventSource:(id<GDTCORUploadBatchEventSource>)eventSource;
+
+/// Passes the events of the batch to the block one at a time. Events read from an event source are
+/// not retained by the batch.
+- (void)enumerateEventsUsingBlock:(void (^)(GDTCOREvent *event, BOOL *stop))block;
+
+/// Returns a batch with the same ID and the events of the receiver plus the given event. The
+/// request body of the receiver doesn't include the event, so it is not kept.
+- (GDTCORUploadBatch *)batchByAddingEvent:(GDTCOREvent *)event;
+
+/// Returns a batch with the same ID and events as the receiver, carrying the given request body.
+- (GDTCORUploadBatch *)batchWithRequestBody:(NSData *)requestBody;
+
 @end
 
 NS_ASSUME_NONNULL_END
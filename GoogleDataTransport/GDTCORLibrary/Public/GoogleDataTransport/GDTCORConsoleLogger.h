@@ -68,6 +68,9 @@ typedef NS_ENUM(NSInteger, GDTCORMessageCode) {
   /** For warning messages concerning the reading of a event file. */
   GDTCORMCWFileReadError = 6,
 
+  /** For warning messages concerning a tracked storage size that drifted from the disk usage. */
+  GDTCORMCWStorageSizeDrift = 7,
+
   /** For error messages concerning transformGDTEvent: not being implemented by an event
      transformer. */
   GDTCORMCETransformerDoesntImplementTransform = 1000,
@@ -82,6 +82,32 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)sendDataEvent:(GDTCOREvent *)event;
 
+/** Copies and sends internal telemetry events in bulk. The events are transformed and stored
+ * together, with a single completion for all of them.
+ *
+ * @note This will convert the events' data objects to data and release the original events.
+ *
+ * @param events The events to send.
+ * @param completion A block that will be called when all the events have been written or dropped,
+ * with the number of events written and the error of an event that failed to be written, if any.
+ */
+- (void)sendTelemetryEvents:(NSArray<GDTCOREvent *> *)events
+                 onComplete:(void (^_Nullable)(NSUInteger writtenEventCount,
+                                               NSError *_Nullable error))completion;
+
+/** Copies and sends SDK service data events in bulk. The events are transformed and stored
+ * together, with a single completion for all of them.
+ *
+ * @note This will convert the events' data objects to data and release the original events.
+ *
+ * @param events The events to send.
+ * @param completion A block that will be called when all the events have been written or dropped,
+ * with the number of events written and the error of an event that failed to be written, if any.
+ */
+- (void)sendDataEvents:(NSArray<GDTCOREvent *> *)events
+            onComplete:(void (^_Nullable)(NSUInteger writtenEventCount,
+                                          NSError *_Nullable error))completion;
+
 /** Creates an event for use by this transport.
  *
  * @return An event that is suited for use by this transport.
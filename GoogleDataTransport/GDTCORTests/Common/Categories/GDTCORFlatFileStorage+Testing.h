@@ -18,7 +18,10 @@
 
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORFlatFileStorage.h"
 
+@class GDTCORBatchIDAllocator;
 @class GDTCORDirectorySizeTracker;
+@class GDTCORFlatFileStoragePartition;
+@class GDTCORStorageSizeBudget;
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -30,7 +33,19 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)reset;
 
-@property(nonatomic, readonly) GDTCORDirectorySizeTracker *sizeTracker;
+/** Checks the tracked sizes of all the storage directories against their disk usage.
+ *
+ * @return YES if every tracked size is exact.
+ */
+- (BOOL)reconcileStorageSize;
+
+@property(nonatomic, readonly) GDTCORStorageSizeBudget *sizeBudget;
+
+@property(nonatomic, readonly) GDTCORDirectorySizeTracker *libraryDataSizeTracker;
+
+@property(nonatomic, readonly) GDTCORBatchIDAllocator *batchIDAllocator;
+
+@property(nonatomic, readonly) NSArray<GDTCORFlatFileStoragePartition *> *partitions;
 
 @end
 
@@ -16,18 +16,35 @@
 
 #import "GoogleDataTransport/GDTCORTests/Common/Categories/GDTCORFlatFileStorage+Testing.h"
 
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORBatchIDAllocator.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORBatchJournal.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORFlatFileStoragePartition.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORLibraryDataStore.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEventIndex.h"
 
 @implementation GDTCORFlatFileStorage (Testing)
 
 // Defined privately.
-@dynamic sizeTracker;
+@dynamic sizeBudget;
+@dynamic libraryDataSizeTracker;
+@dynamic batchIDAllocator;
+@dynamic partitions;
 
 - (void)reset {
   dispatch_sync(self.storageQueue, ^{
     [[NSFileManager defaultManager] removeItemAtPath:GDTCORRootDirectory().path error:nil];
-    [[GDTCORFlatFileStorage sharedInstance].sizeTracker resetCachedSize];
+    [self.libraryDataSizeTracker resetCachedSize];
+    [self.libraryDataStore unload];
+    [self.batchIDAllocator reset];
   });
+  for (GDTCORFlatFileStoragePartition *partition in self.partitions) {
+    dispatch_sync(partition.queue, ^{
+      [partition.batchJournal unload];
+      [partition.eventIndex removeAllEntries];
+      [partition.sizeTracker resetCachedSize];
+    });
+  }
 
   dispatch_semaphore_t sema = dispatch_semaphore_create(0);
   [[GDTCORFlatFileStorage sharedInstance] storageSizeWithCallback:^(uint64_t storageSize) {
@@ -38,4 +55,17 @@
   [GDTCORFlatFileStorage load];
 }
 
+- (BOOL)reconcileStorageSize {
+  __block BOOL isExact = YES;
+  for (GDTCORFlatFileStoragePartition *partition in self.partitions) {
+    dispatch_sync(partition.queue, ^{
+      isExact = [partition.sizeTracker reconcileCachedSize] && isExact;
+    });
+  }
+  dispatch_sync(self.storageQueue, ^{
+    isExact = [self.libraryDataSizeTracker reconcileCachedSize] && isExact;
+  });
+  return isExact;
+}
+
 @end
@@ -24,6 +24,9 @@ NS_ASSUME_NONNULL_BEGIN
 /// Creates an storage fake.
 + (instancetype)storageFake;
 
+/// The number of times the stored metrics metadata was fetched and updated.
+@property(atomic, readonly) NSUInteger metricsUpdateCount;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -120,6 +120,7 @@
 - (nonnull FBLPromise<NSNull *> *)fetchAndUpdateMetricsWithHandler:
     (nonnull GDTCORMetricsMetadata * (^)(GDTCORMetricsMetadata *_Nullable,
                                          NSError *_Nullable))handler {
+  _metricsUpdateCount += 1;
   if (_storedMetricsMetadata != nil) {
     _storedMetricsMetadata = handler(_storedMetricsMetadata, nil);
   } else {
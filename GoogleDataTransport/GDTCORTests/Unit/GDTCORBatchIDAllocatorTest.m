@@ -0,0 +1,139 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORBatchIDAllocator.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORLibraryDataStore.h"
+
+@interface GDTCORBatchIDAllocatorTest : XCTestCase
+
+/** The library data store persisting the high-water mark. */
+@property(nonatomic) GDTCORLibraryDataStore *store;
+
+/** The size tracker of the directory containing the library data store. */
+@property(nonatomic) GDTCORDirectorySizeTracker *sizeTracker;
+
+@end
+
+/** The library data key of the high-water mark. */
+static NSString *const kHighWaterMarkKey = @"batchIDs";
+
+@implementation GDTCORBatchIDAllocatorTest
+
+- (void)setUp {
+  [super setUp];
+  NSString *directoryPath =
+      [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+  [[NSFileManager defaultManager] createDirectoryAtPath:directoryPath
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+  self.sizeTracker = [[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:directoryPath];
+  self.store = [self storeFromDisk];
+}
+
+- (void)tearDown {
+  [[NSFileManager defaultManager] removeItemAtPath:self.sizeTracker.directoryPath error:nil];
+  [super tearDown];
+}
+
+/** Tests that IDs are allocated in order and the high-water mark is only written once per block. */
+- (void)testNextBatchIDWritesHighWaterMarkOncePerBlock {
+  GDTCORBatchIDAllocator *allocator = [self allocatorWithBlockSize:10];
+
+  XCTAssertEqualObjects([allocator nextBatchID], @0);
+  XCTAssertEqual([self persistedHighWaterMark], 10);
+  uint64_t storeSize = [self.sizeTracker directoryContentSize];
+  XCTAssertGreaterThan(storeSize, sizeof(int64_t));
+
+  for (int64_t i = 1; i < 10; i++) {
+    XCTAssertEqualObjects([allocator nextBatchID], @(i));
+  }
+  XCTAssertEqual([self persistedHighWaterMark], 10);
+  XCTAssertEqual([self.sizeTracker directoryContentSize], storeSize);
+
+  XCTAssertEqualObjects([allocator nextBatchID], @10);
+  XCTAssertEqual([self persistedHighWaterMark], 20);
+  XCTAssertEqual([self.sizeTracker directoryContentSize], storeSize * 2);
+}
+
+/** Tests that a new allocator doesn't reuse the IDs reserved by a previous one. */
+- (void)testNextBatchIDIsUniqueAcrossRestarts {
+  GDTCORBatchIDAllocator *allocator = [self allocatorWithBlockSize:10];
+  XCTAssertEqualObjects([allocator nextBatchID], @0);
+  XCTAssertEqualObjects([allocator nextBatchID], @1);
+
+  [allocator reset];
+  XCTAssertEqualObjects([allocator nextBatchID], @10);
+
+  self.store = [self storeFromDisk];
+  GDTCORBatchIDAllocator *newAllocator = [self allocatorWithBlockSize:10];
+  XCTAssertEqualObjects([newAllocator nextBatchID], @20);
+}
+
+/** Tests that the 32-bit counter file written by previous versions is continued. */
+- (void)testNextBatchIDContinuesLegacyCounter {
+  int32_t counter = 42;
+  [[NSData dataWithBytes:&counter length:sizeof(counter)] writeToFile:[self legacyCounterPath]
+                                                           atomically:YES];
+
+  GDTCORBatchIDAllocator *allocator = [self allocatorWithBlockSize:10];
+  XCTAssertEqualObjects([allocator nextBatchID], @42);
+  XCTAssertEqual([self persistedHighWaterMark], 52);
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:[self legacyCounterPath]]);
+}
+
+/** Tests that IDs beyond the 32-bit range are allocated. */
+- (void)testNextBatchIDBeyondInt32Range {
+  int64_t highWaterMark = CFSwapInt64HostToLittle((int64_t)INT32_MAX + 1);
+  [self.store setData:[NSData dataWithBytes:&highWaterMark length:sizeof(highWaterMark)]
+                forKey:kHighWaterMarkKey
+                 error:nil];
+
+  GDTCORBatchIDAllocator *allocator = [self allocatorWithBlockSize:10];
+  XCTAssertEqualObjects([allocator nextBatchID], @((int64_t)INT32_MAX + 1));
+}
+
+#pragma mark - Helpers
+
+- (GDTCORBatchIDAllocator *)allocatorWithBlockSize:(int64_t)blockSize {
+  return [[GDTCORBatchIDAllocator alloc] initWithLibraryDataStore:self.store
+                                                              key:kHighWaterMarkKey
+                                                        blockSize:blockSize];
+}
+
+/** Returns a store replaying the store file from disk. */
+- (GDTCORLibraryDataStore *)storeFromDisk {
+  NSString *path = [self.sizeTracker.directoryPath stringByAppendingPathComponent:@"store"];
+  return [[GDTCORLibraryDataStore alloc] initWithPath:path sizeTracker:self.sizeTracker];
+}
+
+/** Returns the path of the file previous versions wrote the counter to. */
+- (NSString *)legacyCounterPath {
+  return [self.sizeTracker.directoryPath stringByAppendingPathComponent:kHighWaterMarkKey];
+}
+
+- (int64_t)persistedHighWaterMark {
+  NSData *data = [self.store dataForKey:kHighWaterMarkKey];
+  XCTAssertEqual(data.length, sizeof(int64_t));
+  int64_t highWaterMark = 0;
+  [data getBytes:&highWaterMark length:sizeof(highWaterMark)];
+  return (int64_t)CFSwapInt64LittleToHost(highWaterMark);
+}
+
+@end
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORBatchJournal.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
+
+@interface GDTCORBatchJournalTest : XCTestCase
+
+/** The path of the journal file. */
+@property(nonatomic) NSString *path;
+
+/** The size tracker of the directory containing the journal file. */
+@property(nonatomic) GDTCORDirectorySizeTracker *sizeTracker;
+
+@end
+
+@implementation GDTCORBatchJournalTest
+
+- (void)setUp {
+  [super setUp];
+  NSString *directoryPath =
+      [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+  [[NSFileManager defaultManager] createDirectoryAtPath:directoryPath
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+  self.path = [directoryPath stringByAppendingPathComponent:@"journal"];
+  self.sizeTracker = [[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:directoryPath];
+}
+
+- (void)tearDown {
+  [[NSFileManager defaultManager] removeItemAtPath:self.sizeTracker.directoryPath error:nil];
+  [super tearDown];
+}
+
+/** Tests that the open batches are replayed by a new journal. */
+- (void)testOpenBatchesAreReplayed {
+  GDTCORBatchJournal *journal = [self journal];
+  XCTAssertTrue([journal createBatch:[self batchWithID:@1 filenames:@[ @"a", @"b" ]] error:nil]);
+  XCTAssertTrue([journal createBatch:[self batchWithID:@2 filenames:@[ @"c" ]] error:nil]);
+  XCTAssertNotNil([journal abortBatchWithID:@1]);
+
+  GDTCORBatchJournal *newJournal = [self journal];
+  XCTAssertEqualObjects([newJournal load], @[]);
+  NSArray<GDTCORBatchJournalBatch *> *openBatches = [newJournal openBatches];
+  XCTAssertEqual(openBatches.count, 1);
+  GDTCORBatchJournalBatch *batch = openBatches.firstObject;
+  XCTAssertEqualObjects(batch.batchID, @2);
+  XCTAssertEqual(batch.target, kGDTCORTargetTest);
+  XCTAssertEqualObjects(batch.eventFilenames, @[ @"c" ]);
+  XCTAssertTrue([newJournal isEventFileBatched:@"c" target:kGDTCORTargetTest]);
+  XCTAssertFalse([newJournal isEventFileBatched:@"a" target:kGDTCORTargetTest]);
+  XCTAssertFalse([newJournal isEventFileBatched:@"c" target:kGDTCORTargetCCT]);
+}
+
+/** Tests that the batches committed before a crash are returned by load, so that their events can
+ * be deleted, and are only compacted away by compactIfNeeded.
+ */
+- (void)testCommittedBatchesAreReturnedByLoad {
+  GDTCORBatchJournal *journal = [self journal];
+  XCTAssertTrue([journal createBatch:[self batchWithID:@1 filenames:@[ @"a" ]] error:nil]);
+  XCTAssertTrue([journal createBatch:[self batchWithID:@2 filenames:@[ @"b" ]] error:nil]);
+  XCTAssertNotNil([journal commitBatchWithID:@1]);
+
+  GDTCORBatchJournal *newJournal = [self journal];
+  NSArray<GDTCORBatchJournalBatch *> *committedBatches = [newJournal load];
+  XCTAssertEqual(committedBatches.count, 1);
+  XCTAssertEqualObjects(committedBatches.firstObject.eventFilenames, @[ @"a" ]);
+  XCTAssertEqual([newJournal openBatches].count, 1);
+
+  // A crash before the client acted on the committed batch returns it again.
+  XCTAssertEqual([[self journal] load].count, 1);
+
+  [newJournal compactIfNeeded];
+  XCTAssertEqualObjects([[self journal] load], @[]);
+}
+
+/** Tests that a record torn by a crash is discarded together with its batch. */
+- (void)testTornRecordIsDiscarded {
+  GDTCORBatchJournal *journal = [self journal];
+  XCTAssertTrue([journal createBatch:[self batchWithID:@1 filenames:@[ @"a" ]] error:nil]);
+  uint64_t intactSize = [self journalFileSize];
+  XCTAssertTrue([journal createBatch:[self batchWithID:@2 filenames:@[ @"b" ]] error:nil]);
+  [journal unload];
+
+  NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingAtPath:self.path];
+  [fileHandle truncateFileAtOffset:[self journalFileSize] - 1];
+  [fileHandle closeFile];
+
+  GDTCORBatchJournal *newJournal = [self journal];
+  [newJournal load];
+  XCTAssertEqualObjects([[newJournal openBatches] valueForKeyPath:@"batchID"], @[ @1 ]);
+  [newJournal compactIfNeeded];
+  XCTAssertEqual([self journalFileSize], intactSize);
+}
+
+/** Tests that a record appended before compaction isn't lost behind a torn record. */
+- (void)testRecordAppendedAfterTornRecordIsReplayed {
+  GDTCORBatchJournal *journal = [self journal];
+  XCTAssertTrue([journal createBatch:[self batchWithID:@1 filenames:@[ @"a" ]] error:nil]);
+  XCTAssertTrue([journal createBatch:[self batchWithID:@2 filenames:@[ @"b" ]] error:nil]);
+  [journal unload];
+
+  NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingAtPath:self.path];
+  [fileHandle truncateFileAtOffset:[self journalFileSize] - 1];
+  [fileHandle closeFile];
+
+  GDTCORBatchJournal *newJournal = [self journal];
+  XCTAssertTrue([newJournal createBatch:[self batchWithID:@3 filenames:@[ @"c" ]] error:nil]);
+
+  NSArray *batchIDs = [[[[self journal] openBatches] valueForKeyPath:@"batchID"]
+      sortedArrayUsingSelector:@selector(compare:)];
+  XCTAssertEqualObjects(batchIDs, (@[ @1, @3 ]));
+}
+
+/** Tests that the journal is removed once no batch is open and the size tracker follows it. */
+- (void)testJournalIsEmptiedWhenNoBatchIsOpen {
+  [self.sizeTracker directoryContentSize];
+  GDTCORBatchJournal *journal = [self journal];
+  XCTAssertTrue([journal createBatch:[self batchWithID:@1 filenames:@[ @"a" ]] error:nil]);
+  XCTAssertEqual([self.sizeTracker directoryContentSize], [self journalFileSize]);
+
+  XCTAssertNotNil([journal commitBatchWithID:@1]);
+  XCTAssertNil([journal commitBatchWithID:@1]);
+  [journal compactIfNeeded];
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:self.path]);
+  XCTAssertEqual([self.sizeTracker directoryContentSize], 0);
+}
+
+#pragma mark - Helpers
+
+- (GDTCORBatchJournal *)journal {
+  return [[GDTCORBatchJournal alloc] initWithPath:self.path sizeTracker:self.sizeTracker];
+}
+
+- (GDTCORBatchJournalBatch *)batchWithID:(NSNumber *)batchID
+                               filenames:(NSArray<NSString *> *)filenames {
+  return [[GDTCORBatchJournalBatch alloc] initWithBatchID:batchID
+                                                   target:kGDTCORTargetTest
+                                           expirationDate:[NSDate distantFuture]
+                                           eventFilenames:filenames];
+}
+
+- (uint64_t)journalFileSize {
+  return [[[NSFileManager defaultManager] attributesOfItemAtPath:self.path error:nil] fileSize];
+}
+
+@end
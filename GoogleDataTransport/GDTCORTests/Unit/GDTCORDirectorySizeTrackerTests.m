@@ -32,4 +32,86 @@
   XCTAssertNoThrow([tracker directoryContentSize]);
 }
 
+/** Tests that the size is persisted and used by a new tracker instead of enumerating the directory.
+ */
+- (void)testPersistedSizeIsUsedByNewTracker {
+  NSString *path = [self createTemporaryDirectory];
+  [self writeFileOfSize:10 named:@"a" inDirectory:path];
+  GDTCORDirectorySizeTracker *tracker =
+      [[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:path];
+  XCTAssertEqual([tracker directoryContentSize], 10);
+  [tracker persistCachedSize];
+
+  // A file the trackers are not told about is not accounted for, as the directory is not
+  // enumerated.
+  [self writeFileOfSize:5 named:@"b" inDirectory:path];
+  GDTCORDirectorySizeTracker *newTracker =
+      [[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:path];
+  XCTAssertEqual([newTracker directoryContentSize], 10);
+}
+
+/** Tests that a change discards the persisted size, so a new tracker recalculates it. */
+- (void)testPersistedSizeIsDiscardedWhenSizeChanges {
+  NSString *path = [self createTemporaryDirectory];
+  NSString *sizeFilePath =
+      [path stringByAppendingPathComponent:kGDTCORDirectorySizeTrackerSizeFileName];
+  GDTCORDirectorySizeTracker *tracker =
+      [[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:path];
+  XCTAssertEqual([tracker directoryContentSize], 0);
+  [tracker persistCachedSize];
+  XCTAssertTrue([[NSFileManager defaultManager] fileExistsAtPath:sizeFilePath]);
+
+  NSString *filePath = [self writeFileOfSize:7 named:@"a" inDirectory:path];
+  [tracker fileWasAddedAtPath:filePath withSize:7];
+  XCTAssertEqual([tracker directoryContentSize], 7);
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:sizeFilePath]);
+
+  [self writeFileOfSize:5 named:@"b" inDirectory:path];
+  GDTCORDirectorySizeTracker *newTracker =
+      [[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:path];
+  XCTAssertEqual([newTracker directoryContentSize], 12);
+}
+
+#if !NDEBUG
+/** Tests that the reconciliation check detects a drift of the cached size. */
+- (void)testReconcileCachedSizeDetectsDrift {
+  NSString *path = [self createTemporaryDirectory];
+  GDTCORDirectorySizeTracker *tracker =
+      [[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:path];
+  XCTAssertEqual([tracker directoryContentSize], 0);
+
+  NSString *filePath = [self writeFileOfSize:4 named:@"a" inDirectory:path];
+  [tracker fileWasAddedAtPath:filePath withSize:4];
+  XCTAssertTrue([tracker reconcileCachedSize]);
+
+  [self writeFileOfSize:4 named:@"b" inDirectory:path];
+  XCTAssertFalse([tracker reconcileCachedSize]);
+}
+#endif  // !NDEBUG
+
+#pragma mark - Helpers
+
+/** Creates an empty temporary directory that is removed after the test. */
+- (NSString *)createTemporaryDirectory {
+  NSString *path =
+      [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+  XCTAssertTrue([[NSFileManager defaultManager] createDirectoryAtPath:path
+                                          withIntermediateDirectories:YES
+                                                           attributes:nil
+                                                                error:nil]);
+  [self addTeardownBlock:^{
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+  }];
+  return path;
+}
+
+/** Writes a file of the given size and returns its path. */
+- (NSString *)writeFileOfSize:(NSUInteger)size
+                        named:(NSString *)name
+                  inDirectory:(NSString *)directoryPath {
+  NSString *filePath = [directoryPath stringByAppendingPathComponent:name];
+  XCTAssertTrue([[NSMutableData dataWithLength:size] writeToFile:filePath atomically:YES]);
+  return filePath;
+}
+
 @end
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDroppedEventCounters.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
+
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORLogSourceMetrics.h"
+
+@interface GDTCORDroppedEventCountersTest : XCTestCase
+@end
+
+@implementation GDTCORDroppedEventCountersTest
+
+/** Tests that the counts are kept per log source and reason and match the log source metrics of
+ * the same events.
+ */
+- (void)testDrainReturnsCountsByLogSourceAndReason {
+  GDTCORDroppedEventCounters *counters = [[GDTCORDroppedEventCounters alloc] init];
+  NSArray<GDTCOREvent *> *tooOldEvents = @[
+    [self eventWithLogSource:@"log_source_1"], [self eventWithLogSource:@"log_source_1"],
+    [self eventWithLogSource:@"log_source_2"]
+  ];
+  NSArray<GDTCOREvent *> *storageFullEvents = @[ [self eventWithLogSource:@"log_source_2"] ];
+  [counters addEvents:tooOldEvents droppedForReason:GDTCOREventDropReasonMessageTooOld];
+  [counters addEvents:storageFullEvents droppedForReason:GDTCOREventDropReasonStorageFull];
+
+  GDTCORLogSourceMetrics *expectedMetrics = [[GDTCORLogSourceMetrics
+      metricsWithEvents:tooOldEvents
+       droppedForReason:GDTCOREventDropReasonMessageTooOld]
+      logSourceMetricsByMergingWithLogSourceMetrics:
+          [GDTCORLogSourceMetrics metricsWithEvents:storageFullEvents
+                                   droppedForReason:GDTCOREventDropReasonStorageFull]];
+  XCTAssertEqualObjects([counters drainLogSourceMetrics], expectedMetrics);
+}
+
+/** Tests that draining resets the counters. */
+- (void)testDrainResetsCounters {
+  GDTCORDroppedEventCounters *counters = [[GDTCORDroppedEventCounters alloc] init];
+  XCTAssertNil([counters drainLogSourceMetrics]);
+
+  [counters addEvents:@[ [self eventWithLogSource:@"log_source_1"] ]
+      droppedForReason:GDTCOREventDropReasonStorageFull];
+  XCTAssertNotNil([counters drainLogSourceMetrics]);
+  XCTAssertNil([counters drainLogSourceMetrics]);
+
+  [counters addEvents:@[ [self eventWithLogSource:@"log_source_1"] ]
+      droppedForReason:GDTCOREventDropReasonStorageFull];
+  XCTAssertEqualObjects(
+      [counters drainLogSourceMetrics],
+      [GDTCORLogSourceMetrics metricsWithEvents:@[ [self eventWithLogSource:@"log_source_1"] ]
+                               droppedForReason:GDTCOREventDropReasonStorageFull]);
+}
+
+/** Tests that no drop is lost when counted and drained concurrently. */
+- (void)testConcurrentDropsAreAllCounted {
+  GDTCORDroppedEventCounters *counters = [[GDTCORDroppedEventCounters alloc] init];
+  NSArray<GDTCOREvent *> *events = @[ [self eventWithLogSource:@"log_source_1"] ];
+  const size_t dropCount = 10000;
+
+  __block GDTCORLogSourceMetrics *drainedMetrics = [GDTCORLogSourceMetrics metrics];
+  dispatch_apply(dropCount, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t i) {
+    [counters addEvents:events droppedForReason:GDTCOREventDropReasonStorageFull];
+    if (i % 100 == 0) {
+      GDTCORLogSourceMetrics *metrics = [counters drainLogSourceMetrics];
+      @synchronized(self) {
+        if (metrics) {
+          drainedMetrics = [drainedMetrics logSourceMetricsByMergingWithLogSourceMetrics:metrics];
+        }
+      }
+    }
+  });
+  GDTCORLogSourceMetrics *remainingMetrics = [counters drainLogSourceMetrics];
+  if (remainingMetrics) {
+    drainedMetrics =
+        [drainedMetrics logSourceMetricsByMergingWithLogSourceMetrics:remainingMetrics];
+  }
+
+  GDTCORLogSourceMetrics *expectedMetrics = [GDTCORLogSourceMetrics
+      metricsWithDroppedEventCounterByLogSource:@{
+        @"log_source_1" : @{@(GDTCOREventDropReasonStorageFull) : @(dropCount)}
+      }];
+  XCTAssertEqualObjects(drainedMetrics, expectedMetrics);
+}
+
+#pragma mark - Helpers
+
+- (GDTCOREvent *)eventWithLogSource:(NSString *)logSource {
+  return [[GDTCOREvent alloc] initWithMappingID:logSource target:kGDTCORTargetTest];
+}
+
+@end
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventRecordCodec.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORPlatform.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORClock.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORProductData.h"
+
+#import "GoogleDataTransport/GDTCORTests/Unit/Helpers/GDTCORDataObjectTesterClasses.h"
+
+@interface GDTCOREventRecordCodecTest : XCTestCase
+
+@end
+
+@implementation GDTCOREventRecordCodecTest
+
+/** Tests that every stored property survives an encode/decode round trip. */
+- (void)testRoundTrip {
+  GDTCOREvent *event = [self eventWithProductData:[[GDTCORProductData alloc] initWithProductID:42]];
+  event.customBytes = [@"custom" dataUsingEncoding:NSUTF8StringEncoding];
+
+  NSError *error;
+  NSData *record = GDTCOREncodeEventRecord(event, &error);
+  XCTAssertNil(error);
+  XCTAssertTrue(GDTCORIsEventRecord(record));
+  XCTAssertLessThan(record.length, GDTCOREncodeArchive(event, nil, &error).length);
+
+  GDTCOREvent *decodedEvent = GDTCORDecodeEventRecord(record, &error);
+  XCTAssertNil(error);
+  [self assertEvent:decodedEvent isEqualToEvent:event];
+  XCTAssertEqual(decodedEvent.productData.productID, 42);
+  XCTAssertEqualObjects(decodedEvent.customBytes, event.customBytes);
+}
+
+/** Tests that optional properties that aren't set are decoded as nil. */
+- (void)testRoundTripWithoutOptionalProperties {
+  GDTCOREvent *event = [self eventWithProductData:nil];
+
+  NSError *error;
+  NSData *record = GDTCOREncodeEventRecord(event, &error);
+  GDTCOREvent *decodedEvent = GDTCORDecodeEventRecord(record, &error);
+  XCTAssertNil(error);
+  [self assertEvent:decodedEvent isEqualToEvent:event];
+  XCTAssertNil(decodedEvent.productData);
+  XCTAssertNil(decodedEvent.customBytes);
+}
+
+/** Tests that events archived by previous versions of the library can still be decoded. */
+- (void)testDecodingKeyedArchive {
+  GDTCOREvent *event = [self eventWithProductData:nil];
+
+  NSError *error;
+  NSData *archive = GDTCOREncodeArchive(event, nil, &error);
+  XCTAssertFalse(GDTCORIsEventRecord(archive));
+
+  GDTCOREvent *decodedEvent = GDTCORDecodeEventRecord(archive, &error);
+  XCTAssertNil(error);
+  [self assertEvent:decodedEvent isEqualToEvent:event];
+}
+
+/** Tests that truncated records and records of a newer version fail to decode. */
+- (void)testDecodingInvalidRecords {
+  NSData *record = GDTCOREncodeEventRecord([self eventWithProductData:nil], NULL);
+
+  NSError *error;
+  NSData *truncatedRecord = [record subdataWithRange:NSMakeRange(0, record.length - 1)];
+  XCTAssertNil(GDTCORDecodeEventRecord(truncatedRecord, &error));
+  XCTAssertEqual(error.code, GDTCOREventRecordErrorCorruptRecord);
+
+  NSMutableData *newerRecord = [record mutableCopy];
+  uint8_t newerVersion = kGDTCOREventRecordVersion + 1;
+  [newerRecord replaceBytesInRange:NSMakeRange(sizeof(uint32_t), 1) withBytes:&newerVersion];
+  error = nil;
+  XCTAssertNil(GDTCORDecodeEventRecord(newerRecord, &error));
+  XCTAssertEqual(error.code, GDTCOREventRecordErrorUnsupportedVersion);
+}
+
+#pragma mark - Helpers
+
+- (GDTCOREvent *)eventWithProductData:(GDTCORProductData *)productData {
+  GDTCOREvent *event = [[GDTCOREvent alloc] initWithMappingID:@"1018"
+                                                  productData:productData
+                                                       target:kGDTCORTargetTest];
+  event.dataObject = [[GDTCORDataObjectTesterSimple alloc] initWithString:@"someData"];
+  event.qosTier = GDTCOREventQoSFast;
+  event.clockSnapshot = [GDTCORClock snapshot];
+  return event;
+}
+
+- (void)assertEvent:(GDTCOREvent *)decodedEvent isEqualToEvent:(GDTCOREvent *)event {
+  XCTAssertNotNil(decodedEvent);
+  XCTAssertEqualObjects(decodedEvent.eventID, event.eventID);
+  XCTAssertEqualObjects(decodedEvent.mappingID, event.mappingID);
+  XCTAssertEqual(decodedEvent.target, event.target);
+  XCTAssertEqual(decodedEvent.qosTier, event.qosTier);
+  XCTAssertEqualObjects(decodedEvent.expirationDate, event.expirationDate);
+  XCTAssertEqualObjects(decodedEvent.serializedDataObjectBytes, event.serializedDataObjectBytes);
+  XCTAssertEqual(decodedEvent.clockSnapshot.timeMillis, event.clockSnapshot.timeMillis);
+  XCTAssertEqual(decodedEvent.clockSnapshot.timezoneOffsetSeconds,
+                 event.clockSnapshot.timezoneOffsetSeconds);
+  XCTAssertEqual(decodedEvent.clockSnapshot.kernelBootTimeNanoseconds,
+                 event.clockSnapshot.kernelBootTimeNanoseconds);
+  XCTAssertEqual(decodedEvent.clockSnapshot.uptimeNanoseconds,
+                 event.clockSnapshot.uptimeNanoseconds);
+  XCTAssertEqualObjects(decodedEvent, event);
+}
+
+@end
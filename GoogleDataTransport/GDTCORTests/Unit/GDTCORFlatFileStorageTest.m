@@ -23,9 +23,12 @@
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORLogSourceMetrics.h"
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORMetricsMetadata.h"
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORRegistrar_Private.h"
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORUploadBatch.h"
 
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventRecordCodec.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORPlatform.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORRegistrar.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEvictionPolicy.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORProductData.h"
 
@@ -41,6 +44,10 @@
 #import "GoogleDataTransport/GDTCORTests/Common/Categories/GDTCORRegistrar+Testing.h"
 
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORFlatFileStoragePartition.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORLibraryDataStore.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageDurabilityPolicy.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageSizeBudget.h"
 
 /** A category that adds finding a random element to NSSet. NSSet's -anyObject isn't random. */
 @interface NSSet (GDTCORRandomElement)
@@ -87,6 +94,9 @@
   // Destroy these objects before the next test begins.
   [GDTCORFlatFileStorage sharedInstance].uploadCoordinator =
       [[GDTCORUploadCoordinatorFake alloc] init];
+  [GDTCORFlatFileStorage sharedInstance].evictionPolicy = nil;
+  [GDTCORFlatFileStorage sharedInstance].durabilityPolicy =
+      [[GDTCORStorageDurabilityPolicy alloc] init];
 
   dispatch_sync([GDTCORFlatFileStorage sharedInstance].storageQueue, ^{
                 });
@@ -244,6 +254,405 @@
   [self waitForExpectations:@[ expectation ] timeout:10];
 }
 
+/** Tests that events written with relaxed durability are synced when the app backgrounds, and
+ * that events written with synced durability leave no temporary file behind.
+ */
+- (void)testStoreEventsWithDurability {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  [storage.durabilityPolicy setDurability:GDTCORStorageDurabilityRelaxed
+                                forTarget:kGDTCORTargetTest];
+  [storage.durabilityPolicy setDurability:GDTCORStorageDurabilitySynced
+                               forQoSTier:GDTCOREventQoSTelemetry];
+
+  GDTCOREvent *relaxedEvent = [[GDTCOREvent alloc] initWithMappingID:@"404"
+                                                              target:kGDTCORTargetTest];
+  relaxedEvent.dataObject = [[GDTCORDataObjectTesterSimple alloc] initWithString:@"relaxed"];
+  GDTCOREvent *syncedEvent = [[GDTCOREvent alloc] initWithMappingID:@"404"
+                                                             target:kGDTCORTargetFLL];
+  syncedEvent.qosTier = GDTCOREventQoSTelemetry;
+  syncedEvent.dataObject = [[GDTCORDataObjectTesterSimple alloc] initWithString:@"synced"];
+  for (GDTCOREvent *event in @[ relaxedEvent, syncedEvent ]) {
+    XCTestExpectation *writtenExpectation = [self expectationWithDescription:@"event written"];
+    [storage storeEvent:event
+             onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+               XCTAssertTrue(wasWritten);
+               XCTAssertNil(error);
+               [writtenExpectation fulfill];
+             }];
+    [self waitForExpectations:@[ writtenExpectation ] timeout:10.0];
+  }
+
+  GDTCORFlatFileStoragePartition *relaxedPartition = [self partitionOfTarget:kGDTCORTargetTest];
+  dispatch_sync(relaxedPartition.queue, ^{
+    XCTAssertEqual(relaxedPartition.unsyncedEventPaths.count, 1);
+  });
+  [storage appWillBackground:[GDTCORApplication sharedApplication]];
+  dispatch_sync(relaxedPartition.queue, ^{
+    XCTAssertEqual(relaxedPartition.unsyncedEventPaths.count, 0);
+  });
+
+  NSString *syncedEventPath = [GDTCORFlatFileStorage pathForTarget:syncedEvent.target
+                                                           eventID:syncedEvent.eventID
+                                                           qosTier:@(syncedEvent.qosTier)
+                                                    expirationDate:syncedEvent.expirationDate
+                                                         mappingID:syncedEvent.mappingID];
+  NSArray<NSString *> *filenames = [[NSFileManager defaultManager]
+      contentsOfDirectoryAtPath:[syncedEventPath stringByDeletingLastPathComponent]
+                          error:nil];
+  XCTAssertEqualObjects(filenames, @[ [syncedEventPath lastPathComponent] ]);
+
+  for (GDTCOREvent *event in @[ relaxedEvent, syncedEvent ]) {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"batch fetched"];
+    [storage batchWithEventSelector:[GDTCORStorageEventSelector eventSelectorForTarget:event.target]
+                    batchExpiration:[NSDate dateWithTimeIntervalSinceNow:60]
+                         onComplete:^(NSNumber *_Nullable batchID,
+                                      NSSet<GDTCOREvent *> *_Nullable batchEvents) {
+                           XCTAssertEqualObjects(batchEvents, [NSSet setWithObject:event]);
+                           [expectation fulfill];
+                         }];
+    [self waitForExpectations:@[ expectation ] timeout:10.0];
+  }
+}
+
+/** Tests that an open batch is returned for resumption along with its stored request body, and
+ * that the body is removed with the batch.
+ */
+- (void)testPendingBatchIsResumedWithItsRequestBody {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  GDTCOREvent *event = [[GDTCOREvent alloc] initWithMappingID:@"404" target:kGDTCORTargetTest];
+  event.dataObject = [[GDTCORDataObjectTesterSimple alloc] initWithString:@"testString"];
+  XCTestExpectation *writtenExpectation = [self expectationWithDescription:@"event written"];
+  [storage storeEvent:event
+           onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+             [writtenExpectation fulfill];
+           }];
+  [self waitForExpectations:@[ writtenExpectation ] timeout:10.0];
+
+  __block NSNumber *batchID;
+  XCTestExpectation *batchExpectation = [self expectationWithDescription:@"batch created"];
+  [storage uploadBatchWithEventSelector:[GDTCORStorageEventSelector
+                                            eventSelectorForTarget:kGDTCORTargetTest]
+                        batchExpiration:[NSDate dateWithTimeIntervalSinceNow:60]
+                             onComplete:^(GDTCORUploadBatch *_Nullable batch) {
+                               batchID = batch.batchID;
+                               [batchExpectation fulfill];
+                             }];
+  [self waitForExpectations:@[ batchExpectation ] timeout:10.0];
+  XCTAssertNotNil(batchID);
+
+  XCTestExpectation *pendingExpectation = [self expectationWithDescription:@"pending batch"];
+  GDTCORStorageEventSelector *selector =
+      [GDTCORStorageEventSelector eventSelectorForTarget:kGDTCORTargetTest];
+  [storage pendingBatchWithEventSelector:selector
+                              onComplete:^(GDTCORUploadBatch *_Nullable batch) {
+                                XCTAssertEqualObjects(batch.batchID, batchID);
+                                XCTAssertEqualObjects(batch.events, [NSSet setWithObject:event]);
+                                XCTAssertNil(batch.requestBody);
+                                [pendingExpectation fulfill];
+                              }];
+  [self waitForExpectations:@[ pendingExpectation ] timeout:10.0];
+
+  NSData *requestBody = [@"requestBody" dataUsingEncoding:NSUTF8StringEncoding];
+  XCTestExpectation *storedExpectation = [self expectationWithDescription:@"body stored"];
+  [storage storeRequestBody:requestBody
+                 forBatchID:batchID
+                  retryDate:[NSDate date]
+                 onComplete:^(NSError *_Nullable error) {
+                   XCTAssertNil(error);
+                   [storedExpectation fulfill];
+                 }];
+  [self waitForExpectations:@[ storedExpectation ] timeout:10.0];
+
+  pendingExpectation = [self expectationWithDescription:@"pending batch with body"];
+  [storage pendingBatchWithEventSelector:selector
+                              onComplete:^(GDTCORUploadBatch *_Nullable batch) {
+                                XCTAssertEqualObjects(batch.batchID, batchID);
+                                XCTAssertEqualObjects(batch.requestBody, requestBody);
+                                [pendingExpectation fulfill];
+                              }];
+  [self waitForExpectations:@[ pendingExpectation ] timeout:10.0];
+
+  XCTestExpectation *removedExpectation = [self expectationWithDescription:@"batch removed"];
+  [storage removeBatchWithID:batchID
+                deleteEvents:NO
+                  onComplete:^{
+                    [removedExpectation fulfill];
+                  }];
+  [self waitForExpectations:@[ removedExpectation ] timeout:10.0];
+
+  GDTCORFlatFileStoragePartition *partition = [self partitionOfTarget:kGDTCORTargetTest];
+  XCTAssertFalse([[NSFileManager defaultManager]
+      fileExistsAtPath:[partition requestBodyPathForBatchID:batchID]]);
+  pendingExpectation = [self expectationWithDescription:@"no pending batch"];
+  [storage pendingBatchWithEventSelector:selector
+                              onComplete:^(GDTCORUploadBatch *_Nullable batch) {
+                                XCTAssertNil(batch);
+                                [pendingExpectation fulfill];
+                              }];
+  [self waitForExpectations:@[ pendingExpectation ] timeout:10.0];
+
+  // The body of a batch that is not open is not stored.
+  storedExpectation = [self expectationWithDescription:@"body not stored"];
+  [storage storeRequestBody:requestBody
+                 forBatchID:batchID
+                  retryDate:[NSDate date]
+                 onComplete:^(NSError *_Nullable error) {
+                   XCTAssertEqual(error.code, GDTCORFlatFileStorageErrorBatchNotFound);
+                   [storedExpectation fulfill];
+                 }];
+  [self waitForExpectations:@[ storedExpectation ] timeout:10.0];
+}
+
+/** Tests that a damaged request body is removed instead of being returned with its batch. */
+- (void)testDamagedRequestBodyIsNotReplayed {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  NSNumber *batchID = [self batchIDOfNewBatchForTarget:kGDTCORTargetTest];
+  NSData *requestBody = [@"requestBody" dataUsingEncoding:NSUTF8StringEncoding];
+  XCTAssertNil([self storeRequestBody:requestBody forBatchID:batchID]);
+
+  // Flip the last byte of the stored body.
+  NSString *requestBodyPath = [[self partitionOfTarget:kGDTCORTargetTest]
+      requestBodyPathForBatchID:batchID];
+  NSMutableData *storedRequestBody = [NSMutableData dataWithContentsOfFile:requestBodyPath];
+  ((uint8_t *)storedRequestBody.mutableBytes)[storedRequestBody.length - 1] ^= 0xFF;
+  XCTAssertTrue([storedRequestBody writeToFile:requestBodyPath atomically:YES]);
+
+  XCTestExpectation *pendingExpectation = [self expectationWithDescription:@"pending batch"];
+  GDTCORStorageEventSelector *selector =
+      [GDTCORStorageEventSelector eventSelectorForTarget:kGDTCORTargetTest];
+  [storage pendingBatchWithEventSelector:selector
+                              onComplete:^(GDTCORUploadBatch *_Nullable batch) {
+                                XCTAssertEqualObjects(batch.batchID, batchID);
+                                XCTAssertNil(batch.requestBody);
+                                [pendingExpectation fulfill];
+                              }];
+  [self waitForExpectations:@[ pendingExpectation ] timeout:10.0];
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:requestBodyPath]);
+}
+
+/** Tests that an event file that can't be decoded while enumerating a batch is removed, and that
+ * the tracked storage size follows.
+ */
+- (void)testUndecodableBatchedEventFileIsRemoved {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  GDTCOREvent *event = [[self generateEventsForTarget:kGDTCORTargetTest
+                                           expiringIn:1000
+                                                count:1] anyObject];
+  NSString *eventPath = [GDTCORFlatFileStorage pathForTarget:event.target
+                                                     eventID:event.eventID
+                                                     qosTier:@(event.qosTier)
+                                              expirationDate:event.expirationDate
+                                                   mappingID:event.mappingID];
+  // Damage the event file without changing its size.
+  NSUInteger length = [NSData dataWithContentsOfFile:eventPath].length;
+  XCTAssertTrue([[NSMutableData dataWithLength:length] writeToFile:eventPath atomically:NO]);
+
+  __block GDTCORUploadBatch *uploadBatch;
+  XCTestExpectation *batchExpectation = [self expectationWithDescription:@"batch created"];
+  [storage uploadBatchWithEventSelector:[GDTCORStorageEventSelector
+                                            eventSelectorForTarget:kGDTCORTargetTest]
+                        batchExpiration:[NSDate dateWithTimeIntervalSinceNow:60]
+                             onComplete:^(GDTCORUploadBatch *_Nullable batch) {
+                               uploadBatch = batch;
+                               [batchExpectation fulfill];
+                             }];
+  [self waitForExpectations:@[ batchExpectation ] timeout:10.0];
+  XCTAssertEqual(uploadBatch.eventCount, 1);
+
+  [uploadBatch enumerateEventsUsingBlock:^(GDTCOREvent *event, BOOL *stop) {
+    XCTFail(@"The damaged event shouldn't be read.");
+  }];
+  dispatch_sync([storage queueForTarget:kGDTCORTargetTest], ^{
+                });
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:eventPath]);
+#if !NDEBUG
+  [self assertStorageSizeIsExactInStorage:storage];
+#endif  // !NDEBUG
+}
+
+/** Tests that a kept batch holding events of QoS tiers that can't be uploaded under the current
+ * conditions is dissolved instead of being resumed.
+ */
+- (void)testPendingBatchWithUnselectedQosTierIsDissolved {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  GDTCOREvent *event = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetTest
+                                                            qosTier:@(GDTCOREventQoSWifiOnly)
+                                                          mappingID:nil];
+  XCTestExpectation *writtenExpectation = [self expectationWithDescription:@"event written"];
+  [storage storeEvent:event
+           onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+             [writtenExpectation fulfill];
+           }];
+  [self waitForExpectations:@[ writtenExpectation ] timeout:10.0];
+
+  __block NSNumber *batchID;
+  XCTestExpectation *batchExpectation = [self expectationWithDescription:@"batch created"];
+  [storage uploadBatchWithEventSelector:[GDTCORStorageEventSelector
+                                            eventSelectorForTarget:kGDTCORTargetTest]
+                        batchExpiration:[NSDate dateWithTimeIntervalSinceNow:60]
+                             onComplete:^(GDTCORUploadBatch *_Nullable batch) {
+                               batchID = batch.batchID;
+                               [batchExpectation fulfill];
+                             }];
+  [self waitForExpectations:@[ batchExpectation ] timeout:10.0];
+  XCTAssertNotNil(batchID);
+
+  // Only the tiers that can be sent on mobile data are selected.
+  NSSet<NSNumber *> *qosTiers = [NSSet setWithArray:@[ @(GDTCOREventQoSFast) ]];
+  GDTCORStorageEventSelector *selector =
+      [[GDTCORStorageEventSelector alloc] initWithTarget:kGDTCORTargetTest
+                                                eventIDs:nil
+                                              mappingIDs:nil
+                                                qosTiers:qosTiers];
+  XCTestExpectation *pendingExpectation = [self expectationWithDescription:@"no pending batch"];
+  [storage pendingBatchWithEventSelector:selector
+                              onComplete:^(GDTCORUploadBatch *_Nullable batch) {
+                                XCTAssertNil(batch);
+                                [pendingExpectation fulfill];
+                              }];
+  [self waitForExpectations:@[ pendingExpectation ] timeout:10.0];
+
+  // The event is available to be batched again.
+  XCTestExpectation *batchIDsExpectation = [self expectationWithDescription:@"no open batch"];
+  [storage batchIDsForTarget:kGDTCORTargetTest
+                  onComplete:^(NSSet<NSNumber *> *_Nullable batchIDs) {
+                    XCTAssertNil(batchIDs);
+                    [batchIDsExpectation fulfill];
+                  }];
+  XCTestExpectation *hasEventsExpectation = [self expectationWithDescription:@"has events"];
+  [storage hasEventsForTarget:kGDTCORTargetTest
+                   onComplete:^(BOOL hasEvents) {
+                     XCTAssertTrue(hasEvents);
+                     [hasEventsExpectation fulfill];
+                   }];
+  [self waitForExpectations:@[ batchIDsExpectation, hasEventsExpectation ] timeout:10.0];
+}
+
+/** Tests that a request body whose retry date is too long ago is removed instead of being
+ * replayed, as the request time it carries is outdated.
+ */
+- (void)testOutdatedRequestBodyIsNotReplayed {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  NSNumber *batchID = [self batchIDOfNewBatchForTarget:kGDTCORTargetTest];
+  NSData *requestBody = [@"requestBody" dataUsingEncoding:NSUTF8StringEncoding];
+  NSDate *retryDate =
+      [NSDate dateWithTimeIntervalSinceNow:-kGDTCORFlatFileStorageRequestBodyMaxAge - 1];
+  XCTAssertNil([self storeRequestBody:requestBody forBatchID:batchID retryDate:retryDate]);
+
+  NSString *requestBodyPath = [[self partitionOfTarget:kGDTCORTargetTest]
+      requestBodyPathForBatchID:batchID];
+
+  XCTestExpectation *pendingExpectation = [self expectationWithDescription:@"pending batch"];
+  [storage pendingBatchWithEventSelector:[GDTCORStorageEventSelector
+                                             eventSelectorForTarget:kGDTCORTargetTest]
+                              onComplete:^(GDTCORUploadBatch *_Nullable batch) {
+                                XCTAssertEqualObjects(batch.batchID, batchID);
+                                XCTAssertNil(batch.requestBody);
+                                [pendingExpectation fulfill];
+                              }];
+  [self waitForExpectations:@[ pendingExpectation ] timeout:10.0];
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:requestBodyPath]);
+#if !NDEBUG
+  [self assertStorageSizeIsExactInStorage:storage];
+#endif  // !NDEBUG
+}
+
+/** Tests that a request body kept through the default 15 minute backoff of the uploader is still
+ * replayed once the backoff is over, as its age is counted from its retry date.
+ */
+- (void)testRequestBodyIsReplayedAfterDefaultBackoff {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  NSNumber *batchID = [self batchIDOfNewBatchForTarget:kGDTCORTargetTest];
+  NSData *requestBody = [@"requestBody" dataUsingEncoding:NSUTF8StringEncoding];
+  NSTimeInterval backoff = 15 * 60;
+  XCTAssertGreaterThan(backoff, kGDTCORFlatFileStorageRequestBodyMaxAge);
+  XCTAssertNil([self storeRequestBody:requestBody
+                           forBatchID:batchID
+                            retryDate:[NSDate dateWithTimeIntervalSinceNow:backoff]]);
+
+  // Age the body by the backoff, as if it was stored when the upload failed.
+  NSString *requestBodyPath = [[self partitionOfTarget:kGDTCORTargetTest]
+      requestBodyPathForBatchID:batchID];
+  XCTAssertTrue([[NSFileManager defaultManager]
+      setAttributes:@{NSFileModificationDate : [NSDate dateWithTimeIntervalSinceNow:-backoff]}
+       ofItemAtPath:requestBodyPath
+              error:nil]);
+
+  XCTestExpectation *pendingExpectation = [self expectationWithDescription:@"pending batch"];
+  [storage pendingBatchWithEventSelector:[GDTCORStorageEventSelector
+                                             eventSelectorForTarget:kGDTCORTargetTest]
+                              onComplete:^(GDTCORUploadBatch *_Nullable batch) {
+                                XCTAssertEqualObjects(batch.batchID, batchID);
+                                XCTAssertEqualObjects(batch.requestBody, requestBody);
+                                [pendingExpectation fulfill];
+                              }];
+  [self waitForExpectations:@[ pendingExpectation ] timeout:10.0];
+}
+
+/** Tests that the request bodies of the oldest batches are removed to keep the bodies of a target
+ * within their size limit, and that a body larger than the limit isn't stored.
+ */
+- (void)testRequestBodiesAreKeptWithinTheirSizeLimit {
+  NSNumber *batchID1 = [self batchIDOfNewBatchForTarget:kGDTCORTargetTest];
+  NSNumber *batchID2 = [self batchIDOfNewBatchForTarget:kGDTCORTargetTest];
+  NSMutableData *requestBody =
+      [NSMutableData dataWithLength:kGDTCORFlatFileStorageRequestBodiesSizeLimit * 2 / 3];
+  XCTAssertNil([self storeRequestBody:requestBody forBatchID:batchID1]);
+  XCTAssertNil([self storeRequestBody:requestBody forBatchID:batchID2]);
+
+  GDTCORFlatFileStoragePartition *partition = [self partitionOfTarget:kGDTCORTargetTest];
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  XCTAssertFalse([fileManager fileExistsAtPath:[partition requestBodyPathForBatchID:batchID1]]);
+  XCTAssertTrue([fileManager fileExistsAtPath:[partition requestBodyPathForBatchID:batchID2]]);
+
+  [requestBody setLength:kGDTCORFlatFileStorageRequestBodiesSizeLimit];
+  NSError *error = [self storeRequestBody:requestBody forBatchID:batchID1];
+  XCTAssertEqual(error.code, GDTCORFlatFileStorageErrorSizeLimitReached);
+  XCTAssertFalse([fileManager fileExistsAtPath:[partition requestBodyPathForBatchID:batchID1]]);
+#if !NDEBUG
+  [self assertStorageSizeIsExactInStorage:[GDTCORFlatFileStorage sharedInstance]];
+#endif  // !NDEBUG
+}
+
+/** Tests storing events of several targets in bulk. */
+- (void)testStoreEventsInBulk {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  NSMutableArray<GDTCOREvent *> *events = [NSMutableArray array];
+  for (NSNumber *target in @[ @(kGDTCORTargetTest), @(kGDTCORTargetFLL), @(kGDTCORTargetTest) ]) {
+    GDTCOREvent *event = [[GDTCOREvent alloc] initWithMappingID:@"404"
+                                                         target:target.integerValue];
+    event.dataObject = [[GDTCORDataObjectTesterSimple alloc] initWithString:@"testString"];
+    event.clockSnapshot = [GDTCORClock snapshot];
+    [events addObject:event];
+  }
+  GDTCOREvent *eventWithoutData = [[GDTCOREvent alloc] initWithMappingID:@"404"
+                                                                  target:kGDTCORTargetTest];
+  [events addObject:eventWithoutData];
+
+  XCTestExpectation *writtenExpectation = [self expectationWithDescription:@"events written"];
+  [storage storeEvents:events
+            onComplete:^(NSUInteger storedEventCount, NSError *_Nullable error) {
+              XCTAssertEqual(storedEventCount, 3);
+              XCTAssertNotNil(error);
+              [writtenExpectation fulfill];
+            }];
+  [self waitForExpectations:@[ writtenExpectation ] timeout:10.0];
+
+  for (NSNumber *target in @[ @(kGDTCORTargetTest), @(kGDTCORTargetFLL) ]) {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"batch fetched"];
+    [storage batchWithEventSelector:[GDTCORStorageEventSelector
+                                        eventSelectorForTarget:target.integerValue]
+                    batchExpiration:[NSDate dateWithTimeIntervalSinceNow:60]
+                         onComplete:^(NSNumber *_Nullable batchID,
+                                      NSSet<GDTCOREvent *> *_Nullable batchEvents) {
+                           XCTAssertEqual(batchEvents.count,
+                                          target.integerValue == kGDTCORTargetTest ? 2 : 1);
+                           [expectation fulfill];
+                         }];
+    [self waitForExpectations:@[ expectation ] timeout:10];
+  }
+}
+
 /** Tests sending a fast priority event causes an upload attempt. */
 - (void)testQoSTierFast {
   GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
@@ -261,7 +670,7 @@
                             }]);
   [self waitForExpectations:@[ writtenExpectation ] timeout:10.0];
 
-  dispatch_sync(storage.storageQueue, ^{
+  dispatch_sync([storage queueForTarget:kGDTCORTargetTest], ^{
     XCTAssertTrue(self.uploaderFake.forceUploadCalled);
   });
 }
@@ -410,12 +819,9 @@
 - (void)testMetricsStorageLocationRegressions {
   // Given
   // - Initially, there should be no library data stored.
-  NSString *metricsMetadataPath = [GDTCORFlatFileStorage.libraryDataStoragePath
-      stringByAppendingPathComponent:@"metrics_metadata"];
+  NSString *libraryDataStorePath = GDTCORFlatFileStorage.sharedInstance.libraryDataStore.path;
+  XCTAssertFalse([NSFileManager.defaultManager fileExistsAtPath:libraryDataStorePath]);
   NSError *error;
-  XCTAssertNil([[NSFileManager defaultManager] contentsOfDirectoryAtPath:metricsMetadataPath
-                                                                   error:&error]);
-  XCTAssertNotNil(error);
 
   // When
   __auto_type fetchAndUpdatePromise = [GDTCORFlatFileStorage.sharedInstance
@@ -431,12 +837,11 @@
   // Then
   FBLWaitForPromisesWithTimeout(0.5);
   XCTAssert(fetchAndUpdatePromise.isFulfilled);
-  // - Finally, there should be only one new file.
+  // - Finally, there should be only one new file, the library data store.
   NSArray *contentsPaths = [[NSFileManager defaultManager]
       contentsOfDirectoryAtPath:[GDTCORFlatFileStorage libraryDataStoragePath]
                           error:&error];
-  XCTAssertEqual(contentsPaths.count, 1);
-  XCTAssertTrue([NSFileManager.defaultManager fileExistsAtPath:metricsMetadataPath]);
+  XCTAssertEqualObjects(contentsPaths, @[ libraryDataStorePath.lastPathComponent ]);
 }
 
 - (void)testSaveAndLoadLibraryData {
@@ -873,6 +1278,54 @@
   [self waitForExpectations:@[ batchIDsExpectation ] timeout:5];
 }
 
+/** Tests that an upload batch is formed by recording event files and reads them when enumerated. */
+- (void)testUploadBatchWithEventSelector {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  NSSet<GDTCOREvent *> *generatedEvents = [self generateEventsForTarget:kGDTCORTargetTest
+                                                             expiringIn:1000
+                                                                  count:5];
+
+  FBLPromise<GDTCORUploadBatch *> *batchPromise = [storage
+      batchWithEventSelector:[GDTCORStorageEventSelector eventSelectorForTarget:kGDTCORTargetTest]
+             batchExpiration:[NSDate dateWithTimeIntervalSinceNow:600]];
+  FBLWaitForPromisesWithTimeout(1);
+
+  GDTCORUploadBatch *batch = batchPromise.value;
+  XCTAssertNotNil(batch);
+  XCTAssertEqual(batch.eventCount, generatedEvents.count);
+  [self assertBatchIDs:[NSSet setWithObject:batch.batchID] inStorage:storage];
+
+  NSMutableSet<NSString *> *enumeratedEventIDs = [NSMutableSet set];
+  [batch enumerateEventsUsingBlock:^(GDTCOREvent *_Nonnull event, BOOL *_Nonnull stop) {
+    [enumeratedEventIDs addObject:event.eventID];
+  }];
+  XCTAssertEqualObjects(enumeratedEventIDs, [generatedEvents valueForKeyPath:@"eventID"]);
+}
+
+/** Tests that a bounded selector batches no more events than its limit. */
+- (void)testUploadBatchWithBoundedEventSelector {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  [self generateEventsForTarget:kGDTCORTargetTest expiringIn:1000 count:5];
+  GDTCORStorageEventSelector *selector = [[GDTCORStorageEventSelector alloc]
+         initWithTarget:kGDTCORTargetTest
+               eventIDs:nil
+             mappingIDs:nil
+               qosTiers:nil
+          maxEventCount:2
+      maxBatchSizeBytes:0
+                  order:GDTCORStorageEventSelectorOrderPriorityFirst];
+
+  FBLPromise<GDTCORUploadBatch *> *batchPromise =
+      [storage batchWithEventSelector:selector
+                      batchExpiration:[NSDate dateWithTimeIntervalSinceNow:600]];
+  FBLWaitForPromisesWithTimeout(1);
+
+  XCTAssertEqual(batchPromise.value.eventCount, 2);
+  FBLPromise<NSNumber *> *hasEventsPromise = [storage hasEventsForTarget:kGDTCORTargetTest];
+  FBLWaitForPromisesWithTimeout(1);
+  XCTAssertTrue(hasEventsPromise.value.boolValue);
+}
+
 #pragma mark - Expiration tests
 
 /** Tests events expiring at a given time. */
@@ -925,6 +1378,46 @@
   [self waitForExpectations:@[ metricsControllerExpectation, expectation ] timeout:10];
 }
 
+/** Tests that expired events are reported from their metadata and that the storage size is updated
+ * without a rescan.
+ */
+- (void)testCheckForExpirations_ReportsExpiredEventsFromMetadata {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  GDTCOREvent *expiredEvent = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetTest
+                                                                   qosTier:nil
+                                                                 mappingID:@"expired"];
+  expiredEvent.expirationDate = [NSDate dateWithTimeIntervalSinceNow:-1];
+  GDTCOREvent *event = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetTest
+                                                            qosTier:nil
+                                                          mappingID:@"valid"];
+  event.expirationDate = [NSDate dateWithTimeIntervalSinceNow:1000];
+  for (GDTCOREvent *eventToStore in @[ expiredEvent, event ]) {
+    XCTestExpectation *storeExpectation = [self expectationWithDescription:@"event stored"];
+    [storage storeEvent:eventToStore
+             onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+               XCTAssertTrue(wasWritten);
+               [storeExpectation fulfill];
+             }];
+    [self waitForExpectations:@[ storeExpectation ] timeout:5];
+  }
+  uint64_t storageSize = [self storageSize];
+
+  GDTCORMetricsControllerFake *metricsController = [[GDTCORMetricsControllerFake alloc] init];
+  storage.delegate = metricsController;
+  XCTestExpectation *metricsControllerExpectation =
+      [self expectationWithDescription:@"metricsControllerExpectation"];
+  metricsController.onStorageDidRemoveExpiredEvents = ^(NSSet<GDTCOREvent *> *events) {
+    XCTAssertEqualObjects([events valueForKey:@"eventID"],
+                          [NSSet setWithObject:expiredEvent.eventID]);
+    XCTAssertEqualObjects([events valueForKey:@"mappingID"], [NSSet setWithObject:@"expired"]);
+    [metricsControllerExpectation fulfill];
+  };
+  [storage checkForExpirations];
+  [self waitForExpectations:@[ metricsControllerExpectation ] timeout:5];
+
+  XCTAssertEqual([self storageSize], storageSize - [self storageEventSize:expiredEvent]);
+}
+
 - (void)testCheckForExpirations_WhenBatchWithNotExpiredEventsExpires {
   NSTimeInterval batchExpiresIn = 0.5;
   // 0.1. Generate and batch events
@@ -1035,6 +1528,101 @@
                     timeout:0.5];
 }
 
+/** Tests that the batches are replayed from the batch journal by a new storage instance, as after
+ * a crash, and that their events are not batched again.
+ */
+- (void)testBatchesAreRecoveredFromBatchJournal {
+  NSNumber *batchID = [[self generateAndBatchEvents].allKeys firstObject];
+
+  GDTCORFlatFileStorage *newStorage = [[GDTCORFlatFileStorage alloc] init];
+  [self assertBatchIDs:[NSSet setWithObject:batchID] inStorage:newStorage];
+
+  XCTestExpectation *hasEventsExpectation = [self expectationWithDescription:@"hasEvents"];
+  [newStorage hasEventsForTarget:kGDTCORTargetTest
+                      onComplete:^(BOOL hasEvents) {
+                        XCTAssertFalse(hasEvents);
+                        [hasEventsExpectation fulfill];
+                      }];
+  [self waitForExpectations:@[ hasEventsExpectation ] timeout:0.5];
+}
+
+/** Tests that the events of a batch directory left by an earlier version of the storage are
+ * returned to the storage.
+ */
+- (void)testLegacyBatchDirectoryEventsAreReturnedToStorage {
+  NSSet<GDTCOREvent *> *events = [self generateEventsForTarget:kGDTCORTargetTest
+                                                    expiringIn:1000
+                                                         count:5];
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  // Legacy batch directories are named <target>-<batchID>-<expiration>.
+  NSString *legacyBatchName =
+      [NSString stringWithFormat:@"%ld-7-4102444800", (long)kGDTCORTargetTest];
+  NSString *legacyBatchPath =
+      [[GDTCORFlatFileStorage batchDataStoragePath] stringByAppendingPathComponent:legacyBatchName];
+  [self moveEventFilesOfTarget:kGDTCORTargetTest toDirectoryAtPath:legacyBatchPath];
+
+  GDTCORFlatFileStorage *newStorage = [[GDTCORFlatFileStorage alloc] init];
+  [self assertBatchIDs:nil inStorage:newStorage];
+  XCTAssertFalse([fileManager fileExistsAtPath:legacyBatchPath]);
+
+  XCTestExpectation *batchCreatedExpectation =
+      [self expectationWithDescription:@"batchCreatedExpectation"];
+  [newStorage
+      batchWithEventSelector:[GDTCORStorageEventSelector eventSelectorForTarget:kGDTCORTargetTest]
+             batchExpiration:[NSDate dateWithTimeIntervalSinceNow:1000]
+                  onComplete:^(NSNumber *_Nullable newBatchID,
+                               NSSet<GDTCOREvent *> *_Nullable batchEvents) {
+                    XCTAssertEqualObjects([batchEvents valueForKeyPath:@"eventID"],
+                                          [events valueForKeyPath:@"eventID"]);
+                    [batchCreatedExpectation fulfill];
+                  }];
+  [self waitForExpectations:@[ batchCreatedExpectation ] timeout:5];
+}
+
+/** Tests that the event files stored directly in the event data directory of a target by an earlier
+ * version of the storage are moved to their shards and returned by the storage.
+ */
+- (void)testFlatEventFilesAreMovedToShards {
+  NSSet<GDTCOREvent *> *events = [self generateEventsForTarget:kGDTCORTargetTest
+                                                    expiringIn:1000
+                                                         count:5];
+  NSString *targetPath = [[GDTCORFlatFileStorage eventDataStoragePath]
+      stringByAppendingPathComponent:@(kGDTCORTargetTest).stringValue];
+  NSArray<NSString *> *filenames = [self moveEventFilesOfTarget:kGDTCORTargetTest
+                                              toDirectoryAtPath:targetPath];
+  XCTAssertEqual(filenames.count, events.count);
+
+  GDTCORFlatFileStorage *newStorage = [[GDTCORFlatFileStorage alloc] init];
+  XCTestExpectation *batchCreatedExpectation =
+      [self expectationWithDescription:@"batchCreatedExpectation"];
+  [newStorage
+      batchWithEventSelector:[GDTCORStorageEventSelector eventSelectorForTarget:kGDTCORTargetTest]
+             batchExpiration:[NSDate dateWithTimeIntervalSinceNow:1000]
+                  onComplete:^(NSNumber *_Nullable newBatchID,
+                               NSSet<GDTCOREvent *> *_Nullable batchEvents) {
+                    XCTAssertEqualObjects([batchEvents valueForKeyPath:@"eventID"],
+                                          [events valueForKeyPath:@"eventID"]);
+                    [batchCreatedExpectation fulfill];
+                  }];
+  [self waitForExpectations:@[ batchCreatedExpectation ] timeout:5];
+
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  for (NSString *filename in filenames) {
+    XCTAssertFalse(
+        [fileManager fileExistsAtPath:[targetPath stringByAppendingPathComponent:filename]]);
+  }
+  for (GDTCOREvent *event in events) {
+    NSString *shardPath = [targetPath
+        stringByAppendingPathComponent:[GDTCORFlatFileStoragePartition
+                                           shardPathComponentForEventID:event.eventID]];
+    NSArray<NSString *> *shardContents = [fileManager contentsOfDirectoryAtPath:shardPath
+                                                                          error:nil];
+    NSPredicate *isEventFile = [NSPredicate predicateWithFormat:@"SELF BEGINSWITH %@",
+                                                                event.eventID];
+    XCTAssertEqual([shardContents filteredArrayUsingPredicate:isEventFile].count, 1);
+  }
+}
+
 #pragma mark - Remove Batch tests
 
 - (void)testRemoveBatchWithIDWithNoDeletingEvents {
@@ -1191,7 +1779,7 @@
                                                  NSDictionary<NSString *, id> *_Nullable bindings) {
         NSError *error;
         testTargetSize +=
-            event.target == kGDTCORTargetTest ? GDTCOREncodeArchive(event, nil, &error).length : 0;
+            event.target == kGDTCORTargetTest ? GDTCOREncodeEventRecord(event, &error).length : 0;
         XCTAssertNil(error);
         return event.target == kGDTCORTargetTest;
       }]];
@@ -1231,44 +1819,115 @@
   [self waitForExpectations:@[ expectation ] timeout:10];
 }
 
+#if !NDEBUG
+/** Tests that the tracked storage size stays exact through library data overwrites and batch
+ * removals without being recalculated.
+ */
+- (void)testStorageSizeIsTrackedIncrementally {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  XCTAssertEqual([self storageSize], 0);
+
+  // 1. Overwrite library data.
+  [storage storeLibraryData:[@"value" dataUsingEncoding:NSUTF8StringEncoding]
+                     forKey:@"testKey"
+                 onComplete:nil];
+  [storage storeLibraryData:[@"a longer value" dataUsingEncoding:NSUTF8StringEncoding]
+                     forKey:@"testKey"
+                 onComplete:nil];
+  [self assertStorageSizeIsExactInStorage:storage];
+
+  // 2. Move batched events back to the storage.
+  NSNumber *batchID = [[self generateAndBatchEvents].allKeys firstObject];
+  [self assertStorageSizeIsExactInStorage:storage];
+  [storage removeBatchWithID:batchID deleteEvents:NO onComplete:nil];
+  [self assertStorageSizeIsExactInStorage:storage];
+
+  // 3. Delete batched events.
+  XCTestExpectation *batchCreatedExpectation =
+      [self expectationWithDescription:@"batchCreatedExpectation"];
+  [storage
+      batchWithEventSelector:[GDTCORStorageEventSelector eventSelectorForTarget:kGDTCORTargetTest]
+             batchExpiration:[NSDate dateWithTimeIntervalSinceNow:1000]
+                  onComplete:^(NSNumber *_Nullable newBatchID,
+                               NSSet<GDTCOREvent *> *_Nullable events) {
+                    [storage removeBatchWithID:newBatchID deleteEvents:YES onComplete:nil];
+                    [batchCreatedExpectation fulfill];
+                  }];
+  [self waitForExpectations:@[ batchCreatedExpectation ] timeout:5];
+  [self assertStorageSizeIsExactInStorage:storage];
+}
+
+/** Tests that the tracked storage size is persisted when the app goes to the background and used
+ * by a new storage instance.
+ */
+- (void)testStorageSizeIsPersistedWhenAppWillBackground {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  [self generateEventsForStorageTesting];
+  uint64_t storageSize = [self storageSize];
+
+  [storage appWillBackground:[GDTCORApplication sharedApplication]];
+  dispatch_sync([storage queueForTarget:kGDTCORTargetTest], ^{
+                });
+  dispatch_sync(storage.storageQueue, ^{
+                });
+
+  // Each target persists the size of its own event data directory.
+  NSString *targetPath = [[GDTCORFlatFileStorage eventDataStoragePath]
+      stringByAppendingPathComponent:[@(kGDTCORTargetTest) stringValue]];
+  NSString *sizeFilePath =
+      [targetPath stringByAppendingPathComponent:kGDTCORDirectorySizeTrackerSizeFileName];
+  XCTAssertTrue([[NSFileManager defaultManager] fileExistsAtPath:sizeFilePath]);
+
+  GDTCORFlatFileStorage *newStorage = [[GDTCORFlatFileStorage alloc] init];
+  XCTestExpectation *expectation = [self expectationWithDescription:@"storageSize complete"];
+  [newStorage storageSizeWithCallback:^(uint64_t newStorageSize) {
+    XCTAssertEqual(newStorageSize, storageSize);
+    [expectation fulfill];
+  }];
+  [self waitForExpectations:@[ expectation ] timeout:1.0];
+  XCTAssertTrue([[NSFileManager defaultManager] fileExistsAtPath:sizeFilePath]);
+}
+#endif  // !NDEBUG
+
 #pragma mark - Storage Size Limit
 
 /** Tests that the size of the storage is returned accurately. */
 - (void)testStorageSizeWithCallback {
   GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
 
-  NSUInteger ongoingSize = 0;
+  // The size of the events and of the batch journal. The library data store file is checked
+  // separately, as each library data change appends a record to it.
+  uint64_t ongoingSize = 0;
   XCTAssertEqual([self storageSize], 0);
 
   // 1. Check add library data.
   NSData *libData = [@"this is a test" dataUsingEncoding:NSUTF8StringEncoding];
-  ongoingSize += libData.length;
   [storage storeLibraryData:libData forKey:@"testKey" onComplete:nil];
-  XCTAssertEqual([self storageSize], ongoingSize);
+  uint64_t storageSize = [self storageSize];
+  XCTAssertGreaterThan([self libraryDataStoreSize], libData.length);
+  XCTAssertEqual(storageSize, [self libraryDataStoreSize]);
 
   // 2. Check update library data.
   NSData *updatedLibData = [@"updated" dataUsingEncoding:NSUTF8StringEncoding];
-  ongoingSize -= libData.length;
-  ongoingSize += updatedLibData.length;
   [storage libraryDataForKey:@"testKey"
       onFetchComplete:^(NSData *_Nullable data, NSError *_Nullable error) {
       }
       setNewValue:^NSData *_Nullable {
         return updatedLibData;
       }];
-  XCTAssertEqual([self storageSize], ongoingSize);
+  XCTAssertGreaterThan([self storageSize], storageSize);
+  XCTAssertEqual([self storageSize], [self libraryDataStoreSize]);
 
   // 3. Check store events.
   NSSet<GDTCOREvent *> *generatedEvents = [self generateEventsForStorageTesting];
   ongoingSize += [self storageSizeOfEvents:generatedEvents];
-  XCTAssertEqual([self storageSize], ongoingSize);
+  XCTAssertEqual([self storageSize], ongoingSize + [self libraryDataStoreSize]);
 
   // 4. Check remove lib data.
-  ongoingSize -= updatedLibData.length;
   [storage removeLibraryDataForKey:@"testKey"
                         onComplete:^(NSError *_Nullable error){
                         }];
-  XCTAssertEqual([self storageSize], ongoingSize);
+  XCTAssertEqual([self storageSize], ongoingSize + [self libraryDataStoreSize]);
 
   // 5. Check batch.
   XCTestExpectation *batchCreatedExpectation =
@@ -1287,17 +1946,20 @@
                     [batchCreatedExpectation fulfill];
                   }];
   [self waitForExpectations:@[ batchCreatedExpectation ] timeout:5];
-  // Expect size increase due to the batch counter stored in lib data.
-  ongoingSize += sizeof(int32_t);
-  XCTAssertEqual([self storageSize], ongoingSize);
-
-  // 6. Batch remove.
+  // Expect size increase due to the batch ID high-water mark stored in lib data and the batch
+  // journal record.
+  uint64_t batchJournalSize = [self batchJournalSize];
+  XCTAssertGreaterThan(batchJournalSize, 0);
+  ongoingSize += batchJournalSize;
+  XCTAssertEqual([self storageSize], ongoingSize + [self libraryDataStoreSize]);
+
+  // 6. Batch remove. The batch journal is emptied once no batch is open.
   [storage removeBatchWithID:batchID
                 deleteEvents:YES
                   onComplete:^{
                   }];
-  ongoingSize -= batchedEventSize;
-  XCTAssertEqual([self storageSize], ongoingSize);
+  ongoingSize -= batchedEventSize + batchJournalSize;
+  XCTAssertEqual([self storageSize], ongoingSize + [self libraryDataStoreSize]);
 }
 
 - (void)testStoreEvent_WhenSizeLimitReached_ThenNewEventIsSkipped {
@@ -1377,12 +2039,306 @@
            }];
   [self waitForExpectations:@[ storeExpectation2 ] timeout:5];
 
-  GDTCORStorageSizeBytes lastBatchIDSize = sizeof(int32_t);
-  XCTAssertEqual([self storageSize], [self storageEventSize:event] + lastBatchIDSize);
+  XCTAssertEqual([self storageSize], [self storageEventSize:event] + [self libraryDataStoreSize]);
+}
+
+- (void)testStoreEvent_WhenSizeLimitReachedWithEvictionPolicy_ThenStoredEventIsEvicted {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  storage.evictionPolicy = [[GDTCOROldestFirstEvictionPolicy alloc] init];
+
+  // 1. Generate and store maximum allowed amount of events.
+  __auto_type generatedEvents =
+      [self generateAndStoreEventsWithTotalSizeUpTo:kGDTCORFlatFileStorageSizeLimit];
+  NSMutableDictionary<NSString *, NSString *> *mappingIDsByEventID =
+      [NSMutableDictionary dictionary];
+  for (GDTCOREvent *generatedEvent in generatedEvents) {
+    mappingIDsByEventID[generatedEvent.eventID] = generatedEvent.mappingID;
+  }
+
+  // 2. Add another event, which evicts stored events to fit.
+  GDTCOREvent *event = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetTest
+                                                            qosTier:nil
+                                                          mappingID:nil];
+  event.expirationDate = [NSDate dateWithTimeIntervalSinceNow:1000];
+
+  GDTCORMetricsControllerFake *metricsControllerFake = [[GDTCORMetricsControllerFake alloc] init];
+  storage.delegate = metricsControllerFake;
+  XCTestExpectation *metricsControllerExpectation =
+      [self expectationWithDescription:@"metricsControllerExpectation"];
+  metricsControllerExpectation.assertForOverFulfill = NO;
+  metricsControllerFake.onStorageDidDropEvent = ^(GDTCOREvent *droppedEvent) {
+    // The evicted event is reported from its index entry, with its mapping ID.
+    XCTAssertEqualObjects(droppedEvent.mappingID, mappingIDsByEventID[droppedEvent.eventID]);
+    [metricsControllerExpectation fulfill];
+  };
+
+  XCTestExpectation *storeExpectation = [self expectationWithDescription:@"storeExpectation"];
+  [storage storeEvent:event
+           onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+             XCTAssertTrue(wasWritten);
+             XCTAssertNil(error);
+             [storeExpectation fulfill];
+           }];
+  [self waitForExpectations:@[ metricsControllerExpectation, storeExpectation ] timeout:5];
+
+  // 3. Check the storage stays within the limit.
+  XCTAssertLessThanOrEqual([self storageSize], kGDTCORFlatFileStorageSizeLimit);
+}
+
+#pragma mark - Target Isolation
+
+/** Tests that an event of another target doesn't fit once the storage size limit is reached, as
+ * the limit is shared by all targets.
+ */
+- (void)testStoreEvent_WhenSizeLimitReachedByAnotherTarget_ThenNewEventIsSkipped {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  [self generateAndStoreEventsWithTotalSizeUpTo:kGDTCORFlatFileStorageSizeLimit];
+  uint64_t storageSize = [self storageSize];
+
+  GDTCOREvent *event = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetFLL
+                                                            qosTier:nil
+                                                          mappingID:nil];
+  // Make sure the event doesn't fit in the space left by the events of the other target.
+  NSString *largeString = [@"" stringByPaddingToLength:100 * 1000
+                                            withString:@"a"
+                                       startingAtIndex:0];
+  event.dataObject = [[GDTCORDataObjectTesterSimple alloc] initWithString:largeString];
+  XCTestExpectation *storeExpectation = [self expectationWithDescription:@"storeExpectation"];
+  [storage storeEvent:event
+           onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+             XCTAssertFalse(wasWritten);
+             XCTAssertEqual(error.code, GDTCORFlatFileStorageErrorSizeLimitReached);
+             [storeExpectation fulfill];
+           }];
+  [self waitForExpectations:@[ storeExpectation ] timeout:5];
+  XCTAssertEqual([self storageSize], storageSize);
+}
+
+/** Tests that the first event stored after a launch is checked against the size of the events
+ * every target stored before the launch.
+ */
+- (void)testStoreEvent_WhenSizeLimitReachedBeforeLaunch_ThenNewEventIsSkipped {
+  [self generateAndStoreEventsWithTotalSizeUpTo:kGDTCORFlatFileStorageSizeLimit];
+
+  GDTCORFlatFileStorage *newStorage = [[GDTCORFlatFileStorage alloc] init];
+  GDTCOREvent *event = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetFLL
+                                                            qosTier:nil
+                                                          mappingID:nil];
+  NSString *largeString = [@"" stringByPaddingToLength:100 * 1000
+                                            withString:@"a"
+                                       startingAtIndex:0];
+  event.dataObject = [[GDTCORDataObjectTesterSimple alloc] initWithString:largeString];
+  XCTestExpectation *storeExpectation = [self expectationWithDescription:@"storeExpectation"];
+  [newStorage storeEvent:event
+              onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+                XCTAssertFalse(wasWritten);
+                XCTAssertEqual(error.code, GDTCORFlatFileStorageErrorSizeLimitReached);
+                [storeExpectation fulfill];
+              }];
+  [self waitForExpectations:@[ storeExpectation ] timeout:5];
+}
+
+/** Tests that the estimated sizes the first reservation after a launch counts for the other
+ * targets are replaced by their loaded sizes, so that the size budget ends up exact.
+ */
+- (void)testStoreEvent_WhenOtherTargetSizesAreEstimated_ThenEstimatesAreReplaced {
+  [self generateEventsForTarget:kGDTCORTargetTest expiringIn:1000 count:10];
+  [self generateEventsForTarget:kGDTCORTargetCCT expiringIn:1000 count:10];
+
+  GDTCORFlatFileStorage *newStorage = [[GDTCORFlatFileStorage alloc] init];
+  GDTCOREvent *event = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetFLL
+                                                            qosTier:nil
+                                                          mappingID:nil];
+  XCTestExpectation *storeExpectation = [self expectationWithDescription:@"storeExpectation"];
+  [newStorage storeEvent:event
+              onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+                XCTAssertTrue(wasWritten);
+                [storeExpectation fulfill];
+              }];
+  [self waitForExpectations:@[ storeExpectation ] timeout:5];
+
+  __block uint64_t storageSize;
+  __block uint64_t relaunchedStorageSize;
+  XCTestExpectation *sizeExpectation = [self expectationWithDescription:@"sizeExpectation"];
+  sizeExpectation.expectedFulfillmentCount = 2;
+  [newStorage storageSizeWithCallback:^(uint64_t size) {
+    storageSize = size;
+    [sizeExpectation fulfill];
+  }];
+  [[[GDTCORFlatFileStorage alloc] init] storageSizeWithCallback:^(uint64_t size) {
+    relaunchedStorageSize = size;
+    [sizeExpectation fulfill];
+  }];
+  [self waitForExpectations:@[ sizeExpectation ] timeout:5];
+  XCTAssertGreaterThan(storageSize, 0);
+  XCTAssertEqual(storageSize, relaunchedStorageSize);
+}
+
+/** Measures storing events of a target while no other target is storing events, to be compared
+ * with testStoreEventWhileAnotherTargetIsBusyPerformance.
+ */
+- (void)testStoreEventWithIdleTargetsPerformance {
+  [self measureStoringEventsWhileAnotherTargetStoresEvents:0];
+}
+
+/** Measures storing the same events of a target while another target batches its stored events
+ * and stores more at the same time. Only the events of the measured target are waited for.
+ */
+- (void)testStoreEventWhileAnotherTargetIsBusyPerformance {
+  [self measureStoringEventsWhileAnotherTargetStoresEvents:500];
 }
 
 #pragma mark - Helpers
 
+/** Measures storing events of kGDTCORTargetFLL while kGDTCORTargetCSH stores events. The storage
+ * is reset after each measured iteration.
+ */
+- (void)measureStoringEventsWhileAnotherTargetStoresEvents:(NSUInteger)busyEventCount {
+  [self measureMetrics:[[self class] defaultPerformanceMetrics]
+      automaticallyStartMeasuring:NO
+                         forBlock:^{
+                           [self storeEventsWhileAnotherTargetStoresEvents:busyEventCount];
+                           [[GDTCORFlatFileStorage sharedInstance] reset];
+                         }];
+}
+
+/** Stores 50 events of kGDTCORTargetFLL, measuring the time until their completions are called,
+ * while kGDTCORTargetCSH forms a batch of its stored events and stores more events.
+ *
+ * @param busyEventCount The number of events kGDTCORTargetCSH stores before the measurement and
+ * while measuring. It is idle if 0.
+ */
+- (void)storeEventsWhileAnotherTargetStoresEvents:(NSUInteger)busyEventCount {
+  GDTCORFlatFileStorage *storage = [GDTCORFlatFileStorage sharedInstance];
+  NSUInteger eventCount = 50;
+  if (busyEventCount > 0) {
+    [self generateEventsForTarget:kGDTCORTargetCSH expiringIn:1000 count:busyEventCount];
+  }
+  XCTestExpectation *busyExpectation = [self expectationWithDescription:@"busy target done"];
+  busyExpectation.expectedFulfillmentCount = busyEventCount + 1;
+  XCTestExpectation *expectation = [self expectationWithDescription:@"events stored"];
+  expectation.expectedFulfillmentCount = eventCount;
+
+  [self startMeasuring];
+  [storage
+      batchWithEventSelector:[GDTCORStorageEventSelector eventSelectorForTarget:kGDTCORTargetCSH]
+             batchExpiration:[NSDate dateWithTimeIntervalSinceNow:1000]
+                  onComplete:^(NSNumber *_Nullable batchID,
+                               NSSet<GDTCOREvent *> *_Nullable events) {
+                    XCTAssertEqual(events.count, busyEventCount);
+                    [busyExpectation fulfill];
+                  }];
+  for (NSUInteger i = 0; i < busyEventCount; i++) {
+    [storage storeEvent:[GDTCOREventGenerator generateEventForTarget:kGDTCORTargetCSH
+                                                             qosTier:nil
+                                                           mappingID:nil]
+             onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+               XCTAssertTrue(wasWritten);
+               [busyExpectation fulfill];
+             }];
+  }
+  for (NSUInteger i = 0; i < eventCount; i++) {
+    [storage storeEvent:[GDTCOREventGenerator generateEventForTarget:kGDTCORTargetFLL
+                                                             qosTier:nil
+                                                           mappingID:nil]
+             onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+               XCTAssertTrue(wasWritten);
+               [expectation fulfill];
+             }];
+  }
+  [self waitForExpectations:@[ expectation ] timeout:60];
+  [self stopMeasuring];
+
+  [self waitForExpectations:@[ busyExpectation ] timeout:60];
+}
+
+/** Moves the event files of the target out of their shards into the directory, the way earlier
+ * versions of the storage laid them out.
+ *
+ * @return The names of the moved files.
+ */
+- (NSArray<NSString *> *)moveEventFilesOfTarget:(GDTCORTarget)target
+                              toDirectoryAtPath:(NSString *)directoryPath {
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  [fileManager createDirectoryAtPath:directoryPath
+         withIntermediateDirectories:YES
+                          attributes:nil
+                               error:nil];
+  NSString *targetPath = [[GDTCORFlatFileStorage eventDataStoragePath]
+      stringByAppendingPathComponent:@(target).stringValue];
+  NSMutableArray<NSString *> *filenames = [NSMutableArray array];
+  GDTCORStorageSizeBudget *sizeBudget = [[GDTCORStorageSizeBudget alloc] initWithLimit:UINT64_MAX];
+  GDTCORFlatFileStoragePartition *partition =
+      [[GDTCORFlatFileStoragePartition alloc] initWithTarget:target
+                                               eventDataPath:targetPath
+                                                  sizeBudget:sizeBudget];
+  for (NSString *shardPath in [partition shardPaths]) {
+    for (NSString *filename in [fileManager contentsOfDirectoryAtPath:shardPath error:nil]) {
+      if ([filename hasPrefix:@"."]) {
+        continue;
+      }
+      XCTAssertTrue([fileManager
+          moveItemAtPath:[shardPath stringByAppendingPathComponent:filename]
+                  toPath:[directoryPath stringByAppendingPathComponent:filename]
+                   error:nil]);
+      [filenames addObject:filename];
+    }
+  }
+  return filenames;
+}
+
+/** Stores an event of the target and returns the ID of a new batch of the events of the target. */
+- (NSNumber *)batchIDOfNewBatchForTarget:(GDTCORTarget)target {
+  [self generateEventsForTarget:target expiringIn:1000 count:1];
+  __block NSNumber *batchID;
+  XCTestExpectation *batchExpectation = [self expectationWithDescription:@"batch created"];
+  [[GDTCORFlatFileStorage sharedInstance]
+      uploadBatchWithEventSelector:[GDTCORStorageEventSelector eventSelectorForTarget:target]
+                   batchExpiration:[NSDate dateWithTimeIntervalSinceNow:60]
+                        onComplete:^(GDTCORUploadBatch *_Nullable batch) {
+                          batchID = batch.batchID;
+                          [batchExpectation fulfill];
+                        }];
+  [self waitForExpectations:@[ batchExpectation ] timeout:10.0];
+  XCTAssertNotNil(batchID);
+  return batchID;
+}
+
+/** Stores the request body of the batch to be replayed from now and returns the error, if any. */
+- (nullable NSError *)storeRequestBody:(NSData *)requestBody forBatchID:(NSNumber *)batchID {
+  return [self storeRequestBody:requestBody forBatchID:batchID retryDate:[NSDate date]];
+}
+
+/** Calls `[GDTCORFlatFileStorage storeRequestBody:forBatchID:retryDate:onComplete:]`, waits for
+ * the completion and returns its error.
+ */
+- (nullable NSError *)storeRequestBody:(NSData *)requestBody
+                            forBatchID:(NSNumber *)batchID
+                             retryDate:(NSDate *)retryDate {
+  __block NSError *storeError;
+  XCTestExpectation *storedExpectation = [self expectationWithDescription:@"body stored"];
+  [[GDTCORFlatFileStorage sharedInstance] storeRequestBody:requestBody
+                                                forBatchID:batchID
+                                                 retryDate:retryDate
+                                                onComplete:^(NSError *_Nullable error) {
+                                                  storeError = error;
+                                                  [storedExpectation fulfill];
+                                                }];
+  [self waitForExpectations:@[ storedExpectation ] timeout:10.0];
+  return storeError;
+}
+
+/** Returns the partition of the target in the shared storage. */
+- (nullable GDTCORFlatFileStoragePartition *)partitionOfTarget:(GDTCORTarget)target {
+  for (GDTCORFlatFileStoragePartition *partition in
+       [GDTCORFlatFileStorage sharedInstance].partitions) {
+    if (partition.target == target) {
+      return partition;
+    }
+  }
+  return nil;
+}
+
 /** Generates and returns a set of events that are generated randomly and stored.
  *
  * @return A set of randomly generated and stored events.
@@ -1457,7 +2413,7 @@
           [eventStoredExpectation fulfill];
         }];
 
-    dispatch_sync([GDTCORFlatFileStorage sharedInstance].storageQueue, ^{
+    dispatch_sync([[GDTCORFlatFileStorage sharedInstance] queueForTarget:target], ^{
                       // Drain queue to allow event to be stored before proceeding.
                   });
 
@@ -1546,6 +2502,13 @@
   [self waitForExpectations:@[ eventStoredExpectation ] timeout:0.5];
 }
 
+#if !NDEBUG
+/** Waits for the pending storage operations and asserts the tracked size matches the disk usage. */
+- (void)assertStorageSizeIsExactInStorage:(GDTCORFlatFileStorage *)storage {
+  XCTAssertTrue([storage reconcileStorageSize]);
+}
+#endif  // !NDEBUG
+
 /** Calls  `[GDTCORFlatFileStorage storageSizeWithCallback]`, waits for completion and returns the
  * result. */
 - (uint64_t)storageSize {
@@ -1559,6 +2522,19 @@
   return storageSize;
 }
 
+/** Returns the size of the batch journal file. */
+/** Returns the size of the library data store file, which holds the batch ID high-water mark. */
+- (uint64_t)libraryDataStoreSize {
+  NSString *path = [GDTCORFlatFileStorage sharedInstance].libraryDataStore.path;
+  return [[[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil] fileSize];
+}
+
+- (uint64_t)batchJournalSize {
+  NSString *batchJournalPath = [GDTCORFlatFileStorage batchJournalPathForTarget:kGDTCORTargetTest];
+  return [[[NSFileManager defaultManager] attributesOfItemAtPath:batchJournalPath
+                                                           error:nil] fileSize];
+}
+
 /** Returns an expected size taken by the events in the storage. */
 - (GDTCORStorageSizeBytes)storageSizeOfEvents:(NSSet<GDTCOREvent *> *)events {
   uint64_t eventsSize = 0;
@@ -1571,7 +2547,7 @@
 /** Returns an expected size taken by the event in the storage. */
 - (GDTCORStorageSizeBytes)storageEventSize:(GDTCOREvent *)event {
   NSError *error;
-  NSData *serializedEventData = GDTCOREncodeArchive(event, nil, &error);
+  NSData *serializedEventData = GDTCOREncodeEventRecord(event, &error);
   XCTAssertNil(error);
   return serializedEventData.length;
 }
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORLibraryDataStore.h"
+
+@interface GDTCORLibraryDataStoreTest : XCTestCase
+
+/** The path of the store file. */
+@property(nonatomic) NSString *path;
+
+/** The size tracker of the directory containing the store file. */
+@property(nonatomic) GDTCORDirectorySizeTracker *sizeTracker;
+
+@end
+
+@implementation GDTCORLibraryDataStoreTest
+
+- (void)setUp {
+  [super setUp];
+  NSString *directoryPath =
+      [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+  [[NSFileManager defaultManager] createDirectoryAtPath:directoryPath
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+  self.path = [directoryPath stringByAppendingPathComponent:@"store"];
+  self.sizeTracker = [[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:directoryPath];
+}
+
+- (void)tearDown {
+  [[NSFileManager defaultManager] removeItemAtPath:self.sizeTracker.directoryPath error:nil];
+  [super tearDown];
+}
+
+/** Tests that the current values are replayed by a new store. */
+- (void)testValuesAreReplayed {
+  GDTCORLibraryDataStore *store = [self store];
+  XCTAssertTrue([store setData:[self dataWithString:@"1"] forKey:@"a" error:nil]);
+  XCTAssertTrue([store setData:[self dataWithString:@"2"] forKey:@"b" error:nil]);
+  XCTAssertTrue([store setData:[self dataWithString:@"3"] forKey:@"a" error:nil]);
+  XCTAssertTrue([store removeDataForKey:@"b" error:nil]);
+  XCTAssertTrue([store removeDataForKey:@"c" error:nil]);
+  XCTAssertEqualObjects([store dataForKey:@"a"], [self dataWithString:@"3"]);
+  XCTAssertNil([store dataForKey:@"b"]);
+
+  GDTCORLibraryDataStore *newStore = [self store];
+  XCTAssertEqualObjects([newStore dataForKey:@"a"], [self dataWithString:@"3"]);
+  XCTAssertNil([newStore dataForKey:@"b"]);
+  XCTAssertNil([newStore dataForKey:@"c"]);
+}
+
+/** Tests that a record torn by a crash is discarded together with its value. */
+- (void)testTornRecordIsDiscarded {
+  GDTCORLibraryDataStore *store = [self store];
+  XCTAssertTrue([store setData:[self dataWithString:@"1"] forKey:@"a" error:nil]);
+  uint64_t intactSize = [self storeFileSize];
+  XCTAssertTrue([store setData:[self dataWithString:@"2"] forKey:@"b" error:nil]);
+  [store unload];
+
+  NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingAtPath:self.path];
+  [fileHandle truncateFileAtOffset:[self storeFileSize] - 1];
+  [fileHandle closeFile];
+
+  GDTCORLibraryDataStore *newStore = [self store];
+  XCTAssertEqualObjects([newStore dataForKey:@"a"], [self dataWithString:@"1"]);
+  XCTAssertNil([newStore dataForKey:@"b"]);
+  XCTAssertEqual([self storeFileSize], intactSize);
+}
+
+/** Tests that the files previous versions wrote for each key are moved into the store, without
+ * overwriting the values already in it, and that the size tracker follows.
+ */
+- (void)testLegacyFilesAreMigrated {
+  GDTCORLibraryDataStore *store = [self store];
+  XCTAssertTrue([store setData:[self dataWithString:@"new"] forKey:@"a" error:nil]);
+  [store unload];
+  [[self dataWithString:@"old"] writeToFile:[self legacyPathForKey:@"a"] atomically:YES];
+  [[self dataWithString:@"2"] writeToFile:[self legacyPathForKey:@"b"] atomically:YES];
+  [self.sizeTracker directoryContentSize];
+
+  GDTCORLibraryDataStore *newStore = [self store];
+  XCTAssertEqualObjects([newStore dataForKey:@"a"], [self dataWithString:@"new"]);
+  XCTAssertEqualObjects([newStore dataForKey:@"b"], [self dataWithString:@"2"]);
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:[self legacyPathForKey:@"a"]]);
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:[self legacyPathForKey:@"b"]]);
+  XCTAssertEqual([self.sizeTracker directoryContentSize], [self storeFileSize]);
+  XCTAssertEqualObjects([[self store] dataForKey:@"b"], [self dataWithString:@"2"]);
+}
+
+/** Tests that a store file made of overwritten values is compacted, and that the store file is
+ * removed once no value is left.
+ */
+- (void)testStoreFileIsCompacted {
+  [self.sizeTracker directoryContentSize];
+  GDTCORLibraryDataStore *store = [self store];
+  NSMutableData *value = [NSMutableData dataWithLength:1024];
+  for (int i = 0; i < 1000; i++) {
+    XCTAssertTrue([store setData:value forKey:@"a" error:nil]);
+  }
+  XCTAssertLessThan([self storeFileSize], 100 * 1024);
+  XCTAssertEqual([self.sizeTracker directoryContentSize], [self storeFileSize]);
+  [store unload];
+  XCTAssertEqualObjects([store dataForKey:@"a"], value);
+
+  XCTAssertTrue([store removeDataForKey:@"a" error:nil]);
+  [store unload];
+  XCTAssertNil([store dataForKey:@"a"]);
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:self.path]);
+  XCTAssertEqual([self.sizeTracker directoryContentSize], 0);
+}
+
+#pragma mark - Helpers
+
+- (GDTCORLibraryDataStore *)store {
+  return [[GDTCORLibraryDataStore alloc] initWithPath:self.path sizeTracker:self.sizeTracker];
+}
+
+- (NSData *)dataWithString:(NSString *)string {
+  return [string dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (NSString *)legacyPathForKey:(NSString *)key {
+  return [[self.path stringByDeletingLastPathComponent] stringByAppendingPathComponent:key];
+}
+
+- (uint64_t)storeFileSize {
+  return [[[NSFileManager defaultManager] attributesOfItemAtPath:self.path error:nil] fileSize];
+}
+
+@end
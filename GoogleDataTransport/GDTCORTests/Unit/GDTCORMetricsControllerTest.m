@@ -20,6 +20,8 @@
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORTargets.h"
 
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORPlatform.h"
+
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORLogSourceMetrics.h"
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORMetrics.h"
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORMetricsController.h"
@@ -346,4 +348,91 @@
   XCTAssertEqualObjects([metricsPromise.value logSourceMetrics], expectedCombinedLogSourceMetrics);
 }
 
+- (void)testLoggingEvents_WhenNotFlushed_ThenStorageIsNotUpdated {
+  // Given
+  GDTCORStorageFake *storage = [GDTCORStorageFake storageFake];
+  GDTCORMetricsController *metricsController =
+      [[GDTCORMetricsController alloc] initWithStorage:storage flushInterval:1000];
+
+  NSSet<GDTCOREvent *> *droppedEvents = [NSSet setWithArray:@[
+    [[GDTCOREvent alloc] initWithMappingID:@"log_source_1" target:kGDTCORTargetTest],
+    [[GDTCOREvent alloc] initWithMappingID:@"log_source_2" target:kGDTCORTargetTest],
+  ]];
+
+  // When
+  for (int i = 0; i < 3; i++) {
+    [metricsController logEventsDroppedForReason:GDTCOREventDropReasonStorageFull
+                                          events:droppedEvents];
+  }
+
+  // Then
+  // - Assert that the drops are only counted in memory.
+  XCTAssertEqual(storage.metricsUpdateCount, 0);
+
+  // - Assert that the counts are flushed once before the metrics are read.
+  __auto_type metricsPromise = [metricsController getAndResetMetrics];
+  FBLWaitForPromisesWithTimeout(0.5);
+  XCTAssertEqual(storage.metricsUpdateCount, 2);
+
+  GDTCORLogSourceMetrics *expectedLogSourceMetrics =
+      [GDTCORLogSourceMetrics metricsWithEvents:[droppedEvents allObjects]
+                               droppedForReason:GDTCOREventDropReasonStorageFull];
+  expectedLogSourceMetrics = [[expectedLogSourceMetrics
+      logSourceMetricsByMergingWithLogSourceMetrics:expectedLogSourceMetrics]
+      logSourceMetricsByMergingWithLogSourceMetrics:expectedLogSourceMetrics];
+  XCTAssertEqualObjects([metricsPromise.value logSourceMetrics], expectedLogSourceMetrics);
+}
+
+- (void)testLoggingEvents_WhenFlushIntervalElapses_ThenCountsAreFlushed {
+  // Given
+  GDTCORStorageFake *storage = [GDTCORStorageFake storageFake];
+  GDTCORMetricsController *metricsController =
+      [[GDTCORMetricsController alloc] initWithStorage:storage flushInterval:0.1];
+  GDTCOREvent *droppedEvent = [[GDTCOREvent alloc] initWithMappingID:@"log_source_1"
+                                                              target:kGDTCORTargetTest];
+
+  // When
+  [metricsController logEventsDroppedForReason:GDTCOREventDropReasonMessageTooOld
+                                        events:[NSSet setWithObject:droppedEvent]];
+  [metricsController logEventsDroppedForReason:GDTCOREventDropReasonMessageTooOld
+                                        events:[NSSet setWithObject:droppedEvent]];
+
+  // Then
+  // - Assert that a single flush was scheduled for both drops.
+  NSPredicate *flushedOnce = [NSPredicate predicateWithFormat:@"metricsUpdateCount == 1"];
+  XCTestExpectation *flushedOnceExpectation = [self expectationForPredicate:flushedOnce
+                                                        evaluatedWithObject:storage
+                                                                    handler:nil];
+  [self waitForExpectations:@[ flushedOnceExpectation ] timeout:2];
+
+  // - Assert that a drop after the flush schedules another one.
+  [metricsController logEventsDroppedForReason:GDTCOREventDropReasonMessageTooOld
+                                        events:[NSSet setWithObject:droppedEvent]];
+  NSPredicate *flushedTwice = [NSPredicate predicateWithFormat:@"metricsUpdateCount == 2"];
+  XCTestExpectation *flushedTwiceExpectation = [self expectationForPredicate:flushedTwice
+                                                         evaluatedWithObject:storage
+                                                                     handler:nil];
+  [self waitForExpectations:@[ flushedTwiceExpectation ] timeout:2];
+}
+
+- (void)testAppWillBackground_FlushesCounts {
+  // Given
+  GDTCORStorageFake *storage = [GDTCORStorageFake storageFake];
+  GDTCORMetricsController *metricsController =
+      [[GDTCORMetricsController alloc] initWithStorage:storage flushInterval:1000];
+  GDTCOREvent *droppedEvent = [[GDTCOREvent alloc] initWithMappingID:@"log_source_1"
+                                                              target:kGDTCORTargetTest];
+  [metricsController logEventsDroppedForReason:GDTCOREventDropReasonStorageFull
+                                        events:[NSSet setWithObject:droppedEvent]];
+
+  // When
+  [metricsController appWillBackground:[GDTCORApplication sharedApplication]];
+
+  // Then
+  XCTAssertEqual(storage.metricsUpdateCount, 1);
+  // - Assert that nothing is left to flush.
+  [metricsController appWillBackground:[GDTCORApplication sharedApplication]];
+  XCTAssertEqual(storage.metricsUpdateCount, 1);
+}
+
 @end
@@ -78,4 +78,30 @@
   XCTAssertNoThrow([application endBackgroundTask:bgID]);
 }
 
+/** Tests syncing several files, and that a file that can't be synced is reported. */
+- (void)testSyncFilesAtPaths {
+  NSString *directoryPath =
+      [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+  XCTAssertTrue([[NSFileManager defaultManager] createDirectoryAtPath:directoryPath
+                                          withIntermediateDirectories:YES
+                                                           attributes:nil
+                                                                error:nil]);
+  NSMutableArray<NSString *> *paths = [NSMutableArray array];
+  for (NSString *filename in @[ @"a", @"b", @"c" ]) {
+    NSString *path = [directoryPath stringByAppendingPathComponent:filename];
+    XCTAssertTrue([[filename dataUsingEncoding:NSUTF8StringEncoding] writeToFile:path
+                                                                      atomically:NO]);
+    [paths addObject:path];
+  }
+
+  NSError *error;
+  XCTAssertTrue(GDTCORSyncFilesAtPaths(paths, &error));
+  XCTAssertNil(error);
+
+  NSString *missingPath = [directoryPath stringByAppendingPathComponent:@"missing"];
+  XCTAssertFalse(GDTCORSyncFilesAtPaths([paths arrayByAddingObject:missingPath], &error));
+  XCTAssertEqualObjects(error.userInfo[NSFilePathErrorKey], missingPath);
+  [[NSFileManager defaultManager] removeItemAtPath:directoryPath error:nil];
+}
+
 @end
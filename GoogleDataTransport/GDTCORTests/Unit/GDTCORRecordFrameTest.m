@@ -0,0 +1,93 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORRecordFrame.h"
+
+/** The magic of the frames written by the tests. */
+static const uint32_t kTestRecordMagic = 0x54544447;
+
+@interface GDTCORRecordFrameTest : XCTestCase
+
+@end
+
+@implementation GDTCORRecordFrameTest
+
+/** Tests that integers are written as little-endian bytes and read back. */
+- (void)testIntegersAreLittleEndian {
+  NSMutableData *data = [[NSMutableData alloc] init];
+  GDTCORAppendUInt8(data, 0x01);
+  GDTCORAppendUInt16(data, 0x0302);
+  GDTCORAppendUInt32(data, 0x07060504);
+  GDTCORAppendUInt64(data, 0x0F0E0D0C0B0A0908);
+  const uint8_t expectedBytes[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+  XCTAssertEqualObjects(data, [NSData dataWithBytes:expectedBytes length:sizeof(expectedBytes)]);
+
+  const uint8_t *bytes = data.bytes;
+  XCTAssertEqual(GDTCORReadUInt16(bytes + 1), 0x0302);
+  XCTAssertEqual(GDTCORReadUInt32(bytes + 3), 0x07060504u);
+  XCTAssertEqual(GDTCORReadUInt64(bytes + 7), 0x0F0E0D0C0B0A0908ull);
+}
+
+/** Tests that consecutive frames are read back with their type and body. */
+- (void)testFramesAreReadBack {
+  NSData *body1 = [@"first" dataUsingEncoding:NSUTF8StringEncoding];
+  NSData *body2 = [@"second" dataUsingEncoding:NSUTF8StringEncoding];
+  NSMutableData *data = [[NSMutableData alloc] init];
+  [data appendData:GDTCORRecordFrame(kTestRecordMagic, 1, body1)];
+  [data appendData:GDTCORRecordFrame(kTestRecordMagic, 2, body2)];
+  XCTAssertEqual(data.length, kGDTCORRecordFrameHeaderLength * 2 + body1.length + body2.length);
+
+  uint8_t type;
+  NSRange bodyRange;
+  XCTAssertTrue(
+      GDTCORReadRecordFrame(data.bytes, data.length, 0, kTestRecordMagic, &type, &bodyRange));
+  XCTAssertEqual(type, 1);
+  XCTAssertEqualObjects([data subdataWithRange:bodyRange], body1);
+
+  uint64_t offset = NSMaxRange(bodyRange);
+  XCTAssertTrue(GDTCORReadRecordFrame(data.bytes, data.length, offset, kTestRecordMagic, &type,
+                                      &bodyRange));
+  XCTAssertEqual(type, 2);
+  XCTAssertEqualObjects([data subdataWithRange:bodyRange], body2);
+
+  offset = NSMaxRange(bodyRange);
+  XCTAssertFalse(GDTCORReadRecordFrame(data.bytes, data.length, offset, kTestRecordMagic, &type,
+                                       &bodyRange));
+}
+
+/** Tests that a frame isn't read if it has another magic, is truncated or is corrupted. */
+- (void)testInvalidFramesAreNotRead {
+  NSData *body = [@"body" dataUsingEncoding:NSUTF8StringEncoding];
+  NSData *frame = GDTCORRecordFrame(kTestRecordMagic, 1, body);
+  uint8_t type;
+  NSRange bodyRange;
+
+  XCTAssertFalse(
+      GDTCORReadRecordFrame(frame.bytes, frame.length, 0, kTestRecordMagic + 1, &type, &bodyRange));
+  XCTAssertFalse(
+      GDTCORReadRecordFrame(frame.bytes, frame.length - 1, 0, kTestRecordMagic, &type, &bodyRange));
+  XCTAssertFalse(GDTCORReadRecordFrame(frame.bytes, kGDTCORRecordFrameHeaderLength - 1, 0,
+                                       kTestRecordMagic, &type, &bodyRange));
+
+  NSMutableData *corruptedFrame = [frame mutableCopy];
+  ((uint8_t *)corruptedFrame.mutableBytes)[corruptedFrame.length - 1] ^= 0xFF;
+  XCTAssertFalse(GDTCORReadRecordFrame(corruptedFrame.bytes, corruptedFrame.length, 0,
+                                       kTestRecordMagic, &type, &bodyRange));
+}
+
+@end
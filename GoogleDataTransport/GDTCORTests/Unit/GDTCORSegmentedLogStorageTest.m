@@ -0,0 +1,617 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORTests/Unit/GDTCORTestCase.h"
+
+#import "FBLPromise+Testing.h"
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORPlatform.h"
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORSegmentedLogStorage+Promises.h"
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORSegmentedLogStorage.h"
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORUploadBatch.h"
+
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
+
+#import "GoogleDataTransport/GDTCORTests/Unit/Helpers/GDTCORDataObjectTesterClasses.h"
+#import "GoogleDataTransport/GDTCORTests/Unit/Helpers/GDTCOREventGenerator.h"
+
+#import "GoogleDataTransport/GDTCORTests/Common/Fakes/GDTCORMetricsControllerFake.h"
+#import "GoogleDataTransport/GDTCORTests/Common/Fakes/GDTCORUploadCoordinatorFake.h"
+
+@interface GDTCORSegmentedLogStorageTest : GDTCORTestCase
+
+/** The storage instance under test. */
+@property(nonatomic) GDTCORSegmentedLogStorage *storage;
+
+/** The uploader fake. */
+@property(nonatomic) GDTCORUploadCoordinatorFake *uploaderFake;
+
+@end
+
+@implementation GDTCORSegmentedLogStorageTest
+
+- (void)setUp {
+  [super setUp];
+  self.uploaderFake = [[GDTCORUploadCoordinatorFake alloc] init];
+  self.storage = [self relaunchedStorage];
+}
+
+- (void)tearDown {
+  dispatch_sync(self.storage.storageQueue, ^{
+                });
+  self.storage = nil;
+  self.uploaderFake = nil;
+  [super tearDown];
+}
+
+/** Tests storing events and batching them. */
+- (void)testStoreEventAndBatch {
+  XCTAssertFalse([self hasEventsInStorage:self.storage]);
+
+  NSSet<GDTCOREvent *> *storedEvents = [self storeEvents:5 inStorage:self.storage];
+  XCTAssertTrue([self hasEventsInStorage:self.storage]);
+
+  NSSet<GDTCOREvent *> *batchedEvents;
+  NSNumber *batchID = [self batchEventsInStorage:self.storage events:&batchedEvents];
+  XCTAssertNotNil(batchID);
+  XCTAssertEqualObjects([batchedEvents valueForKey:@"eventID"],
+                        [storedEvents valueForKey:@"eventID"]);
+  XCTAssertFalse([self hasEventsInStorage:self.storage]);
+}
+
+/** Tests that a batch only contains the events matching the selector. */
+- (void)testBatchWithEventSelector {
+  [self storeEvents:3 inStorage:self.storage];
+  GDTCOREvent *fastEvent = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetTest
+                                                                qosTier:@(GDTCOREventQoSFast)
+                                                              mappingID:@"fast"];
+  [self storeEvent:fastEvent inStorage:self.storage];
+  XCTAssertTrue(self.uploaderFake.forceUploadCalled);
+
+  NSSet<NSNumber *> *qosTiers = [NSSet setWithObject:@(GDTCOREventQoSFast)];
+  GDTCORStorageEventSelector *selector =
+      [[GDTCORStorageEventSelector alloc] initWithTarget:kGDTCORTargetTest
+                                                eventIDs:nil
+                                              mappingIDs:nil
+                                                qosTiers:qosTiers];
+  XCTestExpectation *expectation = [self expectationWithDescription:@"batch created"];
+  [self.storage batchWithEventSelector:selector
+                       batchExpiration:[NSDate dateWithTimeIntervalSinceNow:600]
+                            onComplete:^(NSNumber *_Nullable batchID,
+                                         NSSet<GDTCOREvent *> *_Nullable events) {
+                              XCTAssertEqual(events.count, 1);
+                              XCTAssertEqualObjects(events.anyObject.eventID, fastEvent.eventID);
+                              [expectation fulfill];
+                            }];
+  [self waitForExpectations:@[ expectation ] timeout:5];
+}
+
+/** Tests that removing a batch without deleting its events makes them available again. */
+- (void)testRemoveBatchWithoutDeletingEvents {
+  [self storeEvents:5 inStorage:self.storage];
+  NSNumber *batchID = [self batchEventsInStorage:self.storage events:NULL];
+  XCTAssertFalse([self hasEventsInStorage:self.storage]);
+
+  [self removeBatchWithID:batchID deleteEvents:NO inStorage:self.storage];
+
+  NSSet<GDTCOREvent *> *events;
+  XCTAssertNotNil([self batchEventsInStorage:self.storage events:&events]);
+  XCTAssertEqual(events.count, 5);
+}
+
+/** Tests that deleting all events reclaims the segment files. */
+- (void)testRemoveBatchDeletingEventsReclaimsSegments {
+  [self storeEvents:5 inStorage:self.storage];
+  NSString *segmentPath = [GDTCORSegmentedLogStorage segmentPathForTarget:kGDTCORTargetTest
+                                                                segmentID:0];
+  XCTAssertTrue([[NSFileManager defaultManager] fileExistsAtPath:segmentPath]);
+
+  NSNumber *batchID = [self batchEventsInStorage:self.storage events:NULL];
+  [self removeBatchWithID:batchID deleteEvents:YES inStorage:self.storage];
+
+  XCTAssertFalse([self hasEventsInStorage:self.storage]);
+  XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:segmentPath]);
+  XCTAssertEqual([self storageSizeOfStorage:self.storage], 0);
+}
+
+/** Tests that large events roll over into new segments. */
+- (void)testSegmentRollOver {
+  NSString *largeString = [@"" stringByPaddingToLength:200 * 1024
+                                            withString:@"a"
+                                       startingAtIndex:0];
+  for (int i = 0; i < 6; i++) {
+    GDTCOREvent *event = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetTest
+                                                              qosTier:@(GDTCOREventQoSDefault)
+                                                            mappingID:@"1018"];
+    event.dataObject = [[GDTCORDataObjectTesterSimple alloc] initWithString:largeString];
+    [self storeEvent:event inStorage:self.storage];
+  }
+  NSString *segment1Path = [GDTCORSegmentedLogStorage segmentPathForTarget:kGDTCORTargetTest
+                                                                 segmentID:1];
+  XCTAssertTrue([[NSFileManager defaultManager] fileExistsAtPath:segment1Path]);
+
+  NSSet<GDTCOREvent *> *events;
+  [self batchEventsInStorage:[self relaunchedStorage] events:&events];
+  XCTAssertEqual(events.count, 6);
+}
+
+/** Tests that stored events and tombstones survive a relaunch. */
+- (void)testEventsAreRestoredAfterRelaunch {
+  NSSet<GDTCOREvent *> *storedEvents = [self storeEvents:4 inStorage:self.storage];
+  GDTCOREvent *deletedEvent = storedEvents.anyObject;
+  GDTCORStorageEventSelector *selector =
+      [[GDTCORStorageEventSelector alloc] initWithTarget:kGDTCORTargetTest
+                                                eventIDs:[NSSet setWithObject:deletedEvent.eventID]
+                                              mappingIDs:nil
+                                                qosTiers:nil];
+  __block NSNumber *batchID;
+  XCTestExpectation *expectation = [self expectationWithDescription:@"batch created"];
+  [self.storage batchWithEventSelector:selector
+                       batchExpiration:[NSDate dateWithTimeIntervalSinceNow:600]
+                            onComplete:^(NSNumber *_Nullable newBatchID,
+                                         NSSet<GDTCOREvent *> *_Nullable events) {
+                              batchID = newBatchID;
+                              [expectation fulfill];
+                            }];
+  [self waitForExpectations:@[ expectation ] timeout:5];
+  [self removeBatchWithID:batchID deleteEvents:YES inStorage:self.storage];
+
+  NSSet<GDTCOREvent *> *restoredEvents;
+  [self batchEventsInStorage:[self relaunchedStorage] events:&restoredEvents];
+  NSMutableSet<NSString *> *expectedEventIDs = [[storedEvents valueForKey:@"eventID"] mutableCopy];
+  [expectedEventIDs removeObject:deletedEvent.eventID];
+  XCTAssertEqualObjects([restoredEvents valueForKey:@"eventID"], expectedEventIDs);
+}
+
+/** Tests that a torn record at the end of a segment is truncated on relaunch. */
+- (void)testTornRecordIsTruncatedAfterRelaunch {
+  [self storeEvents:3 inStorage:self.storage];
+  NSString *segmentPath = [GDTCORSegmentedLogStorage segmentPathForTarget:kGDTCORTargetTest
+                                                                segmentID:0];
+  NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:segmentPath
+                                                                              error:nil];
+  unsigned long long intactSize = attributes.fileSize;
+
+  // Simulate a crash in the middle of appending a record.
+  NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingAtPath:segmentPath];
+  [fileHandle seekToEndOfFile];
+  const uint8_t tornRecord[] = {0x47, 0x44, 0x54, 0x52, 0x01, 0xFF, 0x00, 0x00};
+  [fileHandle writeData:[NSData dataWithBytes:tornRecord length:sizeof(tornRecord)]];
+  [fileHandle closeFile];
+
+  GDTCORSegmentedLogStorage *relaunchedStorage = [self relaunchedStorage];
+  XCTAssertEqual([self storageSizeOfStorage:relaunchedStorage], intactSize);
+  attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:segmentPath error:nil];
+  XCTAssertEqual(attributes.fileSize, intactSize);
+
+  // Records appended after the recovery are readable.
+  [self storeEvents:1 inStorage:relaunchedStorage];
+  NSSet<GDTCOREvent *> *events;
+  [self batchEventsInStorage:[self relaunchedStorage] events:&events];
+  XCTAssertEqual(events.count, 4);
+}
+
+/** Tests that expired events are removed and reported to the delegate. */
+- (void)testCheckForExpirations {
+  GDTCORMetricsControllerFake *metricsController = [[GDTCORMetricsControllerFake alloc] init];
+  XCTestExpectation *expectation = [self expectationWithDescription:@"delegate notified"];
+  metricsController.onStorageDidRemoveExpiredEvents = ^(NSSet<GDTCOREvent *> *events) {
+    XCTAssertEqual(events.count, 2);
+    [expectation fulfill];
+  };
+  self.storage.delegate = metricsController;
+
+  for (int i = 0; i < 2; i++) {
+    GDTCOREvent *event = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetTest
+                                                              qosTier:@(GDTCOREventQoSDefault)
+                                                            mappingID:@"expired"];
+    event.expirationDate = [NSDate dateWithTimeIntervalSinceNow:-1];
+    [self storeEvent:event inStorage:self.storage];
+  }
+  [self storeEvents:1 inStorage:self.storage];
+
+  [self.storage checkForExpirations];
+  [self waitForExpectations:@[ expectation ] timeout:5];
+
+  NSSet<GDTCOREvent *> *events;
+  [self batchEventsInStorage:self.storage events:&events];
+  XCTAssertEqual(events.count, 1);
+}
+
+/** Tests the promise based batch APIs. */
+- (void)testRemoveAllBatchesForTarget {
+  [self storeEvents:2 inStorage:self.storage];
+  FBLPromise<GDTCORUploadBatch *> *batchPromise =
+      [self.storage batchWithEventSelector:[GDTCORStorageEventSelector
+                                               eventSelectorForTarget:kGDTCORTargetTest]
+                           batchExpiration:[NSDate dateWithTimeIntervalSinceNow:600]];
+  FBLWaitForPromisesWithTimeout(1);
+  XCTAssertEqual(batchPromise.value.events.count, 2);
+
+  FBLPromise<NSSet<NSNumber *> *> *batchIDsPromise =
+      [self.storage batchIDsForTarget:kGDTCORTargetTest];
+  FBLWaitForPromisesWithTimeout(1);
+  XCTAssertEqualObjects(batchIDsPromise.value, [NSSet setWithObject:batchPromise.value.batchID]);
+
+  FBLPromise *removePromise = [self.storage removeAllBatchesForTarget:kGDTCORTargetTest
+                                                         deleteEvents:NO];
+  FBLWaitForPromisesWithTimeout(1);
+  XCTAssertTrue(removePromise.isFulfilled);
+  XCTAssertTrue([self hasEventsInStorage:self.storage]);
+}
+
+/** Tests that an upload batch reads its events when enumerated, and only while it exists. */
+- (void)testUploadBatchReadsEventsWhenEnumerated {
+  NSSet<GDTCOREvent *> *storedEvents = [self storeEvents:100 inStorage:self.storage];
+  FBLPromise<GDTCORUploadBatch *> *batchPromise =
+      [self.storage batchWithEventSelector:[GDTCORStorageEventSelector
+                                               eventSelectorForTarget:kGDTCORTargetTest]
+                           batchExpiration:[NSDate dateWithTimeIntervalSinceNow:600]];
+  FBLWaitForPromisesWithTimeout(1);
+  GDTCORUploadBatch *batch = batchPromise.value;
+  XCTAssertEqual(batch.eventCount, 100);
+  XCTAssertFalse([self hasEventsInStorage:self.storage]);
+
+  NSMutableSet<NSString *> *enumeratedEventIDs = [NSMutableSet set];
+  [batch enumerateEventsUsingBlock:^(GDTCOREvent *_Nonnull event, BOOL *_Nonnull stop) {
+    [enumeratedEventIDs addObject:event.eventID];
+  }];
+  XCTAssertEqualObjects(enumeratedEventIDs, [storedEvents valueForKey:@"eventID"]);
+
+  [self removeBatchWithID:batch.batchID deleteEvents:NO inStorage:self.storage];
+  __block NSUInteger enumeratedCount = 0;
+  [batch enumerateEventsUsingBlock:^(GDTCOREvent *_Nonnull event, BOOL *_Nonnull stop) {
+    enumeratedCount++;
+  }];
+  XCTAssertEqual(enumeratedCount, 0);
+}
+
+/** Tests that the storage singleton is only returned for an Info.plist that opts in to it, and that
+ * the Info.plist configures its group commit window.
+ */
+- (void)testSharedInstanceEnabledByInfoDictionary {
+  XCTAssertNil([GDTCORSegmentedLogStorage sharedInstanceEnabledByInfoDictionary:nil]);
+  XCTAssertNil([GDTCORSegmentedLogStorage sharedInstanceEnabledByInfoDictionary:@{}]);
+  XCTAssertNil([GDTCORSegmentedLogStorage
+      sharedInstanceEnabledByInfoDictionary:@{kGDTCORSegmentedLogStorageEnabledKey : @NO}]);
+
+  GDTCORSegmentedLogStorage *sharedStorage = [GDTCORSegmentedLogStorage sharedInstance];
+  NSTimeInterval groupCommitWindow = sharedStorage.groupCommitWindow;
+  GDTCORSegmentedLogStorage *storage =
+      [GDTCORSegmentedLogStorage sharedInstanceEnabledByInfoDictionary:@{
+        kGDTCORSegmentedLogStorageEnabledKey : @YES,
+        kGDTCORSegmentedLogStorageGroupCommitWindowKey : @0.05
+      }];
+  XCTAssertEqual(storage, sharedStorage);
+  XCTAssertEqualWithAccuracy(storage.groupCommitWindow, 0.05, 0.0001);
+  sharedStorage.groupCommitWindow = groupCommitWindow;
+}
+
+/** Tests that an upload batch enumerated on the storage queue reads its events in place instead of
+ * deadlocking on the queue.
+ */
+- (void)testUploadBatchEnumeratedOnStorageQueue {
+  NSSet<GDTCOREvent *> *storedEvents = [self storeEvents:100 inStorage:self.storage];
+  FBLPromise<GDTCORUploadBatch *> *batchPromise =
+      [self.storage batchWithEventSelector:[GDTCORStorageEventSelector
+                                               eventSelectorForTarget:kGDTCORTargetTest]
+                           batchExpiration:[NSDate dateWithTimeIntervalSinceNow:600]];
+  FBLWaitForPromisesWithTimeout(1);
+  GDTCORUploadBatch *batch = batchPromise.value;
+
+  NSMutableSet<NSString *> *enumeratedEventIDs = [NSMutableSet set];
+  XCTestExpectation *enumeratedExpectation = [self expectationWithDescription:@"enumerated"];
+  dispatch_async(self.storage.storageQueue, ^{
+    [batch enumerateEventsUsingBlock:^(GDTCOREvent *_Nonnull event, BOOL *_Nonnull stop) {
+      [enumeratedEventIDs addObject:event.eventID];
+    }];
+    [enumeratedExpectation fulfill];
+  });
+  [self waitForExpectations:@[ enumeratedExpectation ] timeout:5];
+  XCTAssertEqualObjects(enumeratedEventIDs, [storedEvents valueForKey:@"eventID"]);
+}
+
+/** Tests that a bounded selector batches the oldest events up to its limit. */
+- (void)testBoundedSelectorBatchesOldestEvents {
+  NSMutableArray<NSString *> *storedEventIDs = [[NSMutableArray alloc] init];
+  for (NSUInteger i = 0; i < 5; i++) {
+    GDTCOREvent *event = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetTest
+                                                              qosTier:@(GDTCOREventQoSDefault)
+                                                            mappingID:@"1018"];
+    [self storeEvent:event inStorage:self.storage];
+    [storedEventIDs addObject:event.eventID];
+  }
+  GDTCORStorageEventSelector *selector = [[GDTCORStorageEventSelector alloc]
+         initWithTarget:kGDTCORTargetTest
+               eventIDs:nil
+             mappingIDs:nil
+               qosTiers:nil
+          maxEventCount:2
+      maxBatchSizeBytes:0
+                  order:GDTCORStorageEventSelectorOrderOldestFirst];
+  __block NSSet<GDTCOREvent *> *batchedEvents;
+  XCTestExpectation *expectation = [self expectationWithDescription:@"batch created"];
+  [self.storage batchWithEventSelector:selector
+                       batchExpiration:[NSDate dateWithTimeIntervalSinceNow:600]
+                            onComplete:^(NSNumber *_Nullable newBatchID,
+                                         NSSet<GDTCOREvent *> *_Nullable events) {
+                              batchedEvents = events;
+                              [expectation fulfill];
+                            }];
+  [self waitForExpectations:@[ expectation ] timeout:5];
+  NSArray<NSString *> *oldestEventIDs = [storedEventIDs subarrayWithRange:NSMakeRange(0, 2)];
+  XCTAssertEqualObjects([batchedEvents valueForKey:@"eventID"],
+                        [NSSet setWithArray:oldestEventIDs]);
+  XCTAssertTrue([self hasEventsInStorage:self.storage]);
+}
+
+/** Tests that events stored within the group commit window are written together and that each
+ * completion is called once its event is written.
+ */
+- (void)testGroupCommitStoresEventsOfWindow {
+  self.storage.groupCommitWindow = 0.1;
+  NSMutableSet<NSString *> *storedEventIDs = [[NSMutableSet alloc] init];
+  NSMutableArray<XCTestExpectation *> *expectations = [[NSMutableArray alloc] init];
+  for (NSUInteger i = 0; i < 10; i++) {
+    GDTCOREvent *event = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetTest
+                                                              qosTier:@(GDTCOREventQoSDefault)
+                                                            mappingID:@"1018"];
+    [storedEventIDs addObject:event.eventID];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"event stored"];
+    [expectations addObject:expectation];
+    [self.storage storeEvent:event
+                  onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+                    XCTAssertTrue(wasWritten);
+                    XCTAssertNil(error);
+                    [expectation fulfill];
+                  }];
+  }
+  [self waitForExpectations:expectations timeout:5];
+
+  NSSet<GDTCOREvent *> *restoredEvents;
+  [self batchEventsInStorage:[self relaunchedStorage] events:&restoredEvents];
+  XCTAssertEqualObjects([restoredEvents valueForKey:@"eventID"], storedEventIDs);
+}
+
+/** Tests that a group is committed as soon as it reaches the byte threshold. */
+- (void)testGroupCommitByteThresholdCommitsBeforeWindowEnds {
+  self.storage.groupCommitWindow = 60;
+  self.storage.groupCommitByteThreshold = 1;
+  NSSet<GDTCOREvent *> *storedEvents = [self storeEvents:2 inStorage:self.storage];
+  NSSet<GDTCOREvent *> *batchedEvents;
+  [self batchEventsInStorage:self.storage events:&batchedEvents];
+  XCTAssertEqualObjects([batchedEvents valueForKey:@"eventID"],
+                        [storedEvents valueForKey:@"eventID"]);
+}
+
+/** Tests that pending events are committed when the app is backgrounded. */
+- (void)testGroupCommitIsCommittedWhenAppWillBackground {
+  self.storage.groupCommitWindow = 60;
+  GDTCOREvent *event = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetTest
+                                                            qosTier:@(GDTCOREventQoSDefault)
+                                                          mappingID:@"1018"];
+  XCTestExpectation *expectation = [self expectationWithDescription:@"event stored"];
+  [self.storage storeEvent:event
+                onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+                  XCTAssertTrue(wasWritten);
+                  [expectation fulfill];
+                }];
+  [self.storage appWillBackground:[GDTCORApplication sharedApplication]];
+  [self waitForExpectations:@[ expectation ] timeout:5];
+  XCTAssertTrue([self hasEventsInStorage:self.storage]);
+}
+
+/** Measures storing a burst of events when each event is synced to disk as soon as it's stored. */
+- (void)testPerEventCommitPerformance {
+  [self measureStoringEventsWithGroupCommitWindow:60 byteThreshold:1];
+}
+
+/** Measures storing the same burst of events when they are synced to disk in group commits, to be
+ * compared with testPerEventCommitPerformance, which gives the events the same durability.
+ */
+- (void)testGroupCommitPerformance {
+  uint64_t byteThreshold = kGDTCORSegmentedLogStorageGroupCommitByteThreshold;
+  [self measureStoringEventsWithGroupCommitWindow:0.005 byteThreshold:byteThreshold];
+}
+
+/** Tests that library data is stored and removed. */
+- (void)testLibraryData {
+  NSData *data = [@"library data" dataUsingEncoding:NSUTF8StringEncoding];
+  XCTestExpectation *expectation = [self expectationWithDescription:@"data stored"];
+  [self.storage storeLibraryData:data
+                          forKey:@"key"
+                      onComplete:^(NSError *_Nullable error) {
+                        XCTAssertNil(error);
+                        [expectation fulfill];
+                      }];
+  [self waitForExpectations:@[ expectation ] timeout:5];
+  XCTAssertEqual([self storageSizeOfStorage:self.storage], data.length);
+
+  expectation = [self expectationWithDescription:@"data fetched"];
+  [self.storage libraryDataForKey:@"key"
+                  onFetchComplete:^(NSData *_Nullable fetchedData, NSError *_Nullable error) {
+                    XCTAssertEqualObjects(fetchedData, data);
+                    [expectation fulfill];
+                  }
+                      setNewValue:nil];
+  [self waitForExpectations:@[ expectation ] timeout:5];
+
+  expectation = [self expectationWithDescription:@"data removed"];
+  [self.storage removeLibraryDataForKey:@"key"
+                             onComplete:^(NSError *_Nullable error) {
+                               XCTAssertNil(error);
+                               [expectation fulfill];
+                             }];
+  [self waitForExpectations:@[ expectation ] timeout:5];
+  XCTAssertEqual([self storageSizeOfStorage:self.storage], 0);
+}
+
+#pragma mark - Helpers
+
+/** Returns a new storage instance reading the segments written so far, like after a relaunch. */
+- (GDTCORSegmentedLogStorage *)relaunchedStorage {
+  if (self.storage) {
+    dispatch_sync(self.storage.storageQueue, ^{
+                  });
+  }
+  GDTCORSegmentedLogStorage *storage = [[GDTCORSegmentedLogStorage alloc] init];
+  storage.uploadCoordinator = self.uploaderFake;
+  return storage;
+}
+
+- (void)storeEvent:(GDTCOREvent *)event inStorage:(GDTCORSegmentedLogStorage *)storage {
+  XCTestExpectation *expectation = [self expectationWithDescription:@"event stored"];
+  [storage storeEvent:event
+           onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+             XCTAssertTrue(wasWritten);
+             XCTAssertNil(error);
+             [expectation fulfill];
+           }];
+  [self waitForExpectations:@[ expectation ] timeout:5];
+}
+
+- (NSSet<GDTCOREvent *> *)storeEvents:(NSUInteger)count
+                            inStorage:(GDTCORSegmentedLogStorage *)storage {
+  NSMutableSet<GDTCOREvent *> *events = [[NSMutableSet alloc] init];
+  for (NSUInteger i = 0; i < count; i++) {
+    GDTCOREvent *event = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetTest
+                                                              qosTier:@(GDTCOREventQoSDefault)
+                                                            mappingID:@"1018"];
+    [self storeEvent:event inStorage:storage];
+    [events addObject:event];
+  }
+  return events;
+}
+
+- (nullable NSNumber *)batchEventsInStorage:(GDTCORSegmentedLogStorage *)storage
+                                     events:(NSSet<GDTCOREvent *> **_Nullable)outEvents {
+  __block NSNumber *batchID;
+  __block NSSet<GDTCOREvent *> *batchEvents;
+  GDTCORStorageEventSelector *selector =
+      [GDTCORStorageEventSelector eventSelectorForTarget:kGDTCORTargetTest];
+  XCTestExpectation *expectation = [self expectationWithDescription:@"batch created"];
+  [storage batchWithEventSelector:selector
+                  batchExpiration:[NSDate dateWithTimeIntervalSinceNow:600]
+                       onComplete:^(NSNumber *_Nullable newBatchID,
+                                    NSSet<GDTCOREvent *> *_Nullable events) {
+                         batchID = newBatchID;
+                         batchEvents = events;
+                         [expectation fulfill];
+                       }];
+  [self waitForExpectations:@[ expectation ] timeout:5];
+  if (outEvents) {
+    *outEvents = batchEvents;
+  }
+  return batchID;
+}
+
+- (void)removeBatchWithID:(NSNumber *)batchID
+             deleteEvents:(BOOL)deleteEvents
+                inStorage:(GDTCORSegmentedLogStorage *)storage {
+  XCTestExpectation *expectation = [self expectationWithDescription:@"batch removed"];
+  [storage removeBatchWithID:batchID
+                deleteEvents:deleteEvents
+                  onComplete:^{
+                    [expectation fulfill];
+                  }];
+  [self waitForExpectations:@[ expectation ] timeout:5];
+}
+
+/** Measures storing a burst of events until every completion is called, with the given group
+ * commit configuration, and logs the throughput and the p99 latency from storing an event to its
+ * completion being called over all iterations. The stored events are removed after each measured
+ * iteration.
+ */
+- (void)measureStoringEventsWithGroupCommitWindow:(NSTimeInterval)window
+                                    byteThreshold:(uint64_t)byteThreshold {
+  NSUInteger eventCount = 200;
+  NSMutableArray<NSNumber *> *latencies = [[NSMutableArray alloc] init];
+  __block CFAbsoluteTime totalDuration = 0;
+  [self measureMetrics:[[self class] defaultPerformanceMetrics]
+      automaticallyStartMeasuring:NO
+                         forBlock:^{
+                           GDTCORSegmentedLogStorage *storage = [self relaunchedStorage];
+                           storage.groupCommitWindow = window;
+                           storage.groupCommitByteThreshold = byteThreshold;
+                           NSMutableArray<GDTCOREvent *> *events = [[NSMutableArray alloc] init];
+                           for (NSUInteger i = 0; i < eventCount; i++) {
+                             [events addObject:[GDTCOREventGenerator
+                                                   generateEventForTarget:kGDTCORTargetTest
+                                                                  qosTier:@(GDTCOREventQoSDefault)
+                                                                mappingID:@"1018"]];
+                           }
+                           XCTestExpectation *expectation =
+                               [self expectationWithDescription:@"events stored"];
+                           expectation.expectedFulfillmentCount = eventCount;
+
+                           [self startMeasuring];
+                           CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+                           for (GDTCOREvent *event in events) {
+                             CFAbsoluteTime storeTime = CFAbsoluteTimeGetCurrent();
+                             [storage storeEvent:event
+                                      onComplete:^(BOOL wasWritten, NSError *_Nullable error) {
+                                        XCTAssertTrue(wasWritten);
+                                        CFAbsoluteTime latency =
+                                            CFAbsoluteTimeGetCurrent() - storeTime;
+                                        @synchronized(latencies) {
+                                          [latencies addObject:@(latency)];
+                                        }
+                                        [expectation fulfill];
+                                      }];
+                           }
+                           [self waitForExpectations:@[ expectation ] timeout:60];
+                           totalDuration += CFAbsoluteTimeGetCurrent() - start;
+                           [self stopMeasuring];
+
+                           NSSet<GDTCOREvent *> *batchedEvents;
+                           NSNumber *batchID = [self batchEventsInStorage:storage
+                                                                   events:&batchedEvents];
+                           XCTAssertEqual(batchedEvents.count, eventCount);
+                           [self removeBatchWithID:batchID deleteEvents:YES inStorage:storage];
+                         }];
+
+  XCTAssertGreaterThan(latencies.count, 0);
+  [latencies sortUsingSelector:@selector(compare:)];
+  double p99 = latencies[(NSUInteger)(latencies.count * 0.99)].doubleValue;
+  NSLog(@"Group commit window %.3fs, byte threshold %llu: %.0f events/sec, p99 store latency "
+        @"%.2fms",
+        window, (unsigned long long)byteThreshold, latencies.count / totalDuration, p99 * 1000);
+}
+
+- (BOOL)hasEventsInStorage:(GDTCORSegmentedLogStorage *)storage {
+  __block BOOL result;
+  XCTestExpectation *expectation = [self expectationWithDescription:@"hasEvents completion called"];
+  [storage hasEventsForTarget:kGDTCORTargetTest
+                   onComplete:^(BOOL hasEvents) {
+                     result = hasEvents;
+                     [expectation fulfill];
+                   }];
+  [self waitForExpectations:@[ expectation ] timeout:5];
+  return result;
+}
+
+- (uint64_t)storageSizeOfStorage:(GDTCORSegmentedLogStorage *)storage {
+  __block uint64_t result;
+  XCTestExpectation *expectation = [self expectationWithDescription:@"size fetched"];
+  [storage storageSizeWithCallback:^(uint64_t storageSize) {
+    result = storageSize;
+    [expectation fulfill];
+  }];
+  [self waitForExpectations:@[ expectation ] timeout:5];
+  return result;
+}
+
+@end
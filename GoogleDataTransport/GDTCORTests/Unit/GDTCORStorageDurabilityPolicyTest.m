@@ -0,0 +1,52 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageDurabilityPolicy.h"
+
+@interface GDTCORStorageDurabilityPolicyTest : XCTestCase
+
+@end
+
+@implementation GDTCORStorageDurabilityPolicyTest
+
+/** Tests that events no setting applies to use the default durability. */
+- (void)testDefaultDurability {
+  GDTCORStorageDurabilityPolicy *policy = [[GDTCORStorageDurabilityPolicy alloc] init];
+  GDTCOREvent *event = [[GDTCOREvent alloc] initWithMappingID:@"404" target:kGDTCORTargetTest];
+  XCTAssertEqual([policy durabilityForEvent:event], GDTCORStorageDurabilityAtomic);
+  policy.defaultDurability = GDTCORStorageDurabilityRelaxed;
+  XCTAssertEqual([policy durabilityForEvent:event], GDTCORStorageDurabilityRelaxed);
+}
+
+/** Tests that the more durable of the target and QoS tier settings is used. */
+- (void)testTargetAndQoSTierDurabilities {
+  GDTCORStorageDurabilityPolicy *policy = [[GDTCORStorageDurabilityPolicy alloc] init];
+  [policy setDurability:GDTCORStorageDurabilityRelaxed forTarget:kGDTCORTargetTest];
+  [policy setDurability:GDTCORStorageDurabilitySynced forQoSTier:GDTCOREventQoSTelemetry];
+
+  GDTCOREvent *event = [[GDTCOREvent alloc] initWithMappingID:@"404" target:kGDTCORTargetTest];
+  XCTAssertEqual([policy durabilityForEvent:event], GDTCORStorageDurabilityRelaxed);
+  event.qosTier = GDTCOREventQoSTelemetry;
+  XCTAssertEqual([policy durabilityForEvent:event], GDTCORStorageDurabilitySynced);
+
+  GDTCOREvent *otherEvent = [[GDTCOREvent alloc] initWithMappingID:@"404"
+                                                             target:kGDTCORTargetFLL];
+  XCTAssertEqual([policy durabilityForEvent:otherEvent], GDTCORStorageDurabilityAtomic);
+}
+
+@end
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEventIndex.h"
+
+@interface GDTCORStorageEventIndexTest : XCTestCase
+
+@end
+
+@implementation GDTCORStorageEventIndexTest
+
+/** Tests that entries can be found by every key. */
+- (void)testEntriesForTarget {
+  GDTCORStorageEventIndex *index = [[GDTCORStorageEventIndex alloc] init];
+  [index addEntry:[self entryWithEventID:@"1" qosTier:GDTCOREventQoSFast mappingID:@"a"]];
+  [index addEntry:[self entryWithEventID:@"2" qosTier:GDTCOREventQosDefault mappingID:@"a"]];
+  [index addEntry:[self entryWithEventID:@"3" qosTier:GDTCOREventQosDefault mappingID:@"b"]];
+
+  XCTAssertEqual([index countForTarget:kGDTCORTargetTest], 3);
+  XCTAssertEqual([index countForTarget:kGDTCORTargetCCT], 0);
+  XCTAssertEqualObjects([self eventIDsInIndex:index eventIDs:nil qosTiers:nil mappingIDs:nil],
+                        ([NSSet setWithObjects:@"1", @"2", @"3", nil]));
+  XCTAssertEqualObjects([self eventIDsInIndex:index
+                                     eventIDs:[NSSet setWithObject:@"2"]
+                                     qosTiers:nil
+                                   mappingIDs:nil],
+                        [NSSet setWithObject:@"2"]);
+  XCTAssertEqualObjects([self eventIDsInIndex:index
+                                     eventIDs:nil
+                                     qosTiers:[NSSet setWithObject:@(GDTCOREventQosDefault)]
+                                   mappingIDs:nil],
+                        ([NSSet setWithObjects:@"2", @"3", nil]));
+  XCTAssertEqualObjects([self eventIDsInIndex:index
+                                     eventIDs:nil
+                                     qosTiers:[NSSet setWithObject:@(GDTCOREventQosDefault)]
+                                   mappingIDs:[NSSet setWithObject:@"a"]],
+                        [NSSet setWithObject:@"2"]);
+  XCTAssertEqualObjects([self eventIDsInIndex:index
+                                     eventIDs:[NSSet setWithObject:@"1"]
+                                     qosTiers:[NSSet setWithObject:@(GDTCOREventQosDefault)]
+                                   mappingIDs:nil],
+                        [NSSet set]);
+}
+
+/** Tests that removed and replaced entries are no longer found. */
+- (void)testRemoveEntry {
+  GDTCORStorageEventIndex *index = [[GDTCORStorageEventIndex alloc] init];
+  [index addEntry:[self entryWithEventID:@"1" qosTier:GDTCOREventQoSFast mappingID:@"a"]];
+  [index addEntry:[self entryWithEventID:@"1" qosTier:GDTCOREventQosDefault mappingID:@"b"]];
+  XCTAssertEqual([index countForTarget:kGDTCORTargetTest], 1);
+  XCTAssertEqualObjects([self eventIDsInIndex:index
+                                     eventIDs:nil
+                                     qosTiers:nil
+                                   mappingIDs:[NSSet setWithObject:@"a"]],
+                        [NSSet set]);
+
+  XCTAssertNotNil([index removeEntryWithEventID:@"1" target:kGDTCORTargetTest]);
+  XCTAssertNil([index removeEntryWithEventID:@"1" target:kGDTCORTargetTest]);
+  XCTAssertEqual([index countForTarget:kGDTCORTargetTest], 0);
+  XCTAssertEqualObjects([self eventIDsInIndex:index
+                                     eventIDs:nil
+                                     qosTiers:[NSSet setWithObject:@(GDTCOREventQosDefault)]
+                                   mappingIDs:nil],
+                        [NSSet set]);
+}
+
+/** Tests that removing all entries resets the loaded targets. */
+- (void)testRemoveAllEntries {
+  GDTCORStorageEventIndex *index = [[GDTCORStorageEventIndex alloc] init];
+  [index markTargetLoaded:kGDTCORTargetTest];
+  [index addEntry:[self entryWithEventID:@"1" qosTier:GDTCOREventQoSFast mappingID:@"a"]];
+  XCTAssertTrue([index isTargetLoaded:kGDTCORTargetTest]);
+
+  [index removeAllEntries];
+  XCTAssertFalse([index isTargetLoaded:kGDTCORTargetTest]);
+  XCTAssertEqual([index countForTarget:kGDTCORTargetTest], 0);
+}
+
+/** Tests that only the entries that expired before the date are found, and that removed entries
+ * are no longer found.
+ */
+- (void)testEntriesExpiredBeforeDate {
+  GDTCORStorageEventIndex *index = [[GDTCORStorageEventIndex alloc] init];
+  NSDate *now = [NSDate date];
+  [index addEntry:[self entryWithEventID:@"1" expirationDate:[now dateByAddingTimeInterval:-7200]]];
+  [index addEntry:[self entryWithEventID:@"2" expirationDate:[now dateByAddingTimeInterval:-1]]];
+  [index addEntry:[self entryWithEventID:@"3" expirationDate:[now dateByAddingTimeInterval:1]]];
+  [index addEntry:[self entryWithEventID:@"4" expirationDate:[now dateByAddingTimeInterval:7200]]];
+
+  XCTAssertEqualObjects([NSSet setWithArray:[[index entriesExpiredBeforeDate:now]
+                                                valueForKey:@"eventID"]],
+                        ([NSSet setWithObjects:@"1", @"2", nil]));
+
+  [index removeEntryWithEventID:@"1" target:kGDTCORTargetTest];
+  XCTAssertEqualObjects([[index entriesExpiredBeforeDate:now] valueForKey:@"eventID"], @[ @"2" ]);
+}
+
+#pragma mark - Helpers
+
+- (GDTCORStorageEventIndexEntry *)entryWithEventID:(NSString *)eventID
+                                           qosTier:(GDTCOREventQoS)qosTier
+                                         mappingID:(NSString *)mappingID {
+  return [[GDTCORStorageEventIndexEntry alloc]
+      initWithTarget:kGDTCORTargetTest
+             eventID:eventID
+             qosTier:qosTier
+           mappingID:mappingID
+      expirationDate:[NSDate dateWithTimeIntervalSinceNow:60]
+                path:[NSTemporaryDirectory() stringByAppendingPathComponent:eventID]
+          storedDate:[NSDate date]
+                size:1];
+}
+
+- (GDTCORStorageEventIndexEntry *)entryWithEventID:(NSString *)eventID
+                                    expirationDate:(NSDate *)expirationDate {
+  return [[GDTCORStorageEventIndexEntry alloc]
+      initWithTarget:kGDTCORTargetTest
+             eventID:eventID
+             qosTier:GDTCOREventQosDefault
+           mappingID:@"a"
+      expirationDate:expirationDate
+                path:[NSTemporaryDirectory() stringByAppendingPathComponent:eventID]
+          storedDate:[NSDate date]
+                size:1];
+}
+
+- (NSSet<NSString *> *)eventIDsInIndex:(GDTCORStorageEventIndex *)index
+                              eventIDs:(nullable NSSet<NSString *> *)eventIDs
+                              qosTiers:(nullable NSSet<NSNumber *> *)qosTiers
+                            mappingIDs:(nullable NSSet<NSString *> *)mappingIDs {
+  NSArray<GDTCORStorageEventIndexEntry *> *entries = [index entriesForTarget:kGDTCORTargetTest
+                                                                     eventIDs:eventIDs
+                                                                     qosTiers:qosTiers
+                                                                   mappingIDs:mappingIDs];
+  return [NSSet setWithArray:[entries valueForKey:@"eventID"]];
+}
+
+@end
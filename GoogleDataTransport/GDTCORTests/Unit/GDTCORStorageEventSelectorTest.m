@@ -0,0 +1,111 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEventSelector.h"
+
+@interface GDTCORStorageEventSelectorTest : XCTestCase
+
+@end
+
+@implementation GDTCORStorageEventSelectorTest
+
+/** Tests that an unbounded selector selects all candidates. */
+- (void)testUnboundedSelectorSelectsAllCandidates {
+  GDTCORStorageEventSelector *selector =
+      [GDTCORStorageEventSelector eventSelectorForTarget:kGDTCORTargetTest];
+  XCTAssertFalse([selector isBounded]);
+  XCTAssertEqualObjects([self selectCandidates:@[ @"a", @"b", @"c" ] withSelector:selector],
+                        (@[ @"a", @"b", @"c" ]));
+}
+
+/** Tests that the oldest candidates are selected up to the event count limit. */
+- (void)testMaxEventCount {
+  GDTCORStorageEventSelector *selector =
+      [self selectorWithMaxEventCount:2
+                    maxBatchSizeBytes:0
+                                order:GDTCORStorageEventSelectorOrderOldestFirst];
+  XCTAssertTrue([selector isBounded]);
+  XCTAssertEqualObjects([self selectCandidates:@[ @"a", @"b", @"c" ] withSelector:selector],
+                        (@[ @"a", @"b" ]));
+}
+
+/** Tests that candidates are selected up to the byte limit, and that a candidate larger than the
+ * limit is selected on its own.
+ */
+- (void)testMaxBatchSizeBytes {
+  GDTCORStorageEventSelector *selector =
+      [self selectorWithMaxEventCount:0
+                    maxBatchSizeBytes:2
+                                order:GDTCORStorageEventSelectorOrderOldestFirst];
+  XCTAssertEqualObjects([self selectCandidates:@[ @"a", @"b", @"c" ] withSelector:selector],
+                        (@[ @"a", @"b" ]));
+  XCTAssertEqualObjects([self selectCandidates:@[ @"aaa", @"b" ] withSelector:selector],
+                        (@[ @"aaa" ]));
+}
+
+/** Tests that candidates of more urgent QoS tiers are selected first, oldest first within a tier.
+ */
+- (void)testPriorityFirstOrder {
+  GDTCORStorageEventSelector *selector =
+      [self selectorWithMaxEventCount:3
+                    maxBatchSizeBytes:0
+                                order:GDTCORStorageEventSelectorOrderPriorityFirst];
+  NSDictionary<NSString *, NSNumber *> *qosTiers = @{
+    @"telemetry" : @(GDTCOREventQoSTelemetry),
+    @"default1" : @(GDTCOREventQosDefault),
+    @"fast" : @(GDTCOREventQoSFast),
+    @"default2" : @(GDTCOREventQosDefault),
+  };
+  NSArray *selected =
+      [selector selectCandidates:@[ @"telemetry", @"default1", @"fast", @"default2" ]
+                         qosTier:^GDTCOREventQoS(NSString *candidate) {
+                           return (GDTCOREventQoS)qosTiers[candidate].integerValue;
+                         }
+                            size:^uint64_t(NSString *candidate) {
+                              return 1;
+                            }];
+  XCTAssertEqualObjects(selected, (@[ @"fast", @"default1", @"default2" ]));
+}
+
+#pragma mark - Helpers
+
+- (GDTCORStorageEventSelector *)selectorWithMaxEventCount:(NSUInteger)maxEventCount
+                                        maxBatchSizeBytes:(uint64_t)maxBatchSizeBytes
+                                                    order:(GDTCORStorageEventSelectorOrder)order {
+  return [[GDTCORStorageEventSelector alloc] initWithTarget:kGDTCORTargetTest
+                                                   eventIDs:nil
+                                                 mappingIDs:nil
+                                                   qosTiers:nil
+                                              maxEventCount:maxEventCount
+                                          maxBatchSizeBytes:maxBatchSizeBytes
+                                                      order:order];
+}
+
+/** Selects candidates of the default QoS tier whose size is their length. */
+- (NSArray *)selectCandidates:(NSArray<NSString *> *)candidates
+                 withSelector:(GDTCORStorageEventSelector *)selector {
+  return [selector selectCandidates:candidates
+                            qosTier:^GDTCOREventQoS(NSString *candidate) {
+                              return GDTCOREventQosDefault;
+                            }
+                               size:^uint64_t(NSString *candidate) {
+                                 return candidate.length;
+                               }];
+}
+
+@end
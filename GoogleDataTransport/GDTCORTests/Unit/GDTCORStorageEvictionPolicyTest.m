@@ -0,0 +1,121 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEvictionPolicy.h"
+
+#import "GoogleDataTransport/GDTCORTests/Unit/Helpers/GDTCOREventGenerator.h"
+
+@interface GDTCORStorageEvictionPolicyTest : XCTestCase
+
+@end
+
+@implementation GDTCORStorageEvictionPolicyTest
+
+/** Tests that the oldest first policy evicts the events stored earliest first. */
+- (void)testOldestFirstEvictionPolicy {
+  NSArray<GDTCORStorageEvictionCandidate *> *candidates = @[
+    [self candidateWithEventID:@"2" qosTier:GDTCOREventQoSFast mappingID:@"a" age:2 size:1],
+    [self candidateWithEventID:@"3" qosTier:GDTCOREventQoSFast mappingID:@"a" age:1 size:1],
+    [self candidateWithEventID:@"1" qosTier:GDTCOREventQoSFast mappingID:@"a" age:3 size:1],
+  ];
+  id<GDTCORStorageEvictionPolicy> policy = [[GDTCOROldestFirstEvictionPolicy alloc] init];
+  XCTAssertEqualObjects([self eventIDsToEvictWithPolicy:policy
+                                             candidates:candidates
+                                                qosTier:GDTCOREventQoSTelemetry],
+                        (@[ @"1", @"2", @"3" ]));
+}
+
+/** Tests that the lowest QoS first policy evicts the least urgent events first, and never events
+ * more urgent than the new event.
+ */
+- (void)testLowestQoSFirstEvictionPolicy {
+  NSArray<GDTCORStorageEvictionCandidate *> *candidates = @[
+    [self candidateWithEventID:@"fast" qosTier:GDTCOREventQoSFast mappingID:@"a" age:4 size:1],
+    [self candidateWithEventID:@"default"
+                       qosTier:GDTCOREventQosDefault
+                     mappingID:@"a"
+                           age:3
+                          size:1],
+    [self candidateWithEventID:@"telemetry2"
+                       qosTier:GDTCOREventQoSTelemetry
+                     mappingID:@"a"
+                           age:1
+                          size:1],
+    [self candidateWithEventID:@"telemetry1"
+                       qosTier:GDTCOREventQoSTelemetry
+                     mappingID:@"a"
+                           age:2
+                          size:1],
+  ];
+  id<GDTCORStorageEvictionPolicy> policy = [[GDTCORLowestQoSFirstEvictionPolicy alloc] init];
+  XCTAssertEqualObjects([self eventIDsToEvictWithPolicy:policy
+                                             candidates:candidates
+                                                qosTier:GDTCOREventQoSFast],
+                        (@[ @"telemetry1", @"telemetry2", @"default", @"fast" ]));
+  XCTAssertEqualObjects([self eventIDsToEvictWithPolicy:policy
+                                             candidates:candidates
+                                                qosTier:GDTCOREventQoSTelemetry],
+                        (@[ @"telemetry1", @"telemetry2" ]));
+}
+
+/** Tests that the largest log source first policy evicts the events of the mapping ID taking the
+ * most storage first.
+ */
+- (void)testLargestLogSourceFirstEvictionPolicy {
+  NSArray<GDTCORStorageEvictionCandidate *> *candidates = @[
+    [self candidateWithEventID:@"small" qosTier:GDTCOREventQoSFast mappingID:@"a" age:3 size:5],
+    [self candidateWithEventID:@"large2" qosTier:GDTCOREventQoSFast mappingID:@"b" age:1 size:3],
+    [self candidateWithEventID:@"large1" qosTier:GDTCOREventQoSFast mappingID:@"b" age:2 size:3],
+  ];
+  id<GDTCORStorageEvictionPolicy> policy =
+      [[GDTCORLargestLogSourceFirstEvictionPolicy alloc] init];
+  XCTAssertEqualObjects([self eventIDsToEvictWithPolicy:policy
+                                             candidates:candidates
+                                                qosTier:GDTCOREventQoSFast],
+                        (@[ @"large1", @"large2", @"small" ]));
+}
+
+#pragma mark - Helpers
+
+/** Creates a candidate stored the given number of seconds ago. */
+- (GDTCORStorageEvictionCandidate *)candidateWithEventID:(NSString *)eventID
+                                                 qosTier:(GDTCOREventQoS)qosTier
+                                               mappingID:(NSString *)mappingID
+                                                     age:(NSTimeInterval)age
+                                                    size:(uint64_t)size {
+  return [[GDTCORStorageEvictionCandidate alloc]
+      initWithTarget:kGDTCORTargetTest
+             eventID:eventID
+             qosTier:qosTier
+           mappingID:mappingID
+          storedDate:[NSDate dateWithTimeIntervalSinceNow:-age]
+                size:size];
+}
+
+- (NSArray<NSString *> *)eventIDsToEvictWithPolicy:(id<GDTCORStorageEvictionPolicy>)policy
+                                        candidates:
+                                            (NSArray<GDTCORStorageEvictionCandidate *> *)candidates
+                                           qosTier:(GDTCOREventQoS)qosTier {
+  GDTCOREvent *event = [GDTCOREventGenerator generateEventForTarget:kGDTCORTargetTest
+                                                            qosTier:@(qosTier)
+                                                          mappingID:@"new"];
+  return [[policy candidatesToEvictFromCandidates:candidates
+                                         forEvent:event] valueForKey:@"eventID"];
+}
+
+@end
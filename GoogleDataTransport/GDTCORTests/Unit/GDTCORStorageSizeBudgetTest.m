@@ -0,0 +1,94 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <XCTest/XCTest.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageSizeBudget.h"
+
+@interface GDTCORStorageSizeBudgetTest : XCTestCase
+
+@end
+
+@implementation GDTCORStorageSizeBudgetTest
+
+/** Tests that sizes are only reserved within the limit. */
+- (void)testReserveSizeWithinLimit {
+  GDTCORStorageSizeBudget *budget = [[GDTCORStorageSizeBudget alloc] initWithLimit:100];
+  XCTAssertTrue([budget reserveSize:60]);
+  XCTAssertFalse([budget reserveSize:41]);
+  XCTAssertTrue([budget reserveSize:40]);
+  XCTAssertEqual(budget.totalSize, 100);
+  XCTAssertFalse([budget reserveSize:1]);
+  XCTAssertFalse([budget reserveSize:UINT64_MAX]);
+}
+
+/** Tests that added sizes may exceed the limit and removed sizes don't go below zero. */
+- (void)testAddAndRemoveSize {
+  GDTCORStorageSizeBudget *budget = [[GDTCORStorageSizeBudget alloc] initWithLimit:100];
+  [budget addSize:150];
+  XCTAssertEqual(budget.totalSize, 150);
+  XCTAssertFalse([budget reserveSize:1]);
+  [budget removeSize:100];
+  XCTAssertEqual(budget.totalSize, 50);
+  [budget removeSize:100];
+  XCTAssertEqual(budget.totalSize, 0);
+}
+
+/** Tests that concurrent reservations never exceed the limit. */
+- (void)testConcurrentReservations {
+  GDTCORStorageSizeBudget *budget = [[GDTCORStorageSizeBudget alloc] initWithLimit:1000];
+  __block NSInteger reservationCount = 0;
+  dispatch_apply(2000, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t iteration) {
+    if ([budget reserveSize:1]) {
+      @synchronized(budget) {
+        reservationCount++;
+      }
+    }
+  });
+  XCTAssertEqual(reservationCount, 1000);
+  XCTAssertEqual(budget.totalSize, 1000);
+}
+
+/** Tests that the size changes of a directory size tracker are reported to the budget. */
+- (void)testDirectorySizeTrackerReportsToBudget {
+  NSString *directoryPath =
+      [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+  [[NSFileManager defaultManager] createDirectoryAtPath:directoryPath
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:nil];
+  NSString *filePath = [directoryPath stringByAppendingPathComponent:@"file"];
+  [[NSData dataWithBytes:"12345" length:5] writeToFile:filePath atomically:YES];
+
+  GDTCORStorageSizeBudget *budget = [[GDTCORStorageSizeBudget alloc] initWithLimit:100];
+  GDTCORDirectorySizeTracker *sizeTracker =
+      [[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:directoryPath sizeBudget:budget];
+  XCTAssertEqual(budget.totalSize, 0);
+  XCTAssertEqual([sizeTracker directoryContentSize], 5);
+  XCTAssertEqual(budget.totalSize, 5);
+
+  [sizeTracker fileWasAddedAtPath:filePath withSize:10];
+  XCTAssertEqual(budget.totalSize, 15);
+  [sizeTracker fileWasRemovedAtPath:filePath withSize:12];
+  XCTAssertEqual(budget.totalSize, 3);
+  [sizeTracker resetCachedSize];
+  XCTAssertEqual(budget.totalSize, 0);
+
+  [[NSFileManager defaultManager] removeItemAtPath:directoryPath error:nil];
+}
+
+@end
@@ -156,6 +156,53 @@
   [self waitForExpectations:bgTaskExpectations timeout:0.5];
 }
 
+/** Tests writing events in bulk under a single background task. */
+- (void)testWriteEventsWithoutTransformers {
+  __auto_type bgTaskExpectations =
+      [self expectationsBackgroundTaskBeginAndEndWithName:@"GDTTransformer"];
+
+  NSMutableArray<GDTCOREvent *> *events = [NSMutableArray array];
+  for (int i = 0; i < 3; i++) {
+    GDTCOREvent *event = [[GDTCOREvent alloc] initWithMappingID:@"1" target:kGDTCORTargetTest];
+    event.dataObject = [[GDTCORDataObjectTesterSimple alloc] init];
+    [events addObject:event];
+  }
+  XCTestExpectation *writtenExpectation = [self expectationWithDescription:@"events written"];
+  XCTAssertNoThrow([self.transformer
+      transformEvents:events
+      withTransformers:nil
+            onComplete:^(NSUInteger writtenEventCount, NSError *_Nullable error) {
+              XCTAssertEqual(writtenEventCount, 3);
+              XCTAssertNil(error);
+              [writtenExpectation fulfill];
+            }]);
+
+  [self waitForExpectations:[bgTaskExpectations arrayByAddingObject:writtenExpectation]
+                    timeout:0.5];
+}
+
+/** Tests writing events in bulk with a transformer that nils out the events. */
+- (void)testWriteEventsWithTransformersThatNilTheEvents {
+  __auto_type bgTaskExpectations =
+      [self expectationsBackgroundTaskBeginAndEndWithName:@"GDTTransformer"];
+
+  GDTCOREvent *event = [[GDTCOREvent alloc] initWithMappingID:@"2" target:kGDTCORTargetTest];
+  event.dataObject = [[GDTCORDataObjectTesterSimple alloc] init];
+  NSArray<id<GDTCOREventTransformer>> *transformers =
+      @[ [[GDTCORTransformerTestNilingTransformer alloc] init] ];
+  XCTestExpectation *writtenExpectation = [self expectationWithDescription:@"events dropped"];
+  XCTAssertNoThrow([self.transformer
+      transformEvents:@[ event, [event copy] ]
+      withTransformers:transformers
+            onComplete:^(NSUInteger writtenEventCount, NSError *_Nullable error) {
+              XCTAssertEqual(writtenEventCount, 0);
+              [writtenExpectation fulfill];
+            }]);
+
+  [self waitForExpectations:[bgTaskExpectations arrayByAddingObject:writtenExpectation]
+                    timeout:0.5];
+}
+
 #pragma mark - Helpers
 
 /** Sets  GDTCORApplicationFake handlers to expect the begin and the end of a background task with
@@ -141,4 +141,30 @@ static int32_t kTestProductID = 123456;
   }
 }
 
+/** Tests sending data events in bulk. */
+- (void)testSendDataEvents {
+  GDTCORTransport *transport = [[GDTCORTransport alloc] initWithMappingID:@"1"
+                                                             transformers:nil
+                                                                   target:kGDTCORTargetTest];
+  transport.transformerInstance = [[GDTCORTransformerFake alloc] init];
+  NSArray<GDTCOREvent *> *events = @[
+    [transport eventForTransport], [transport eventForTransport],
+    [transport eventForTransportWithProductData:[[GDTCORProductData alloc]
+                                                    initWithProductID:kTestProductID]]
+  ];
+  for (GDTCOREvent *event in events) {
+    event.dataObject = [[GDTCORDataObjectTesterSimple alloc] init];
+  }
+
+  XCTestExpectation *writtenExpectation = [self expectationWithDescription:@"events written"];
+  XCTAssertNoThrow([transport
+      sendDataEvents:events
+          onComplete:^(NSUInteger writtenEventCount, NSError *_Nullable error) {
+            XCTAssertEqual(writtenEventCount, events.count);
+            XCTAssertNil(error);
+            [writtenExpectation fulfill];
+          }]);
+  [self waitForExpectations:@[ writtenExpectation ] timeout:10.0];
+}
+
 @end